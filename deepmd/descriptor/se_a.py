@@ -1,3 +1,4 @@
+import os
 from typing import (
     List,
     Optional,
@@ -205,6 +206,7 @@ class DescrptSeA(DescrptSe):
         self.compress = False
         self.embedding_net_variables = None
         self.mixed_prec = None
+        self.trim_nnei = False
         self.place_holders = {}
         self.nei_type = np.repeat(np.arange(self.ntypes), self.sel_a)  # like a mask
 
@@ -586,6 +588,11 @@ class DescrptSeA(DescrptSe):
             sel_a=self.sel_a,
             sel_r=self.sel_r,
         )
+        # the force and virial skip the neighbor slots that are padding in
+        # the whole batch, see TrimEnvMatA
+        self.trim_nnei = not nvnmd_cfg.enable and bool(
+            int(os.environ.get("DP_TRIM_NNEI", 0))
+        )
         # only used when tensorboard was set as true
         tf.summary.histogram("descrpt", self.descrpt)
         tf.summary.histogram("rij", self.rij)
@@ -642,19 +649,32 @@ class DescrptSeA(DescrptSe):
             net_deriv,
             [np.cast["int64"](-1), natoms[0] * np.cast["int64"](self.ndescrpt)],
         )
+        descrpt_deriv, rij, nlist = self.descrpt_deriv, self.rij, self.nlist
+        if self.trim_nnei:
+            descrpt_deriv, rij, nlist, sel_index = op_module.trim_env_mat_a(
+                descrpt_deriv, rij, nlist, natoms, sel_a=self.sel_a
+            )
+            net_deriv_reshape = tf.reshape(
+                tf.gather(
+                    tf.reshape(net_deriv_reshape, [-1, natoms[0], self.nnei, 4]),
+                    sel_index,
+                    axis=2,
+                ),
+                [-1, natoms[0] * tf.size(sel_index) * 4],
+            )
         force = op_module.prod_force_se_a(
             net_deriv_reshape,
-            self.descrpt_deriv,
-            self.nlist,
+            descrpt_deriv,
+            nlist,
             natoms,
             n_a_sel=self.nnei_a,
             n_r_sel=self.nnei_r,
         )
         virial, atom_virial = op_module.prod_virial_se_a(
             net_deriv_reshape,
-            self.descrpt_deriv,
-            self.rij,
-            self.nlist,
+            descrpt_deriv,
+            rij,
+            nlist,
             natoms,
             n_a_sel=self.nnei_a,
             n_r_sel=self.nnei_r,
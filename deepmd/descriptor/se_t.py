@@ -678,6 +678,8 @@ class DescrptSeT(DescrptSe):
                             ebd_env_ij,
                             env_ij,
                             last_layer_size=outputs_size[-1],
+                            # the neighbors of the same type make a symmetric env_ij
+                            symmetric=(type_i == type_j),
                         )
                     else:
                         # with (natom x nei_type_i x nei_type_j) x out_size
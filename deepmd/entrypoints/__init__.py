@@ -21,6 +21,9 @@ from .freeze import (
 from .neighbor_stat import (
     neighbor_stat,
 )
+from .table_prec import (
+    table_prec,
+)
 from .test import (
     test,
 )
@@ -44,4 +47,5 @@ __all__ = [
     "make_model_devi",
     "convert",
     "neighbor_stat",
+    "table_prec",
 ]
@@ -28,6 +28,9 @@ from deepmd.utils.graph import (
     get_tensor_by_name_from_graph,
     load_graph_def,
 )
+from deepmd.utils.table_prec import (
+    convert_table_bf16,
+)
 
 from .freeze import (
     freeze,
@@ -55,6 +58,7 @@ def compress(
     mpi_log: str,
     log_path: Optional[str],
     log_level: int,
+    table_prec: str = "high",
     **kwargs
 ):
     """Compress model.
@@ -87,6 +91,8 @@ def compress(
         if speccified log will be written to this file
     log_level : int
         logging level
+    table_prec : str
+        precision of the se_e2_a tables in the compressed model, high or bf16
     **kwargs
         additional arguments
     """
@@ -182,6 +188,15 @@ def compress(
             "increase the step size." % step
         ) from e
 
+    if table_prec == "bf16":
+        # stage 3: store the tables in bfloat16
+        log.info("\n\n")
+        log.info("stage 3: store the tables in bfloat16")
+        _, graph_def = load_graph_def(output)
+        graph_def = convert_table_bf16(graph_def)
+        with tf.gfile.GFile(output, "wb") as f:
+            f.write(graph_def.SerializeToString())
+
 
 def _check_compress_type(graph: tf.Graph):
     try:
@@ -25,6 +25,7 @@ from deepmd.entrypoints import (
     freeze,
     make_model_devi,
     neighbor_stat,
+    table_prec,
     test,
     train_dp,
     transfer,
@@ -405,6 +406,14 @@ def main_parser() -> argparse.ArgumentParser:
         default=None,
         help="The training script of the input frozen model",
     )
+    parser_compress.add_argument(
+        "--table-prec",
+        default="high",
+        choices=["high", "bf16"],
+        type=str,
+        help="The precision of the tables of the se_e2_a descriptor. The bf16 "
+        "tables are evaluated by CPU-only operators",
+    )
 
     # * print docs script **************************************************************
     parsers_doc = subparsers.add_parser(
@@ -543,6 +552,48 @@ def main_parser() -> argparse.ArgumentParser:
         help="treat all types as a single type. Used with se_atten descriptor.",
     )
 
+    # table_prec
+    parser_table_prec = subparsers.add_parser(
+        "table-prec",
+        parents=[parser_log],
+        help="Check the error of a compressed model with a low precision table",
+        formatter_class=RawTextArgumentDefaultsHelpFormatter,
+        epilog=textwrap.dedent(
+            """\
+        examples:
+            dp table-prec -m compressed.pb -s data -p bf16
+        """
+        ),
+    )
+    parser_table_prec.add_argument(
+        "-m",
+        "--model",
+        default="frozen_model_compressed.pb",
+        type=str,
+        help="Compressed frozen model file to import",
+    )
+    parser_table_prec.add_argument(
+        "-s",
+        "--system",
+        default=".",
+        type=str,
+        help="The system dir. Recursively detect systems in this directory",
+    )
+    parser_table_prec.add_argument(
+        "-S", "--set-prefix", default="set", type=str, help="The set prefix"
+    )
+    parser_table_prec.add_argument(
+        "-n", "--numb-test", default=10, type=int, help="The number of data for test"
+    )
+    parser_table_prec.add_argument(
+        "-p",
+        "--precision",
+        default="bf16",
+        choices=["bf16"],
+        type=str,
+        help="The precision of the table, see `dp compress --table-prec`",
+    )
+
     # --version
     parser.add_argument(
         "--version", action="version", version="DeePMD-kit v%s" % __version__
@@ -647,6 +698,8 @@ def main(args: Optional[List[str]] = None):
         convert(**dict_args)
     elif args.command == "neighbor-stat":
         neighbor_stat(**dict_args)
+    elif args.command == "table-prec":
+        table_prec(**dict_args)
     elif args.command == "train-nvnmd":  # nvnmd
         train_nvnmd(**dict_args)
     elif args.command is None:
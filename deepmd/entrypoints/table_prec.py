@@ -0,0 +1,104 @@
+"""Check the error of a compressed model with a low precision table."""
+import logging
+import os
+import tempfile
+
+import numpy as np
+
+from deepmd.common import (
+    expand_sys_str,
+)
+from deepmd.infer import (
+    DeepPot,
+)
+from deepmd.utils.data import (
+    DeepmdData,
+)
+from deepmd.utils.graph import (
+    load_graph_def,
+)
+from deepmd.utils.table_prec import (
+    convert_table_bf16,
+)
+
+__all__ = ["table_prec"]
+
+log = logging.getLogger(__name__)
+
+
+def table_prec(
+    *,
+    model: str,
+    system: str,
+    set_prefix: str,
+    numb_test: int,
+    precision: str,
+    **kwargs,
+):
+    """Report the error of a compressed model with a low precision table.
+
+    The energy, force and virial evaluated with the tables stored in precision,
+    as `dp compress --table-prec` does, are compared with those evaluated with
+    the tables of the model.
+
+    Parameters
+    ----------
+    model : str
+        the compressed frozen model
+    system : str
+        system directory
+    set_prefix : str
+        string prefix of set
+    numb_test : int
+        number of frames to test in each system
+    precision : str
+        the precision of the table, bf16
+    **kwargs
+        additional arguments
+
+    Raises
+    ------
+    RuntimeError
+        if no valid system was found, or the model has no se_e2_a table
+    """
+    all_sys = expand_sys_str(system)
+    if len(all_sys) == 0:
+        raise RuntimeError("Did not find valid system")
+    dp = DeepPot(model)
+    type_map = dp.get_type_map()
+    # the same conversion as `dp compress --table-prec`
+    _, graph_def = load_graph_def(model)
+    graph_def = convert_table_bf16(graph_def)
+    fd, low_model = tempfile.mkstemp(suffix=".pb")
+    try:
+        with os.fdopen(fd, "wb") as f:
+            f.write(graph_def.SerializeToString())
+        dp_low = DeepPot(low_model)
+    finally:
+        os.remove(low_model)
+    max_err_e = max_err_f = max_err_v = 0.0
+    for system in all_sys:
+        data = DeepmdData(system, set_prefix, type_map=type_map)
+        test_data = data.get_test()
+        nframes = min(test_data["box"].shape[0], numb_test)
+        coord = test_data["coord"][:nframes].reshape([nframes, -1])
+        box = test_data["box"][:nframes] if data.pbc else None
+        atype = test_data["type"][0]
+        natoms = atype.size
+        e0, f0, v0 = dp.eval(coord, box, atype)[:3]
+        e1, f1, v1 = dp_low.eval(coord, box, atype)[:3]
+        err_e = np.max(np.abs(e1 - e0)) / natoms
+        err_f = np.max(np.abs(f1 - f0))
+        err_v = np.max(np.abs(v1 - v0)) / natoms
+        log.info(f"# system : {system}")
+        log.info(f"Max energy error per atom : {err_e:e} eV")
+        log.info(f"Max force error           : {err_f:e} eV/A")
+        log.info(f"Max virial error per atom : {err_v:e} eV")
+        max_err_e = max(max_err_e, err_e)
+        max_err_f = max(max_err_f, err_f)
+        max_err_v = max(max_err_v, err_v)
+    log.info(f"# {precision} table of {len(all_sys)} systems")
+    log.info(f"Max energy error per atom : {max_err_e:e} eV")
+    log.info(f"Max force error           : {max_err_f:e} eV/A")
+    log.info(f"Max virial error per atom : {max_err_v:e} eV")
+    return max_err_e, max_err_f, max_err_v
@@ -305,6 +305,12 @@ def get_tf_session_config() -> Any:
         os.environ.get("DP_AUTO_PARALLELIZATION", 0)
     ):
         config.graph_options.rewrite_options.custom_optimizers.add().name = "dpparallel"
+    if (
+        Version(tf_py_version) >= Version("1.15")
+        and platform.system() != "Windows"
+        and int(os.environ.get("DP_OP_FUSION", 0))
+    ):
+        config.graph_options.rewrite_options.custom_optimizers.add().name = "dpfuse"
     return config
 
 
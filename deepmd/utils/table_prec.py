@@ -0,0 +1,145 @@
+"""Store the tables of a compressed model in a low precision."""
+from typing import (
+    Dict,
+    List,
+)
+
+import numpy as np
+
+from deepmd.env import (
+    tf,
+)
+from deepmd.utils.sess import (
+    run_sess,
+)
+
+__all__ = ["table_to_bf16", "convert_table_bf16"]
+
+# the se_a table ops and their counterparts on a bfloat16 table
+TABLE_BF16_OPS = {
+    "TabulateFusionSeA": "TabulateFusionSeABf16",
+    "TabulateFusionSeAGrad": "TabulateFusionSeABf16Grad",
+    "TabulateFusionSeAGradGrad": "TabulateFusionSeABf16GradGrad",
+}
+
+
+def table_to_bf16(table: np.ndarray) -> np.ndarray:
+    """Convert a se_a table to the coefficient-major bfloat16 table.
+
+    Parameters
+    ----------
+    table : np.ndarray
+        the table of TabulateFusionSeA, in the shape of
+        [nspline, last_layer_size * 6] with the 6 coefficients of each output
+        stored contiguously
+
+    Returns
+    -------
+    np.ndarray
+        the table in the shape of [nspline, 6 * last_layer_size] with the
+        outputs of each coefficient stored contiguously, rounded to the
+        nearest bfloat16 with ties to even, and stored as the upper 16 bits of
+        a float in uint16
+    """
+    nspline = table.shape[0]
+    last_layer_size = table.shape[1] // 6
+    table_cm = (
+        table.reshape([nspline, last_layer_size, 6])
+        .transpose([0, 2, 1])
+        .reshape([nspline, 6 * last_layer_size])
+    )
+    bits = np.ascontiguousarray(table_cm, dtype=np.float32).view(np.uint32)
+    bits = bits + np.uint32(0x7FFF) + ((bits >> np.uint32(16)) & np.uint32(1))
+    return (bits >> np.uint32(16)).astype(np.uint16)
+
+
+def _tensor_name(name: str) -> str:
+    return name if ":" in name else name + ":0"
+
+
+def _node_name(name: str) -> str:
+    return name.lstrip("^").split(":")[0]
+
+
+def convert_table_bf16(graph_def: tf.GraphDef) -> tf.GraphDef:
+    """Store the se_a tables of a compressed model in bfloat16.
+
+    The se_a table ops are replaced by the ops taking a bfloat16 table, which
+    is written into the graph as a constant. The tables in the precision of
+    the model are removed, so the model takes a quarter of the memory of a
+    double table. The polynomial is still evaluated in the precision of the
+    model.
+
+    Parameters
+    ----------
+    graph_def : tf.GraphDef
+        the graph_def of the compressed model
+
+    Returns
+    -------
+    tf.GraphDef
+        the graph_def with the bfloat16 tables
+
+    Raises
+    ------
+    RuntimeError
+        if the graph has no se_a table
+    """
+    nodes = [node for node in graph_def.node if node.op in TABLE_BF16_OPS]
+    if len(nodes) == 0:
+        raise RuntimeError(
+            "The model has no se_e2_a table in full precision, "
+            "please check if it is compressed or has been converted."
+        )
+    # the tables may be cast to the precision of the descriptor, so they are
+    # evaluated instead of read from the constants
+    with tf.Graph().as_default() as graph:
+        tf.import_graph_def(graph_def, name="")
+    tables: Dict[str, np.ndarray] = {}
+    with tf.Session(graph=graph) as sess:
+        for node in nodes:
+            name = _tensor_name(node.input[0])
+            if name not in tables:
+                tables[name] = run_sess(sess, graph.get_tensor_by_name(name))
+
+    node_names = {node.name for node in graph_def.node}
+    bf16_names: Dict[str, str] = {}
+    bf16_nodes: List[tf.NodeDef] = []
+    with tf.Graph().as_default() as graph:
+        for name, table in tables.items():
+            bf16_name = _node_name(name) + "_bf16"
+            while bf16_name in node_names:
+                bf16_name += "_"
+            node_names.add(bf16_name)
+            bf16_names[name] = bf16_name
+            tf.constant(table_to_bf16(table), dtype=tf.uint16, name=bf16_name)
+        bf16_nodes.extend(graph.as_graph_def().node)
+
+    new_graph_def = tf.GraphDef()
+    new_graph_def.CopyFrom(graph_def)
+    for node in new_graph_def.node:
+        if node.op in TABLE_BF16_OPS:
+            node.op = TABLE_BF16_OPS[node.op]
+            node.input[0] = bf16_names[_tensor_name(node.input[0])]
+    new_graph_def.node.extend(bf16_nodes)
+
+    # remove the tables in the precision of the model that are no longer used
+    removable = {_node_name(name) for name in tables}
+    while True:
+        used = {_node_name(name) for node in new_graph_def.node for name in node.input}
+        unused = [
+            node
+            for node in new_graph_def.node
+            if node.name in removable
+            and node.name not in used
+            and node.op in ("Const", "Identity", "Cast")
+        ]
+        if len(unused) == 0:
+            break
+        for node in unused:
+            removable.update(_node_name(name) for name in node.input)
+        unused_names = {node.name for node in unused}
+        kept = [node for node in new_graph_def.node if node.name not in unused_names]
+        del new_graph_def.node[:]
+        new_graph_def.node.extend(kept)
+    return new_graph_def
@@ -353,6 +353,126 @@ extern void DP_DeepPotComputeNListf2(DP_DeepPot* dp,
                                      float* atomic_energy,
                                      float* atomic_virial);
 
+/**
+ * @brief Evaluate only the energy by using a DP. The force and the virial are
+ *not computed. (double version)
+ * @param[in] dp The DP to use.
+ * @param[in] nframes The number of frames.
+ * @param[in] natoms The number of atoms.
+ * @param[in] coord The coordinates of atoms. The array should be of size
+ *nframes x natoms x 3.
+ * @param[in] atype The atom types. The array should contain natoms ints.
+ * @param[in] box The cell of the region. The array should be of size nframes x
+ *9. Pass NULL if pbc is not used.
+ * @param[in] fparam The frame parameters. The array should be of size nframes x
+ *dim_fparam. Pass NULL if not used.
+ * @param[in] aparam The atom parameters. The array should be of size nframes x
+ *nloc x dim_aparam. Pass NULL if not used.
+ * @param[out] energy Output energy. The array should be of size nframes.
+ **/
+extern void DP_DeepPotComputeEnergy(DP_DeepPot* dp,
+                                    const int nframes,
+                                    const int natom,
+                                    const double* coord,
+                                    const int* atype,
+                                    const double* cell,
+                                    const double* fparam,
+                                    const double* aparam,
+                                    double* energy);
+
+/**
+ * @brief Evaluate only the energy by using a DP. The force and the virial are
+ *not computed. (float version)
+ * @param[in] dp The DP to use.
+ * @param[in] nframes The number of frames.
+ * @param[in] natoms The number of atoms.
+ * @param[in] coord The coordinates of atoms. The array should be of size
+ *nframes x natoms x 3.
+ * @param[in] atype The atom types. The array should contain natoms ints.
+ * @param[in] box The cell of the region. The array should be of size nframes x
+ *9. Pass NULL if pbc is not used.
+ * @param[in] fparam The frame parameters. The array should be of size nframes x
+ *dim_fparam. Pass NULL if not used.
+ * @param[in] aparam The atom parameters. The array should be of size nframes x
+ *nloc x dim_aparam. Pass NULL if not used.
+ * @param[out] energy Output energy. The array should be of size nframes.
+ **/
+extern void DP_DeepPotComputeEnergyf(DP_DeepPot* dp,
+                                     const int nframes,
+                                     const int natom,
+                                     const float* coord,
+                                     const int* atype,
+                                     const float* cell,
+                                     const float* fparam,
+                                     const float* aparam,
+                                     double* energy);
+
+/**
+ * @brief Evaluate only the energy by using a DP with the neighbor list. The
+ *force and the virial are not computed. (double version)
+ * @param[in] dp The DP to use.
+ * @param[in] nframes The number of frames.
+ * @param[in] natoms The number of atoms.
+ * @param[in] coord The coordinates of atoms. The array should be of size
+ *nframes x natoms x 3.
+ * @param[in] atype The atom types. The array should contain natoms ints.
+ * @param[in] box The cell of the region. The array should be of size nframes x
+ *9. Pass NULL if pbc is not used.
+ * @param[in] nghost The number of ghost atoms.
+ * @param[in] nlist The neighbor list.
+ * @param[in] ago Update the internal neighbour list if ago is 0.
+ * @param[in] fparam The frame parameters. The array should be of size nframes x
+ *dim_fparam. Pass NULL if not used.
+ * @param[in] aparam The atom parameters. The array should be of size nframes x
+ *nloc x dim_aparam. Pass NULL if not used.
+ * @param[out] energy Output energy. The array should be of size nframes.
+ **/
+extern void DP_DeepPotComputeEnergyNList(DP_DeepPot* dp,
+                                         const int nframes,
+                                         const int natom,
+                                         const double* coord,
+                                         const int* atype,
+                                         const double* cell,
+                                         const int nghost,
+                                         const DP_Nlist* nlist,
+                                         const int ago,
+                                         const double* fparam,
+                                         const double* aparam,
+                                         double* energy);
+
+/**
+ * @brief Evaluate only the energy by using a DP with the neighbor list. The
+ *force and the virial are not computed. (float version)
+ * @param[in] dp The DP to use.
+ * @param[in] nframes The number of frames.
+ * @param[in] natoms The number of atoms.
+ * @param[in] coord The coordinates of atoms. The array should be of size
+ *nframes x natoms x 3.
+ * @param[in] atype The atom types. The array should contain natoms ints.
+ * @param[in] box The cell of the region. The array should be of size nframes x
+ *9. Pass NULL if pbc is not used.
+ * @param[in] nghost The number of ghost atoms.
+ * @param[in] nlist The neighbor list.
+ * @param[in] ago Update the internal neighbour list if ago is 0.
+ * @param[in] fparam The frame parameters. The array should be of size nframes x
+ *dim_fparam. Pass NULL if not used.
+ * @param[in] aparam The atom parameters. The array should be of size nframes x
+ *nloc x dim_aparam. Pass NULL if not used.
+ * @param[out] energy Output energy. The array should be of size nframes.
+ **/
+extern void DP_DeepPotComputeEnergyNListf(DP_DeepPot* dp,
+                                          const int nframes,
+                                          const int natom,
+                                          const float* coord,
+                                          const int* atype,
+                                          const float* cell,
+                                          const int nghost,
+                                          const DP_Nlist* nlist,
+                                          const int ago,
+                                          const float* fparam,
+                                          const float* aparam,
+                                          double* energy);
+
 /**
  * @brief Evaluate the energy, force and virial by using a DP with the mixed
  *type. (double version)
@@ -529,6 +649,32 @@ double DP_DeepPotModelDeviGetCutoff(DP_DeepPotModelDevi* dp);
  */
 int DP_DeepPotModelDeviGetNumbTypes(DP_DeepPotModelDevi* dp);
 
+/**
+ * @brief Get the statistics of the numbers of neighbors within the cutoff
+ *radius of a DP model deviation. They are sampled each time a neighbor list
+ *is given with ago = 0, against the coordinates of that call. The other calls
+ *collect nothing.
+ * @param[in] dp The DP model deviation to use.
+ * @param[out] max_nnei The maximal number of neighbors of each type. The array
+ *should be of size ntypes.
+ * @param[out] mean_nnei The mean number of neighbors of each type. The array
+ *should be of size ntypes.
+ * @param[out] noverflow The number of atoms with more neighbors of a type than
+ *the smallest sel of the models. The array should be of size ntypes.
+ * @return The number of sampled atoms.
+ */
+long long DP_DeepPotModelDeviGetNlistStats(DP_DeepPotModelDevi* dp,
+                                           int* max_nnei,
+                                           double* mean_nnei,
+                                           long long* noverflow);
+
+/**
+ * @brief Clear the statistics of the numbers of neighbors of a DP model
+ *deviation.
+ * @param[in] dp The DP model deviation to use.
+ */
+void DP_DeepPotModelDeviResetNlistStats(DP_DeepPotModelDevi* dp);
+
 /**
  * @brief Check if there is any exceptions throw.
  *
@@ -558,6 +704,33 @@ int DP_DeepPotGetNumbTypes(DP_DeepPot* dp);
  */
 const char* DP_DeepPotGetTypeMap(DP_DeepPot* dp);
 
+/**
+ * @brief Get the statistics of the numbers of neighbors within the cutoff
+ *radius of a DP. They are sampled each time the neighbor list is rebuilt,
+ *i.e. a neighbor list is given with ago = 0, or the Verlet skin is set and
+ *exceeded, against the coordinates of that call. The calls between the
+ *rebuilds, and the calls without a neighbor list if the skin is not set,
+ *collect nothing.
+ * @param[in] dp The DP to use.
+ * @param[out] max_nnei The maximal number of neighbors of each type. The array
+ *should be of size ntypes.
+ * @param[out] mean_nnei The mean number of neighbors of each type. The array
+ *should be of size ntypes.
+ * @param[out] noverflow The number of atoms with more neighbors of a type than
+ *sel, which are dropped by the model. The array should be of size ntypes.
+ * @return The number of sampled atoms.
+ */
+long long DP_DeepPotGetNlistStats(DP_DeepPot* dp,
+                                  int* max_nnei,
+                                  double* mean_nnei,
+                                  long long* noverflow);
+
+/**
+ * @brief Clear the statistics of the numbers of neighbors of a DP.
+ * @param[in] dp The DP to use.
+ */
+void DP_DeepPotResetNlistStats(DP_DeepPot* dp);
+
 /**
  * @brief The deep tensor.
  **/
@@ -151,6 +151,93 @@ inline void _DP_DeepPotComputeNList<float>(DP_DeepPot *dp,
                            atomic_energy, atomic_virial);
 }
 
+template <typename FPTYPE>
+inline void _DP_DeepPotComputeEnergy(DP_DeepPot *dp,
+                                     const int nframes,
+                                     const int natom,
+                                     const FPTYPE *coord,
+                                     const int *atype,
+                                     const FPTYPE *cell,
+                                     const FPTYPE *fparam,
+                                     const FPTYPE *aparam,
+                                     double *energy);
+
+template <>
+inline void _DP_DeepPotComputeEnergy<double>(DP_DeepPot *dp,
+                                             const int nframes,
+                                             const int natom,
+                                             const double *coord,
+                                             const int *atype,
+                                             const double *cell,
+                                             const double *fparam,
+                                             const double *aparam,
+                                             double *energy) {
+  DP_DeepPotComputeEnergy(dp, nframes, natom, coord, atype, cell, fparam,
+                          aparam, energy);
+}
+
+template <>
+inline void _DP_DeepPotComputeEnergy<float>(DP_DeepPot *dp,
+                                            const int nframes,
+                                            const int natom,
+                                            const float *coord,
+                                            const int *atype,
+                                            const float *cell,
+                                            const float *fparam,
+                                            const float *aparam,
+                                            double *energy) {
+  DP_DeepPotComputeEnergyf(dp, nframes, natom, coord, atype, cell, fparam,
+                           aparam, energy);
+}
+
+template <typename FPTYPE>
+inline void _DP_DeepPotComputeEnergyNList(DP_DeepPot *dp,
+                                          const int nframes,
+                                          const int natom,
+                                          const FPTYPE *coord,
+                                          const int *atype,
+                                          const FPTYPE *cell,
+                                          const int nghost,
+                                          const DP_Nlist *nlist,
+                                          const int ago,
+                                          const FPTYPE *fparam,
+                                          const FPTYPE *aparam,
+                                          double *energy);
+
+template <>
+inline void _DP_DeepPotComputeEnergyNList<double>(DP_DeepPot *dp,
+                                                  const int nframes,
+                                                  const int natom,
+                                                  const double *coord,
+                                                  const int *atype,
+                                                  const double *cell,
+                                                  const int nghost,
+                                                  const DP_Nlist *nlist,
+                                                  const int ago,
+                                                  const double *fparam,
+                                                  const double *aparam,
+                                                  double *energy) {
+  DP_DeepPotComputeEnergyNList(dp, nframes, natom, coord, atype, cell, nghost,
+                               nlist, ago, fparam, aparam, energy);
+}
+
+template <>
+inline void _DP_DeepPotComputeEnergyNList<float>(DP_DeepPot *dp,
+                                                 const int nframes,
+                                                 const int natom,
+                                                 const float *coord,
+                                                 const int *atype,
+                                                 const float *cell,
+                                                 const int nghost,
+                                                 const DP_Nlist *nlist,
+                                                 const int ago,
+                                                 const float *fparam,
+                                                 const float *aparam,
+                                                 double *energy) {
+  DP_DeepPotComputeEnergyNListf(dp, nframes, natom, coord, atype, cell, nghost,
+                                nlist, ago, fparam, aparam, energy);
+}
+
 template <typename FPTYPE>
 inline void _DP_DeepPotComputeMixedType(DP_DeepPot *dp,
                                         const int nframes,
@@ -774,6 +861,73 @@ class DeepPot {
         nullptr, nullptr, ener_, force_, virial_, atomic_ener_, atomic_virial_);
     DP_CHECK_OK(DP_DeepPotCheckOK, dp);
   };
+  /**
+   * @brief Evaluate only the energy by using this DP. The force and the virial
+   *are not computed.
+   * @param[out] ener The system energy.
+   * @param[in] coord The coordinates of atoms. The array should be of size
+   *nframes x natoms x 3.
+   * @param[in] atype The atom types. The list should contain natoms ints.
+   * @param[in] box The cell of the region. The array should be of size nframes
+   *x 9 (PBC) or empty (no PBC).
+   **/
+  template <typename VALUETYPE, typename ENERGYVTYPE>
+  void compute_energy(ENERGYVTYPE &ener,
+                      const std::vector<VALUETYPE> &coord,
+                      const std::vector<int> &atype,
+                      const std::vector<VALUETYPE> &box) {
+    unsigned int natoms = atype.size();
+    unsigned int nframes = coord.size() / natoms / 3;
+    assert(nframes * natoms * 3 == coord.size());
+    if (!box.empty()) {
+      assert(box.size() == nframes * 9);
+    }
+    const VALUETYPE *coord_ = &coord[0];
+    const VALUETYPE *box_ = !box.empty() ? &box[0] : nullptr;
+    const int *atype_ = &atype[0];
+    double *ener_ = _DP_Get_Energy_Pointer(ener, nframes);
+
+    _DP_DeepPotComputeEnergy<VALUETYPE>(dp, nframes, natoms, coord_, atype_,
+                                        box_, nullptr, nullptr, ener_);
+    DP_CHECK_OK(DP_DeepPotCheckOK, dp);
+  };
+  /**
+   * @brief Evaluate only the energy by using this DP with the neighbor list.
+   *The force and the virial are not computed.
+   * @param[out] ener The system energy.
+   * @param[in] coord The coordinates of atoms. The array should be of size
+   *nframes x natoms x 3.
+   * @param[in] atype The atom types. The list should contain natoms ints.
+   * @param[in] box The cell of the region. The array should be of size nframes
+   *x 9 (PBC) or empty (no PBC).
+   * @param[in] nghost The number of ghost atoms.
+   * @param[in] nlist The neighbor list.
+   * @param[in] ago Update the internal neighbour list if ago is 0.
+   **/
+  template <typename VALUETYPE, typename ENERGYVTYPE>
+  void compute_energy(ENERGYVTYPE &ener,
+                      const std::vector<VALUETYPE> &coord,
+                      const std::vector<int> &atype,
+                      const std::vector<VALUETYPE> &box,
+                      const int nghost,
+                      const InputNlist &lmp_list,
+                      const int &ago) {
+    unsigned int natoms = atype.size();
+    unsigned int nframes = coord.size() / natoms / 3;
+    assert(nframes * natoms * 3 == coord.size());
+    if (!box.empty()) {
+      assert(box.size() == nframes * 9);
+    }
+    const VALUETYPE *coord_ = &coord[0];
+    const VALUETYPE *box_ = !box.empty() ? &box[0] : nullptr;
+    const int *atype_ = &atype[0];
+    double *ener_ = _DP_Get_Energy_Pointer(ener, nframes);
+
+    _DP_DeepPotComputeEnergyNList<VALUETYPE>(dp, nframes, natoms, coord_,
+                                             atype_, box_, nghost, lmp_list.nl,
+                                             ago, nullptr, nullptr, ener_);
+    DP_CHECK_OK(DP_DeepPotCheckOK, dp);
+  };
   /**
    * @brief Evaluate the energy, force and virial by using this DP with the
    *mixed type.
@@ -879,6 +1033,38 @@ class DeepPot {
     assert(dp);
     return DP_DeepPotGetNumbTypes(dp);
   };
+  /**
+   * @brief Get the statistics of the numbers of neighbors within the cutoff
+   *radius.
+   * @details The statistics are sampled each time the neighbor list is
+   *rebuilt, i.e. a neighbor list is given with ago = 0, or the Verlet skin is
+   *set and exceeded, against the coordinates of that call. The calls between
+   *the rebuilds, and the calls without a neighbor list if the skin is not set,
+   *collect nothing.
+   * @param[out] max_nnei The maximal number of neighbors of each type.
+   * @param[out] mean_nnei The mean number of neighbors of each type.
+   * @param[out] noverflow The number of atoms with more neighbors of a type
+   *than sel.
+   * @return The number of sampled atoms.
+   **/
+  long long get_nlist_stats(std::vector<int> &max_nnei,
+                            std::vector<double> &mean_nnei,
+                            std::vector<long long> &noverflow) const {
+    assert(dp);
+    int ntypes = numb_types();
+    max_nnei.resize(ntypes);
+    mean_nnei.resize(ntypes);
+    noverflow.resize(ntypes);
+    return DP_DeepPotGetNlistStats(dp, &max_nnei[0], &mean_nnei[0],
+                                   &noverflow[0]);
+  };
+  /**
+   * @brief Clear the statistics of the numbers of neighbors.
+   **/
+  void reset_nlist_stats() {
+    assert(dp);
+    DP_DeepPotResetNlistStats(dp);
+  };
   /**
    * @brief Get the type map (element name of the atom types) of this model.
    * @param[out] type_map The type map of this model.
@@ -1083,6 +1269,36 @@ class DeepPotModelDevi {
     assert(dp);
     return DP_DeepPotModelDeviGetNumbTypes(dp);
   };
+  /**
+   * @brief Get the statistics of the numbers of neighbors within the cutoff
+   *radius.
+   * @details The statistics are sampled each time a neighbor list is given
+   *with ago = 0, against the coordinates of that call. The other calls collect
+   *nothing.
+   * @param[out] max_nnei The maximal number of neighbors of each type.
+   * @param[out] mean_nnei The mean number of neighbors of each type.
+   * @param[out] noverflow The number of atoms with more neighbors of a type
+   *than the smallest sel of the models.
+   * @return The number of sampled atoms.
+   **/
+  long long get_nlist_stats(std::vector<int> &max_nnei,
+                            std::vector<double> &mean_nnei,
+                            std::vector<long long> &noverflow) const {
+    assert(dp);
+    int ntypes = numb_types();
+    max_nnei.resize(ntypes);
+    mean_nnei.resize(ntypes);
+    noverflow.resize(ntypes);
+    return DP_DeepPotModelDeviGetNlistStats(dp, &max_nnei[0], &mean_nnei[0],
+                                            &noverflow[0]);
+  };
+  /**
+   * @brief Clear the statistics of the numbers of neighbors.
+   **/
+  void reset_nlist_stats() {
+    assert(dp);
+    DP_DeepPotModelDeviResetNlistStats(dp);
+  };
 
  private:
   DP_DeepPotModelDevi *dp;
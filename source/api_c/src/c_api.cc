@@ -1,5 +1,6 @@
 #include "c_api.h"
 
+#include <algorithm>
 #include <numeric>
 #include <string>
 #include <vector>
@@ -231,6 +232,74 @@ template void DP_DeepPotComputeNList_variant<float>(DP_DeepPot* dp,
                                                     float* atomic_energy,
                                                     float* atomic_virial);
 
+template <typename VALUETYPE>
+inline void DP_DeepPotComputeEnergy_variant(DP_DeepPot* dp,
+                                            const int nframes,
+                                            const int natoms,
+                                            const VALUETYPE* coord,
+                                            const int* atype,
+                                            const VALUETYPE* cell,
+                                            const int nghost,
+                                            const DP_Nlist* nlist,
+                                            const int ago,
+                                            const VALUETYPE* fparam,
+                                            const VALUETYPE* aparam,
+                                            double* energy) {
+  // init C++ vectors from C arrays
+  std::vector<VALUETYPE> coord_(coord, coord + nframes * natoms * 3);
+  std::vector<int> atype_(atype, atype + natoms);
+  std::vector<VALUETYPE> cell_;
+  if (cell) {
+    // pbc
+    cell_.assign(cell, cell + nframes * 9);
+  }
+  std::vector<VALUETYPE> fparam_, aparam_;
+  if (fparam) {
+    fparam_.assign(fparam, fparam + nframes * dp->dp.dim_fparam());
+  }
+  if (aparam) {
+    aparam_.assign(aparam,
+                   aparam + nframes * (natoms - nghost) * dp->dp.dim_aparam());
+  }
+  std::vector<double> e;
+
+  if (nlist) {
+    DP_REQUIRES_OK(dp, dp->dp.compute_energy(e, coord_, atype_, cell_, nghost,
+                                             nlist->nl, ago, fparam_, aparam_));
+  } else {
+    DP_REQUIRES_OK(
+        dp, dp->dp.compute_energy(e, coord_, atype_, cell_, fparam_, aparam_));
+  }
+  // copy from C++ vectors to C arrays, if not NULL pointer
+  if (energy) std::copy(e.begin(), e.end(), energy);
+}
+
+template void DP_DeepPotComputeEnergy_variant<double>(DP_DeepPot* dp,
+                                                      const int nframes,
+                                                      const int natoms,
+                                                      const double* coord,
+                                                      const int* atype,
+                                                      const double* cell,
+                                                      const int nghost,
+                                                      const DP_Nlist* nlist,
+                                                      const int ago,
+                                                      const double* fparam,
+                                                      const double* aparam,
+                                                      double* energy);
+
+template void DP_DeepPotComputeEnergy_variant<float>(DP_DeepPot* dp,
+                                                     const int nframes,
+                                                     const int natoms,
+                                                     const float* coord,
+                                                     const int* atype,
+                                                     const float* cell,
+                                                     const int nghost,
+                                                     const DP_Nlist* nlist,
+                                                     const int ago,
+                                                     const float* fparam,
+                                                     const float* aparam,
+                                                     double* energy);
+
 template <typename VALUETYPE>
 inline void DP_DeepPotComputeMixedType_variant(DP_DeepPot* dp,
                                                const int nframes,
@@ -835,6 +904,68 @@ void DP_DeepPotComputeNListf2(DP_DeepPot* dp,
       dp, nframes, natoms, coord, atype, cell, nghost, nlist, ago, fparam,
       aparam, energy, force, virial, atomic_energy, atomic_virial);
 }
+
+void DP_DeepPotComputeEnergy(DP_DeepPot* dp,
+                             const int nframes,
+                             const int natoms,
+                             const double* coord,
+                             const int* atype,
+                             const double* cell,
+                             const double* fparam,
+                             const double* aparam,
+                             double* energy) {
+  DP_DeepPotComputeEnergy_variant<double>(dp, nframes, natoms, coord, atype,
+                                          cell, 0, NULL, 0, fparam, aparam,
+                                          energy);
+}
+
+void DP_DeepPotComputeEnergyf(DP_DeepPot* dp,
+                              const int nframes,
+                              const int natoms,
+                              const float* coord,
+                              const int* atype,
+                              const float* cell,
+                              const float* fparam,
+                              const float* aparam,
+                              double* energy) {
+  DP_DeepPotComputeEnergy_variant<float>(dp, nframes, natoms, coord, atype,
+                                         cell, 0, NULL, 0, fparam, aparam,
+                                         energy);
+}
+
+void DP_DeepPotComputeEnergyNList(DP_DeepPot* dp,
+                                  const int nframes,
+                                  const int natoms,
+                                  const double* coord,
+                                  const int* atype,
+                                  const double* cell,
+                                  const int nghost,
+                                  const DP_Nlist* nlist,
+                                  const int ago,
+                                  const double* fparam,
+                                  const double* aparam,
+                                  double* energy) {
+  DP_DeepPotComputeEnergy_variant<double>(dp, nframes, natoms, coord, atype,
+                                          cell, nghost, nlist, ago, fparam,
+                                          aparam, energy);
+}
+
+void DP_DeepPotComputeEnergyNListf(DP_DeepPot* dp,
+                                   const int nframes,
+                                   const int natoms,
+                                   const float* coord,
+                                   const int* atype,
+                                   const float* cell,
+                                   const int nghost,
+                                   const DP_Nlist* nlist,
+                                   const int ago,
+                                   const float* fparam,
+                                   const float* aparam,
+                                   double* energy) {
+  DP_DeepPotComputeEnergy_variant<float>(dp, nframes, natoms, coord, atype,
+                                         cell, nghost, nlist, ago, fparam,
+                                         aparam, energy);
+}
 // end multiple frames
 
 void DP_DeepPotComputeMixedType(DP_DeepPot* dp,
@@ -883,6 +1014,28 @@ double DP_DeepPotGetCutoff(DP_DeepPot* dp) { return dp->dp.cutoff(); }
 
 int DP_DeepPotGetNumbTypes(DP_DeepPot* dp) { return dp->dp.numb_types(); }
 
+inline long long DP_GetNlistStats(const deepmd::NlistStats& stats,
+                                  int* max_nnei,
+                                  double* mean_nnei,
+                                  long long* noverflow) {
+  std::vector<double> mean_nnei_;
+  stats.get_mean_nnei(mean_nnei_);
+  std::copy(stats.max_nnei.begin(), stats.max_nnei.end(), max_nnei);
+  std::copy(mean_nnei_.begin(), mean_nnei_.end(), mean_nnei);
+  std::copy(stats.noverflow.begin(), stats.noverflow.end(), noverflow);
+  return stats.nsamples;
+}
+
+long long DP_DeepPotGetNlistStats(DP_DeepPot* dp,
+                                  int* max_nnei,
+                                  double* mean_nnei,
+                                  long long* noverflow) {
+  return DP_GetNlistStats(dp->dp.get_nlist_stats(), max_nnei, mean_nnei,
+                          noverflow);
+}
+
+void DP_DeepPotResetNlistStats(DP_DeepPot* dp) { dp->dp.reset_nlist_stats(); }
+
 const char* DP_DeepPotCheckOK(DP_DeepPot* dp) {
   return string_to_char(dp->exception);
 }
@@ -931,6 +1084,18 @@ int DP_DeepPotModelDeviGetNumbTypes(DP_DeepPotModelDevi* dp) {
   return dp->dp.numb_types();
 }
 
+long long DP_DeepPotModelDeviGetNlistStats(DP_DeepPotModelDevi* dp,
+                                           int* max_nnei,
+                                           double* mean_nnei,
+                                           long long* noverflow) {
+  return DP_GetNlistStats(dp->dp.get_nlist_stats(), max_nnei, mean_nnei,
+                          noverflow);
+}
+
+void DP_DeepPotModelDeviResetNlistStats(DP_DeepPotModelDevi* dp) {
+  dp->dp.reset_nlist_stats();
+}
+
 const char* DP_DeepPotModelDeviCheckOK(DP_DeepPotModelDevi* dp) {
   return string_to_char(dp->exception);
 }
@@ -10,6 +10,22 @@ class AtomMap {
   AtomMap();
   AtomMap(const std::vector<int>::const_iterator in_begin,
           const std::vector<int>::const_iterator in_end);
+  /**
+   * @brief Sort the atoms by type, and then by the Morton (Z-order) key of
+   * the cell they are in, so that atoms close in space are close in memory.
+   * @param[in] in_begin The begin of the atom types.
+   * @param[in] in_end The end of the atom types.
+   * @param[in] coord The coordinates of the atoms, at least natoms x 3.
+   * @param[in] box The simulation box, 9 or empty. If empty (or zero), the
+   * cells are taken in the bounding box of the atoms.
+   * @param[in] cell_size The size of the cells.
+   **/
+  template <typename VALUETYPE>
+  AtomMap(const std::vector<int>::const_iterator in_begin,
+          const std::vector<int>::const_iterator in_end,
+          const std::vector<VALUETYPE>& coord,
+          const std::vector<VALUETYPE>& box,
+          const double& cell_size);
   template <typename VALUETYPE>
   void forward(typename std::vector<VALUETYPE>::iterator out,
                const typename std::vector<VALUETYPE>::const_iterator in,
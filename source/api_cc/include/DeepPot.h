@@ -174,6 +174,64 @@ class DeepPot {
                const int& ago,
                const std::vector<VALUETYPE>& fparam = std::vector<VALUETYPE>(),
                const std::vector<VALUETYPE>& aparam = std::vector<VALUETYPE>());
+  /**
+   * @brief Evaluate only the energy by using this DP. The force and the virial
+   *are not computed, which is much cheaper than compute, e.g. for Monte Carlo.
+   * @param[out] ener The system energy.
+   * @param[in] coord The coordinates of atoms. The array should be of size
+   *nframes x natoms x 3.
+   * @param[in] atype The atom types. The list should contain natoms ints.
+   * @param[in] box The cell of the region. The array should be of size nframes
+   *x 9.
+   * @param[in] fparam The frame parameter. The array can be of size :
+   * nframes x dim_fparam.
+   * dim_fparam. Then all frames are assumed to be provided with the same
+   *fparam.
+   * @param[in] aparam The atomic parameter The array can be of size :
+   * nframes x natoms x dim_aparam.
+   * natoms x dim_aparam. Then all frames are assumed to be provided with the
+   *same aparam.
+   **/
+  template <typename VALUETYPE, typename ENERGYVTYPE>
+  void compute_energy(
+      ENERGYVTYPE& ener,
+      const std::vector<VALUETYPE>& coord,
+      const std::vector<int>& atype,
+      const std::vector<VALUETYPE>& box,
+      const std::vector<VALUETYPE>& fparam = std::vector<VALUETYPE>(),
+      const std::vector<VALUETYPE>& aparam = std::vector<VALUETYPE>());
+  /**
+   * @brief Evaluate only the energy by using this DP with the neighbor list.
+   *The force and the virial are not computed.
+   * @param[out] ener The system energy.
+   * @param[in] coord The coordinates of atoms. The array should be of size
+   *nframes x natoms x 3.
+   * @param[in] atype The atom types. The list should contain natoms ints.
+   * @param[in] box The cell of the region. The array should be of size nframes
+   *x 9.
+   * @param[in] nghost The number of ghost atoms.
+   * @param[in] inlist The input neighbour list.
+   * @param[in] ago Update the internal neighbour list if ago is 0.
+   * @param[in] fparam The frame parameter. The array can be of size :
+   * nframes x dim_fparam.
+   * dim_fparam. Then all frames are assumed to be provided with the same
+   *fparam.
+   * @param[in] aparam The atomic parameter The array can be of size :
+   * nframes x natoms x dim_aparam.
+   * natoms x dim_aparam. Then all frames are assumed to be provided with the
+   *same aparam.
+   **/
+  template <typename VALUETYPE, typename ENERGYVTYPE>
+  void compute_energy(
+      ENERGYVTYPE& ener,
+      const std::vector<VALUETYPE>& coord,
+      const std::vector<int>& atype,
+      const std::vector<VALUETYPE>& box,
+      const int nghost,
+      const InputNlist& inlist,
+      const int& ago,
+      const std::vector<VALUETYPE>& fparam = std::vector<VALUETYPE>(),
+      const std::vector<VALUETYPE>& aparam = std::vector<VALUETYPE>());
   /**
    * @brief Evaluate the energy, force, and virial with the mixed type
    *by using this DP.
@@ -281,6 +339,42 @@ class DeepPot {
    * @param[out] type_map The type map of this model.
    **/
   void get_type_map(std::string& type_map);
+  /**
+   * @brief Set the Verlet skin of the neighbor list built by DP when no
+   *external neighbor list is given.
+   * @details The neighbor list is built with the cutoff rcut + skin and is
+   *reused until an atom moves more than skin / 2 since the last build. It only
+   *applies to a single frame with the periodic boundary condition.
+   * @param[in] skin The skin distance. Non-positive values disable the reuse
+   *of the neighbor list, which is the default.
+   **/
+  void set_nlist_skin(const double& skin);
+  /**
+   * @brief Set whether the local atoms are sorted spatially.
+   * @details If enabled, the local atoms of each type are ordered along a
+   *Morton (Z-order) curve of their cells when the neighbor list is rebuilt,
+   *which improves the cache locality of large systems. The outputs are not
+   *affected.
+   * @param[in] spatial_sort Whether to sort the atoms spatially. The default
+   *is false.
+   **/
+  void set_spatial_sort(const bool& spatial_sort);
+  /**
+   * @brief Get the statistics of the numbers of neighbors within the cutoff
+   *radius.
+   * @details The statistics are sampled each time the neighbor list is
+   *rebuilt, i.e. a neighbor list is given with ago = 0, or the Verlet skin is
+   *set and exceeded, against the coordinates of that call. The calls between
+   *the rebuilds, and the calls without a neighbor list if the skin is not set,
+   *collect nothing. The overflows are counted if the sel of the model is
+   *known.
+   * @return The statistics of the numbers of neighbors.
+   **/
+  const NlistStats& get_nlist_stats() const { return nlist_stats; };
+  /**
+   * @brief Clear the statistics of the numbers of neighbors.
+   **/
+  void reset_nlist_stats();
 
  private:
   tensorflow::Session* session;
@@ -299,6 +393,8 @@ class DeepPot {
   int ntypes;
   int dfparam;
   int daparam;
+  // whether the model reduces the virial in the graph
+  bool has_o_virial;
   /**
    * @brief Validate the size of frame and atomic parameters.
    * @param[in] nframes The number of frames.
@@ -338,7 +434,22 @@ class DeepPot {
       const int nghost,
       const int& ago,
       const std::vector<VALUETYPE>& fparam = std::vector<VALUETYPE>(),
-      const std::vector<VALUETYPE>& aparam = std::vector<VALUETYPE>());
+      const std::vector<VALUETYPE>& aparam = std::vector<VALUETYPE>(),
+      const bool energy_only = false);
+  // the force and the virial are not computed if energy_only is true
+  template <typename VALUETYPE, typename ENERGYVTYPE>
+  void compute_nlist(ENERGYVTYPE& ener,
+                     std::vector<VALUETYPE>& force,
+                     std::vector<VALUETYPE>& virial,
+                     const std::vector<VALUETYPE>& coord,
+                     const std::vector<int>& atype,
+                     const std::vector<VALUETYPE>& box,
+                     const int nghost,
+                     const InputNlist& lmp_list,
+                     const int& ago,
+                     const std::vector<VALUETYPE>& fparam,
+                     const std::vector<VALUETYPE>& aparam,
+                     const bool energy_only);
 
   // copy neighbor list info from host
   bool init_nbor;
@@ -349,6 +460,49 @@ class DeepPot {
 
   // function used for neighbor list copy
   std::vector<int> get_sel_a() const;
+  // the real atoms in the external neighbor list, updated on rebuilds.
+  // real_identity is true if no atom is excluded.
+  std::vector<int> real_fwd_map, real_bkw_map;
+  int real_nghost;
+  bool real_identity;
+  template <typename VALUETYPE>
+  void update_real_atoms(const std::vector<VALUETYPE>& dcoord_,
+                         const std::vector<int>& datype_,
+                         const int nghost,
+                         const InputNlist& lmp_list);
+  // statistics of the numbers of neighbors
+  NlistStats nlist_stats;
+  // sort the local atoms along a space-filling curve
+  bool spatial_sort;
+  template <typename VALUETYPE>
+  void build_atom_map(const std::vector<int>& datype,
+                      const std::vector<VALUETYPE>& dcoord,
+                      const std::vector<VALUETYPE>& dbox,
+                      const int nloc);
+
+  // neighbor list with the Verlet skin, used if no nlist is given
+  double nlist_skin;
+  std::vector<int> skin_atype;
+  std::vector<int> skin_atype_cpy;
+  std::vector<int> skin_mapping;
+  std::vector<int> skin_image;
+  std::vector<double> skin_coord_cpy;
+  NeighborListData skin_nlist_data;
+  InputNlist skin_nlist;
+  /**
+   * @brief Update the extended coordinates of the skin neighbor list, and
+   *rebuild the list if any atom has moved more than half of the skin.
+   * @param[out] coord_cpy The extended coordinates.
+   * @param[in] coord The coordinates of local atoms.
+   * @param[in] atype The types of local atoms.
+   * @param[in] box The cell of the region.
+   * @return The ago for the neighbor list, 0 if it is rebuilt.
+   */
+  template <typename VALUETYPE>
+  int update_skin_nlist(std::vector<VALUETYPE>& coord_cpy,
+                        const std::vector<VALUETYPE>& coord,
+                        const std::vector<int>& atype,
+                        const std::vector<VALUETYPE>& box);
 };
 
 class DeepPotModelDevi {
@@ -488,6 +642,20 @@ class DeepPotModelDevi {
     assert(inited);
     return daparam;
   };
+  /**
+   * @brief Get the statistics of the numbers of neighbors within the cutoff
+   *radius.
+   * @details The statistics are sampled each time a neighbor list is given
+   *with ago = 0, against the coordinates of that call. The other calls collect
+   *nothing. The overflows are counted against the smallest sel of the models
+   *if the sel of all models is known.
+   * @return The statistics of the numbers of neighbors.
+   **/
+  const NlistStats& get_nlist_stats() const { return nlist_stats; };
+  /**
+   * @brief Clear the statistics of the numbers of neighbors.
+   **/
+  void reset_nlist_stats();
   /**
    * @brief Compute the average energy.
    * @param[out] dener The average energy.
@@ -576,6 +744,8 @@ class DeepPotModelDevi {
   int ntypes;
   int dfparam;
   int daparam;
+  // whether each model reduces the virial in the graph
+  std::vector<bool> has_o_virial;
   template <typename VALUETYPE>
   void validate_fparam_aparam(const int& nloc,
                               const std::vector<VALUETYPE>& fparam,
@@ -587,6 +757,7 @@ class DeepPotModelDevi {
   deepmd::AtomMap atommap;
   NeighborListData nlist_data;
   InputNlist nlist;
+  NlistStats nlist_stats;
 
   // function used for nborlist copy
   std::vector<std::vector<int> > get_sel() const;
@@ -19,11 +19,19 @@ namespace deepmd {
 
 typedef double ENERGYTYPE;
 
+/**
+ * @brief Neighbor list stored in the compressed sparse row (CSR) layout.
+ * @details The neighbors of the ii-th core region atom are
+ * jlist[jrange[ii]], ..., jlist[jrange[ii + 1] - 1].
+ **/
 struct NeighborListData {
   /// Array stores the core region atom's index
   std::vector<int> ilist;
-  /// Array stores the core region atom's neighbor index
-  std::vector<std::vector<int>> jlist;
+  /// Array stores the offset of each core region atom's neighbors in jlist,
+  /// of size inum + 1
+  std::vector<int> jrange;
+  /// Array stores the neighbor index of all core region atoms contiguously
+  std::vector<int> jlist;
   /// Array stores the number of neighbors of core region atoms
   std::vector<int> numneigh;
   /// Array stores the the location of the first neighbor of core region atoms
@@ -37,6 +45,53 @@ struct NeighborListData {
   void make_inlist(InputNlist& inlist);
 };
 
+/**
+ * @brief Statistics of the numbers of neighbors within the cutoff radius,
+ *accumulated over the atoms of the sampled neighbor lists. DeepPot samples
+ *the neighbor lists when they are rebuilt, see DeepPot::get_nlist_stats.
+ * @details The neighbors of a type beyond sel are dropped by the model, and
+ *the slots of sel not taken by any neighbor are padding.
+ **/
+struct NlistStats {
+  /// The number of sampled atoms
+  long long nsamples;
+  /// The numbers of selected neighbors of each type, empty if unknown
+  std::vector<int> sel;
+  /// The maximal number of neighbors of each type
+  std::vector<int> max_nnei;
+  /// The total number of neighbors of each type
+  std::vector<long long> sum_nnei;
+  /// The number of atoms with more neighbors of a type than sel
+  std::vector<long long> noverflow;
+
+ public:
+  NlistStats() : nsamples(0) {}
+  /**
+   * @brief Clear the statistics.
+   * @param[in] ntypes The number of types.
+   * @param[in] sel The numbers of selected neighbors of each type. It is
+   *ignored if its size is not ntypes.
+   **/
+  void reset(const int& ntypes, const std::vector<int>& sel);
+  /**
+   * @brief Get the mean number of neighbors of each type.
+   * @param[out] mean_nnei The mean number of neighbors of each type.
+   **/
+  void get_mean_nnei(std::vector<double>& mean_nnei) const;
+  /**
+   * @brief Accumulate the statistics of a neighbor list.
+   * @param[in] nlist_data The neighbor list.
+   * @param[in] coord The coordinates of the first frame.
+   * @param[in] atype The atom types.
+   * @param[in] rcut The cutoff radius.
+   **/
+  template <typename VALUETYPE>
+  void update(const NeighborListData& nlist_data,
+              const std::vector<VALUETYPE>& coord,
+              const std::vector<int>& atype,
+              const double& rcut);
+};
+
 /**
  * @brief Check if the model version is supported.
  * @param[in] model_version The model version.
@@ -62,6 +117,22 @@ void select_real_atoms(std::vector<int>& fwd_map,
                        const int& nghost,
                        const int& ntypes);
 
+/**
+ * @brief Exclude the ghost atoms that are not in the neighbor list.
+ * @details The selected atoms keep their order, so the maps can be used in
+ *the same way as those of select_real_atoms.
+ * @param[in,out] fwd_map The forward map, updated in place.
+ * @param[in,out] bkw_map The backward map, updated in place.
+ * @param[in,out] nghost_real The number of selected ghost atoms.
+ * @param[in] inlist The neighbor list in the original index.
+ * @param[in] nloc The number of local atoms.
+ **/
+void prune_ghost_atoms(std::vector<int>& fwd_map,
+                       std::vector<int>& bkw_map,
+                       int& nghost_real,
+                       const InputNlist& inlist,
+                       const int& nloc);
+
 template <typename VT>
 void select_map(std::vector<VT>& out,
                 const std::vector<VT>& in,
@@ -166,6 +237,15 @@ int session_get_dtype(tensorflow::Session* session,
                       const std::string name,
                       const std::string scope = "");
 
+/**
+ * @brief Check if a node exists in the graph.
+ * @param[in] graph_def The graph.
+ * @param[in] name The name of the node.
+ * @return Whether the node exists.
+ **/
+bool graph_has_node(const tensorflow::GraphDef& graph_def,
+                    const std::string& name);
+
 /**
  * @brief Get input tensors.
  * @param[out] input_tensors Input tensors.
@@ -2,6 +2,11 @@
 
 #include <algorithm>
 #include <cassert>
+#include <cmath>
+#include <cstdint>
+
+#include "coord.h"
+#include "region.h"
 
 using namespace deepmd;
 
@@ -26,6 +31,91 @@ AtomMap::AtomMap(const std::vector<int>::const_iterator in_begin,
   }
 }
 
+// spread the lower 21 bits of x so that there are two zeros between bits
+static inline uint64_t morton_spread(uint64_t x) {
+  x &= 0x1fffff;
+  x = (x | x << 32) & 0x1f00000000ffffULL;
+  x = (x | x << 16) & 0x1f0000ff0000ffULL;
+  x = (x | x << 8) & 0x100f00f00f00f00fULL;
+  x = (x | x << 4) & 0x10c30c30c30c30c3ULL;
+  x = (x | x << 2) & 0x1249249249249249ULL;
+  return x;
+}
+
+template <typename VALUETYPE>
+AtomMap::AtomMap(const std::vector<int>::const_iterator in_begin,
+                 const std::vector<int>::const_iterator in_end,
+                 const std::vector<VALUETYPE>& coord,
+                 const std::vector<VALUETYPE>& box,
+                 const double& cell_size) {
+  int natoms = in_end - in_begin;
+  assert(coord.size() >= natoms * 3);
+  // cell index of each atom in terms of the internal coordinates
+  std::vector<double> posi(natoms * 3);
+  int ncell[3];
+  Region<double> region;
+  bool pbc = false;
+  if (box.size() == 9) {
+    std::vector<double> boxt(box.begin(), box.end());
+    init_region_cpu(region, &boxt[0]);
+    pbc = volume_cpu(region) != 0.;
+  }
+  if (pbc) {
+    int cell_info[23];
+    compute_cell_info(cell_info, cell_size, region);
+    for (int dd = 0; dd < 3; ++dd) {
+      ncell[dd] = cell_info[3 + dd];
+    }
+    for (int ii = 0; ii < natoms; ++ii) {
+      double rp[3] = {coord[ii * 3 + 0], coord[ii * 3 + 1], coord[ii * 3 + 2]};
+      convert_to_inter_cpu(&posi[ii * 3], region, rp);
+    }
+  } else {
+    double lower[3], upper[3];
+    for (int dd = 0; dd < 3; ++dd) {
+      lower[dd] = upper[dd] = natoms > 0 ? coord[dd] : 0.;
+    }
+    for (int ii = 0; ii < natoms; ++ii) {
+      for (int dd = 0; dd < 3; ++dd) {
+        lower[dd] = std::min(lower[dd], (double)coord[ii * 3 + dd]);
+        upper[dd] = std::max(upper[dd], (double)coord[ii * 3 + dd]);
+      }
+    }
+    for (int dd = 0; dd < 3; ++dd) {
+      ncell[dd] = (upper[dd] - lower[dd]) / cell_size;
+      if (ncell[dd] == 0) ncell[dd] = 1;
+      for (int ii = 0; ii < natoms; ++ii) {
+        posi[ii * 3 + dd] = (coord[ii * 3 + dd] - lower[dd]) /
+                            (upper[dd] - lower[dd] + cell_size);
+      }
+    }
+  }
+
+  atype.resize(natoms);
+  // sort by (type, Morton key, index)
+  std::vector<std::pair<std::pair<int, uint64_t>, int> > sorting(natoms);
+  std::vector<int>::const_iterator iter = in_begin;
+  for (int ii = 0; ii < natoms; ++ii) {
+    uint64_t key = 0;
+    for (int dd = 0; dd < 3; ++dd) {
+      // atoms slightly out of the box are wrapped into it
+      int idx = floor(posi[ii * 3 + dd] * ncell[dd]);
+      idx %= ncell[dd];
+      if (idx < 0) idx += ncell[dd];
+      key |= morton_spread(idx) << dd;
+    }
+    sorting[ii] = std::make_pair(std::make_pair(*(iter++), key), ii);
+  }
+  sort(sorting.begin(), sorting.end());
+  idx_map.resize(natoms);
+  fwd_idx_map.resize(natoms);
+  for (unsigned ii = 0; ii < idx_map.size(); ++ii) {
+    idx_map[ii] = sorting[ii].second;
+    fwd_idx_map[sorting[ii].second] = ii;
+    atype[ii] = sorting[ii].first.first;
+  }
+}
+
 template <typename VALUETYPE>
 void AtomMap::forward(typename std::vector<VALUETYPE>::iterator out,
                       const typename std::vector<VALUETYPE>::const_iterator in,
@@ -64,6 +154,20 @@ void AtomMap::backward(typename std::vector<VALUETYPE>::iterator out,
   }
 }
 
+template AtomMap::AtomMap(
+    const std::vector<int>::const_iterator in_begin,
+    const std::vector<int>::const_iterator in_end,
+    const std::vector<double>& coord,
+    const std::vector<double>& box,
+    const double& cell_size);
+
+template AtomMap::AtomMap(
+    const std::vector<int>::const_iterator in_begin,
+    const std::vector<int>::const_iterator in_end,
+    const std::vector<float>& coord,
+    const std::vector<float>& box,
+    const double& cell_size);
+
 template void AtomMap::forward<double>(
     typename std::vector<double>::iterator out,
     const typename std::vector<double>::const_iterator in,
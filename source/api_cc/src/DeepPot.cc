@@ -1,8 +1,13 @@
 #include "DeepPot.h"
 
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <cstdlib>
 #include <stdexcept>
 
 #include "AtomMap.h"
+#include "coord.h"
 #include "device.h"
 
 using namespace tensorflow;
@@ -18,6 +23,23 @@ static std::vector<int> cum_sum(const std::vector<int32>& n_sel) {
   return sec;
 }
 
+// fuse ProdForceSeA and ProdVirialSeA of the loaded graph into
+// ProdForceVirialSeA on CPUs, and skip the outputs that are not used, see
+// source/op/optimizer/fuse.cc. It is enabled by setting DP_OP_FUSION=1.
+static void set_op_fusion(SessionOptions& options) {
+#if !defined(_WIN32) && \
+    (TF_MAJOR_VERSION >= 2 || (TF_MAJOR_VERSION == 1 && TF_MINOR_VERSION >= 15))
+  const char* env_op_fusion = std::getenv("DP_OP_FUSION");
+  if (!env_op_fusion || std::string(env_op_fusion) == "0") {
+    return;
+  }
+  options.config.mutable_graph_options()
+      ->mutable_rewrite_options()
+      ->add_custom_optimizers()
+      ->set_name("dpfuse");
+#endif
+}
+
 // start multiple frames
 
 template <typename MODELTYPE, typename VALUETYPE>
@@ -29,7 +51,8 @@ static void run_model(
     const std::vector<std::pair<std::string, Tensor>>& input_tensors,
     const AtomMap& atommap,
     const int nframes,
-    const int nghost = 0) {
+    const int nghost = 0,
+    const bool has_o_virial = false) {
   unsigned nloc = atommap.get_type().size();
   unsigned nall = nloc + nghost;
   dener.resize(nframes);
@@ -45,17 +68,19 @@ static void run_model(
   }
 
   std::vector<Tensor> output_tensors;
-  check_status(session->Run(
-      input_tensors, {"o_energy", "o_force", "o_atom_energy", "o_atom_virial"},
-      {}, &output_tensors));
+  // the virial is reduced in the graph if the model has it, otherwise it is
+  // summed from the atomic virial
+  const std::string virial_name = has_o_virial ? "o_virial" : "o_atom_virial";
+  check_status(session->Run(input_tensors, {"o_energy", "o_force", virial_name},
+                            {}, &output_tensors));
 
   Tensor output_e = output_tensors[0];
   Tensor output_f = output_tensors[1];
-  Tensor output_av = output_tensors[3];
+  Tensor output_v = output_tensors[2];
 
   auto oe = output_e.flat<ENERGYTYPE>();
   auto of = output_f.flat<MODELTYPE>();
-  auto oav = output_av.flat<MODELTYPE>();
+  auto ov = output_v.flat<MODELTYPE>();
 
   std::vector<VALUETYPE> dforce(nframes * 3 * nall);
   dvirial.resize(nframes * 9);
@@ -65,19 +90,19 @@ static void run_model(
   for (unsigned ii = 0; ii < nframes * nall * 3; ++ii) {
     dforce[ii] = of(ii);
   }
-  // set dvirial to zero, prevent input vector is not zero (#1123)
-  std::fill(dvirial.begin(), dvirial.end(), (VALUETYPE)0.);
-  for (int kk = 0; kk < nframes; ++kk) {
-    for (int ii = 0; ii < nall; ++ii) {
-      dvirial[kk * 9 + 0] += (VALUETYPE)1.0 * oav(kk * nall * 9 + 9 * ii + 0);
-      dvirial[kk * 9 + 1] += (VALUETYPE)1.0 * oav(kk * nall * 9 + 9 * ii + 1);
-      dvirial[kk * 9 + 2] += (VALUETYPE)1.0 * oav(kk * nall * 9 + 9 * ii + 2);
-      dvirial[kk * 9 + 3] += (VALUETYPE)1.0 * oav(kk * nall * 9 + 9 * ii + 3);
-      dvirial[kk * 9 + 4] += (VALUETYPE)1.0 * oav(kk * nall * 9 + 9 * ii + 4);
-      dvirial[kk * 9 + 5] += (VALUETYPE)1.0 * oav(kk * nall * 9 + 9 * ii + 5);
-      dvirial[kk * 9 + 6] += (VALUETYPE)1.0 * oav(kk * nall * 9 + 9 * ii + 6);
-      dvirial[kk * 9 + 7] += (VALUETYPE)1.0 * oav(kk * nall * 9 + 9 * ii + 7);
-      dvirial[kk * 9 + 8] += (VALUETYPE)1.0 * oav(kk * nall * 9 + 9 * ii + 8);
+  if (has_o_virial) {
+    for (int ii = 0; ii < nframes * 9; ++ii) {
+      dvirial[ii] = ov(ii);
+    }
+  } else {
+    // set dvirial to zero, prevent input vector is not zero (#1123)
+    std::fill(dvirial.begin(), dvirial.end(), (VALUETYPE)0.);
+    for (int kk = 0; kk < nframes; ++kk) {
+      for (int ii = 0; ii < nall; ++ii) {
+        for (int dd = 0; dd < 9; ++dd) {
+          dvirial[kk * 9 + dd] += ov(kk * nall * 9 + 9 * ii + dd);
+        }
+      }
     }
   }
   dforce_ = dforce;
@@ -93,7 +118,8 @@ template void run_model<double, double>(
     const std::vector<std::pair<std::string, Tensor>>& input_tensors,
     const AtomMap& atommap,
     const int nframes,
-    const int nghost);
+    const int nghost,
+    const bool has_o_virial);
 
 template void run_model<double, float>(
     std::vector<ENERGYTYPE>& dener,
@@ -103,7 +129,8 @@ template void run_model<double, float>(
     const std::vector<std::pair<std::string, Tensor>>& input_tensors,
     const AtomMap& atommap,
     const int nframes,
-    const int nghost);
+    const int nghost,
+    const bool has_o_virial);
 
 template void run_model<float, double>(
     std::vector<ENERGYTYPE>& dener,
@@ -113,7 +140,8 @@ template void run_model<float, double>(
     const std::vector<std::pair<std::string, Tensor>>& input_tensors,
     const AtomMap& atommap,
     const int nframes,
-    const int nghost);
+    const int nghost,
+    const bool has_o_virial);
 
 template void run_model<float, float>(
     std::vector<ENERGYTYPE>& dener,
@@ -123,7 +151,32 @@ template void run_model<float, float>(
     const std::vector<std::pair<std::string, Tensor>>& input_tensors,
     const AtomMap& atommap,
     const int nframes,
-    const int nghost);
+    const int nghost,
+    const bool has_o_virial);
+
+// only the energy is fetched, so that the graphs of the force and the virial
+// are not evaluated
+static void run_model_energy(
+    std::vector<ENERGYTYPE>& dener,
+    Session* session,
+    const std::vector<std::pair<std::string, Tensor>>& input_tensors,
+    const AtomMap& atommap,
+    const int nframes) {
+  unsigned nloc = atommap.get_type().size();
+  dener.resize(nframes);
+  if (nloc == 0) {
+    std::fill(dener.begin(), dener.end(), (ENERGYTYPE)0.);
+    return;
+  }
+
+  std::vector<Tensor> output_tensors;
+  check_status(session->Run(input_tensors, {"o_energy"}, {}, &output_tensors));
+
+  auto oe = output_tensors[0].flat<ENERGYTYPE>();
+  for (int ii = 0; ii < nframes; ++ii) {
+    dener[ii] = oe(ii);
+  }
+}
 
 template <typename MODELTYPE, typename VALUETYPE>
 static void run_model(
@@ -286,12 +339,14 @@ static void run_model(
     const std::vector<std::pair<std::string, Tensor>>& input_tensors,
     const AtomMap& atommap,
     const int nframes = 1,
-    const int nghost = 0) {
+    const int nghost = 0,
+    const bool has_o_virial = false) {
   assert(nframes == 1);
   std::vector<ENERGYTYPE> dener_(1);
   // call multi-frame version
   run_model<MODELTYPE, VALUETYPE>(dener_, dforce_, dvirial, session,
-                                  input_tensors, atommap, nframes, nghost);
+                                  input_tensors, atommap, nframes, nghost,
+                                  has_o_virial);
   dener = dener_[0];
 }
 
@@ -303,7 +358,8 @@ template void run_model<double, double>(
     const std::vector<std::pair<std::string, Tensor>>& input_tensors,
     const AtomMap& atommap,
     const int nframes,
-    const int nghost);
+    const int nghost,
+    const bool has_o_virial);
 
 template void run_model<double, float>(
     ENERGYTYPE& dener,
@@ -313,7 +369,8 @@ template void run_model<double, float>(
     const std::vector<std::pair<std::string, Tensor>>& input_tensors,
     const AtomMap& atommap,
     const int nframes,
-    const int nghost);
+    const int nghost,
+    const bool has_o_virial);
 
 template void run_model<float, double>(
     ENERGYTYPE& dener,
@@ -323,7 +380,8 @@ template void run_model<float, double>(
     const std::vector<std::pair<std::string, Tensor>>& input_tensors,
     const AtomMap& atommap,
     const int nframes,
-    const int nghost);
+    const int nghost,
+    const bool has_o_virial);
 
 template void run_model<float, float>(
     ENERGYTYPE& dener,
@@ -333,7 +391,8 @@ template void run_model<float, float>(
     const std::vector<std::pair<std::string, Tensor>>& input_tensors,
     const AtomMap& atommap,
     const int nframes,
-    const int nghost);
+    const int nghost,
+    const bool has_o_virial);
 
 template <typename MODELTYPE, typename VALUETYPE>
 static void run_model(
@@ -404,15 +463,57 @@ template void run_model<float, float>(
     const int& nframes,
     const int& nghost);
 
+static void run_model_energy(
+    ENERGYTYPE& dener,
+    Session* session,
+    const std::vector<std::pair<std::string, Tensor>>& input_tensors,
+    const AtomMap& atommap,
+    const int nframes = 1) {
+  assert(nframes == 1);
+  std::vector<ENERGYTYPE> dener_(1);
+  // call multi-frame version
+  run_model_energy(dener_, session, input_tensors, atommap, nframes);
+  dener = dener_[0];
+}
+
 // end single frame
 
+template <typename VALUETYPE>
+static void fold_back(std::vector<VALUETYPE>& out,
+                      const std::vector<VALUETYPE>& in,
+                      const std::vector<int>& mapping,
+                      const int nloc,
+                      const int ndim) {
+  out.resize(nloc * ndim);
+  std::fill(out.begin(), out.end(), (VALUETYPE)0.);
+  for (int ii = 0; ii < mapping.size(); ++ii) {
+    for (int dd = 0; dd < ndim; ++dd) {
+      out[mapping[ii] * ndim + dd] += in[ii * ndim + dd];
+    }
+  }
+}
+
 DeepPot::DeepPot()
-    : inited(false), init_nbor(false), graph_def(new GraphDef()) {}
+    : inited(false),
+      has_o_virial(false),
+      init_nbor(false),
+      graph_def(new GraphDef()),
+      real_nghost(0),
+      real_identity(false),
+      spatial_sort(false),
+      nlist_skin(0.) {}
 
 DeepPot::DeepPot(const std::string& model,
                  const int& gpu_rank,
                  const std::string& file_content)
-    : inited(false), init_nbor(false), graph_def(new GraphDef()) {
+    : inited(false),
+      has_o_virial(false),
+      init_nbor(false),
+      graph_def(new GraphDef()),
+      real_nghost(0),
+      real_identity(false),
+      spatial_sort(false),
+      nlist_skin(0.) {
   init(model, gpu_rank, file_content);
 }
 
@@ -431,6 +532,7 @@ void DeepPot::init(const std::string& model,
   get_env_nthreads(num_intra_nthreads, num_inter_nthreads);
   options.config.set_inter_op_parallelism_threads(num_inter_nthreads);
   options.config.set_intra_op_parallelism_threads(num_intra_nthreads);
+  set_op_fusion(options);
   deepmd::load_op_library();
 
   if (file_content.size() == 0)
@@ -466,6 +568,7 @@ void DeepPot::init(const std::string& model,
   if (dfparam < 0) dfparam = 0;
   if (daparam < 0) daparam = 0;
   model_type = get_scalar<STRINGTYPE>("model_attr/model_type");
+  has_o_virial = graph_has_node(*graph_def, "o_virial");
   try {
     model_version = get_scalar<STRINGTYPE>("model_attr/model_version");
   } catch (deepmd::tf_exception& e) {
@@ -478,6 +581,7 @@ void DeepPot::init(const std::string& model,
                                    global_model_version + " supported ");
   }
   inited = true;
+  reset_nlist_stats();
 
   init_nbor = false;
 }
@@ -611,6 +715,14 @@ void DeepPot::compute(ENERGYVTYPE& dener,
   int nall = datype_.size();
   int nframes = dcoord_.size() / nall / 3;
   int nloc = nall;
+  if (nlist_skin > 0. && nframes == 1 && dbox.size() == 9) {
+    std::vector<VALUETYPE> dcoord_cpy, dforce_cpy;
+    int ago = update_skin_nlist(dcoord_cpy, dcoord_, datype_, dbox);
+    compute(dener, dforce_cpy, dvirial, dcoord_cpy, skin_atype_cpy, dbox,
+            skin_atype_cpy.size() - nloc, skin_nlist, ago, fparam_, aparam_);
+    fold_back(dforce_, dforce_cpy, skin_mapping, nloc, 3);
+    return;
+  }
   atommap = deepmd::AtomMap(datype_.begin(), datype_.begin() + nloc);
   assert(nloc == atommap.get_type().size());
   std::vector<VALUETYPE> fparam;
@@ -627,14 +739,14 @@ void DeepPot::compute(ENERGYVTYPE& dener,
                                       dbox, cell_size, fparam, aparam, atommap);
     assert(ret == nloc);
     run_model<double>(dener, dforce_, dvirial, session, input_tensors, atommap,
-                      nframes);
+                      nframes, 0, has_o_virial);
   } else {
     int ret =
         session_input_tensors<float>(input_tensors, dcoord_, ntypes, datype_,
                                      dbox, cell_size, fparam, aparam, atommap);
     assert(ret == nloc);
     run_model<float>(dener, dforce_, dvirial, session, input_tensors, atommap,
-                     nframes);
+                     nframes, 0, has_o_virial);
   }
 }
 
@@ -690,13 +802,101 @@ void DeepPot::compute(ENERGYVTYPE& dener,
                       const int& ago,
                       const std::vector<VALUETYPE>& fparam_,
                       const std::vector<VALUETYPE>& aparam__) {
+  compute_nlist(dener, dforce_, dvirial, dcoord_, datype_, dbox, nghost,
+                lmp_list, ago, fparam_, aparam__, false);
+}
+
+template void DeepPot::compute<double, ENERGYTYPE>(
+    ENERGYTYPE& dener,
+    std::vector<double>& dforce_,
+    std::vector<double>& dvirial,
+    const std::vector<double>& dcoord_,
+    const std::vector<int>& datype_,
+    const std::vector<double>& dbox,
+    const int nghost,
+    const InputNlist& lmp_list,
+    const int& ago,
+    const std::vector<double>& fparam,
+    const std::vector<double>& aparam_);
+
+template void DeepPot::compute<float, ENERGYTYPE>(
+    ENERGYTYPE& dener,
+    std::vector<float>& dforce_,
+    std::vector<float>& dvirial,
+    const std::vector<float>& dcoord_,
+    const std::vector<int>& datype_,
+    const std::vector<float>& dbox,
+    const int nghost,
+    const InputNlist& lmp_list,
+    const int& ago,
+    const std::vector<float>& fparam,
+    const std::vector<float>& aparam_);
+
+template void DeepPot::compute<double, std::vector<ENERGYTYPE>>(
+    std::vector<ENERGYTYPE>& dener,
+    std::vector<double>& dforce_,
+    std::vector<double>& dvirial,
+    const std::vector<double>& dcoord_,
+    const std::vector<int>& datype_,
+    const std::vector<double>& dbox,
+    const int nghost,
+    const InputNlist& lmp_list,
+    const int& ago,
+    const std::vector<double>& fparam,
+    const std::vector<double>& aparam_);
+
+template void DeepPot::compute<float, std::vector<ENERGYTYPE>>(
+    std::vector<ENERGYTYPE>& dener,
+    std::vector<float>& dforce_,
+    std::vector<float>& dvirial,
+    const std::vector<float>& dcoord_,
+    const std::vector<int>& datype_,
+    const std::vector<float>& dbox,
+    const int nghost,
+    const InputNlist& lmp_list,
+    const int& ago,
+    const std::vector<float>& fparam,
+    const std::vector<float>& aparam_);
+
+template <typename VALUETYPE, typename ENERGYVTYPE>
+void DeepPot::compute_nlist(ENERGYVTYPE& dener,
+                            std::vector<VALUETYPE>& dforce_,
+                            std::vector<VALUETYPE>& dvirial,
+                            const std::vector<VALUETYPE>& dcoord_,
+                            const std::vector<int>& datype_,
+                            const std::vector<VALUETYPE>& dbox,
+                            const int nghost,
+                            const InputNlist& lmp_list,
+                            const int& ago,
+                            const std::vector<VALUETYPE>& fparam_,
+                            const std::vector<VALUETYPE>& aparam__,
+                            const bool energy_only) {
   int nall = datype_.size();
   int nframes = dcoord_.size() / nall / 3;
+  std::vector<VALUETYPE> fparam;
+  std::vector<VALUETYPE> aparam_;
+  validate_fparam_aparam(nframes, nall - nghost, fparam_, aparam__);
+  tile_fparam_aparam(fparam, nframes, dfparam, fparam_);
+  tile_fparam_aparam(aparam_, nframes, (nall - nghost) * daparam, aparam__);
+  // internal nlist
+  if (ago == 0) {
+    update_real_atoms(dcoord_, datype_, nghost, lmp_list);
+    nlist_data.copy_from_nlist(lmp_list);
+    if (!real_identity) {
+      nlist_data.shuffle_exclude_empty(real_fwd_map);
+    }
+  }
+  if (real_identity) {
+    // no atom is excluded, the forces are written directly
+    compute_inner(dener, dforce_, dvirial, dcoord_, datype_, dbox, nghost, ago,
+                  fparam, aparam_, energy_only);
+    return;
+  }
   std::vector<VALUETYPE> dcoord, dforce, aparam;
-  std::vector<int> datype, fwd_map, bkw_map;
-  int nghost_real;
-  select_real_atoms(fwd_map, bkw_map, nghost_real, dcoord_, datype_, nghost,
-                    ntypes);
+  std::vector<int> datype;
+  const std::vector<int>& fwd_map = real_fwd_map;
+  const std::vector<int>& bkw_map = real_bkw_map;
+  const int nghost_real = real_nghost;
   // resize to nall_real
   dcoord.resize(nframes * bkw_map.size() * 3);
   datype.resize(bkw_map.size());
@@ -704,31 +904,28 @@ void DeepPot::compute(ENERGYVTYPE& dener,
   select_map<VALUETYPE>(dcoord, dcoord_, fwd_map, 3, nframes, bkw_map.size(),
                         nall);
   select_map<int>(datype, datype_, fwd_map, 1);
-  std::vector<VALUETYPE> fparam;
-  std::vector<VALUETYPE> aparam_;
-  validate_fparam_aparam(nframes, nall - nghost, fparam_, aparam__);
-  tile_fparam_aparam(fparam, nframes, dfparam, fparam_);
-  tile_fparam_aparam(aparam_, nframes, (nall - nghost) * daparam, aparam__);
   // aparam
   if (daparam > 0) {
     aparam.resize(nframes * (bkw_map.size() - nghost_real));
     select_map<VALUETYPE>(aparam, aparam_, fwd_map, daparam, nframes,
                           bkw_map.size() - nghost_real, nall - nghost);
   }
-  // internal nlist
-  if (ago == 0) {
-    nlist_data.copy_from_nlist(lmp_list);
-    nlist_data.shuffle_exclude_empty(fwd_map);
-  }
   compute_inner(dener, dforce, dvirial, dcoord, datype, dbox, nghost_real, ago,
-                fparam, aparam);
+                fparam, aparam, energy_only);
+  if (energy_only) {
+    return;
+  }
   // bkw map
   dforce_.resize(nframes * fwd_map.size() * 3);
+  if (bkw_map.size() < fwd_map.size()) {
+    // the excluded atoms have no force
+    std::fill(dforce_.begin(), dforce_.end(), (VALUETYPE)0.);
+  }
   select_map<VALUETYPE>(dforce_, dforce, bkw_map, 3, nframes, fwd_map.size(),
                         bkw_map.size());
 }
 
-template void DeepPot::compute<double, ENERGYTYPE>(
+template void DeepPot::compute_nlist<double, ENERGYTYPE>(
     ENERGYTYPE& dener,
     std::vector<double>& dforce_,
     std::vector<double>& dvirial,
@@ -739,9 +936,10 @@ template void DeepPot::compute<double, ENERGYTYPE>(
     const InputNlist& lmp_list,
     const int& ago,
     const std::vector<double>& fparam,
-    const std::vector<double>& aparam_);
+    const std::vector<double>& aparam_,
+    const bool energy_only);
 
-template void DeepPot::compute<float, ENERGYTYPE>(
+template void DeepPot::compute_nlist<float, ENERGYTYPE>(
     ENERGYTYPE& dener,
     std::vector<float>& dforce_,
     std::vector<float>& dvirial,
@@ -752,9 +950,10 @@ template void DeepPot::compute<float, ENERGYTYPE>(
     const InputNlist& lmp_list,
     const int& ago,
     const std::vector<float>& fparam,
-    const std::vector<float>& aparam_);
+    const std::vector<float>& aparam_,
+    const bool energy_only);
 
-template void DeepPot::compute<double, std::vector<ENERGYTYPE>>(
+template void DeepPot::compute_nlist<double, std::vector<ENERGYTYPE>>(
     std::vector<ENERGYTYPE>& dener,
     std::vector<double>& dforce_,
     std::vector<double>& dvirial,
@@ -765,9 +964,10 @@ template void DeepPot::compute<double, std::vector<ENERGYTYPE>>(
     const InputNlist& lmp_list,
     const int& ago,
     const std::vector<double>& fparam,
-    const std::vector<double>& aparam_);
+    const std::vector<double>& aparam_,
+    const bool energy_only);
 
-template void DeepPot::compute<float, std::vector<ENERGYTYPE>>(
+template void DeepPot::compute_nlist<float, std::vector<ENERGYTYPE>>(
     std::vector<ENERGYTYPE>& dener,
     std::vector<float>& dforce_,
     std::vector<float>& dvirial,
@@ -778,7 +978,8 @@ template void DeepPot::compute<float, std::vector<ENERGYTYPE>>(
     const InputNlist& lmp_list,
     const int& ago,
     const std::vector<float>& fparam,
-    const std::vector<float>& aparam_);
+    const std::vector<float>& aparam_,
+    const bool energy_only);
 
 template <typename VALUETYPE, typename ENERGYVTYPE>
 void DeepPot::compute_inner(ENERGYVTYPE& dener,
@@ -790,7 +991,8 @@ void DeepPot::compute_inner(ENERGYVTYPE& dener,
                             const int nghost,
                             const int& ago,
                             const std::vector<VALUETYPE>& fparam,
-                            const std::vector<VALUETYPE>& aparam) {
+                            const std::vector<VALUETYPE>& aparam,
+                            const bool energy_only) {
   int nall = datype_.size();
   int nframes = dcoord_.size() / nall / 3;
   int nloc = nall - nghost;
@@ -799,7 +1001,8 @@ void DeepPot::compute_inner(ENERGYVTYPE& dener,
 
   // agp == 0 means that the LAMMPS nbor list has been updated
   if (ago == 0) {
-    atommap = deepmd::AtomMap(datype_.begin(), datype_.begin() + nloc);
+    nlist_stats.update(nlist_data, dcoord_, datype_, rcut);
+    build_atom_map(datype_, dcoord_, dbox, nloc);
     assert(nloc == atommap.get_type().size());
     nlist_data.shuffle(atommap);
     nlist_data.make_inlist(nlist);
@@ -809,15 +1012,23 @@ void DeepPot::compute_inner(ENERGYVTYPE& dener,
                                             datype_, dbox, nlist, fparam,
                                             aparam, atommap, nghost, ago);
     assert(nloc == ret);
-    run_model<double>(dener, dforce_, dvirial, session, input_tensors, atommap,
-                      nframes, nghost);
+    if (energy_only) {
+      run_model_energy(dener, session, input_tensors, atommap, nframes);
+    } else {
+      run_model<double>(dener, dforce_, dvirial, session, input_tensors,
+                        atommap, nframes, nghost, has_o_virial);
+    }
   } else {
     int ret = session_input_tensors<float>(input_tensors, dcoord_, ntypes,
                                            datype_, dbox, nlist, fparam, aparam,
                                            atommap, nghost, ago);
     assert(nloc == ret);
-    run_model<float>(dener, dforce_, dvirial, session, input_tensors, atommap,
-                     nframes, nghost);
+    if (energy_only) {
+      run_model_energy(dener, session, input_tensors, atommap, nframes);
+    } else {
+      run_model<float>(dener, dforce_, dvirial, session, input_tensors,
+                       atommap, nframes, nghost, has_o_virial);
+    }
   }
 }
 
@@ -831,7 +1042,8 @@ template void DeepPot::compute_inner<double, ENERGYTYPE>(
     const int nghost,
     const int& ago,
     const std::vector<double>& fparam,
-    const std::vector<double>& aparam);
+    const std::vector<double>& aparam,
+    const bool energy_only);
 
 template void DeepPot::compute_inner<float, ENERGYTYPE>(
     ENERGYTYPE& dener,
@@ -843,7 +1055,8 @@ template void DeepPot::compute_inner<float, ENERGYTYPE>(
     const int nghost,
     const int& ago,
     const std::vector<float>& fparam,
-    const std::vector<float>& aparam);
+    const std::vector<float>& aparam,
+    const bool energy_only);
 
 template void DeepPot::compute_inner<double, std::vector<ENERGYTYPE>>(
     std::vector<ENERGYTYPE>& dener,
@@ -855,7 +1068,8 @@ template void DeepPot::compute_inner<double, std::vector<ENERGYTYPE>>(
     const int nghost,
     const int& ago,
     const std::vector<double>& fparam,
-    const std::vector<double>& aparam);
+    const std::vector<double>& aparam,
+    const bool energy_only);
 
 template void DeepPot::compute_inner<float, std::vector<ENERGYTYPE>>(
     std::vector<ENERGYTYPE>& dener,
@@ -867,8 +1081,143 @@ template void DeepPot::compute_inner<float, std::vector<ENERGYTYPE>>(
     const int nghost,
     const int& ago,
     const std::vector<float>& fparam,
+    const std::vector<float>& aparam,
+    const bool energy_only);
+
+template <typename VALUETYPE, typename ENERGYVTYPE>
+void DeepPot::compute_energy(ENERGYVTYPE& dener,
+                             const std::vector<VALUETYPE>& dcoord_,
+                             const std::vector<int>& datype_,
+                             const std::vector<VALUETYPE>& dbox,
+                             const std::vector<VALUETYPE>& fparam_,
+                             const std::vector<VALUETYPE>& aparam_) {
+  int nall = datype_.size();
+  int nframes = dcoord_.size() / nall / 3;
+  int nloc = nall;
+  if (nlist_skin > 0. && nframes == 1 && dbox.size() == 9) {
+    std::vector<VALUETYPE> dcoord_cpy;
+    int ago = update_skin_nlist(dcoord_cpy, dcoord_, datype_, dbox);
+    compute_energy(dener, dcoord_cpy, skin_atype_cpy, dbox,
+                   skin_atype_cpy.size() - nloc, skin_nlist, ago, fparam_,
+                   aparam_);
+    return;
+  }
+  atommap = deepmd::AtomMap(datype_.begin(), datype_.begin() + nloc);
+  assert(nloc == atommap.get_type().size());
+  std::vector<VALUETYPE> fparam;
+  std::vector<VALUETYPE> aparam;
+  validate_fparam_aparam(nframes, nloc, fparam_, aparam_);
+  tile_fparam_aparam(fparam, nframes, dfparam, fparam_);
+  tile_fparam_aparam(aparam, nframes, nloc * daparam, aparam_);
+
+  std::vector<std::pair<std::string, Tensor>> input_tensors;
+
+  if (dtype == tensorflow::DT_DOUBLE) {
+    int ret =
+        session_input_tensors<double>(input_tensors, dcoord_, ntypes, datype_,
+                                      dbox, cell_size, fparam, aparam, atommap);
+    assert(ret == nloc);
+  } else {
+    int ret =
+        session_input_tensors<float>(input_tensors, dcoord_, ntypes, datype_,
+                                     dbox, cell_size, fparam, aparam, atommap);
+    assert(ret == nloc);
+  }
+  run_model_energy(dener, session, input_tensors, atommap, nframes);
+}
+
+template void DeepPot::compute_energy<double, ENERGYTYPE>(
+    ENERGYTYPE& dener,
+    const std::vector<double>& dcoord_,
+    const std::vector<int>& datype_,
+    const std::vector<double>& dbox,
+    const std::vector<double>& fparam,
+    const std::vector<double>& aparam);
+
+template void DeepPot::compute_energy<float, ENERGYTYPE>(
+    ENERGYTYPE& dener,
+    const std::vector<float>& dcoord_,
+    const std::vector<int>& datype_,
+    const std::vector<float>& dbox,
+    const std::vector<float>& fparam,
+    const std::vector<float>& aparam);
+
+template void DeepPot::compute_energy<double, std::vector<ENERGYTYPE>>(
+    std::vector<ENERGYTYPE>& dener,
+    const std::vector<double>& dcoord_,
+    const std::vector<int>& datype_,
+    const std::vector<double>& dbox,
+    const std::vector<double>& fparam,
+    const std::vector<double>& aparam);
+
+template void DeepPot::compute_energy<float, std::vector<ENERGYTYPE>>(
+    std::vector<ENERGYTYPE>& dener,
+    const std::vector<float>& dcoord_,
+    const std::vector<int>& datype_,
+    const std::vector<float>& dbox,
+    const std::vector<float>& fparam,
     const std::vector<float>& aparam);
 
+template <typename VALUETYPE, typename ENERGYVTYPE>
+void DeepPot::compute_energy(ENERGYVTYPE& dener,
+                             const std::vector<VALUETYPE>& dcoord_,
+                             const std::vector<int>& datype_,
+                             const std::vector<VALUETYPE>& dbox,
+                             const int nghost,
+                             const InputNlist& lmp_list,
+                             const int& ago,
+                             const std::vector<VALUETYPE>& fparam_,
+                             const std::vector<VALUETYPE>& aparam_) {
+  // not touched in the energy-only mode
+  std::vector<VALUETYPE> dforce, dvirial;
+  compute_nlist(dener, dforce, dvirial, dcoord_, datype_, dbox, nghost,
+                lmp_list, ago, fparam_, aparam_, true);
+}
+
+template void DeepPot::compute_energy<double, ENERGYTYPE>(
+    ENERGYTYPE& dener,
+    const std::vector<double>& dcoord_,
+    const std::vector<int>& datype_,
+    const std::vector<double>& dbox,
+    const int nghost,
+    const InputNlist& lmp_list,
+    const int& ago,
+    const std::vector<double>& fparam,
+    const std::vector<double>& aparam_);
+
+template void DeepPot::compute_energy<float, ENERGYTYPE>(
+    ENERGYTYPE& dener,
+    const std::vector<float>& dcoord_,
+    const std::vector<int>& datype_,
+    const std::vector<float>& dbox,
+    const int nghost,
+    const InputNlist& lmp_list,
+    const int& ago,
+    const std::vector<float>& fparam,
+    const std::vector<float>& aparam_);
+
+template void DeepPot::compute_energy<double, std::vector<ENERGYTYPE>>(
+    std::vector<ENERGYTYPE>& dener,
+    const std::vector<double>& dcoord_,
+    const std::vector<int>& datype_,
+    const std::vector<double>& dbox,
+    const int nghost,
+    const InputNlist& lmp_list,
+    const int& ago,
+    const std::vector<double>& fparam,
+    const std::vector<double>& aparam_);
+
+template void DeepPot::compute_energy<float, std::vector<ENERGYTYPE>>(
+    std::vector<ENERGYTYPE>& dener,
+    const std::vector<float>& dcoord_,
+    const std::vector<int>& datype_,
+    const std::vector<float>& dbox,
+    const int nghost,
+    const InputNlist& lmp_list,
+    const int& ago,
+    const std::vector<float>& fparam,
+    const std::vector<float>& aparam_);
+
 template <typename VALUETYPE, typename ENERGYVTYPE>
 void DeepPot::compute(ENERGYVTYPE& dener,
                       std::vector<VALUETYPE>& dforce_,
@@ -881,8 +1230,20 @@ void DeepPot::compute(ENERGYVTYPE& dener,
                       const std::vector<VALUETYPE>& fparam_,
                       const std::vector<VALUETYPE>& aparam_) {
   int nframes = dcoord_.size() / 3 / datype_.size();
-  atommap = deepmd::AtomMap(datype_.begin(), datype_.end());
   int nloc = datype_.size();
+  if (nlist_skin > 0. && nframes == 1 && dbox.size() == 9) {
+    std::vector<VALUETYPE> dcoord_cpy, dforce_cpy, datom_energy_cpy,
+        datom_virial_cpy;
+    int ago = update_skin_nlist(dcoord_cpy, dcoord_, datype_, dbox);
+    compute(dener, dforce_cpy, dvirial, datom_energy_cpy, datom_virial_cpy,
+            dcoord_cpy, skin_atype_cpy, dbox, skin_atype_cpy.size() - nloc,
+            skin_nlist, ago, fparam_, aparam_);
+    fold_back(dforce_, dforce_cpy, skin_mapping, nloc, 3);
+    fold_back(datom_energy_, datom_energy_cpy, skin_mapping, nloc, 1);
+    fold_back(datom_virial_, datom_virial_cpy, skin_mapping, nloc, 9);
+    return;
+  }
+  atommap = deepmd::AtomMap(datype_.begin(), datype_.end());
   std::vector<VALUETYPE> fparam;
   std::vector<VALUETYPE> aparam;
   validate_fparam_aparam(nframes, nloc, fparam_, aparam_);
@@ -978,31 +1339,50 @@ void DeepPot::compute(ENERGYVTYPE& dener,
   tile_fparam_aparam(aparam_, nframes, nloc * daparam, aparam__);
   std::vector<std::pair<std::string, Tensor>> input_tensors;
   // select real atoms
-  std::vector<VALUETYPE> dcoord, dforce, aparam, datom_energy, datom_virial;
-  std::vector<int> datype, fwd_map, bkw_map;
-  int nghost_real;
-  select_real_atoms(fwd_map, bkw_map, nghost_real, dcoord_, datype_, nghost,
-                    ntypes);
-  // resize to nall_real
+  if (ago == 0) {
+    update_real_atoms(dcoord_, datype_, nghost, lmp_list);
+  }
+  std::vector<VALUETYPE> dcoord_sel, dforce_sel, aparam_sel, datom_energy_sel,
+      datom_virial_sel;
+  std::vector<int> datype_sel;
+  const std::vector<int>& fwd_map = real_fwd_map;
+  const std::vector<int>& bkw_map = real_bkw_map;
+  const int nghost_real = real_nghost;
   int nall_real = bkw_map.size();
   int nloc_real = nall_real - nghost_real;
-  dcoord.resize(nframes * nall_real * 3);
-  datype.resize(nall_real);
-  // fwd map
-  select_map<VALUETYPE>(dcoord, dcoord_, fwd_map, 3, nframes, nall_real, nall);
-  select_map<int>(datype, datype_, fwd_map, 1);
-  // aparam
-  if (daparam > 0) {
-    aparam.resize(nframes * nloc_real);
-    select_map<VALUETYPE>(aparam, aparam_, fwd_map, daparam, nframes, nloc_real,
-                          nall - nghost);
+  if (!real_identity) {
+    // resize to nall_real
+    dcoord_sel.resize(nframes * nall_real * 3);
+    datype_sel.resize(nall_real);
+    // fwd map
+    select_map<VALUETYPE>(dcoord_sel, dcoord_, fwd_map, 3, nframes, nall_real,
+                          nall);
+    select_map<int>(datype_sel, datype_, fwd_map, 1);
+    // aparam
+    if (daparam > 0) {
+      aparam_sel.resize(nframes * nloc_real);
+      select_map<VALUETYPE>(aparam_sel, aparam_, fwd_map, daparam, nframes,
+                            nloc_real, nall - nghost);
+    }
   }
+  // if no atom is excluded, the inputs and outputs are used directly
+  const std::vector<VALUETYPE>& dcoord = real_identity ? dcoord_ : dcoord_sel;
+  const std::vector<int>& datype = real_identity ? datype_ : datype_sel;
+  const std::vector<VALUETYPE>& aparam = real_identity ? aparam_ : aparam_sel;
+  std::vector<VALUETYPE>& dforce = real_identity ? dforce_ : dforce_sel;
+  std::vector<VALUETYPE>& datom_energy =
+      real_identity ? datom_energy_ : datom_energy_sel;
+  std::vector<VALUETYPE>& datom_virial =
+      real_identity ? datom_virial_ : datom_virial_sel;
   if (ago == 0) {
-    atommap = deepmd::AtomMap(datype.begin(), datype.begin() + nloc_real);
+    build_atom_map(datype, dcoord, dbox, nloc_real);
     assert(nloc_real == atommap.get_type().size());
 
     nlist_data.copy_from_nlist(lmp_list);
-    nlist_data.shuffle_exclude_empty(fwd_map);
+    if (!real_identity) {
+      nlist_data.shuffle_exclude_empty(fwd_map);
+    }
+    nlist_stats.update(nlist_data, dcoord, datype, rcut);
     nlist_data.shuffle(atommap);
     nlist_data.make_inlist(nlist);
   }
@@ -1022,11 +1402,20 @@ void DeepPot::compute(ENERGYVTYPE& dener,
     run_model<float>(dener, dforce, dvirial, datom_energy, datom_virial,
                      session, input_tensors, atommap, nframes, nghost_real);
   }
+  if (real_identity) {
+    return;
+  }
 
   // bkw map
   dforce_.resize(nframes * fwd_map.size() * 3);
   datom_energy_.resize(nframes * fwd_map.size());
   datom_virial_.resize(nframes * fwd_map.size() * 9);
+  if (bkw_map.size() < fwd_map.size()) {
+    // the excluded atoms have no contribution
+    std::fill(dforce_.begin(), dforce_.end(), (VALUETYPE)0.);
+    std::fill(datom_energy_.begin(), datom_energy_.end(), (VALUETYPE)0.);
+    std::fill(datom_virial_.begin(), datom_virial_.end(), (VALUETYPE)0.);
+  }
   select_map<VALUETYPE>(dforce_, dforce, bkw_map, 3, nframes, fwd_map.size(),
                         nall_real);
   select_map<VALUETYPE>(datom_energy_, datom_energy, bkw_map, 1, nframes,
@@ -1123,14 +1512,14 @@ void DeepPot::compute_mixed_type(ENERGYVTYPE& dener,
         fparam, aparam, atommap);
     assert(ret == nloc);
     run_model<double>(dener, dforce_, dvirial, session, input_tensors, atommap,
-                      nframes);
+                      nframes, 0, has_o_virial);
   } else {
     int ret = session_input_tensors_mixed_type<float>(
         input_tensors, nframes, dcoord_, ntypes, datype_, dbox, cell_size,
         fparam, aparam, atommap);
     assert(ret == nloc);
     run_model<float>(dener, dforce_, dvirial, session, input_tensors, atommap,
-                     nframes);
+                     nframes, 0, has_o_virial);
   }
 }
 
@@ -1272,6 +1661,176 @@ void DeepPot::get_type_map(std::string& type_map) {
   type_map = get_scalar<STRINGTYPE>("model_attr/tmap");
 }
 
+void DeepPot::set_nlist_skin(const double& skin) {
+  nlist_skin = skin;
+  // force to rebuild the neighbor list at the next call
+  skin_atype.clear();
+}
+
+template <typename VALUETYPE>
+void DeepPot::update_real_atoms(const std::vector<VALUETYPE>& dcoord_,
+                                const std::vector<int>& datype_,
+                                const int nghost,
+                                const InputNlist& lmp_list) {
+  int nall = datype_.size();
+  select_real_atoms(real_fwd_map, real_bkw_map, real_nghost, dcoord_, datype_,
+                    nghost, ntypes);
+  bool has_virtual = real_bkw_map.size() < nall;
+  // the ghost atoms out of the neighbor list do not contribute
+  prune_ghost_atoms(real_fwd_map, real_bkw_map, real_nghost, lmp_list,
+                    nall - nghost);
+  // excluding a few ghost atoms does not pay off the copies of the inputs
+  // and outputs
+  real_identity = !has_virtual && (nghost - real_nghost) * 8 <= nghost;
+  if (real_identity) {
+    real_fwd_map.resize(nall);
+    real_bkw_map.resize(nall);
+    for (int ii = 0; ii < nall; ++ii) {
+      real_fwd_map[ii] = real_bkw_map[ii] = ii;
+    }
+    real_nghost = nghost;
+  }
+}
+
+void DeepPot::set_spatial_sort(const bool& spatial_sort_) {
+  spatial_sort = spatial_sort_;
+}
+
+void DeepPot::reset_nlist_stats() { nlist_stats.reset(ntypes, get_sel_a()); }
+
+template <typename VALUETYPE>
+void DeepPot::build_atom_map(const std::vector<int>& datype,
+                             const std::vector<VALUETYPE>& dcoord,
+                             const std::vector<VALUETYPE>& dbox,
+                             const int nloc) {
+  if (spatial_sort) {
+    // the cells are those of the first frame
+    std::vector<VALUETYPE> box;
+    if (dbox.size() >= 9) {
+      box.assign(dbox.begin(), dbox.begin() + 9);
+    }
+    atommap = deepmd::AtomMap(datype.begin(), datype.begin() + nloc, dcoord,
+                              box, rcut);
+  } else {
+    atommap = deepmd::AtomMap(datype.begin(), datype.begin() + nloc);
+  }
+}
+
+template <typename VALUETYPE>
+int DeepPot::update_skin_nlist(std::vector<VALUETYPE>& dcoord_cpy,
+                               const std::vector<VALUETYPE>& dcoord_,
+                               const std::vector<int>& datype_,
+                               const std::vector<VALUETYPE>& dbox) {
+  int nloc = datype_.size();
+  std::vector<double> box(dbox.begin(), dbox.end());
+  deepmd::Region<double> region;
+  init_region_cpu(region, &box[0]);
+  // the images move with the atoms and the box
+  bool rebuild = (skin_atype != datype_);
+  if (!rebuild) {
+    int nall = skin_mapping.size();
+    double max_disp2 = 0.25 * nlist_skin * nlist_skin;
+    std::vector<double> coord_cpy(nall * 3);
+    for (int ii = 0; ii < nall; ++ii) {
+      double image[3], shift[3];
+      for (int dd = 0; dd < 3; ++dd) {
+        image[dd] = skin_image[ii * 3 + dd];
+      }
+      convert_to_phys_cpu(shift, region, image);
+      double disp[3];
+      for (int dd = 0; dd < 3; ++dd) {
+        coord_cpy[ii * 3 + dd] =
+            dcoord_[skin_mapping[ii] * 3 + dd] + shift[dd];
+        disp[dd] = coord_cpy[ii * 3 + dd] - skin_coord_cpy[ii * 3 + dd];
+      }
+      if (deepmd::dot3(disp, disp) > max_disp2) {
+        rebuild = true;
+        break;
+      }
+    }
+    if (!rebuild) {
+      dcoord_cpy.assign(coord_cpy.begin(), coord_cpy.end());
+      return 1;
+    }
+  }
+  // copy the images within rcut + skin
+  float rcut_skin = rcut + nlist_skin;
+  std::vector<double> coord(dcoord_.begin(), dcoord_.end());
+  normalize_coord_cpu(&coord[0], nloc, region);
+  int nall = 0;
+  int mem_cpy = skin_mapping.size() > 0 ? skin_mapping.size() : nloc * 4 + 64;
+  std::vector<double> coord_cpy;
+  for (int tt = 0; tt < 2; ++tt) {
+    coord_cpy.resize(mem_cpy * 3);
+    skin_atype_cpy.resize(mem_cpy);
+    skin_mapping.resize(mem_cpy);
+    if (copy_coord_cpu(&coord_cpy[0], &skin_atype_cpy[0], &skin_mapping[0],
+                       &nall, &coord[0], &datype_[0], nloc, mem_cpy, rcut_skin,
+                       region) == 0) {
+      break;
+    }
+    mem_cpy = nall;
+  }
+  coord_cpy.resize(nall * 3);
+  skin_atype_cpy.resize(nall);
+  skin_mapping.resize(nall);
+  // build the neighbor list of rcut + skin, each atom is given mem_nnei
+  // slots, then the list is compacted to the CSR layout
+  std::vector<int>& jrange = skin_nlist_data.jrange;
+  std::vector<int>& jlist = skin_nlist_data.jlist;
+  skin_nlist_data.ilist.resize(nloc);
+  skin_nlist_data.numneigh.resize(nloc);
+  skin_nlist_data.firstneigh.resize(nloc);
+  jrange.resize(nloc + 1);
+  int mem_nnei = std::max(256, (int)jlist.capacity() / std::max(nloc, 1));
+  int max_nnei = 0;
+  for (int tt = 0; tt < 2; ++tt) {
+    jlist.resize(nloc * mem_nnei);
+    for (int ii = 0; ii < nloc; ++ii) {
+      skin_nlist_data.firstneigh[ii] = &jlist[ii * mem_nnei];
+    }
+    InputNlist inlist(nloc, &skin_nlist_data.ilist[0],
+                      &skin_nlist_data.numneigh[0],
+                      &skin_nlist_data.firstneigh[0]);
+    if (build_nlist_cpu(inlist, &max_nnei, &coord_cpy[0], nloc, nall,
+                        mem_nnei, rcut_skin) == 0) {
+      break;
+    }
+    mem_nnei = max_nnei;
+  }
+  jrange[0] = 0;
+  for (int ii = 0; ii < nloc; ++ii) {
+    jrange[ii + 1] = jrange[ii] + skin_nlist_data.numneigh[ii];
+    std::copy(jlist.begin() + ii * mem_nnei,
+              jlist.begin() + ii * mem_nnei + skin_nlist_data.numneigh[ii],
+              jlist.begin() + jrange[ii]);
+  }
+  jlist.resize(jrange[nloc]);
+  skin_nlist_data.make_inlist(skin_nlist);
+  // record the periodic images of the extended atoms
+  skin_image.resize(nall * 3);
+  skin_coord_cpy.resize(nall * 3);
+  for (int ii = 0; ii < nall; ++ii) {
+    double diff[3], image[3], shift[3];
+    for (int dd = 0; dd < 3; ++dd) {
+      diff[dd] = coord_cpy[ii * 3 + dd] - dcoord_[skin_mapping[ii] * 3 + dd];
+    }
+    convert_to_inter_cpu(image, region, diff);
+    for (int dd = 0; dd < 3; ++dd) {
+      skin_image[ii * 3 + dd] = std::lround(image[dd]);
+      image[dd] = skin_image[ii * 3 + dd];
+    }
+    convert_to_phys_cpu(shift, region, image);
+    for (int dd = 0; dd < 3; ++dd) {
+      skin_coord_cpy[ii * 3 + dd] =
+          dcoord_[skin_mapping[ii] * 3 + dd] + shift[dd];
+    }
+  }
+  skin_atype = datype_;
+  dcoord_cpy.assign(skin_coord_cpy.begin(), skin_coord_cpy.end());
+  return 0;
+}
+
 DeepPotModelDevi::DeepPotModelDevi()
     : inited(false), init_nbor(false), numb_models(0) {}
 
@@ -1311,6 +1870,7 @@ void DeepPotModelDevi::init(const std::vector<std::string>& models,
   get_env_nthreads(num_intra_nthreads, num_inter_nthreads);
   options.config.set_inter_op_parallelism_threads(num_inter_nthreads);
   options.config.set_intra_op_parallelism_threads(num_intra_nthreads);
+  set_op_fusion(options);
   for (unsigned ii = 0; ii < numb_models; ++ii) {
     graph_defs[ii] = new GraphDef();
     if (file_contents.size() == 0)
@@ -1337,6 +1897,10 @@ void DeepPotModelDevi::init(const std::vector<std::string>& models,
     check_status(NewSession(options, &(sessions[ii])));
     check_status(sessions[ii]->Create(*graph_defs[ii]));
   }
+  has_o_virial.resize(numb_models);
+  for (unsigned ii = 0; ii < numb_models; ++ii) {
+    has_o_virial[ii] = graph_has_node(*graph_defs[ii], "o_virial");
+  }
   dtype = session_get_dtype(sessions[0], "descrpt_attr/rcut");
   if (dtype == tensorflow::DT_DOUBLE) {
     rcut = get_scalar<double>("descrpt_attr/rcut");
@@ -1360,6 +1924,7 @@ void DeepPotModelDevi::init(const std::vector<std::string>& models,
   // cell_size = rcut;
   // ntypes = get_ntypes();
   inited = true;
+  reset_nlist_stats();
 
   init_nbor = false;
 }
@@ -1408,6 +1973,22 @@ std::vector<std::vector<int>> DeepPotModelDevi::get_sel() const {
   return sec;
 }
 
+void DeepPotModelDevi::reset_nlist_stats() {
+  // a neighbor overflows if it is dropped by any of the models
+  std::vector<std::vector<int>> sel_models = get_sel();
+  std::vector<int> sel(ntypes, INT_MAX);
+  for (unsigned ii = 0; ii < numb_models; ++ii) {
+    if (sel_models[ii].size() != ntypes) {
+      sel.clear();
+      break;
+    }
+    for (int tt = 0; tt < ntypes; ++tt) {
+      sel[tt] = std::min(sel[tt], sel_models[ii][tt]);
+    }
+  }
+  nlist_stats.reset(ntypes, sel);
+}
+
 template <typename VALUETYPE>
 void DeepPotModelDevi::validate_fparam_aparam(
     const int& nloc,
@@ -1509,6 +2090,7 @@ void DeepPotModelDevi::compute(std::vector<ENERGYTYPE>& all_energy,
     assert(nloc == atommap.get_type().size());
 
     nlist_data.copy_from_nlist(lmp_list);
+    nlist_stats.update(nlist_data, dcoord_, datype_, rcut);
     nlist_data.shuffle(atommap);
     nlist_data.make_inlist(nlist);
   }
@@ -1529,10 +2111,12 @@ void DeepPotModelDevi::compute(std::vector<ENERGYTYPE>& all_energy,
   for (unsigned ii = 0; ii < numb_models; ++ii) {
     if (dtype == tensorflow::DT_DOUBLE) {
       run_model<double>(all_energy[ii], all_force[ii], all_virial[ii],
-                        sessions[ii], input_tensors, atommap, 1, nghost);
+                        sessions[ii], input_tensors, atommap, 1, nghost,
+                        has_o_virial[ii]);
     } else {
       run_model<float>(all_energy[ii], all_force[ii], all_virial[ii],
-                       sessions[ii], input_tensors, atommap, 1, nghost);
+                       sessions[ii], input_tensors, atommap, 1, nghost,
+                       has_o_virial[ii]);
     }
   }
 }
@@ -1590,6 +2174,7 @@ void DeepPotModelDevi::compute(
     assert(nloc == atommap.get_type().size());
 
     nlist_data.copy_from_nlist(lmp_list);
+    nlist_stats.update(nlist_data, dcoord_, datype_, rcut);
     nlist_data.shuffle(atommap);
     nlist_data.make_inlist(nlist);
   }
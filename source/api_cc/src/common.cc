@@ -2,6 +2,8 @@
 
 #include <fcntl.h>
 
+#include <algorithm>
+
 #include "AtomMap.h"
 #include "device.h"
 #if defined(_WIN32)
@@ -147,15 +149,48 @@ template void deepmd::select_real_atoms<float>(
     const int& nghost,
     const int& ntypes);
 
+void deepmd::prune_ghost_atoms(std::vector<int>& fwd_map,
+                               std::vector<int>& bkw_map,
+                               int& nghost_real,
+                               const InputNlist& inlist,
+                               const int& nloc) {
+  int nall = fwd_map.size();
+  std::vector<char> in_nlist(nall, 0);
+  for (int ii = 0; ii < inlist.inum; ++ii) {
+    for (int jj = 0; jj < inlist.numneigh[ii]; ++jj) {
+      in_nlist[inlist.firstneigh[ii][jj]] = 1;
+    }
+  }
+  bkw_map.clear();
+  nghost_real = 0;
+  for (int ii = 0; ii < nall; ++ii) {
+    if (fwd_map[ii] >= 0 && (ii < nloc || in_nlist[ii])) {
+      fwd_map[ii] = bkw_map.size();
+      bkw_map.push_back(ii);
+      if (ii >= nloc) {
+        nghost_real++;
+      }
+    } else {
+      fwd_map[ii] = -1;
+    }
+  }
+}
+
 void deepmd::NeighborListData::copy_from_nlist(const InputNlist& inlist) {
   int inum = inlist.inum;
   ilist.resize(inum);
-  jlist.resize(inum);
+  jrange.resize(inum + 1);
   memcpy(&ilist[0], inlist.ilist, inum * sizeof(int));
+  jrange[0] = 0;
+  for (int ii = 0; ii < inum; ++ii) {
+    jrange[ii + 1] = jrange[ii] + inlist.numneigh[ii];
+  }
+  jlist.resize(jrange[inum]);
+#pragma omp parallel for
   for (int ii = 0; ii < inum; ++ii) {
     int jnum = inlist.numneigh[ii];
-    jlist[ii].resize(jnum);
-    memcpy(&jlist[ii][0], inlist.firstneigh[ii], jnum * sizeof(int));
+    memcpy(jlist.data() + jrange[ii], inlist.firstneigh[ii],
+           jnum * sizeof(int));
   }
 }
 
@@ -171,11 +206,11 @@ void deepmd::NeighborListData::shuffle(const std::vector<int>& fwd_map) {
       ilist[ii] = fwd_map[ilist[ii]];
     }
   }
-  for (unsigned ii = 0; ii < jlist.size(); ++ii) {
-    for (unsigned jj = 0; jj < jlist[ii].size(); ++jj) {
-      if (jlist[ii][jj] < nloc) {
-        jlist[ii][jj] = fwd_map[jlist[ii][jj]];
-      }
+  int nnei = jlist.size();
+#pragma omp parallel for
+  for (int jj = 0; jj < nnei; ++jj) {
+    if (jlist[jj] < nloc) {
+      jlist[jj] = fwd_map[jlist[jj]];
     }
   }
 }
@@ -183,39 +218,59 @@ void deepmd::NeighborListData::shuffle(const std::vector<int>& fwd_map) {
 void deepmd::NeighborListData::shuffle_exclude_empty(
     const std::vector<int>& fwd_map) {
   shuffle(fwd_map);
-  std::vector<int> new_ilist;
-  std::vector<std::vector<int>> new_jlist;
-  new_ilist.reserve(ilist.size());
-  new_jlist.reserve(jlist.size());
-  for (int ii = 0; ii < ilist.size(); ++ii) {
+  int inum = ilist.size();
+  // count the remaining neighbors of each remaining atom
+  std::vector<int> new_jrange(inum + 1, 0);
+#pragma omp parallel for
+  for (int ii = 0; ii < inum; ++ii) {
+    int jnum = 0;
     if (ilist[ii] >= 0) {
-      new_ilist.push_back(ilist[ii]);
+      for (int jj = jrange[ii]; jj < jrange[ii + 1]; ++jj) {
+        if (jlist[jj] >= 0) {
+          jnum++;
+        }
+      }
     }
+    new_jrange[ii + 1] = jnum;
+  }
+  for (int ii = 0; ii < inum; ++ii) {
+    new_jrange[ii + 1] += new_jrange[ii];
   }
-  int new_inum = new_ilist.size();
-  for (int ii = 0; ii < jlist.size(); ++ii) {
+  std::vector<int> new_jlist(new_jrange[inum]);
+#pragma omp parallel for
+  for (int ii = 0; ii < inum; ++ii) {
+    int kk = new_jrange[ii];
     if (ilist[ii] >= 0) {
-      std::vector<int> tmp_jlist;
-      tmp_jlist.reserve(jlist[ii].size());
-      for (int jj = 0; jj < jlist[ii].size(); ++jj) {
-        if (jlist[ii][jj] >= 0) {
-          tmp_jlist.push_back(jlist[ii][jj]);
+      for (int jj = jrange[ii]; jj < jrange[ii + 1]; ++jj) {
+        if (jlist[jj] >= 0) {
+          new_jlist[kk++] = jlist[jj];
         }
       }
-      new_jlist.push_back(tmp_jlist);
     }
   }
-  ilist = new_ilist;
-  jlist = new_jlist;
+  // remove the empty atoms
+  int new_inum = 0;
+  for (int ii = 0; ii < inum; ++ii) {
+    if (ilist[ii] >= 0) {
+      ilist[new_inum] = ilist[ii];
+      new_jrange[new_inum + 1] = new_jrange[ii + 1];
+      new_inum++;
+    }
+  }
+  ilist.resize(new_inum);
+  new_jrange.resize(new_inum + 1);
+  jrange.swap(new_jrange);
+  jlist.swap(new_jlist);
 }
 
 void deepmd::NeighborListData::make_inlist(InputNlist& inlist) {
   int nloc = ilist.size();
   numneigh.resize(nloc);
   firstneigh.resize(nloc);
+#pragma omp parallel for
   for (int ii = 0; ii < nloc; ++ii) {
-    numneigh[ii] = jlist[ii].size();
-    firstneigh[ii] = &jlist[ii][0];
+    numneigh[ii] = jrange[ii + 1] - jrange[ii];
+    firstneigh[ii] = jlist.data() + jrange[ii];
   }
   inlist.inum = nloc;
   inlist.ilist = &ilist[0];
@@ -223,6 +278,96 @@ void deepmd::NeighborListData::make_inlist(InputNlist& inlist) {
   inlist.firstneigh = &firstneigh[0];
 }
 
+void deepmd::NlistStats::reset(const int& ntypes,
+                               const std::vector<int>& sel_) {
+  nsamples = 0;
+  sel.clear();
+  if (sel_.size() == ntypes) {
+    sel = sel_;
+  }
+  max_nnei.assign(ntypes, 0);
+  sum_nnei.assign(ntypes, 0);
+  noverflow.assign(ntypes, 0);
+}
+
+void deepmd::NlistStats::get_mean_nnei(std::vector<double>& mean_nnei) const {
+  mean_nnei.resize(sum_nnei.size());
+  for (int tt = 0; tt < sum_nnei.size(); ++tt) {
+    mean_nnei[tt] = nsamples > 0 ? (double)sum_nnei[tt] / nsamples : 0.;
+  }
+}
+
+template <typename VALUETYPE>
+void deepmd::NlistStats::update(const NeighborListData& nlist_data,
+                                const std::vector<VALUETYPE>& coord,
+                                const std::vector<int>& atype,
+                                const double& rcut) {
+  const int ntypes = max_nnei.size();
+  const int inum = nlist_data.ilist.size();
+  const double rcut2 = rcut * rcut;
+  const bool check_sel = sel.size() == ntypes;
+#pragma omp parallel
+  {
+    std::vector<int> nnei(ntypes);
+    std::vector<int> max_nnei_(ntypes, 0);
+    std::vector<long long> sum_nnei_(ntypes, 0);
+    std::vector<long long> noverflow_(ntypes, 0);
+    long long nsamples_ = 0;
+#pragma omp for nowait
+    for (int ii = 0; ii < inum; ++ii) {
+      const int i_idx = nlist_data.ilist[ii];
+      if (i_idx < 0) {
+        continue;
+      }
+      std::fill(nnei.begin(), nnei.end(), 0);
+      for (int jj = nlist_data.jrange[ii]; jj < nlist_data.jrange[ii + 1];
+           ++jj) {
+        const int j_idx = nlist_data.jlist[jj];
+        if (j_idx < 0 || atype[j_idx] < 0 || atype[j_idx] >= ntypes) {
+          continue;
+        }
+        double rr2 = 0.;
+        for (int dd = 0; dd < 3; ++dd) {
+          double diff = coord[j_idx * 3 + dd] - coord[i_idx * 3 + dd];
+          rr2 += diff * diff;
+        }
+        if (rr2 <= rcut2) {
+          nnei[atype[j_idx]]++;
+        }
+      }
+      for (int tt = 0; tt < ntypes; ++tt) {
+        max_nnei_[tt] = std::max(max_nnei_[tt], nnei[tt]);
+        sum_nnei_[tt] += nnei[tt];
+        if (check_sel && nnei[tt] > sel[tt]) {
+          noverflow_[tt]++;
+        }
+      }
+      nsamples_++;
+    }
+#pragma omp critical
+    {
+      for (int tt = 0; tt < ntypes; ++tt) {
+        max_nnei[tt] = std::max(max_nnei[tt], max_nnei_[tt]);
+        sum_nnei[tt] += sum_nnei_[tt];
+        noverflow[tt] += noverflow_[tt];
+      }
+      nsamples += nsamples_;
+    }
+  }
+}
+
+template void deepmd::NlistStats::update<double>(
+    const NeighborListData& nlist_data,
+    const std::vector<double>& coord,
+    const std::vector<int>& atype,
+    const double& rcut);
+
+template void deepmd::NlistStats::update<float>(
+    const NeighborListData& nlist_data,
+    const std::vector<float>& coord,
+    const std::vector<int>& atype,
+    const double& rcut);
+
 void deepmd::check_status(const tensorflow::Status& status) {
   if (!status.ok()) {
     std::cout << status.ToString() << std::endl;
@@ -734,6 +879,16 @@ int deepmd::session_get_dtype(tensorflow::Session* session,
   return (int)output_rc.dtype();
 }
 
+bool deepmd::graph_has_node(const GraphDef& graph_def,
+                            const std::string& name) {
+  for (int ii = 0; ii < graph_def.node_size(); ++ii) {
+    if (graph_def.node(ii).name() == name) {
+      return true;
+    }
+  }
+  return false;
+}
+
 template <typename VT>
 void deepmd::select_map(std::vector<VT>& out,
                         const std::vector<VT>& in,
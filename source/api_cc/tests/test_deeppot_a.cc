@@ -175,6 +175,80 @@ TYPED_TEST(TestInferDeepPotA, cpu_build_nlist_numfv) {
   model.test_v(coord, box_);
 }
 
+TYPED_TEST(TestInferDeepPotA, cpu_build_nlist_skin) {
+  using VALUETYPE = TypeParam;
+  std::vector<VALUETYPE>& coord = this->coord;
+  std::vector<int>& atype = this->atype;
+  std::vector<VALUETYPE>& box = this->box;
+  std::vector<VALUETYPE>& expected_e = this->expected_e;
+  std::vector<VALUETYPE>& expected_f = this->expected_f;
+  std::vector<VALUETYPE>& expected_v = this->expected_v;
+  int& natoms = this->natoms;
+  double& expected_tot_e = this->expected_tot_e;
+  std::vector<VALUETYPE>& expected_tot_v = this->expected_tot_v;
+  deepmd::DeepPot& dp = this->dp;
+  dp.set_nlist_skin(1.0);
+  double ener;
+  std::vector<VALUETYPE> force, virial, atom_ener, atom_vir;
+  // the first call builds the nlist, the second one reuses it
+  for (int tt = 0; tt < 2; ++tt) {
+    dp.compute(ener, force, virial, atom_ener, atom_vir, coord, atype, box);
+
+    EXPECT_EQ(force.size(), natoms * 3);
+    EXPECT_EQ(virial.size(), 9);
+    EXPECT_EQ(atom_ener.size(), natoms);
+    EXPECT_EQ(atom_vir.size(), natoms * 9);
+
+    EXPECT_LT(fabs(ener - expected_tot_e), EPSILON);
+    for (int ii = 0; ii < natoms * 3; ++ii) {
+      EXPECT_LT(fabs(force[ii] - expected_f[ii]), EPSILON);
+    }
+    for (int ii = 0; ii < 3 * 3; ++ii) {
+      EXPECT_LT(fabs(virial[ii] - expected_tot_v[ii]), EPSILON);
+    }
+    for (int ii = 0; ii < natoms; ++ii) {
+      EXPECT_LT(fabs(atom_ener[ii] - expected_e[ii]), EPSILON);
+    }
+    for (int ii = 0; ii < natoms * 9; ++ii) {
+      EXPECT_LT(fabs(atom_vir[ii] - expected_v[ii]), EPSILON);
+    }
+  }
+}
+
+TYPED_TEST(TestInferDeepPotA, cpu_build_nlist_skin_numfv) {
+  using VALUETYPE = TypeParam;
+  std::vector<VALUETYPE>& coord = this->coord;
+  std::vector<int>& atype = this->atype;
+  std::vector<VALUETYPE>& box = this->box;
+  deepmd::DeepPot& dp = this->dp;
+  class MyModel : public EnergyModelTest<VALUETYPE> {
+    deepmd::DeepPot& mydp;
+    const std::vector<int> atype;
+
+   public:
+    MyModel(deepmd::DeepPot& dp_, const std::vector<int>& atype_)
+        : mydp(dp_), atype(atype_){};
+    virtual void compute(double& ener,
+                         std::vector<VALUETYPE>& force,
+                         std::vector<VALUETYPE>& virial,
+                         const std::vector<VALUETYPE>& coord,
+                         const std::vector<VALUETYPE>& box) {
+      mydp.compute(ener, force, virial, coord, atype, box);
+    }
+  };
+  dp.set_nlist_skin(1.0);
+  MyModel model(dp, atype);
+  model.test_f(coord, box);
+  model.test_v(coord, box);
+  std::vector<VALUETYPE> box_(box);
+  box_[1] -= 0.4;
+  model.test_f(coord, box_);
+  model.test_v(coord, box_);
+  box_[4] += 0.2;
+  model.test_f(coord, box_);
+  model.test_v(coord, box_);
+}
+
 TYPED_TEST(TestInferDeepPotA, cpu_build_nlist_atomic) {
   using VALUETYPE = TypeParam;
   std::vector<VALUETYPE>& coord = this->coord;
@@ -273,6 +347,111 @@ TYPED_TEST(TestInferDeepPotA, cpu_lmp_nlist) {
   }
 }
 
+TYPED_TEST(TestInferDeepPotA, cpu_build_nlist_energy) {
+  using VALUETYPE = TypeParam;
+  std::vector<VALUETYPE>& coord = this->coord;
+  std::vector<int>& atype = this->atype;
+  std::vector<VALUETYPE>& box = this->box;
+  double& expected_tot_e = this->expected_tot_e;
+  deepmd::DeepPot& dp = this->dp;
+  double ener;
+  dp.compute_energy(ener, coord, atype, box);
+
+  EXPECT_LT(fabs(ener - expected_tot_e), EPSILON);
+}
+
+TYPED_TEST(TestInferDeepPotA, cpu_lmp_nlist_energy) {
+  using VALUETYPE = TypeParam;
+  std::vector<VALUETYPE>& coord = this->coord;
+  std::vector<int>& atype = this->atype;
+  std::vector<VALUETYPE>& box = this->box;
+  double& expected_tot_e = this->expected_tot_e;
+  deepmd::DeepPot& dp = this->dp;
+  float rc = dp.cutoff();
+  int nloc = coord.size() / 3;
+  std::vector<VALUETYPE> coord_cpy;
+  std::vector<int> atype_cpy, mapping;
+  std::vector<std::vector<int> > nlist_data;
+  _build_nlist<VALUETYPE>(nlist_data, coord_cpy, atype_cpy, mapping, coord,
+                          atype, box, rc);
+  int nall = coord_cpy.size() / 3;
+  std::vector<int> ilist(nloc), numneigh(nloc);
+  std::vector<int*> firstneigh(nloc);
+  deepmd::InputNlist inlist(nloc, &ilist[0], &numneigh[0], &firstneigh[0]);
+  convert_nlist(inlist, nlist_data);
+
+  double ener;
+  dp.compute_energy(ener, coord_cpy, atype_cpy, box, nall - nloc, inlist, 0);
+  EXPECT_LT(fabs(ener - expected_tot_e), EPSILON);
+
+  ener = 0.;
+  dp.compute_energy(ener, coord_cpy, atype_cpy, box, nall - nloc, inlist, 1);
+  EXPECT_LT(fabs(ener - expected_tot_e), EPSILON);
+
+  // the same as the energy of compute
+  std::vector<VALUETYPE> force, virial;
+  double ener_1;
+  dp.compute(ener_1, force, virial, coord_cpy, atype_cpy, box, nall - nloc,
+             inlist, 1);
+  EXPECT_LT(fabs(ener - ener_1), EPSILON);
+}
+
+TYPED_TEST(TestInferDeepPotA, cpu_lmp_nlist_spatial_sort) {
+  using VALUETYPE = TypeParam;
+  std::vector<VALUETYPE>& coord = this->coord;
+  std::vector<int>& atype = this->atype;
+  std::vector<VALUETYPE>& box = this->box;
+  std::vector<VALUETYPE>& expected_e = this->expected_e;
+  std::vector<VALUETYPE>& expected_f = this->expected_f;
+  std::vector<VALUETYPE>& expected_v = this->expected_v;
+  int& natoms = this->natoms;
+  double& expected_tot_e = this->expected_tot_e;
+  std::vector<VALUETYPE>& expected_tot_v = this->expected_tot_v;
+  deepmd::DeepPot& dp = this->dp;
+  float rc = dp.cutoff();
+  int nloc = coord.size() / 3;
+  std::vector<VALUETYPE> coord_cpy;
+  std::vector<int> atype_cpy, mapping;
+  std::vector<std::vector<int> > nlist_data;
+  _build_nlist<VALUETYPE>(nlist_data, coord_cpy, atype_cpy, mapping, coord,
+                          atype, box, rc);
+  int nall = coord_cpy.size() / 3;
+  std::vector<int> ilist(nloc), numneigh(nloc);
+  std::vector<int*> firstneigh(nloc);
+  deepmd::InputNlist inlist(nloc, &ilist[0], &numneigh[0], &firstneigh[0]);
+  convert_nlist(inlist, nlist_data);
+
+  dp.set_spatial_sort(true);
+  for (int ago = 0; ago < 2; ++ago) {
+    double ener;
+    std::vector<VALUETYPE> force_, virial, atom_ener, atom_vir_;
+    dp.compute(ener, force_, virial, atom_ener, atom_vir_, coord_cpy,
+               atype_cpy, box, nall - nloc, inlist, ago);
+    std::vector<VALUETYPE> force, atom_vir;
+    _fold_back<VALUETYPE>(force, force_, mapping, nloc, nall, 3);
+    _fold_back<VALUETYPE>(atom_vir, atom_vir_, mapping, nloc, nall, 9);
+
+    EXPECT_EQ(force.size(), natoms * 3);
+    EXPECT_EQ(virial.size(), 9);
+    EXPECT_EQ(atom_ener.size(), natoms);
+    EXPECT_EQ(atom_vir.size(), natoms * 9);
+
+    EXPECT_LT(fabs(ener - expected_tot_e), EPSILON);
+    for (int ii = 0; ii < natoms * 3; ++ii) {
+      EXPECT_LT(fabs(force[ii] - expected_f[ii]), EPSILON);
+    }
+    for (int ii = 0; ii < 3 * 3; ++ii) {
+      EXPECT_LT(fabs(virial[ii] - expected_tot_v[ii]), EPSILON);
+    }
+    for (int ii = 0; ii < natoms; ++ii) {
+      EXPECT_LT(fabs(atom_ener[ii] - expected_e[ii]), EPSILON);
+    }
+    for (int ii = 0; ii < natoms * 9; ++ii) {
+      EXPECT_LT(fabs(atom_vir[ii] - expected_v[ii]), EPSILON);
+    }
+  }
+}
+
 TYPED_TEST(TestInferDeepPotA, cpu_lmp_nlist_atomic) {
   using VALUETYPE = TypeParam;
   std::vector<VALUETYPE>& coord = this->coord;
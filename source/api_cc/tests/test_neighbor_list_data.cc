@@ -0,0 +1,87 @@
+#include <gtest/gtest.h>
+
+#include <vector>
+
+#include "common.h"
+
+class TestNeighborListData : public ::testing::Test {
+ protected:
+  std::vector<int> ilist = {0, 1, 2, 3};
+  std::vector<std::vector<int>> jlist = {
+      {1, 2, 4, 5}, {0, 3, 5}, {}, {0, 1, 2, 4}};
+  // atoms 2 and 4 are virtual
+  std::vector<int> fwd_map = {0, 1, -1, 2, -1, 3};
+  std::vector<int> expected_ilist = {0, 1, 2};
+  std::vector<std::vector<int>> expected_jlist = {{1, 3}, {0, 2, 3}, {0, 1}};
+  std::vector<int> numneigh;
+  std::vector<int*> firstneigh;
+  deepmd::InputNlist inlist;
+
+  void SetUp() override {
+    int inum = ilist.size();
+    numneigh.resize(inum);
+    firstneigh.resize(inum);
+    for (int ii = 0; ii < inum; ++ii) {
+      numneigh[ii] = jlist[ii].size();
+      firstneigh[ii] = jlist[ii].data();
+    }
+    inlist = deepmd::InputNlist(inum, &ilist[0], &numneigh[0], &firstneigh[0]);
+  }
+};
+
+TEST_F(TestNeighborListData, copy) {
+  deepmd::NeighborListData nlist_data;
+  nlist_data.copy_from_nlist(inlist);
+  deepmd::InputNlist outlist;
+  nlist_data.make_inlist(outlist);
+  EXPECT_EQ(outlist.inum, ilist.size());
+  EXPECT_EQ(nlist_data.jrange.back(), nlist_data.jlist.size());
+  for (int ii = 0; ii < outlist.inum; ++ii) {
+    EXPECT_EQ(outlist.ilist[ii], ilist[ii]);
+    ASSERT_EQ(outlist.numneigh[ii], jlist[ii].size());
+    for (int jj = 0; jj < outlist.numneigh[ii]; ++jj) {
+      EXPECT_EQ(outlist.firstneigh[ii][jj], jlist[ii][jj]);
+    }
+  }
+}
+
+TEST_F(TestNeighborListData, shuffle_exclude_empty) {
+  deepmd::NeighborListData nlist_data;
+  nlist_data.copy_from_nlist(inlist);
+  nlist_data.shuffle_exclude_empty(fwd_map);
+  deepmd::InputNlist outlist;
+  nlist_data.make_inlist(outlist);
+  EXPECT_EQ(outlist.inum, expected_ilist.size());
+  EXPECT_EQ(nlist_data.jrange.back(), nlist_data.jlist.size());
+  for (int ii = 0; ii < outlist.inum; ++ii) {
+    EXPECT_EQ(outlist.ilist[ii], expected_ilist[ii]);
+    ASSERT_EQ(outlist.numneigh[ii], expected_jlist[ii].size());
+    for (int jj = 0; jj < outlist.numneigh[ii]; ++jj) {
+      EXPECT_EQ(outlist.firstneigh[ii][jj], expected_jlist[ii][jj]);
+    }
+  }
+}
+
+TEST_F(TestNeighborListData, nlist_stats) {
+  deepmd::NeighborListData nlist_data;
+  nlist_data.copy_from_nlist(inlist);
+  // atom 5 is out of the cutoff of atom 1, and atom 4 of atom 3
+  std::vector<double> coord = {0.0, 0.0, 0.0, 1.0, 0.0, 0.0, 0.0, 1.0, 0.0,
+                               1.0, 1.0, 0.0, 0.0, 0.0, 1.0, 0.0, 0.0, 1.2};
+  std::vector<int> atype = {0, 1, 0, 1, 0, 1};
+  deepmd::NlistStats stats;
+  stats.reset(2, {2, 1});
+  stats.update(nlist_data, coord, atype, 1.5);
+  // neighbors of each type: {2, 2}, {1, 1}, {0, 0}, {2, 1}
+  std::vector<int> expected_max_nnei = {2, 2};
+  std::vector<long long> expected_sum_nnei = {5, 4};
+  std::vector<long long> expected_noverflow = {0, 1};
+  EXPECT_EQ(stats.nsamples, 4);
+  EXPECT_EQ(stats.max_nnei, expected_max_nnei);
+  EXPECT_EQ(stats.sum_nnei, expected_sum_nnei);
+  EXPECT_EQ(stats.noverflow, expected_noverflow);
+  std::vector<double> mean_nnei;
+  stats.get_mean_nnei(mean_nnei);
+  EXPECT_DOUBLE_EQ(mean_nnei[0], 1.25);
+  EXPECT_DOUBLE_EQ(mean_nnei[1], 1.0);
+}
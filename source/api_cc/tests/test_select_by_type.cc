@@ -76,3 +76,26 @@ TYPED_TEST(TestSelectByType, selectbytype1) {
     EXPECT_EQ(this->expected_bkw_map_1[ii], this->bkw_map_1[ii]);
   }
 }
+
+TEST(TestPruneGhostAtoms, prune) {
+  // 3 local atoms, 5 ghost atoms, atom 6 is virtual
+  std::vector<int> fwd_map = {0, 1, 2, 3, 4, 5, -1, 6};
+  std::vector<int> bkw_map = {0, 1, 2, 3, 4, 5, 7};
+  int nghost_real = 4;
+  int nloc = 3;
+  std::vector<int> ilist = {0, 1, 2};
+  std::vector<std::vector<int>> jlist = {{1, 4}, {0, 7}, {6, 4}};
+  std::vector<int> numneigh(3);
+  std::vector<int*> firstneigh(3);
+  for (int ii = 0; ii < 3; ++ii) {
+    numneigh[ii] = jlist[ii].size();
+    firstneigh[ii] = &jlist[ii][0];
+  }
+  deepmd::InputNlist inlist(3, &ilist[0], &numneigh[0], &firstneigh[0]);
+  deepmd::prune_ghost_atoms(fwd_map, bkw_map, nghost_real, inlist, nloc);
+  std::vector<int> expected_fwd_map = {0, 1, 2, -1, 3, -1, -1, 4};
+  std::vector<int> expected_bkw_map = {0, 1, 2, 4, 7};
+  EXPECT_EQ(nghost_real, 2);
+  EXPECT_EQ(fwd_map, expected_fwd_map);
+  EXPECT_EQ(bkw_map, expected_bkw_map);
+}
@@ -91,6 +91,9 @@ int main(int argc, char *argv[]) {
 
   Convert<double> cvt(atom_name, name_type_map);
   deepmd::DeepPot nnp_inter(graph_file);
+  if (jdata.find("nlist_skin") != jdata.end()) {
+    nnp_inter.set_nlist_skin(jdata["nlist_skin"]);
+  }
 
   enum { _MSGLEN = 12 };
   int MSGLEN = _MSGLEN;
@@ -20,6 +20,8 @@ void normalize_coord_cpu(FPTYPE* coord,
 //	0: succssful
 //	1: the memory is not large enough to hold all copied coords and types.
 //	   i.e. nall > mem_nall
+// the ghost atoms are generated cell by cell (see compute_cell_info) in
+// parallel, and written directly to the outputs.
 template <typename FPTYPE>
 int copy_coord_cpu(FPTYPE* out_c,
                    int* out_t,
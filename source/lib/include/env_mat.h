@@ -28,6 +28,88 @@ void env_mat_r_cpu(std::vector<FPTYPE>& descrpt_a,
                    const float& rmin,
                    const float& rmax);
 
+/**
+ * @brief Compute the environment matrix of se_a for a single atom, written
+ *directly to the outputs without any allocation.
+ * @param[out] descrpt_a The environment matrix, sec_a.back() x 4.
+ * @param[out] descrpt_a_deriv The derivative, sec_a.back() x 4 x 3.
+ * @param[out] rij_a The displacements, sec_a.back() x 3.
+ * @param[in] posi The coordinates.
+ * @param[in] i_idx The index of the atom.
+ * @param[in] fmt_nlist_a The formatted neighbor list, sec_a.back() ints.
+ * @param[in] sec_a The sections of the neighbor types.
+ * @param[in] rmin The smooth cutoff radius.
+ * @param[in] rmax The cutoff radius.
+ **/
+template <typename FPTYPE>
+void env_mat_a_cpu(FPTYPE* descrpt_a,
+                   FPTYPE* descrpt_a_deriv,
+                   FPTYPE* rij_a,
+                   const FPTYPE* posi,
+                   const int& i_idx,
+                   const int* fmt_nlist_a,
+                   const std::vector<int>& sec_a,
+                   const float& rmin,
+                   const float& rmax);
+
+/**
+ * @brief Compute the environment matrix of se_r for a single atom, written
+ *directly to the outputs without any allocation.
+ * @param[out] descrpt_r The environment matrix, sec.back().
+ * @param[out] descrpt_r_deriv The derivative, sec.back() x 3.
+ * @param[out] rij_r The displacements, sec.back() x 3.
+ * @param[in] posi The coordinates.
+ * @param[in] i_idx The index of the atom.
+ * @param[in] fmt_nlist The formatted neighbor list, sec.back() ints.
+ * @param[in] sec The sections of the neighbor types.
+ * @param[in] rmin The smooth cutoff radius.
+ * @param[in] rmax The cutoff radius.
+ **/
+template <typename FPTYPE>
+void env_mat_r_cpu(FPTYPE* descrpt_r,
+                   FPTYPE* descrpt_r_deriv,
+                   FPTYPE* rij_r,
+                   const FPTYPE* posi,
+                   const int& i_idx,
+                   const int* fmt_nlist,
+                   const std::vector<int>& sec,
+                   const float& rmin,
+                   const float& rmax);
+
+/**
+ * @brief The same as env_mat_a_cpu, but the neighbors are evaluated in
+ *batches by SIMD instructions. The instruction set (AVX-512, AVX2 or the
+ *baseline) is chosen at runtime. If descrpt_a_deriv is NULL, the derivative
+ *is not computed.
+ **/
+template <typename FPTYPE>
+void env_mat_a_simd_cpu(FPTYPE* descrpt_a,
+                        FPTYPE* descrpt_a_deriv,
+                        FPTYPE* rij_a,
+                        const FPTYPE* posi,
+                        const int& i_idx,
+                        const int* fmt_nlist_a,
+                        const std::vector<int>& sec_a,
+                        const float& rmin,
+                        const float& rmax);
+
+/**
+ * @brief The same as env_mat_r_cpu, but the neighbors are evaluated in
+ *batches by SIMD instructions. The instruction set (AVX-512, AVX2 or the
+ *baseline) is chosen at runtime. If descrpt_r_deriv is NULL, the derivative
+ *is not computed.
+ **/
+template <typename FPTYPE>
+void env_mat_r_simd_cpu(FPTYPE* descrpt_r,
+                        FPTYPE* descrpt_r_deriv,
+                        FPTYPE* rij_r,
+                        const FPTYPE* posi,
+                        const int& i_idx,
+                        const int* fmt_nlist,
+                        const std::vector<int>& sec,
+                        const float& rmin,
+                        const float& rmax);
+
 }  // namespace deepmd
 
 ////////////////////////////////////////////////////////
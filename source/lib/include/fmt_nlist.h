@@ -17,6 +17,67 @@ void format_nlist_cpu(int* nlist,
                       const float rcut,
                       const std::vector<int> sec);
 
+/**
+ * @brief Format the neighbor list of a single atom.
+ * @param[out] fmt_nei_idx_a The formatted neighbors, sec_a.back() ints.
+ * @param[in] posi The coordinates.
+ * @param[in] type The atom types.
+ * @param[in] i_idx The index of the atom.
+ * @param[in] nei_idx_a The candidate neighbors.
+ * @param[in] nei_num The number of candidate neighbors.
+ * @param[in] rcut The cutoff radius.
+ * @param[in] sec_a The sections of the neighbor types.
+ * @return -1 if OK, otherwise the last type whose neighbors exceed sel.
+ **/
+template <typename FPTYPE>
+int format_nlist_i_cpu(int* fmt_nei_idx_a,
+                       const FPTYPE* posi,
+                       const int* type,
+                       const int i_idx,
+                       const int* nei_idx_a,
+                       const int nei_num,
+                       const float rcut,
+                       const std::vector<int>& sec_a);
+
+/**
+ * @brief The candidate neighbors of each local atom, bucketed by type and
+ * sorted by (distance, index), including those beyond the cutoff.
+ * @details The order is kept between the steps in which the input neighbor
+ * list does not change, so that it can be repaired instead of re-sorted.
+ **/
+struct NeighborOrder {
+  int nloc, nall, ntypes;
+  // the bucket of local atom ii and type tt is
+  // [jrange[ii * ntypes + tt], jrange[ii * ntypes + tt + 1])
+  std::vector<int> jrange;
+  std::vector<int> jlist;
+  // squared distances of jlist
+  std::vector<float> dist;
+  NeighborOrder() : nloc(0), nall(0), ntypes(0) {}
+};
+
+/**
+ * @brief Format the neighbor list and keep the neighbor order.
+ * @param[out] nlist The formatted neighbor list, nloc x sec.back().
+ * @param[in,out] order The neighbor order of the previous call.
+ * @param[in] reuse Whether in_nlist is the same neighbor list as in the
+ * previous call. If so, the kept order is repaired by an insertion sort,
+ * which is nearly linear as the order changes little between steps.
+ * Otherwise all candidates are sorted again. The formatted neighbor list
+ * is identical in both cases.
+ **/
+template <typename FPTYPE>
+void format_nlist_cpu(int* nlist,
+                      NeighborOrder& order,
+                      const InputNlist& in_nlist,
+                      const FPTYPE* coord,
+                      const int* type,
+                      const int nloc,
+                      const int nall,
+                      const float rcut,
+                      const std::vector<int> sec,
+                      const bool reuse);
+
 #if GOOGLE_CUDA
 template <typename FPTYPE>
 void format_nbor_list_gpu_cuda(int* nlist,
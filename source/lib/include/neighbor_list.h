@@ -58,6 +58,9 @@ void convert_nlist(InputNlist& to_nlist,
 int max_numneigh(const InputNlist& to_nlist);
 
 // build neighbor list.
+// the extended coords are binned into a cell list, so the cost is
+// O(nall) rather than O(nloc * nall). the neighbors of each atom are
+// sorted in ascending order.
 // outputs
 //	nlist, max_list_size
 //	max_list_size is the maximal size of jlist.
@@ -77,6 +80,24 @@ int build_nlist_cpu(InputNlist& nlist,
                     const int& mem_size,
                     const float& rcut);
 
+// build the reverse of the padded neighbor list nlist of the local atoms
+// [start_index, start_index + nloc) in the CSR format.
+// outputs
+//	rev_start, rev_slot
+//	the slots i_idx * nnei + jj with nlist[i_idx * nnei + jj] == j_idx are
+//	rev_slot[rev_start[j_idx]], ..., rev_slot[rev_start[j_idx + 1] - 1],
+//	in ascending order. the order does not depend on the number of
+//	threads, so the kernels gathering over it are deterministic.
+// inputs
+//	nlist, nloc, nall, nnei, start_index
+void build_reverse_nlist_cpu(std::vector<int>& rev_start,
+                             std::vector<int>& rev_slot,
+                             const int* nlist,
+                             const int nloc,
+                             const int nall,
+                             const int nnei,
+                             const int start_index = 0);
+
 void use_nei_info_cpu(int* nlist,
                       int* ntype,
                       bool* nmask,
@@ -2,10 +2,14 @@
 #include <vector>
 
 #include "device.h"
+#include "fmt_nlist.h"
 #include "neighbor_list.h"
 
 namespace deepmd {
 
+// If nbor_order is given, the neighbor order is kept in it between calls,
+// see format_nlist_cpu. If em_deriv is NULL, the derivative is skipped, which
+// is the case when only the energy is evaluated.
 template <typename FPTYPE>
 void prod_env_mat_a_cpu(FPTYPE *em,
                         FPTYPE *em_deriv,
@@ -22,7 +26,9 @@ void prod_env_mat_a_cpu(FPTYPE *em,
                         const float rcut,
                         const float rcut_smth,
                         const std::vector<int> sec,
-                        const int *f_type = NULL);
+                        const int *f_type = NULL,
+                        NeighborOrder *nbor_order = NULL,
+                        const bool reuse_nbor_order = false);
 
 template <typename FPTYPE>
 void prod_env_mat_r_cpu(FPTYPE *em,
@@ -39,7 +45,33 @@ void prod_env_mat_r_cpu(FPTYPE *em,
                         const int nall,
                         const float rcut,
                         const float rcut_smth,
-                        const std::vector<int> sec);
+                        const std::vector<int> sec,
+                        NeighborOrder *nbor_order = NULL,
+                        const bool reuse_nbor_order = false);
+
+// The slots of the formatted nlist kept when each section of sec is trimmed
+// to the largest number of neighbors of that type found in the nsamples
+// rows of nlist. The valid neighbors are packed at the head of each section,
+// so the dropped slots are padding in every row.
+// outputs
+//	sel_index: the slots in the full layout, ascending. sel_index.size() is
+//	the trimmed nnei.
+//	sel_trim: the trimmed width of each section.
+void env_mat_trim_index_cpu(std::vector<int> &sel_index,
+                            std::vector<int> &sel_trim,
+                            const int *nlist,
+                            const int nsamples,
+                            const std::vector<int> &sec);
+
+// Gather the slots in sel_index of the nsamples rows of in, each slot having
+// ncomp values, into out of nsamples x sel_index.size() x ncomp.
+template <typename T>
+void env_mat_trim_cpu(T *out,
+                      const T *in,
+                      const std::vector<int> &sel_index,
+                      const int nsamples,
+                      const int nnei,
+                      const int ncomp);
 
 #if GOOGLE_CUDA
 template <typename FPTYPE>
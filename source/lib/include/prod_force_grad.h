@@ -2,13 +2,15 @@
 
 namespace deepmd {
 
+// The CPU kernels process nframes contiguous frames at once.
 template <typename FPTYPE>
 void prod_force_grad_a_cpu(FPTYPE* grad_net,
                            const FPTYPE* grad,
                            const FPTYPE* env_deriv,
                            const int* nlist,
                            const int nloc,
-                           const int nnei);
+                           const int nnei,
+                           const int nframes = 1);
 
 template <typename FPTYPE>
 void prod_force_grad_r_cpu(FPTYPE* grad_net,
@@ -16,7 +18,8 @@ void prod_force_grad_r_cpu(FPTYPE* grad_net,
                            const FPTYPE* env_deriv,
                            const int* nlist,
                            const int nloc,
-                           const int nnei);
+                           const int nnei,
+                           const int nframes = 1);
 
 #if GOOGLE_CUDA
 template <typename FPTYPE>
@@ -0,0 +1,21 @@
+#pragma once
+
+namespace deepmd {
+
+// Compute the force, the virial and the atom virial of se_a in a single
+// traversal of net_deriv, env_deriv and nlist. The outputs are the same as
+// those of prod_force_a_cpu and prod_virial_a_cpu. If atom_virial is NULL,
+// only the virial is accumulated and the atom virial is not computed.
+template <typename FPTYPE>
+void prod_force_virial_a_cpu(FPTYPE* force,
+                             FPTYPE* virial,
+                             FPTYPE* atom_virial,
+                             const FPTYPE* net_deriv,
+                             const FPTYPE* env_deriv,
+                             const FPTYPE* rij,
+                             const int* nlist,
+                             const int nloc,
+                             const int nall,
+                             const int nnei);
+
+}  // namespace deepmd
@@ -2,6 +2,7 @@
 
 namespace deepmd {
 
+// If atom_virial is NULL, only the virial is computed.
 template <typename FPTYPE>
 void prod_virial_a_cpu(FPTYPE* virial,
                        FPTYPE* atom_virial,
@@ -13,6 +14,7 @@ void prod_virial_a_cpu(FPTYPE* virial,
                        const int nall,
                        const int nnei);
 
+// If atom_virial is NULL, only the virial is computed.
 template <typename FPTYPE>
 void prod_virial_r_cpu(FPTYPE* virial,
                        FPTYPE* atom_virial,
@@ -2,6 +2,7 @@
 
 namespace deepmd {
 
+// The CPU kernels process nframes contiguous frames at once.
 template <typename FPTYPE>
 void prod_virial_grad_a_cpu(FPTYPE* grad_net,
                             const FPTYPE* grad,
@@ -9,7 +10,8 @@ void prod_virial_grad_a_cpu(FPTYPE* grad_net,
                             const FPTYPE* rij,
                             const int* nlist,
                             const int nloc,
-                            const int nnei);
+                            const int nnei,
+                            const int nframes = 1);
 
 template <typename FPTYPE>
 void prod_virial_grad_r_cpu(FPTYPE* grad_net,
@@ -18,7 +20,8 @@ void prod_virial_grad_r_cpu(FPTYPE* grad_net,
                             const FPTYPE* rij,
                             const int* nlist,
                             const int nloc,
-                            const int nnei);
+                            const int nnei,
+                            const int nframes = 1);
 
 #if GOOGLE_CUDA
 template <typename FPTYPE>
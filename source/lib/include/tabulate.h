@@ -1,4 +1,5 @@
 #pragma once
+#include <stdint.h>
 
 namespace deepmd {
 
@@ -36,6 +37,61 @@ void tabulate_fusion_se_a_grad_grad_cpu(FPTYPE* dz_dy,
                                         const int nnei,
                                         const int last_layer_size);
 
+// Re-lay the table of tabulate_fusion_se_a_cpu out from [idx][kk][6] to the
+// coefficient-major [idx][6][kk] taken by the SIMD kernels below.
+template <typename FPTYPE>
+void tabulate_table_coef_major_cpu(FPTYPE* table_cm,
+                                   const FPTYPE* table,
+                                   const int nspline,
+                                   const int last_layer_size);
+
+// Round a table to bfloat16, stored as the upper 16 bits of a float.
+template <typename FPTYPE>
+void tabulate_table_bf16_cpu(uint16_t* table_bf16,
+                             const FPTYPE* table,
+                             const int size);
+
+// The same as tabulate_fusion_se_a_cpu and its gradients, but the lanes of
+// kk are evaluated by SIMD instructions, taking the coefficient-major table
+// table_cm. The instruction set (AVX-512, AVX2 or the baseline) is chosen at
+// runtime. The results agree with the scalar kernels up to rounding. The
+// table may be of FPTYPE, or of bfloat16 (TTYPE = uint16_t, see
+// tabulate_table_bf16_cpu), a quarter of the footprint of a double table, at
+// a relative error of at most 2^-9 in the coefficients.
+template <typename FPTYPE, typename TTYPE>
+void tabulate_fusion_se_a_simd_cpu(FPTYPE* out,
+                                   const TTYPE* table_cm,
+                                   const FPTYPE* table_info,
+                                   const FPTYPE* em_x,
+                                   const FPTYPE* em,
+                                   const int nloc,
+                                   const int nnei,
+                                   const int last_layer_size);
+
+template <typename FPTYPE, typename TTYPE>
+void tabulate_fusion_se_a_grad_simd_cpu(FPTYPE* dy_dem_x,
+                                        FPTYPE* dy_dem,
+                                        const TTYPE* table_cm,
+                                        const FPTYPE* table_info,
+                                        const FPTYPE* em_x,
+                                        const FPTYPE* em,
+                                        const FPTYPE* dy,
+                                        const int nloc,
+                                        const int nnei,
+                                        const int last_layer_size);
+
+template <typename FPTYPE, typename TTYPE>
+void tabulate_fusion_se_a_grad_grad_simd_cpu(FPTYPE* dz_dy,
+                                             const TTYPE* table_cm,
+                                             const FPTYPE* table_info,
+                                             const FPTYPE* em_x,
+                                             const FPTYPE* em,
+                                             const FPTYPE* dz_dy_dem_x,
+                                             const FPTYPE* dz_dy_dem,
+                                             const int nloc,
+                                             const int nnei,
+                                             const int last_layer_size);
+
 template <typename FPTYPE>
 void tabulate_fusion_se_t_cpu(FPTYPE* out,
                               const FPTYPE* table,
@@ -73,6 +129,44 @@ void tabulate_fusion_se_t_grad_grad_cpu(FPTYPE* dz_dy,
                                         const int nnei_j,
                                         const int last_layer_size);
 
+// The same as tabulate_fusion_se_t_cpu and its gradients when the two
+// neighbor sets are the same, so that em_x of each atom is a symmetric
+// nnei x nnei matrix. Only the pairs jj <= kk are evaluated. The results
+// agree with the general kernels up to rounding.
+template <typename FPTYPE>
+void tabulate_fusion_se_t_sym_cpu(FPTYPE* out,
+                                  const FPTYPE* table,
+                                  const FPTYPE* table_info,
+                                  const FPTYPE* em_x,
+                                  const FPTYPE* em,
+                                  const int nloc,
+                                  const int nnei,
+                                  const int last_layer_size);
+
+template <typename FPTYPE>
+void tabulate_fusion_se_t_grad_sym_cpu(FPTYPE* dy_dem_x,
+                                       FPTYPE* dy_dem,
+                                       const FPTYPE* table,
+                                       const FPTYPE* table_info,
+                                       const FPTYPE* em_x,
+                                       const FPTYPE* em,
+                                       const FPTYPE* dy,
+                                       const int nloc,
+                                       const int nnei,
+                                       const int last_layer_size);
+
+template <typename FPTYPE>
+void tabulate_fusion_se_t_grad_grad_sym_cpu(FPTYPE* dz_dy,
+                                            const FPTYPE* table,
+                                            const FPTYPE* table_info,
+                                            const FPTYPE* em_x,
+                                            const FPTYPE* em,
+                                            const FPTYPE* dz_dy_dem_x,
+                                            const FPTYPE* dz_dy_dem,
+                                            const int nloc,
+                                            const int nnei,
+                                            const int last_layer_size);
+
 template <typename FPTYPE>
 void tabulate_fusion_se_r_cpu(FPTYPE* out,
                               const FPTYPE* table,
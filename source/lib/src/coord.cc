@@ -3,7 +3,6 @@
 #include <vector>
 
 #include "SimulationRegion.h"
-#include "neighbor_list.h"
 
 using namespace deepmd;
 
@@ -23,6 +22,14 @@ void deepmd::normalize_coord_cpu(FPTYPE* coord,
   }
 }
 
+// the periodic image of the cell index, and the number of boxes shifted
+static inline int image_cell(int& shift, const int idx, const int ncell) {
+  int img = idx % ncell;
+  if (img < 0) img += ncell;
+  shift = (img - idx) / ncell;
+  return img;
+}
+
 template <typename FPTYPE>
 int deepmd::copy_coord_cpu(FPTYPE* out_c,
                            int* out_t,
@@ -35,28 +42,122 @@ int deepmd::copy_coord_cpu(FPTYPE* out_c,
                            const float& rcut,
                            const Region<FPTYPE>& region) {
   const int mem_nall = mem_nall_;
-  std::vector<double> coord(nloc * 3);
-  std::vector<int> atype(nloc);
-  std::copy(in_c, in_c + nloc * 3, coord.begin());
-  std::copy(in_t, in_t + nloc, atype.begin());
-  SimulationRegion<double> tmpr;
-  double tmp_boxt[9];
-  std::copy(region.boxt, region.boxt + 9, tmp_boxt);
-  tmpr.reinitBox(tmp_boxt);
+  int cell_info[23];
+  compute_cell_info(cell_info, rcut, region);
+  const int* ncell = cell_info + 3;
+  const int* ext_stt = cell_info + 6;
+  const int* ext_end = cell_info + 9;
+  const int loc_cellnum = cell_info[21];
+  const int total_cellnum = cell_info[22];
+  int ext_ncell[3];
+  for (int dd = 0; dd < 3; ++dd) {
+    ext_ncell[dd] = ext_end[dd] - ext_stt[dd];
+  }
 
-  std::vector<double> out_coord;
-  std::vector<int> out_atype, out_mapping, ncell, ngcell;
-  copy_coord(out_coord, out_atype, out_mapping, ncell, ngcell, coord, atype,
-             rcut, tmpr);
+  // scratch of the cell lists, reused between calls. The references are
+  // shared by the OpenMP threads below.
+  static thread_local std::vector<int> atom_cell_, cell_start_, cell_atoms_,
+      ghost_start_;
+  std::vector<int>& atom_cell = atom_cell_;
+  std::vector<int>& cell_start = cell_start_;
+  std::vector<int>& cell_atoms = cell_atoms_;
+  std::vector<int>& ghost_start = ghost_start_;
+  atom_cell.resize(nloc);
+  cell_start.assign(loc_cellnum + 1, 0);
+  cell_atoms.resize(nloc);
+  ghost_start.resize(total_cellnum + 1);
 
-  *nall = out_atype.size();
+  // bin the local atoms into the local cells
+#pragma omp parallel for
+  for (int ii = 0; ii < nloc; ++ii) {
+    FPTYPE inter[3];
+    convert_to_inter_cpu(inter, region, in_c + ii * 3);
+    int idx[3];
+    for (int dd = 0; dd < 3; ++dd) {
+      idx[dd] = inter[dd] * ncell[dd];
+      if (inter[dd] < (FPTYPE)0.) idx[dd]--;
+      if (idx[dd] < 0) {
+        idx[dd] = 0;
+      } else if (idx[dd] >= ncell[dd]) {
+        idx[dd] = ncell[dd] - 1;
+      }
+    }
+    atom_cell[ii] = (idx[0] * ncell[1] + idx[1]) * ncell[2] + idx[2];
+  }
+  for (int ii = 0; ii < nloc; ++ii) {
+    cell_start[atom_cell[ii] + 1]++;
+  }
+  for (int cc = 0; cc < loc_cellnum; ++cc) {
+    cell_start[cc + 1] += cell_start[cc];
+  }
+  for (int ii = 0; ii < nloc; ++ii) {
+    cell_atoms[cell_start[atom_cell[ii]]++] = ii;
+  }
+  // cell_start has been shifted by the fill
+  for (int cc = loc_cellnum; cc > 0; --cc) {
+    cell_start[cc] = cell_start[cc - 1];
+  }
+  cell_start[0] = 0;
+
+  // the ghost atoms are ordered by the extended cells, and within a cell by
+  // the index of the local atom they are copied from
+  ghost_start[0] = nloc;
+  for (int cc = 0; cc < total_cellnum; ++cc) {
+    int ii[3], jj[3], shift;
+    ii[2] = cc % ext_ncell[2] + ext_stt[2];
+    ii[1] = (cc / ext_ncell[2]) % ext_ncell[1] + ext_stt[1];
+    ii[0] = cc / (ext_ncell[2] * ext_ncell[1]) + ext_stt[0];
+    bool local = true;
+    for (int dd = 0; dd < 3; ++dd) {
+      jj[dd] = image_cell(shift, ii[dd], ncell[dd]);
+      local = local && (shift == 0);
+    }
+    const int img = (jj[0] * ncell[1] + jj[1]) * ncell[2] + jj[2];
+    ghost_start[cc + 1] =
+        ghost_start[cc] + (local ? 0 : cell_start[img + 1] - cell_start[img]);
+  }
+  *nall = ghost_start[total_cellnum];
   if (*nall > mem_nall) {
     // size of the output arrays is not large enough
     return 1;
-  } else {
-    std::copy(out_coord.begin(), out_coord.end(), out_c);
-    std::copy(out_atype.begin(), out_atype.end(), out_t);
-    std::copy(out_mapping.begin(), out_mapping.end(), mapping);
+  }
+
+#pragma omp parallel
+  {
+#pragma omp for nowait
+    for (int ii = 0; ii < nloc; ++ii) {
+      for (int dd = 0; dd < 3; ++dd) {
+        out_c[ii * 3 + dd] = in_c[ii * 3 + dd];
+      }
+      out_t[ii] = in_t[ii];
+      mapping[ii] = ii;
+    }
+#pragma omp for schedule(dynamic, 4)
+    for (int cc = 0; cc < total_cellnum; ++cc) {
+      if (ghost_start[cc + 1] == ghost_start[cc]) continue;
+      int ii[3], jj[3], shift[3];
+      ii[2] = cc % ext_ncell[2] + ext_stt[2];
+      ii[1] = (cc / ext_ncell[2]) % ext_ncell[1] + ext_stt[1];
+      ii[0] = cc / (ext_ncell[2] * ext_ncell[1]) + ext_stt[0];
+      for (int dd = 0; dd < 3; ++dd) {
+        jj[dd] = image_cell(shift[dd], ii[dd], ncell[dd]);
+      }
+      const int img = (jj[0] * ncell[1] + jj[1]) * ncell[2] + jj[2];
+      FPTYPE shift_d[3] = {(FPTYPE)shift[0], (FPTYPE)shift[1],
+                           (FPTYPE)shift[2]};
+      FPTYPE shift_v[3];
+      convert_to_phys_cpu(shift_v, region, shift_d);
+      int out_idx = ghost_start[cc];
+      for (int kk = cell_start[img]; kk < cell_start[img + 1]; ++kk) {
+        const int p_idx = cell_atoms[kk];
+        for (int dd = 0; dd < 3; ++dd) {
+          out_c[out_idx * 3 + dd] = in_c[p_idx * 3 + dd] - shift_v[dd];
+        }
+        out_t[out_idx] = in_t[p_idx];
+        mapping[out_idx] = p_idx;
+        out_idx++;
+      }
+    }
   }
   return 0;
 }
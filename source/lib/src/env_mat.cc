@@ -1,5 +1,7 @@
 #include "env_mat.h"
 
+#include <algorithm>
+
 #include "switcher.h"
 
 // output deriv size: n_sel_a_nei x 4 x 12
@@ -123,30 +125,35 @@ void deepmd::env_mat_a_cpu(std::vector<FPTYPE>& descrpt_a,
                            const std::vector<int>& sec_a,
                            const float& rmin,
                            const float& rmax) {
-  // compute the diff of the neighbors
   rij_a.resize(sec_a.back() * 3);
-  fill(rij_a.begin(), rij_a.end(), (FPTYPE)0.0);
-  for (int ii = 0; ii < int(sec_a.size()) - 1; ++ii) {
-    for (int jj = sec_a[ii]; jj < sec_a[ii + 1]; ++jj) {
-      if (fmt_nlist_a[jj] < 0) break;
-      const int& j_idx = fmt_nlist_a[jj];
-      for (int dd = 0; dd < 3; ++dd) {
-        rij_a[jj * 3 + dd] = posi[j_idx * 3 + dd] - posi[i_idx * 3 + dd];
-      }
-    }
-  }
   // 1./rr, cos(theta), cos(phi), sin(phi)
   descrpt_a.resize(sec_a.back() * 4);
-  fill(descrpt_a.begin(), descrpt_a.end(), (FPTYPE)0.0);
   // deriv wrt center: 3
   descrpt_a_deriv.resize(sec_a.back() * 4 * 3);
-  fill(descrpt_a_deriv.begin(), descrpt_a_deriv.end(), (FPTYPE)0.0);
+  env_mat_a_cpu(&descrpt_a[0], &descrpt_a_deriv[0], &rij_a[0], &posi[0], i_idx,
+                &fmt_nlist_a[0], sec_a, rmin, rmax);
+}
 
+template <typename FPTYPE>
+void deepmd::env_mat_a_cpu(FPTYPE* descrpt_a,
+                           FPTYPE* descrpt_a_deriv,
+                           FPTYPE* rij_a,
+                           const FPTYPE* posi,
+                           const int& i_idx,
+                           const int* fmt_nlist_a,
+                           const std::vector<int>& sec_a,
+                           const float& rmin,
+                           const float& rmax) {
   for (int sec_iter = 0; sec_iter < int(sec_a.size()) - 1; ++sec_iter) {
-    for (int nei_iter = sec_a[sec_iter]; nei_iter < sec_a[sec_iter + 1];
-         ++nei_iter) {
-      if (fmt_nlist_a[nei_iter] < 0) break;
-      const FPTYPE* rr = &rij_a[nei_iter * 3];
+    int nei_iter = sec_a[sec_iter];
+    for (; nei_iter < sec_a[sec_iter + 1]; ++nei_iter) {
+      const int j_idx = fmt_nlist_a[nei_iter];
+      if (j_idx < 0) break;
+      // compute the diff of the neighbor
+      FPTYPE* rr = &rij_a[nei_iter * 3];
+      for (int dd = 0; dd < 3; ++dd) {
+        rr[dd] = posi[j_idx * 3 + dd] - posi[i_idx * 3 + dd];
+      }
       FPTYPE nr2 = deepmd::dot3(rr, rr);
       FPTYPE inr = (FPTYPE)1. / sqrt(nr2);
       FPTYPE nr = nr2 * inr;
@@ -155,56 +162,50 @@ void deepmd::env_mat_a_cpu(std::vector<FPTYPE>& descrpt_a,
       FPTYPE inr3 = inr4 * nr;
       FPTYPE sw, dsw;
       deepmd::spline5_switch(sw, dsw, nr, rmin, rmax);
-      int idx_deriv = nei_iter * 4 * 3;  // 4 components time 3 directions
-      int idx_value = nei_iter * 4;      // 4 components
+      FPTYPE* value = &descrpt_a[nei_iter * 4];       // 4 components
+      FPTYPE* deriv = &descrpt_a_deriv[nei_iter * 12];  // 4 x 3 directions
       // 4 value components
-      descrpt_a[idx_value + 0] = (FPTYPE)1. / nr;
-      descrpt_a[idx_value + 1] = rr[0] / nr2;
-      descrpt_a[idx_value + 2] = rr[1] / nr2;
-      descrpt_a[idx_value + 3] = rr[2] / nr2;
+      value[0] = (FPTYPE)1. / nr;
+      value[1] = rr[0] / nr2;
+      value[2] = rr[1] / nr2;
+      value[3] = rr[2] / nr2;
       // deriv of component 1/r
-      descrpt_a_deriv[idx_deriv + 0] =
-          rr[0] * inr3 * sw - descrpt_a[idx_value + 0] * dsw * rr[0] * inr;
-      descrpt_a_deriv[idx_deriv + 1] =
-          rr[1] * inr3 * sw - descrpt_a[idx_value + 0] * dsw * rr[1] * inr;
-      descrpt_a_deriv[idx_deriv + 2] =
-          rr[2] * inr3 * sw - descrpt_a[idx_value + 0] * dsw * rr[2] * inr;
+      deriv[0] = rr[0] * inr3 * sw - value[0] * dsw * rr[0] * inr;
+      deriv[1] = rr[1] * inr3 * sw - value[0] * dsw * rr[1] * inr;
+      deriv[2] = rr[2] * inr3 * sw - value[0] * dsw * rr[2] * inr;
       // deriv of component x/r2
-      descrpt_a_deriv[idx_deriv + 3] =
-          ((FPTYPE)2. * rr[0] * rr[0] * inr4 - inr2) * sw -
-          descrpt_a[idx_value + 1] * dsw * rr[0] * inr;
-      descrpt_a_deriv[idx_deriv + 4] =
-          ((FPTYPE)2. * rr[0] * rr[1] * inr4) * sw -
-          descrpt_a[idx_value + 1] * dsw * rr[1] * inr;
-      descrpt_a_deriv[idx_deriv + 5] =
-          ((FPTYPE)2. * rr[0] * rr[2] * inr4) * sw -
-          descrpt_a[idx_value + 1] * dsw * rr[2] * inr;
+      deriv[3] = ((FPTYPE)2. * rr[0] * rr[0] * inr4 - inr2) * sw -
+                 value[1] * dsw * rr[0] * inr;
+      deriv[4] = ((FPTYPE)2. * rr[0] * rr[1] * inr4) * sw -
+                 value[1] * dsw * rr[1] * inr;
+      deriv[5] = ((FPTYPE)2. * rr[0] * rr[2] * inr4) * sw -
+                 value[1] * dsw * rr[2] * inr;
       // deriv of component y/r2
-      descrpt_a_deriv[idx_deriv + 6] =
-          ((FPTYPE)2. * rr[1] * rr[0] * inr4) * sw -
-          descrpt_a[idx_value + 2] * dsw * rr[0] * inr;
-      descrpt_a_deriv[idx_deriv + 7] =
-          ((FPTYPE)2. * rr[1] * rr[1] * inr4 - inr2) * sw -
-          descrpt_a[idx_value + 2] * dsw * rr[1] * inr;
-      descrpt_a_deriv[idx_deriv + 8] =
-          ((FPTYPE)2. * rr[1] * rr[2] * inr4) * sw -
-          descrpt_a[idx_value + 2] * dsw * rr[2] * inr;
+      deriv[6] = ((FPTYPE)2. * rr[1] * rr[0] * inr4) * sw -
+                 value[2] * dsw * rr[0] * inr;
+      deriv[7] = ((FPTYPE)2. * rr[1] * rr[1] * inr4 - inr2) * sw -
+                 value[2] * dsw * rr[1] * inr;
+      deriv[8] = ((FPTYPE)2. * rr[1] * rr[2] * inr4) * sw -
+                 value[2] * dsw * rr[2] * inr;
       // deriv of component z/r2
-      descrpt_a_deriv[idx_deriv + 9] =
-          ((FPTYPE)2. * rr[2] * rr[0] * inr4) * sw -
-          descrpt_a[idx_value + 3] * dsw * rr[0] * inr;
-      descrpt_a_deriv[idx_deriv + 10] =
-          ((FPTYPE)2. * rr[2] * rr[1] * inr4) * sw -
-          descrpt_a[idx_value + 3] * dsw * rr[1] * inr;
-      descrpt_a_deriv[idx_deriv + 11] =
-          ((FPTYPE)2. * rr[2] * rr[2] * inr4 - inr2) * sw -
-          descrpt_a[idx_value + 3] * dsw * rr[2] * inr;
+      deriv[9] = ((FPTYPE)2. * rr[2] * rr[0] * inr4) * sw -
+                 value[3] * dsw * rr[0] * inr;
+      deriv[10] = ((FPTYPE)2. * rr[2] * rr[1] * inr4) * sw -
+                  value[3] * dsw * rr[1] * inr;
+      deriv[11] = ((FPTYPE)2. * rr[2] * rr[2] * inr4 - inr2) * sw -
+                  value[3] * dsw * rr[2] * inr;
       // 4 value components
-      descrpt_a[idx_value + 0] *= sw;
-      descrpt_a[idx_value + 1] *= sw;
-      descrpt_a[idx_value + 2] *= sw;
-      descrpt_a[idx_value + 3] *= sw;
+      value[0] *= sw;
+      value[1] *= sw;
+      value[2] *= sw;
+      value[3] *= sw;
     }
+    // the padding of the section
+    const int nei_end = sec_a[sec_iter + 1];
+    std::fill(rij_a + nei_iter * 3, rij_a + nei_end * 3, (FPTYPE)0.);
+    std::fill(descrpt_a + nei_iter * 4, descrpt_a + nei_end * 4, (FPTYPE)0.);
+    std::fill(descrpt_a_deriv + nei_iter * 12, descrpt_a_deriv + nei_end * 12,
+              (FPTYPE)0.);
   }
 }
 
@@ -291,31 +292,35 @@ void deepmd::env_mat_r_cpu(std::vector<FPTYPE>& descrpt_a,
                            const std::vector<int>& sec,
                            const float& rmin,
                            const float& rmax) {
-  // compute the diff of the neighbors
   rij_a.resize(sec.back() * 3);
-  fill(rij_a.begin(), rij_a.end(), (FPTYPE)0.0);
-  for (int ii = 0; ii < int(sec.size()) - 1; ++ii) {
-    for (int jj = sec[ii]; jj < sec[ii + 1]; ++jj) {
-      if (fmt_nlist[jj] < 0) break;
-      const int& j_idx = fmt_nlist[jj];
-
-      for (int dd = 0; dd < 3; ++dd) {
-        rij_a[jj * 3 + dd] = posi[j_idx * 3 + dd] - posi[i_idx * 3 + dd];
-      }
-    }
-  }
-  // 1./rr, cos(theta), cos(phi), sin(phi)
+  // 1./rr
   descrpt_a.resize(sec.back());
-  fill(descrpt_a.begin(), descrpt_a.end(), (FPTYPE)0.0);
   // deriv wrt center: 3
   descrpt_a_deriv.resize(sec.back() * 3);
-  fill(descrpt_a_deriv.begin(), descrpt_a_deriv.end(), (FPTYPE)0.0);
+  env_mat_r_cpu(&descrpt_a[0], &descrpt_a_deriv[0], &rij_a[0], &posi[0], i_idx,
+                &fmt_nlist[0], sec, rmin, rmax);
+}
 
+template <typename FPTYPE>
+void deepmd::env_mat_r_cpu(FPTYPE* descrpt_r,
+                           FPTYPE* descrpt_r_deriv,
+                           FPTYPE* rij_r,
+                           const FPTYPE* posi,
+                           const int& i_idx,
+                           const int* fmt_nlist,
+                           const std::vector<int>& sec,
+                           const float& rmin,
+                           const float& rmax) {
   for (int sec_iter = 0; sec_iter < int(sec.size()) - 1; ++sec_iter) {
-    for (int nei_iter = sec[sec_iter]; nei_iter < sec[sec_iter + 1];
-         ++nei_iter) {
-      if (fmt_nlist[nei_iter] < 0) break;
-      const FPTYPE* rr = &rij_a[nei_iter * 3];
+    int nei_iter = sec[sec_iter];
+    for (; nei_iter < sec[sec_iter + 1]; ++nei_iter) {
+      const int j_idx = fmt_nlist[nei_iter];
+      if (j_idx < 0) break;
+      // compute the diff of the neighbor
+      FPTYPE* rr = &rij_r[nei_iter * 3];
+      for (int dd = 0; dd < 3; ++dd) {
+        rr[dd] = posi[j_idx * 3 + dd] - posi[i_idx * 3 + dd];
+      }
       FPTYPE nr2 = deepmd::dot3(rr, rr);
       FPTYPE inr = (FPTYPE)1. / sqrt(nr2);
       FPTYPE nr = nr2 * inr;
@@ -324,20 +329,21 @@ void deepmd::env_mat_r_cpu(std::vector<FPTYPE>& descrpt_a,
       FPTYPE inr3 = inr4 * nr;
       FPTYPE sw, dsw;
       deepmd::spline5_switch(sw, dsw, nr, rmin, rmax);
-      int idx_deriv = nei_iter * 3;  // 1 components time 3 directions
-      int idx_value = nei_iter;      // 1 components
-      // 4 value components
-      descrpt_a[idx_value + 0] = (FPTYPE)1. / nr;
+      FPTYPE* deriv = &descrpt_r_deriv[nei_iter * 3];  // 3 directions
+      // value component
+      FPTYPE value = (FPTYPE)1. / nr;
       // deriv of component 1/r
-      descrpt_a_deriv[idx_deriv + 0] =
-          rr[0] * inr3 * sw - descrpt_a[idx_value + 0] * dsw * rr[0] * inr;
-      descrpt_a_deriv[idx_deriv + 1] =
-          rr[1] * inr3 * sw - descrpt_a[idx_value + 0] * dsw * rr[1] * inr;
-      descrpt_a_deriv[idx_deriv + 2] =
-          rr[2] * inr3 * sw - descrpt_a[idx_value + 0] * dsw * rr[2] * inr;
-      // 4 value components
-      descrpt_a[idx_value + 0] *= sw;
+      deriv[0] = rr[0] * inr3 * sw - value * dsw * rr[0] * inr;
+      deriv[1] = rr[1] * inr3 * sw - value * dsw * rr[1] * inr;
+      deriv[2] = rr[2] * inr3 * sw - value * dsw * rr[2] * inr;
+      descrpt_r[nei_iter] = value * sw;
     }
+    // the padding of the section
+    const int nei_end = sec[sec_iter + 1];
+    std::fill(rij_r + nei_iter * 3, rij_r + nei_end * 3, (FPTYPE)0.);
+    std::fill(descrpt_r + nei_iter, descrpt_r + nei_end, (FPTYPE)0.);
+    std::fill(descrpt_r_deriv + nei_iter * 3, descrpt_r_deriv + nei_end * 3,
+              (FPTYPE)0.);
   }
 }
 
@@ -386,3 +392,43 @@ template void deepmd::env_mat_r_cpu<float>(std::vector<float>& descrpt_r,
                                            const std::vector<int>& sec,
                                            const float& rmin,
                                            const float& rmax);
+
+template void deepmd::env_mat_a_cpu<double>(double* descrpt_a,
+                                            double* descrpt_a_deriv,
+                                            double* rij_a,
+                                            const double* posi,
+                                            const int& i_idx,
+                                            const int* fmt_nlist_a,
+                                            const std::vector<int>& sec_a,
+                                            const float& rmin,
+                                            const float& rmax);
+
+template void deepmd::env_mat_a_cpu<float>(float* descrpt_a,
+                                           float* descrpt_a_deriv,
+                                           float* rij_a,
+                                           const float* posi,
+                                           const int& i_idx,
+                                           const int* fmt_nlist_a,
+                                           const std::vector<int>& sec_a,
+                                           const float& rmin,
+                                           const float& rmax);
+
+template void deepmd::env_mat_r_cpu<double>(double* descrpt_r,
+                                            double* descrpt_r_deriv,
+                                            double* rij_r,
+                                            const double* posi,
+                                            const int& i_idx,
+                                            const int* fmt_nlist,
+                                            const std::vector<int>& sec,
+                                            const float& rmin,
+                                            const float& rmax);
+
+template void deepmd::env_mat_r_cpu<float>(float* descrpt_r,
+                                           float* descrpt_r_deriv,
+                                           float* rij_r,
+                                           const float* posi,
+                                           const int& i_idx,
+                                           const int* fmt_nlist,
+                                           const std::vector<int>& sec,
+                                           const float& rmin,
+                                           const float& rmax);
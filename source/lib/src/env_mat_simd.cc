@@ -0,0 +1,419 @@
+#include <algorithm>
+#include <cmath>
+
+#include "env_mat.h"
+
+// The neighbors of a section are gathered into lanes of x, y and z
+// displacements (structure of arrays), so that the square root, the switch
+// function and the derivatives are evaluated by SIMD instructions. The same
+// kernel is compiled for AVX-512, AVX2 and the baseline ISA, and the best one
+// supported by the CPU is chosen at runtime.
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define ENV_MAT_SIMD_DISPATCH
+#define ENV_MAT_INLINE inline __attribute__((always_inline))
+#else
+#define ENV_MAT_INLINE inline
+#endif
+
+// number of neighbors in a batch, a multiple of the widest vector
+#define ENV_MAT_LANES 16
+
+// the switch function in the same form as spline5_switch, with xx clamped
+// to [rmin, rmax] instead of branching
+template <typename FPTYPE>
+static ENV_MAT_INLINE void spline5_switch_lane(FPTYPE& vv,
+                                               FPTYPE& dd,
+                                               const FPTYPE& xx,
+                                               const FPTYPE& rmin,
+                                               const FPTYPE& drange) {
+  FPTYPE uu = std::min(std::max((xx - rmin) / drange, (FPTYPE)0.), (FPTYPE)1.);
+  FPTYPE du = (FPTYPE)1. / drange;
+  vv = uu * uu * uu *
+           ((FPTYPE)-6. * uu * uu + (FPTYPE)15. * uu - (FPTYPE)10.) +
+       (FPTYPE)1.;
+  dd = ((FPTYPE)3. * uu * uu *
+            ((FPTYPE)-6. * uu * uu + (FPTYPE)15. * uu - (FPTYPE)10.) +
+        uu * uu * uu * ((FPTYPE)-12. * uu + (FPTYPE)15.)) *
+       du;
+}
+
+// gather the displacements of a batch, the unused lanes are kept finite
+template <typename FPTYPE>
+static ENV_MAT_INLINE void env_mat_gather(FPTYPE* xx,
+                                          FPTYPE* yy,
+                                          FPTYPE* zz,
+                                          const FPTYPE* posi,
+                                          const int& i_idx,
+                                          const int* fmt_nlist,
+                                          const int& nn) {
+  for (int kk = 0; kk < nn; ++kk) {
+    const int j_idx = fmt_nlist[kk];
+    xx[kk] = posi[j_idx * 3 + 0] - posi[i_idx * 3 + 0];
+    yy[kk] = posi[j_idx * 3 + 1] - posi[i_idx * 3 + 1];
+    zz[kk] = posi[j_idx * 3 + 2] - posi[i_idx * 3 + 2];
+  }
+  for (int kk = nn; kk < ENV_MAT_LANES; ++kk) {
+    xx[kk] = (FPTYPE)1.;
+    yy[kk] = (FPTYPE)0.;
+    zz[kk] = (FPTYPE)0.;
+  }
+}
+
+// one section of env_mat_a_simd_kernel, the neighbors in [nei_begin,
+// nei_begin + SEL) if SEL > 0 or else in [nei_begin, _nei_end)
+template <int SEL, bool DERIV, typename FPTYPE>
+static ENV_MAT_INLINE void env_mat_a_simd_section(FPTYPE* descrpt_a,
+                                                  FPTYPE* descrpt_a_deriv,
+                                                  FPTYPE* rij_a,
+                                                  const FPTYPE* posi,
+                                                  const int& i_idx,
+                                                  const int* fmt_nlist_a,
+                                                  const int nei_begin,
+                                                  const int _nei_end,
+                                                  const FPTYPE rmin_,
+                                                  const FPTYPE drange) {
+  const int nei_end = SEL > 0 ? nei_begin + SEL : _nei_end;
+  FPTYPE xx[ENV_MAT_LANES], yy[ENV_MAT_LANES], zz[ENV_MAT_LANES];
+  // 4 value components and 4 x 3 derivatives of each lane
+  FPTYPE out[16][ENV_MAT_LANES];
+  int nei_num = nei_begin;
+  while (nei_num < nei_end && fmt_nlist_a[nei_num] >= 0) {
+    ++nei_num;
+  }
+  for (int nei_iter = nei_begin; nei_iter < nei_num;
+       nei_iter += ENV_MAT_LANES) {
+    const int nn = std::min(ENV_MAT_LANES, nei_num - nei_iter);
+    env_mat_gather(xx, yy, zz, posi, i_idx, fmt_nlist_a + nei_iter, nn);
+#pragma omp simd
+    for (int kk = 0; kk < ENV_MAT_LANES; ++kk) {
+      const FPTYPE rr[3] = {xx[kk], yy[kk], zz[kk]};
+      FPTYPE nr2 = rr[0] * rr[0] + rr[1] * rr[1] + rr[2] * rr[2];
+      FPTYPE inr = (FPTYPE)1. / std::sqrt(nr2);
+      FPTYPE nr = nr2 * inr;
+      FPTYPE inr2 = inr * inr;
+      FPTYPE inr4 = inr2 * inr2;
+      FPTYPE inr3 = inr4 * nr;
+      FPTYPE sw, dsw;
+      spline5_switch_lane(sw, dsw, nr, rmin_, drange);
+      FPTYPE value0 = (FPTYPE)1. / nr;
+      FPTYPE value1 = rr[0] / nr2;
+      FPTYPE value2 = rr[1] / nr2;
+      FPTYPE value3 = rr[2] / nr2;
+      if (DERIV) {
+        // deriv of component 1/r
+        out[4][kk] = rr[0] * inr3 * sw - value0 * dsw * rr[0] * inr;
+        out[5][kk] = rr[1] * inr3 * sw - value0 * dsw * rr[1] * inr;
+        out[6][kk] = rr[2] * inr3 * sw - value0 * dsw * rr[2] * inr;
+        // deriv of component x/r2
+        out[7][kk] = ((FPTYPE)2. * rr[0] * rr[0] * inr4 - inr2) * sw -
+                     value1 * dsw * rr[0] * inr;
+        out[8][kk] = ((FPTYPE)2. * rr[0] * rr[1] * inr4) * sw -
+                     value1 * dsw * rr[1] * inr;
+        out[9][kk] = ((FPTYPE)2. * rr[0] * rr[2] * inr4) * sw -
+                     value1 * dsw * rr[2] * inr;
+        // deriv of component y/r2
+        out[10][kk] = ((FPTYPE)2. * rr[1] * rr[0] * inr4) * sw -
+                      value2 * dsw * rr[0] * inr;
+        out[11][kk] = ((FPTYPE)2. * rr[1] * rr[1] * inr4 - inr2) * sw -
+                      value2 * dsw * rr[1] * inr;
+        out[12][kk] = ((FPTYPE)2. * rr[1] * rr[2] * inr4) * sw -
+                      value2 * dsw * rr[2] * inr;
+        // deriv of component z/r2
+        out[13][kk] = ((FPTYPE)2. * rr[2] * rr[0] * inr4) * sw -
+                      value3 * dsw * rr[0] * inr;
+        out[14][kk] = ((FPTYPE)2. * rr[2] * rr[1] * inr4) * sw -
+                      value3 * dsw * rr[1] * inr;
+        out[15][kk] = ((FPTYPE)2. * rr[2] * rr[2] * inr4 - inr2) * sw -
+                      value3 * dsw * rr[2] * inr;
+      }
+      // 4 value components
+      out[0][kk] = value0 * sw;
+      out[1][kk] = value1 * sw;
+      out[2][kk] = value2 * sw;
+      out[3][kk] = value3 * sw;
+    }
+    // scatter to the array-of-structures outputs
+    for (int kk = 0; kk < nn; ++kk) {
+      const int nei = nei_iter + kk;
+      rij_a[nei * 3 + 0] = xx[kk];
+      rij_a[nei * 3 + 1] = yy[kk];
+      rij_a[nei * 3 + 2] = zz[kk];
+      for (int cc = 0; cc < 4; ++cc) {
+        descrpt_a[nei * 4 + cc] = out[cc][kk];
+      }
+      if (DERIV) {
+        for (int cc = 0; cc < 12; ++cc) {
+          descrpt_a_deriv[nei * 12 + cc] = out[4 + cc][kk];
+        }
+      }
+    }
+  }
+  // the padding of the section
+  std::fill(rij_a + nei_num * 3, rij_a + nei_end * 3, (FPTYPE)0.);
+  std::fill(descrpt_a + nei_num * 4, descrpt_a + nei_end * 4, (FPTYPE)0.);
+  if (DERIV) {
+    std::fill(descrpt_a_deriv + nei_num * 12, descrpt_a_deriv + nei_end * 12,
+              (FPTYPE)0.);
+  }
+}
+
+// The sections are also compiled with their width fixed to the common sel of
+// the example inputs, 46 and 92 of water and 60 and 120, so that the scan for
+// the padding and the padding itself have a constant bound. Other widths use
+// the generic section, SEL = 0. The gain of each width is measured by
+// source/lib/tests/bench_simd_widths.sh.
+#ifndef SIMD_GENERIC_WIDTH_ONLY
+#define ENV_MAT_SEL_CASE(N)                                                \
+  case N: {                                                                \
+    env_mat_a_simd_section<N, DERIV>(descrpt_a, descrpt_a_deriv, rij_a,    \
+                                     posi, i_idx, fmt_nlist_a, nei_begin,  \
+                                     nei_end, rmin_, drange);              \
+    break;                                                                 \
+  }
+#else
+#define ENV_MAT_SEL_CASE(N)
+#endif  // SIMD_GENERIC_WIDTH_ONLY
+
+template <bool DERIV, typename FPTYPE>
+static ENV_MAT_INLINE void env_mat_a_simd_kernel(FPTYPE* descrpt_a,
+                                                 FPTYPE* descrpt_a_deriv,
+                                                 FPTYPE* rij_a,
+                                                 const FPTYPE* posi,
+                                                 const int& i_idx,
+                                                 const int* fmt_nlist_a,
+                                                 const std::vector<int>& sec_a,
+                                                 const float& rmin,
+                                                 const float& rmax) {
+  const FPTYPE rmin_ = rmin;
+  const FPTYPE drange = rmax - rmin;
+  for (int sec_iter = 0; sec_iter < int(sec_a.size()) - 1; ++sec_iter) {
+    const int nei_begin = sec_a[sec_iter];
+    const int nei_end = sec_a[sec_iter + 1];
+    switch (nei_end - nei_begin) {
+      ENV_MAT_SEL_CASE(46)
+      ENV_MAT_SEL_CASE(60)
+      ENV_MAT_SEL_CASE(92)
+      ENV_MAT_SEL_CASE(120)
+      default: {
+        env_mat_a_simd_section<0, DERIV>(descrpt_a, descrpt_a_deriv, rij_a,
+                                         posi, i_idx, fmt_nlist_a, nei_begin,
+                                         nei_end, rmin_, drange);
+      }
+    }
+  }
+}
+#undef ENV_MAT_SEL_CASE
+
+template <bool DERIV, typename FPTYPE>
+static ENV_MAT_INLINE void env_mat_r_simd_kernel(FPTYPE* descrpt_r,
+                                                 FPTYPE* descrpt_r_deriv,
+                                                 FPTYPE* rij_r,
+                                                 const FPTYPE* posi,
+                                                 const int& i_idx,
+                                                 const int* fmt_nlist,
+                                                 const std::vector<int>& sec,
+                                                 const float& rmin,
+                                                 const float& rmax) {
+  const FPTYPE rmin_ = rmin;
+  const FPTYPE drange = rmax - rmin;
+  FPTYPE xx[ENV_MAT_LANES], yy[ENV_MAT_LANES], zz[ENV_MAT_LANES];
+  // 1 value component and 3 derivatives of each lane
+  FPTYPE out[4][ENV_MAT_LANES];
+  for (int sec_iter = 0; sec_iter < int(sec.size()) - 1; ++sec_iter) {
+    const int nei_end = sec[sec_iter + 1];
+    int nei_num = sec[sec_iter];
+    while (nei_num < nei_end && fmt_nlist[nei_num] >= 0) {
+      ++nei_num;
+    }
+    for (int nei_iter = sec[sec_iter]; nei_iter < nei_num;
+         nei_iter += ENV_MAT_LANES) {
+      const int nn = std::min(ENV_MAT_LANES, nei_num - nei_iter);
+      env_mat_gather(xx, yy, zz, posi, i_idx, fmt_nlist + nei_iter, nn);
+#pragma omp simd
+      for (int kk = 0; kk < ENV_MAT_LANES; ++kk) {
+        const FPTYPE rr[3] = {xx[kk], yy[kk], zz[kk]};
+        FPTYPE nr2 = rr[0] * rr[0] + rr[1] * rr[1] + rr[2] * rr[2];
+        FPTYPE inr = (FPTYPE)1. / std::sqrt(nr2);
+        FPTYPE nr = nr2 * inr;
+        FPTYPE inr2 = inr * inr;
+        FPTYPE inr4 = inr2 * inr2;
+        FPTYPE inr3 = inr4 * nr;
+        FPTYPE sw, dsw;
+        spline5_switch_lane(sw, dsw, nr, rmin_, drange);
+        FPTYPE value = (FPTYPE)1. / nr;
+        if (DERIV) {
+          // deriv of component 1/r
+          out[1][kk] = rr[0] * inr3 * sw - value * dsw * rr[0] * inr;
+          out[2][kk] = rr[1] * inr3 * sw - value * dsw * rr[1] * inr;
+          out[3][kk] = rr[2] * inr3 * sw - value * dsw * rr[2] * inr;
+        }
+        out[0][kk] = value * sw;
+      }
+      // scatter to the array-of-structures outputs
+      for (int kk = 0; kk < nn; ++kk) {
+        const int nei = nei_iter + kk;
+        rij_r[nei * 3 + 0] = xx[kk];
+        rij_r[nei * 3 + 1] = yy[kk];
+        rij_r[nei * 3 + 2] = zz[kk];
+        descrpt_r[nei] = out[0][kk];
+        if (DERIV) {
+          for (int dd = 0; dd < 3; ++dd) {
+            descrpt_r_deriv[nei * 3 + dd] = out[1 + dd][kk];
+          }
+        }
+      }
+    }
+    // the padding of the section
+    std::fill(rij_r + nei_num * 3, rij_r + nei_end * 3, (FPTYPE)0.);
+    std::fill(descrpt_r + nei_num, descrpt_r + nei_end, (FPTYPE)0.);
+    if (DERIV) {
+      std::fill(descrpt_r_deriv + nei_num * 3, descrpt_r_deriv + nei_end * 3,
+                (FPTYPE)0.);
+    }
+  }
+}
+
+#ifdef ENV_MAT_SIMD_DISPATCH
+// the kernels compiled for each ISA
+#define ENV_MAT_SIMD_VARIANT(name, kernel, isa)                            \
+  template <typename FPTYPE>                                               \
+  __attribute__((target(isa))) static void name(                           \
+      FPTYPE* descrpt, FPTYPE* descrpt_deriv, FPTYPE* rij,                 \
+      const FPTYPE* posi, const int& i_idx, const int* fmt_nlist,          \
+      const std::vector<int>& sec, const float& rmin, const float& rmax) { \
+    if (descrpt_deriv != NULL) {                                           \
+      kernel<true>(descrpt, descrpt_deriv, rij, posi, i_idx, fmt_nlist,    \
+                   sec, rmin, rmax);                                       \
+    } else {                                                               \
+      kernel<false>(descrpt, descrpt_deriv, rij, posi, i_idx, fmt_nlist,   \
+                    sec, rmin, rmax);                                      \
+    }                                                                      \
+  }
+ENV_MAT_SIMD_VARIANT(env_mat_a_simd_avx512,
+                     env_mat_a_simd_kernel,
+                     "avx512f,avx512dq,avx2,fma")
+ENV_MAT_SIMD_VARIANT(env_mat_a_simd_avx2, env_mat_a_simd_kernel, "avx2,fma")
+ENV_MAT_SIMD_VARIANT(env_mat_r_simd_avx512,
+                     env_mat_r_simd_kernel,
+                     "avx512f,avx512dq,avx2,fma")
+ENV_MAT_SIMD_VARIANT(env_mat_r_simd_avx2, env_mat_r_simd_kernel, "avx2,fma")
+#undef ENV_MAT_SIMD_VARIANT
+
+enum EnvMatIsa { ENV_MAT_BASE, ENV_MAT_AVX2, ENV_MAT_AVX512 };
+
+static EnvMatIsa env_mat_detect_isa() {
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512dq")) {
+    return ENV_MAT_AVX512;
+  } else if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) {
+    return ENV_MAT_AVX2;
+  } else {
+    return ENV_MAT_BASE;
+  }
+}
+
+static const EnvMatIsa env_mat_isa = env_mat_detect_isa();
+#endif  // ENV_MAT_SIMD_DISPATCH
+
+template <typename FPTYPE>
+void deepmd::env_mat_a_simd_cpu(FPTYPE* descrpt_a,
+                                FPTYPE* descrpt_a_deriv,
+                                FPTYPE* rij_a,
+                                const FPTYPE* posi,
+                                const int& i_idx,
+                                const int* fmt_nlist_a,
+                                const std::vector<int>& sec_a,
+                                const float& rmin,
+                                const float& rmax) {
+#ifdef ENV_MAT_SIMD_DISPATCH
+  if (env_mat_isa == ENV_MAT_AVX512) {
+    env_mat_a_simd_avx512(descrpt_a, descrpt_a_deriv, rij_a, posi, i_idx,
+                          fmt_nlist_a, sec_a, rmin, rmax);
+    return;
+  } else if (env_mat_isa == ENV_MAT_AVX2) {
+    env_mat_a_simd_avx2(descrpt_a, descrpt_a_deriv, rij_a, posi, i_idx,
+                        fmt_nlist_a, sec_a, rmin, rmax);
+    return;
+  }
+#endif
+  if (descrpt_a_deriv != NULL) {
+    env_mat_a_simd_kernel<true>(descrpt_a, descrpt_a_deriv, rij_a, posi, i_idx,
+                                fmt_nlist_a, sec_a, rmin, rmax);
+  } else {
+    env_mat_a_simd_kernel<false>(descrpt_a, descrpt_a_deriv, rij_a, posi, i_idx,
+                                 fmt_nlist_a, sec_a, rmin, rmax);
+  }
+}
+
+template <typename FPTYPE>
+void deepmd::env_mat_r_simd_cpu(FPTYPE* descrpt_r,
+                                FPTYPE* descrpt_r_deriv,
+                                FPTYPE* rij_r,
+                                const FPTYPE* posi,
+                                const int& i_idx,
+                                const int* fmt_nlist,
+                                const std::vector<int>& sec,
+                                const float& rmin,
+                                const float& rmax) {
+#ifdef ENV_MAT_SIMD_DISPATCH
+  if (env_mat_isa == ENV_MAT_AVX512) {
+    env_mat_r_simd_avx512(descrpt_r, descrpt_r_deriv, rij_r, posi, i_idx,
+                          fmt_nlist, sec, rmin, rmax);
+    return;
+  } else if (env_mat_isa == ENV_MAT_AVX2) {
+    env_mat_r_simd_avx2(descrpt_r, descrpt_r_deriv, rij_r, posi, i_idx,
+                        fmt_nlist, sec, rmin, rmax);
+    return;
+  }
+#endif
+  if (descrpt_r_deriv != NULL) {
+    env_mat_r_simd_kernel<true>(descrpt_r, descrpt_r_deriv, rij_r, posi, i_idx,
+                                fmt_nlist, sec, rmin, rmax);
+  } else {
+    env_mat_r_simd_kernel<false>(descrpt_r, descrpt_r_deriv, rij_r, posi, i_idx,
+                                 fmt_nlist, sec, rmin, rmax);
+  }
+}
+
+template void deepmd::env_mat_a_simd_cpu<double>(
+    double* descrpt_a,
+    double* descrpt_a_deriv,
+    double* rij_a,
+    const double* posi,
+    const int& i_idx,
+    const int* fmt_nlist_a,
+    const std::vector<int>& sec_a,
+    const float& rmin,
+    const float& rmax);
+
+template void deepmd::env_mat_a_simd_cpu<float>(float* descrpt_a,
+                                                float* descrpt_a_deriv,
+                                                float* rij_a,
+                                                const float* posi,
+                                                const int& i_idx,
+                                                const int* fmt_nlist_a,
+                                                const std::vector<int>& sec_a,
+                                                const float& rmin,
+                                                const float& rmax);
+
+template void deepmd::env_mat_r_simd_cpu<double>(
+    double* descrpt_r,
+    double* descrpt_r_deriv,
+    double* rij_r,
+    const double* posi,
+    const int& i_idx,
+    const int* fmt_nlist,
+    const std::vector<int>& sec,
+    const float& rmin,
+    const float& rmax);
+
+template void deepmd::env_mat_r_simd_cpu<float>(float* descrpt_r,
+                                                float* descrpt_r_deriv,
+                                                float* rij_r,
+                                                const float* posi,
+                                                const int& i_idx,
+                                                const int* fmt_nlist,
+                                                const std::vector<int>& sec,
+                                                const float& rmin,
+                                                const float& rmax);
@@ -6,7 +6,6 @@
 #include <vector>
 
 #include "SimulationRegion.h"
-#include "errors.h"
 
 using namespace deepmd;
 
@@ -93,6 +92,90 @@ int format_nlist_i_fill_a(std::vector<int> &fmt_nei_idx_a,
   return overflowed;
 }
 
+// candidate neighbor of a given type, ordered by (distance, index)
+struct NeighborDist {
+  float dist;
+  int index;
+  NeighborDist() : dist(0), index(0) {}
+  NeighborDist(float dd, int ii) : dist(dd), index(ii) {}
+  bool operator<(const NeighborDist &b) const {
+    return (dist < b.dist || (dist == b.dist && index < b.index));
+  }
+};
+
+// per-thread scratch of the type buckets, reused across atoms and calls
+static std::vector<std::vector<NeighborDist> > &format_nlist_buckets(
+    const int ntypes) {
+  static thread_local std::vector<std::vector<NeighborDist> > buckets;
+  if (buckets.size() < (size_t)ntypes) {
+    buckets.resize(ntypes);
+  }
+  for (int tt = 0; tt < ntypes; ++tt) {
+    buckets[tt].clear();
+  }
+  return buckets;
+}
+
+// rcut is float in the formatting, so float rr is enough
+template <typename FPTYPE>
+static inline float neighbor_dist2(const FPTYPE *posi,
+                                   const int i_idx,
+                                   const int j_idx) {
+  float diff[3];
+  for (int dd = 0; dd < 3; ++dd) {
+    diff[dd] = (float)posi[j_idx * 3 + dd] - (float)posi[i_idx * 3 + dd];
+  }
+  return deepmd::dot3(diff, diff);
+}
+
+// The candidates are bucketed by type, and only the nearest sel[type]
+// neighbors of each type are ordered. The result is identical to sorting
+// all candidates by (type, distance, index).
+template <typename FPTYPE>
+int deepmd::format_nlist_i_cpu(int *fmt_nei_idx_a,
+                               const FPTYPE *posi,
+                               const int *type,
+                               const int i_idx,
+                               const int *nei_idx_a,
+                               const int nei_num,
+                               const float rcut,
+                               const std::vector<int> &sec_a) {
+  const int ntypes = sec_a.size() - 1;
+  std::fill(fmt_nei_idx_a, fmt_nei_idx_a + sec_a.back(), -1);
+  std::vector<std::vector<NeighborDist> > &buckets =
+      format_nlist_buckets(ntypes);
+
+  float rcut2 = rcut * rcut;
+  for (int kk = 0; kk < nei_num; ++kk) {
+    const int j_idx = nei_idx_a[kk];
+    const int j_type = type[j_idx];
+    if (j_type < 0) continue;
+    float rr2 = neighbor_dist2(posi, i_idx, j_idx);
+    if (rr2 <= rcut2) {
+      buckets[j_type].push_back(NeighborDist(rr2, j_idx));
+    }
+  }
+
+  int overflowed = -1;
+  for (int tt = 0; tt < ntypes; ++tt) {
+    std::vector<NeighborDist> &bucket = buckets[tt];
+    const int sel = sec_a[tt + 1] - sec_a[tt];
+    int nkeep = bucket.size();
+    if (nkeep > sel) {
+      // only the nearest sel neighbors are kept
+      std::nth_element(bucket.begin(), bucket.begin() + sel, bucket.end());
+      nkeep = sel;
+      overflowed = tt;
+    }
+    std::sort(bucket.begin(), bucket.begin() + nkeep);
+    int *out = fmt_nei_idx_a + sec_a[tt];
+    for (int kk = 0; kk < nkeep; ++kk) {
+      out[kk] = bucket[kk].index;
+    }
+  }
+  return overflowed;
+}
+
 template <typename FPTYPE>
 int format_nlist_i_cpu(std::vector<int> &fmt_nei_idx_a,
                        const std::vector<FPTYPE> &posi,
@@ -102,76 +185,169 @@ int format_nlist_i_cpu(std::vector<int> &fmt_nei_idx_a,
                        const float &rcut,
                        const std::vector<int> &sec_a) {
   fmt_nei_idx_a.resize(sec_a.back());
-  fill(fmt_nei_idx_a.begin(), fmt_nei_idx_a.end(), -1);
+  return deepmd::format_nlist_i_cpu(&fmt_nei_idx_a[0], &posi[0], &type[0],
+                                    i_idx, nei_idx_a.data(), nei_idx_a.size(),
+                                    rcut, sec_a);
+}
 
-  // gether all neighbors
-  std::vector<int> nei_idx(nei_idx_a);
-  // allocate the information for all neighbors
-  std::vector<NeighborInfo<float> > sel_nei;
-  sel_nei.reserve(nei_idx_a.size());
-  float rcut2 = rcut * rcut;
-  for (unsigned kk = 0; kk < nei_idx.size(); ++kk) {
-    // rcut is float in this function, so float rr is enough
-    float diff[3];
-    const int &j_idx = nei_idx[kk];
-    if (type[j_idx] < 0) continue;
-    for (int dd = 0; dd < 3; ++dd) {
-      diff[dd] = (float)posi[j_idx * 3 + dd] - (float)posi[i_idx * 3 + dd];
-    }
-    float rr2 = deepmd::dot3(diff, diff);
-    if (rr2 <= rcut2) {
-      sel_nei.push_back(NeighborInfo<float>(type[j_idx], rr2, j_idx));
+template <typename FPTYPE>
+void deepmd::format_nlist_cpu(int *nlist,
+                              const InputNlist &in_nlist,
+                              const FPTYPE *coord,
+                              const int *type,
+                              const int nloc,
+                              const int /*nall*/,
+                              const float rcut,
+                              const std::vector<int> sec) {
+  const int nnei = sec.back();
+
+#pragma omp parallel for schedule(dynamic, 32)
+  for (int ii = 0; ii < in_nlist.inum; ++ii) {
+    int i_idx = in_nlist.ilist[ii];
+    format_nlist_i_cpu(nlist + i_idx * nnei, coord, type, i_idx,
+                       in_nlist.firstneigh[ii], in_nlist.numneigh[ii], rcut,
+                       sec);
+  }
+}
+
+// sort a bucket that is almost in (distance, index) order
+static void insertion_sort_neighbors(float *dist, int *jlist, const int nn) {
+  for (int kk = 1; kk < nn; ++kk) {
+    const float dd = dist[kk];
+    const int idx = jlist[kk];
+    int pp = kk - 1;
+    while (pp >= 0 && (dd < dist[pp] || (dd == dist[pp] && idx < jlist[pp]))) {
+      dist[pp + 1] = dist[pp];
+      jlist[pp + 1] = jlist[pp];
+      --pp;
     }
+    dist[pp + 1] = dd;
+    jlist[pp + 1] = idx;
   }
-  sort(sel_nei.begin(), sel_nei.end());
+}
 
-  std::vector<int> nei_iter = sec_a;
-  int overflowed = -1;
-  for (unsigned kk = 0; kk < sel_nei.size(); ++kk) {
-    const int &nei_type = sel_nei[kk].type;
-    if (nei_iter[nei_type] < sec_a[nei_type + 1]) {
-      fmt_nei_idx_a[nei_iter[nei_type]++] = sel_nei[kk].index;
-    } else {
-      overflowed = nei_type;
+// keep the nearest sel[type] neighbors within the cutoff
+static void format_nlist_i_order(int *fmt_nei_idx_a,
+                                 const deepmd::NeighborOrder &order,
+                                 const int i_idx,
+                                 const float rcut2,
+                                 const std::vector<int> &sec) {
+  const int ntypes = order.ntypes;
+  for (int tt = 0; tt < ntypes; ++tt) {
+    const int start = order.jrange[i_idx * ntypes + tt];
+    const int end = order.jrange[i_idx * ntypes + tt + 1];
+    int kk = 0;
+    for (int jj = sec[tt]; jj < sec[tt + 1]; ++jj, ++kk) {
+      if (start + kk < end && order.dist[start + kk] <= rcut2) {
+        fmt_nei_idx_a[jj] = order.jlist[start + kk];
+      } else {
+        fmt_nei_idx_a[jj] = -1;
+      }
     }
   }
-  return overflowed;
 }
 
 template <typename FPTYPE>
 void deepmd::format_nlist_cpu(int *nlist,
+                              NeighborOrder &order,
                               const InputNlist &in_nlist,
                               const FPTYPE *coord,
                               const int *type,
                               const int nloc,
                               const int nall,
                               const float rcut,
-                              const std::vector<int> sec) {
-  std::vector<FPTYPE> posi_(nall * 3);
-  std::vector<int> type_(nall);
-  std::copy(coord, coord + nall * 3, posi_.begin());
-  std::copy(type, type + nall, type_.begin());
-  std::vector<int> ilist, fmt_ilist;
-  int nnei = sec.back();
+                              const std::vector<int> sec,
+                              const bool reuse) {
+  const int ntypes = sec.size() - 1;
+  const int nnei = sec.back();
+  const float rcut2 = rcut * rcut;
+
+  if (reuse && order.nloc == nloc && order.nall == nall &&
+      order.ntypes == ntypes) {
+    // the candidates are unchanged, repair the order of each bucket
+#pragma omp parallel for schedule(dynamic, 32)
+    for (int ii = 0; ii < nloc; ++ii) {
+      for (int tt = 0; tt < ntypes; ++tt) {
+        const int start = order.jrange[ii * ntypes + tt];
+        const int end = order.jrange[ii * ntypes + tt + 1];
+        for (int kk = start; kk < end; ++kk) {
+          order.dist[kk] = neighbor_dist2(coord, ii, order.jlist[kk]);
+        }
+        insertion_sort_neighbors(&order.dist[start], &order.jlist[start],
+                                 end - start);
+      }
+      format_nlist_i_order(nlist + ii * nnei, order, ii, rcut2, sec);
+    }
+    return;
+  }
 
+  order.nloc = nloc;
+  order.nall = nall;
+  order.ntypes = ntypes;
+  // count the candidates of each type
+  order.jrange.assign(nloc * ntypes + 1, 0);
+#pragma omp parallel for
   for (int ii = 0; ii < in_nlist.inum; ++ii) {
-    int i_idx = in_nlist.ilist[ii];
-    int i_num = in_nlist.numneigh[ii];
-    ilist.resize(i_num);
-    std::copy(in_nlist.firstneigh[ii], in_nlist.firstneigh[ii] + i_num,
-              ilist.begin());
-    format_nlist_i_cpu(fmt_ilist, posi_, type_, i_idx, ilist, rcut, sec);
-    int *cur_nlist = nlist + i_idx * nnei;
-    if (fmt_ilist.size() != nnei) {
-      std::cerr << "FATAL: formatted nlist of i have length "
-                << fmt_ilist.size() << " which does not match " << nnei
-                << std::endl;
-      throw deepmd::deepmd_exception();
+    const int i_idx = in_nlist.ilist[ii];
+    int *count = &order.jrange[i_idx * ntypes + 1];
+    for (int jj = 0; jj < in_nlist.numneigh[ii]; ++jj) {
+      const int j_type = type[in_nlist.firstneigh[ii][jj]];
+      if (j_type >= 0) {
+        count[j_type]++;
+      }
     }
-    std::copy(fmt_ilist.begin(), fmt_ilist.end(), cur_nlist);
+  }
+  for (int ii = 0; ii < nloc * ntypes; ++ii) {
+    order.jrange[ii + 1] += order.jrange[ii];
+  }
+  order.jlist.resize(order.jrange.back());
+  order.dist.resize(order.jrange.back());
+
+  // fully sort each bucket
+  std::fill(nlist, nlist + nloc * nnei, -1);
+#pragma omp parallel for schedule(dynamic, 32)
+  for (int ii = 0; ii < in_nlist.inum; ++ii) {
+    const int i_idx = in_nlist.ilist[ii];
+    std::vector<std::vector<NeighborDist> > &buckets =
+        format_nlist_buckets(ntypes);
+    for (int jj = 0; jj < in_nlist.numneigh[ii]; ++jj) {
+      const int j_idx = in_nlist.firstneigh[ii][jj];
+      const int j_type = type[j_idx];
+      if (j_type < 0) continue;
+      buckets[j_type].push_back(
+          NeighborDist(neighbor_dist2(coord, i_idx, j_idx), j_idx));
+    }
+    for (int tt = 0; tt < ntypes; ++tt) {
+      std::sort(buckets[tt].begin(), buckets[tt].end());
+      const int start = order.jrange[i_idx * ntypes + tt];
+      const int nn = buckets[tt].size();
+      for (int kk = 0; kk < nn; ++kk) {
+        order.dist[start + kk] = buckets[tt][kk].dist;
+        order.jlist[start + kk] = buckets[tt][kk].index;
+      }
+    }
+    format_nlist_i_order(nlist + i_idx * nnei, order, i_idx, rcut2, sec);
   }
 }
 
+template int deepmd::format_nlist_i_cpu<double>(int *fmt_nei_idx_a,
+                                                const double *posi,
+                                                const int *type,
+                                                const int i_idx,
+                                                const int *nei_idx_a,
+                                                const int nei_num,
+                                                const float rcut,
+                                                const std::vector<int> &sec_a);
+
+template int deepmd::format_nlist_i_cpu<float>(int *fmt_nei_idx_a,
+                                               const float *posi,
+                                               const int *type,
+                                               const int i_idx,
+                                               const int *nei_idx_a,
+                                               const int nei_num,
+                                               const float rcut,
+                                               const std::vector<int> &sec_a);
+
 template int format_nlist_i_cpu<double>(std::vector<int> &fmt_nei_idx_a,
                                         const std::vector<double> &posi,
                                         const std::vector<int> &type,
@@ -207,3 +383,27 @@ template void deepmd::format_nlist_cpu<float>(
     const int nall,
     const float rcut,
     const std::vector<int> sec);
+
+template void deepmd::format_nlist_cpu<double>(
+    int *nlist,
+    deepmd::NeighborOrder &order,
+    const deepmd::InputNlist &in_nlist,
+    const double *coord,
+    const int *type,
+    const int nloc,
+    const int nall,
+    const float rcut,
+    const std::vector<int> sec,
+    const bool reuse);
+
+template void deepmd::format_nlist_cpu<float>(
+    int *nlist,
+    deepmd::NeighborOrder &order,
+    const deepmd::InputNlist &in_nlist,
+    const float *coord,
+    const int *type,
+    const int nloc,
+    const int nall,
+    const float rcut,
+    const std::vector<int> sec,
+    const bool reuse);
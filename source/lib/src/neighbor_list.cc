@@ -1,8 +1,13 @@
 #include "neighbor_list.h"
 
+#include <cmath>
 #include <iostream>
 #include <limits>
+#if defined(_OPENMP)
+#include <omp.h>
+#endif
 
+#include "coord.h"
 #include "device.h"
 // #include <iomanip>
 
@@ -788,33 +793,211 @@ int deepmd::build_nlist_cpu(InputNlist& nlist,
   *max_list_size = 0;
   nlist.inum = nloc;
   FPTYPE rcut2 = rcut * rcut;
-  std::vector<int> jlist;
-  jlist.reserve(mem_size);
-  for (int ii = 0; ii < nlist.inum; ++ii) {
-    nlist.ilist[ii] = ii;
-    jlist.clear();
+  if (nloc <= 0) {
+    return 0;
+  }
+  // the copied coords are not periodic, so bin them in the axis-aligned
+  // bounding box. this works for any (triclinic) simulation box.
+  FPTYPE lower[3], upper[3];
+  for (int dd = 0; dd < 3; ++dd) {
+    lower[dd] = upper[dd] = c_cpy[dd];
+  }
+  for (int jj = 1; jj < nall; ++jj) {
+    for (int dd = 0; dd < 3; ++dd) {
+      lower[dd] = std::min(lower[dd], c_cpy[jj * 3 + dd]);
+      upper[dd] = std::max(upper[dd], c_cpy[jj * 3 + dd]);
+    }
+  }
+  FPTYPE boxt[9] = {0.};
+  for (int dd = 0; dd < 3; ++dd) {
+    boxt[dd * 3 + dd] = std::max(upper[dd] - lower[dd], (FPTYPE)rcut) +
+                        (FPTYPE)rcut * (FPTYPE)1e-3;
+  }
+  // use cells not smaller than rcut, and no more cells than atoms, so the
+  // cell list stays O(nall) in memory for sparse systems
+  float rbin = rcut;
+  FPTYPE vol_per_atom = boxt[0] * boxt[4] * boxt[8] / (FPTYPE)nall;
+  if (vol_per_atom > (FPTYPE)rbin * rbin * rbin) {
+    rbin = std::cbrt(vol_per_atom);
+  }
+  Region<FPTYPE> region;
+  init_region_cpu(region, boxt);
+  int cell_info[23];
+  compute_cell_info(cell_info, rbin, region);
+  const int* ncell = cell_info + 3;
+  const int* cell_iter = cell_info + 18;
+  const int loc_cellnum = cell_info[21];
+  FPTYPE cell_size[3];
+  for (int dd = 0; dd < 3; ++dd) {
+    cell_size[dd] = boxt[dd * 3 + dd] / ncell[dd];
+  }
+
+  // build the cell list in CSR layout by counting sort, atoms in a cell are
+  // stored in ascending order
+  std::vector<int> atom_cell(nall);
+  std::vector<int> cell_start(loc_cellnum + 1, 0);
+  std::vector<int> cell_atoms(nall);
+#pragma omp parallel for
+  for (int jj = 0; jj < nall; ++jj) {
+    int idx[3];
+    for (int dd = 0; dd < 3; ++dd) {
+      idx[dd] = (c_cpy[jj * 3 + dd] - lower[dd]) / cell_size[dd];
+      idx[dd] = std::max(0, std::min(idx[dd], ncell[dd] - 1));
+    }
+    atom_cell[jj] = (idx[0] * ncell[1] + idx[1]) * ncell[2] + idx[2];
+  }
+  for (int jj = 0; jj < nall; ++jj) {
+    cell_start[atom_cell[jj] + 1]++;
+  }
+  for (int cc = 0; cc < loc_cellnum; ++cc) {
+    cell_start[cc + 1] += cell_start[cc];
+  }
+  {
+    std::vector<int> cell_fill(cell_start.begin(), cell_start.end() - 1);
     for (int jj = 0; jj < nall; ++jj) {
-      if (jj == ii) continue;
-      FPTYPE diff[3];
+      cell_atoms[cell_fill[atom_cell[jj]]++] = jj;
+    }
+  }
+
+  int max_size = 0;
+  bool overflowed = false;
+#pragma omp parallel reduction(max : max_size) reduction(|| : overflowed)
+  {
+    std::vector<int> jlist;
+    jlist.reserve(mem_size);
+#pragma omp for schedule(dynamic, 64)
+    for (int ii = 0; ii < nloc; ++ii) {
+      nlist.ilist[ii] = ii;
+      jlist.clear();
+      int cidx[3];
+      int ci = atom_cell[ii];
+      cidx[2] = ci % ncell[2];
+      cidx[1] = (ci / ncell[2]) % ncell[1];
+      cidx[0] = ci / (ncell[2] * ncell[1]);
+      int tidx[3], tstt[3], tend[3];
       for (int dd = 0; dd < 3; ++dd) {
-        diff[dd] = c_cpy[ii * 3 + dd] - c_cpy[jj * 3 + dd];
+        tstt[dd] = std::max(0, cidx[dd] - cell_iter[dd]);
+        tend[dd] = std::min(ncell[dd], cidx[dd] + cell_iter[dd] + 1);
       }
-      FPTYPE diff2 = deepmd::dot3(diff, diff);
-      if (diff2 < rcut2) {
-        jlist.push_back(jj);
+      for (tidx[0] = tstt[0]; tidx[0] < tend[0]; ++tidx[0]) {
+        for (tidx[1] = tstt[1]; tidx[1] < tend[1]; ++tidx[1]) {
+          for (tidx[2] = tstt[2]; tidx[2] < tend[2]; ++tidx[2]) {
+            int tc = (tidx[0] * ncell[1] + tidx[1]) * ncell[2] + tidx[2];
+            for (int kk = cell_start[tc]; kk < cell_start[tc + 1]; ++kk) {
+              int jj = cell_atoms[kk];
+              if (jj == ii) continue;
+              FPTYPE diff[3];
+              for (int dd = 0; dd < 3; ++dd) {
+                diff[dd] = c_cpy[ii * 3 + dd] - c_cpy[jj * 3 + dd];
+              }
+              FPTYPE diff2 = deepmd::dot3(diff, diff);
+              if (diff2 < rcut2) {
+                jlist.push_back(jj);
+              }
+            }
+          }
+        }
       }
-    }
-    if (jlist.size() > mem_size) {
-      *max_list_size = jlist.size();
-      return 1;
-    } else {
+      // keep the ascending order of the all-pair search
+      std::sort(jlist.begin(), jlist.end());
       int list_size = jlist.size();
-      nlist.numneigh[ii] = list_size;
-      if (list_size > *max_list_size) *max_list_size = list_size;
-      std::copy(jlist.begin(), jlist.end(), nlist.firstneigh[ii]);
+      if (list_size > max_size) max_size = list_size;
+      if (list_size > mem_size) {
+        overflowed = true;
+      } else {
+        nlist.numneigh[ii] = list_size;
+        std::copy(jlist.begin(), jlist.end(), nlist.firstneigh[ii]);
+      }
+    }
+  }
+  *max_list_size = max_size;
+  return overflowed ? 1 : 0;
+}
+
+void deepmd::build_reverse_nlist_cpu(std::vector<int>& rev_start,
+                                     std::vector<int>& rev_slot,
+                                     const int* nlist,
+                                     const int nloc,
+                                     const int nall,
+                                     const int nnei,
+                                     const int start_index) {
+  int nchunk = 1;
+#if defined(_OPENMP)
+  nchunk = omp_get_max_threads();
+#endif
+  const int chunk = nloc / nchunk + 1;
+  // the local atoms are split into nchunk contiguous chunks. chunk tc only
+  // counts the neighbors in [lo[tc], hi[tc]], the range its slots point to,
+  // so that the counts of all chunks take about as many ints as the
+  // neighbors seen by the chunks instead of nchunk * nall.
+  std::vector<int> lo(nchunk, 0), hi(nchunk, -1);
+#pragma omp parallel for schedule(static, 1)
+  for (int tc = 0; tc < nchunk; ++tc) {
+    const int i_start = start_index + std::min(tc * chunk, nloc);
+    const int i_end = start_index + std::min((tc + 1) * chunk, nloc);
+    int jlo = nall, jhi = -1;
+    for (int ii = i_start * nnei; ii < i_end * nnei; ++ii) {
+      if (nlist[ii] < 0) continue;
+      jlo = std::min(jlo, nlist[ii]);
+      jhi = std::max(jhi, nlist[ii]);
+    }
+    if (jhi >= 0) {
+      lo[tc] = jlo;
+      hi[tc] = jhi;
+    }
+  }
+  // the counts of chunk tc start from counts[base[tc]], the slots of chunk tc
+  // pointing to j_idx are recorded in counts[base[tc] + j_idx - lo[tc]]
+  std::vector<size_t> base(nchunk + 1, 0);
+  for (int tc = 0; tc < nchunk; ++tc) {
+    base[tc + 1] = base[tc] + (hi[tc] - lo[tc] + 1);
+  }
+  std::vector<int> counts(base[nchunk], 0);
+#pragma omp parallel for schedule(static, 1)
+  for (int tc = 0; tc < nchunk; ++tc) {
+    int* count = counts.data() + base[tc];
+    const int i_start = start_index + std::min(tc * chunk, nloc);
+    const int i_end = start_index + std::min((tc + 1) * chunk, nloc);
+    for (int ii = i_start * nnei; ii < i_end * nnei; ++ii) {
+      if (nlist[ii] >= 0) count[nlist[ii] - lo[tc]]++;
+    }
+  }
+  rev_start.resize(nall + 1);
+  rev_start[0] = 0;
+#pragma omp parallel for
+  for (int j_idx = 0; j_idx < nall; ++j_idx) {
+    int nrev = 0;
+    for (int tc = 0; tc < nchunk; ++tc) {
+      if (j_idx < lo[tc] || j_idx > hi[tc]) continue;
+      nrev += counts[base[tc] + j_idx - lo[tc]];
+    }
+    rev_start[j_idx + 1] = nrev;
+  }
+  for (int j_idx = 0; j_idx < nall; ++j_idx) {
+    rev_start[j_idx + 1] += rev_start[j_idx];
+  }
+  // turn the counts into the offsets where the chunks write their slots
+#pragma omp parallel for
+  for (int j_idx = 0; j_idx < nall; ++j_idx) {
+    int offset = rev_start[j_idx];
+    for (int tc = 0; tc < nchunk; ++tc) {
+      if (j_idx < lo[tc] || j_idx > hi[tc]) continue;
+      const size_t idx = base[tc] + j_idx - lo[tc];
+      const int nrev = counts[idx];
+      counts[idx] = offset;
+      offset += nrev;
+    }
+  }
+  rev_slot.resize(rev_start[nall]);
+#pragma omp parallel for schedule(static, 1)
+  for (int tc = 0; tc < nchunk; ++tc) {
+    int* offset = counts.data() + base[tc];
+    const int i_start = start_index + std::min(tc * chunk, nloc);
+    const int i_end = start_index + std::min((tc + 1) * chunk, nloc);
+    for (int ii = i_start * nnei; ii < i_end * nnei; ++ii) {
+      if (nlist[ii] >= 0) rev_slot[offset[nlist[ii] - lo[tc]]++] = ii;
     }
   }
-  return 0;
 }
 
 void deepmd::use_nei_info_cpu(int* nlist,
@@ -2,7 +2,9 @@
 
 #include <string.h>
 
+#include <algorithm>
 #include <cassert>
+#include <cstddef>
 #include <iostream>
 
 #include "env_mat.h"
@@ -18,7 +20,7 @@ void deepmd::prod_env_mat_a_cpu(FPTYPE *em,
                                 const FPTYPE *coord,
                                 const int *type,
                                 const InputNlist &inlist,
-                                const int max_nbor_size,
+                                const int /*max_nbor_size*/,
                                 const FPTYPE *avg,
                                 const FPTYPE *std,
                                 const int nloc,
@@ -26,82 +28,59 @@ void deepmd::prod_env_mat_a_cpu(FPTYPE *em,
                                 const float rcut,
                                 const float rcut_smth,
                                 const std::vector<int> sec,
-                                const int *f_type) {
+                                const int *f_type,
+                                NeighborOrder *nbor_order,
+                                const bool reuse_nbor_order) {
   if (f_type == NULL) {
     f_type = type;
   }
   const int nnei = sec.back();
   const int nem = nnei * 4;
 
-  // set & normalize coord
-  std::vector<FPTYPE> d_coord3(nall * 3);
-  for (int ii = 0; ii < nall; ++ii) {
-    for (int dd = 0; dd < 3; ++dd) {
-      d_coord3[ii * 3 + dd] = coord[ii * 3 + dd];
-    }
-  }
-
-  // set type
-  std::vector<int> d_f_type(nall);
-  for (int ii = 0; ii < nall; ++ii) {
-    d_f_type[ii] = f_type[ii];
-  }
-
-  // build nlist
-  std::vector<std::vector<int> > d_nlist_a(nloc);
-
   assert(nloc == inlist.inum);
-  for (unsigned ii = 0; ii < nloc; ++ii) {
-    d_nlist_a[ii].reserve(max_nbor_size);
-  }
-  for (unsigned ii = 0; ii < nloc; ++ii) {
-    int i_idx = inlist.ilist[ii];
-    for (unsigned jj = 0; jj < inlist.numneigh[ii]; ++jj) {
-      int j_idx = inlist.firstneigh[ii][jj];
-      d_nlist_a[i_idx].push_back(j_idx);
-    }
+  if (nbor_order != NULL) {
+    // format all at once, keeping the neighbor order for the next call
+    format_nlist_cpu(nlist, *nbor_order, inlist, coord, f_type, nloc, nall,
+                     rcut, sec, reuse_nbor_order);
   }
 
-#pragma omp parallel for
+  // the outputs of each atom are written in place, and the scratch of the
+  // formatting is kept by each thread
+#pragma omp parallel for schedule(dynamic, 32)
   for (int ii = 0; ii < nloc; ++ii) {
-    std::vector<int> fmt_nlist_a;
-    int ret = format_nlist_i_cpu(fmt_nlist_a, d_coord3, d_f_type, ii,
-                                 d_nlist_a[ii], rcut, sec);
-    std::vector<FPTYPE> d_em_a;
-    std::vector<FPTYPE> d_em_a_deriv;
-    std::vector<FPTYPE> d_em_r;
-    std::vector<FPTYPE> d_em_r_deriv;
-    std::vector<FPTYPE> d_rij_a;
-    env_mat_a_cpu(d_em_a, d_em_a_deriv, d_rij_a, d_coord3, d_f_type, ii,
-                  fmt_nlist_a, sec, rcut_smth, rcut);
-
-    // check sizes
-    assert(d_em_a.size() == nem);
-    assert(d_em_a_deriv.size() == nem * 3);
-    assert(d_rij_a.size() == nnei * 3);
-    assert(fmt_nlist_a.size() == nnei);
-    // record outputs
-    for (int jj = 0; jj < nem; ++jj) {
-      if (type[ii] >= 0) {
-        em[ii * nem + jj] =
-            (d_em_a[jj] - avg[type[ii] * nem + jj]) / std[type[ii] * nem + jj];
-      } else {
-        em[ii * nem + jj] = 0;
-      }
+    const int i_idx = inlist.ilist[ii];
+    int *i_nlist = nlist + i_idx * nnei;
+    if (nbor_order == NULL) {
+      format_nlist_i_cpu(i_nlist, coord, f_type, i_idx, inlist.firstneigh[ii],
+                         inlist.numneigh[ii], rcut, sec);
     }
-    for (int jj = 0; jj < nem * 3; ++jj) {
-      if (type[ii] >= 0) {
-        em_deriv[ii * nem * 3 + jj] =
-            d_em_a_deriv[jj] / std[type[ii] * nem + jj / 3];
-      } else {
-        em_deriv[ii * nem * 3 + jj] = 0;
+    FPTYPE *i_em = em + i_idx * nem;
+    FPTYPE *i_em_deriv = em_deriv ? em_deriv + i_idx * nem * 3 : NULL;
+    env_mat_a_simd_cpu(i_em, i_em_deriv, rij + i_idx * nnei * 3, coord, i_idx,
+                       i_nlist, sec, rcut_smth, rcut);
+    // normalize
+    if (type[i_idx] >= 0) {
+      const FPTYPE *i_avg = avg + type[i_idx] * nem;
+      const FPTYPE *i_std = std + type[i_idx] * nem;
+      for (int jj = 0; jj < nem; ++jj) {
+        i_em[jj] = (i_em[jj] - i_avg[jj]) / i_std[jj];
+      }
+      if (i_em_deriv) {
+        // the neighbors of each type are packed at the beginning of their
+        // section, and the derivative of the padding is already zero
+        for (int tt = 0; tt < int(sec.size()) - 1; ++tt) {
+          for (int jj = sec[tt]; jj < sec[tt + 1] && i_nlist[jj] >= 0; ++jj) {
+            for (int kk = jj * 4 * 3; kk < (jj + 1) * 4 * 3; ++kk) {
+              i_em_deriv[kk] = i_em_deriv[kk] / i_std[kk / 3];
+            }
+          }
+        }
+      }
+    } else {
+      std::fill(i_em, i_em + nem, (FPTYPE)0.);
+      if (i_em_deriv) {
+        std::fill(i_em_deriv, i_em_deriv + nem * 3, (FPTYPE)0.);
       }
-    }
-    for (int jj = 0; jj < nnei * 3; ++jj) {
-      rij[ii * nnei * 3 + jj] = d_rij_a[jj];
-    }
-    for (int jj = 0; jj < nnei; ++jj) {
-      nlist[ii * nnei + jj] = fmt_nlist_a[jj];
     }
   }
 }
@@ -114,78 +93,54 @@ void deepmd::prod_env_mat_r_cpu(FPTYPE *em,
                                 const FPTYPE *coord,
                                 const int *type,
                                 const InputNlist &inlist,
-                                const int max_nbor_size,
+                                const int /*max_nbor_size*/,
                                 const FPTYPE *avg,
                                 const FPTYPE *std,
                                 const int nloc,
                                 const int nall,
                                 const float rcut,
                                 const float rcut_smth,
-                                const std::vector<int> sec) {
+                                const std::vector<int> sec,
+                                NeighborOrder *nbor_order,
+                                const bool reuse_nbor_order) {
   const int nnei = sec.back();
   const int nem = nnei * 1;
 
-  // set & normalize coord
-  std::vector<FPTYPE> d_coord3(nall * 3);
-  for (int ii = 0; ii < nall; ++ii) {
-    for (int dd = 0; dd < 3; ++dd) {
-      d_coord3[ii * 3 + dd] = coord[ii * 3 + dd];
-    }
-  }
-
-  // set type
-  std::vector<int> d_type(nall);
-  for (int ii = 0; ii < nall; ++ii) {
-    d_type[ii] = type[ii];
-  }
-
-  // build nlist
-  std::vector<std::vector<int> > d_nlist_a(nloc);
-
   assert(nloc == inlist.inum);
-  for (unsigned ii = 0; ii < nloc; ++ii) {
-    d_nlist_a[ii].reserve(max_nbor_size);
-  }
-  for (unsigned ii = 0; ii < nloc; ++ii) {
-    int i_idx = inlist.ilist[ii];
-    for (unsigned jj = 0; jj < inlist.numneigh[ii]; ++jj) {
-      int j_idx = inlist.firstneigh[ii][jj];
-      d_nlist_a[i_idx].push_back(j_idx);
-    }
+  if (nbor_order != NULL) {
+    // format all at once, keeping the neighbor order for the next call
+    format_nlist_cpu(nlist, *nbor_order, inlist, coord, type, nloc, nall, rcut,
+                     sec, reuse_nbor_order);
   }
 
-#pragma omp parallel for
+  // the outputs of each atom are written in place
+#pragma omp parallel for schedule(dynamic, 32)
   for (int ii = 0; ii < nloc; ++ii) {
-    std::vector<int> fmt_nlist_a;
-    int ret = format_nlist_i_cpu(fmt_nlist_a, d_coord3, d_type, ii,
-                                 d_nlist_a[ii], rcut, sec);
-    std::vector<FPTYPE> d_em_a;
-    std::vector<FPTYPE> d_em_a_deriv;
-    std::vector<FPTYPE> d_em_r;
-    std::vector<FPTYPE> d_em_r_deriv;
-    std::vector<FPTYPE> d_rij_a;
-    env_mat_r_cpu(d_em_a, d_em_a_deriv, d_rij_a, d_coord3, d_type, ii,
-                  fmt_nlist_a, sec, rcut_smth, rcut);
-
-    // check sizes
-    assert(d_em_a.size() == nem);
-    assert(d_em_a_deriv.size() == nem * 3);
-    assert(d_rij_a.size() == nnei * 3);
-    assert(fmt_nlist_a.size() == nnei);
-    // record outputs
-    for (int jj = 0; jj < nem; ++jj) {
-      em[ii * nem + jj] = (d_em_a[jj] - avg[d_type[ii] * nem + jj]) /
-                          std[d_type[ii] * nem + jj];
+    const int i_idx = inlist.ilist[ii];
+    int *i_nlist = nlist + i_idx * nnei;
+    if (nbor_order == NULL) {
+      format_nlist_i_cpu(i_nlist, coord, type, i_idx, inlist.firstneigh[ii],
+                         inlist.numneigh[ii], rcut, sec);
     }
-    for (int jj = 0; jj < nem * 3; ++jj) {
-      em_deriv[ii * nem * 3 + jj] =
-          d_em_a_deriv[jj] / std[d_type[ii] * nem + jj / 3];
-    }
-    for (int jj = 0; jj < nnei * 3; ++jj) {
-      rij[ii * nnei * 3 + jj] = d_rij_a[jj];
+    FPTYPE *i_em = em + i_idx * nem;
+    FPTYPE *i_em_deriv = em_deriv ? em_deriv + i_idx * nem * 3 : NULL;
+    env_mat_r_simd_cpu(i_em, i_em_deriv, rij + i_idx * nnei * 3, coord, i_idx,
+                       i_nlist, sec, rcut_smth, rcut);
+    // normalize
+    const FPTYPE *i_avg = avg + type[i_idx] * nem;
+    const FPTYPE *i_std = std + type[i_idx] * nem;
+    for (int jj = 0; jj < nem; ++jj) {
+      i_em[jj] = (i_em[jj] - i_avg[jj]) / i_std[jj];
     }
-    for (int jj = 0; jj < nnei; ++jj) {
-      nlist[ii * nnei + jj] = fmt_nlist_a[jj];
+    if (i_em_deriv) {
+      // only the packed neighbors, the derivative of the padding is zero
+      for (int tt = 0; tt < int(sec.size()) - 1; ++tt) {
+        for (int jj = sec[tt]; jj < sec[tt + 1] && i_nlist[jj] >= 0; ++jj) {
+          for (int kk = jj * 3; kk < (jj + 1) * 3; ++kk) {
+            i_em_deriv[kk] = i_em_deriv[kk] / i_std[jj];
+          }
+        }
+      }
     }
   }
 }
@@ -205,7 +160,9 @@ template void deepmd::prod_env_mat_a_cpu<double>(double *em,
                                                  const float rcut,
                                                  const float rcut_smth,
                                                  const std::vector<int> sec,
-                                                 const int *f_type);
+                                                 const int *f_type,
+                                                 NeighborOrder *nbor_order,
+                                                 const bool reuse_nbor_order);
 
 template void deepmd::prod_env_mat_a_cpu<float>(float *em,
                                                 float *em_deriv,
@@ -222,7 +179,9 @@ template void deepmd::prod_env_mat_a_cpu<float>(float *em,
                                                 const float rcut,
                                                 const float rcut_smth,
                                                 const std::vector<int> sec,
-                                                const int *f_type);
+                                                const int *f_type,
+                                                NeighborOrder *nbor_order,
+                                                const bool reuse_nbor_order);
 
 template void deepmd::prod_env_mat_r_cpu<double>(double *em,
                                                  double *em_deriv,
@@ -238,7 +197,9 @@ template void deepmd::prod_env_mat_r_cpu<double>(double *em,
                                                  const int nall,
                                                  const float rcut,
                                                  const float rcut_smth,
-                                                 const std::vector<int> sec);
+                                                 const std::vector<int> sec,
+                                                 NeighborOrder *nbor_order,
+                                                 const bool reuse_nbor_order);
 
 template void deepmd::prod_env_mat_r_cpu<float>(float *em,
                                                 float *em_deriv,
@@ -254,7 +215,76 @@ template void deepmd::prod_env_mat_r_cpu<float>(float *em,
                                                 const int nall,
                                                 const float rcut,
                                                 const float rcut_smth,
-                                                const std::vector<int> sec);
+                                                const std::vector<int> sec,
+                                                NeighborOrder *nbor_order,
+                                                const bool reuse_nbor_order);
+
+void deepmd::env_mat_trim_index_cpu(std::vector<int> &sel_index,
+                                    std::vector<int> &sel_trim,
+                                    const int *nlist,
+                                    const int nsamples,
+                                    const std::vector<int> &sec) {
+  const int nnei = sec.back();
+  const int nsec = sec.size() - 1;
+  sel_trim.assign(nsec, 0);
+  for (int ii = 0; ii < nsamples; ++ii) {
+    const int *i_nlist = nlist + (size_t)ii * nnei;
+    for (int tt = 0; tt < nsec; ++tt) {
+      int jj = sec[tt] + sel_trim[tt];
+      while (jj < sec[tt + 1] && i_nlist[jj] >= 0) {
+        ++jj;
+      }
+      sel_trim[tt] = jj - sec[tt];
+    }
+  }
+  sel_index.clear();
+  for (int tt = 0; tt < nsec; ++tt) {
+    for (int jj = sec[tt]; jj < sec[tt] + sel_trim[tt]; ++jj) {
+      sel_index.push_back(jj);
+    }
+  }
+}
+
+template <typename T>
+void deepmd::env_mat_trim_cpu(T *out,
+                              const T *in,
+                              const std::vector<int> &sel_index,
+                              const int nsamples,
+                              const int nnei,
+                              const int ncomp) {
+  const int nnei_trim = sel_index.size();
+#pragma omp parallel for
+  for (int ii = 0; ii < nsamples; ++ii) {
+    const T *i_in = in + (size_t)ii * nnei * ncomp;
+    T *i_out = out + (size_t)ii * nnei_trim * ncomp;
+    for (int jj = 0; jj < nnei_trim; ++jj) {
+      std::copy(i_in + sel_index[jj] * ncomp,
+                i_in + (sel_index[jj] + 1) * ncomp, i_out + jj * ncomp);
+    }
+  }
+}
+
+template void deepmd::env_mat_trim_cpu<double>(
+    double *out,
+    const double *in,
+    const std::vector<int> &sel_index,
+    const int nsamples,
+    const int nnei,
+    const int ncomp);
+
+template void deepmd::env_mat_trim_cpu<float>(float *out,
+                                              const float *in,
+                                              const std::vector<int> &sel_index,
+                                              const int nsamples,
+                                              const int nnei,
+                                              const int ncomp);
+
+template void deepmd::env_mat_trim_cpu<int>(int *out,
+                                            const int *in,
+                                            const std::vector<int> &sel_index,
+                                            const int nsamples,
+                                            const int nnei,
+                                            const int ncomp);
 
 #if GOOGLE_CUDA || TENSORFLOW_USE_ROCM
 void deepmd::env_mat_nbor_update(InputNlist &inlist,
@@ -92,8 +92,8 @@ void deepmd::prod_env_mat_a_nvnmd_quantize_cpu(FPTYPE* em,
 #pragma omp parallel for
   for (int ii = 0; ii < nloc; ++ii) {
     std::vector<int> fmt_nlist_a;
-    int ret = format_nlist_i_cpu(fmt_nlist_a, d_coord3, d_type, ii,
-                                 d_nlist_a[ii], rcut, sec);
+    int ret = ::format_nlist_i_cpu(fmt_nlist_a, d_coord3, d_type, ii,
+                                   d_nlist_a[ii], rcut, sec);
     std::vector<FPTYPE> d_em_a;
     std::vector<FPTYPE> d_em_a_deriv;
     std::vector<FPTYPE> d_em_r;
@@ -2,22 +2,9 @@
 
 #include <math.h>
 
-#include <cstring>
-#include <stdexcept>
+#include <vector>
 
-#include "errors.h"
-
-inline void make_index_range(int& idx_start,
-                             int& idx_end,
-                             const int& nei_idx,
-                             const int& nnei) {
-  if (nei_idx < nnei) {
-    idx_start = nei_idx * 4;
-    idx_end = nei_idx * 4 + 4;
-  } else {
-    throw deepmd::deepmd_exception("should no reach here");
-  }
-}
+#include "neighbor_list.h"
 
 template <typename FPTYPE>
 void deepmd::prod_force_a_cpu(FPTYPE* force,
@@ -30,33 +17,45 @@ void deepmd::prod_force_a_cpu(FPTYPE* force,
                               const int start_index) {
   const int ndescrpt = 4 * nnei;
 
-  memset(force, 0, sizeof(FPTYPE) * nall * 3);
+  // gather the force on each atom instead of scattering the contributions
+  // of each center atom, so that the atoms can be processed in parallel
+  // without atomics and the result does not depend on the number of threads
+  std::vector<int> rev_start, rev_slot;
+  deepmd::build_reverse_nlist_cpu(rev_start, rev_slot, nlist, nloc, nall,
+                                  nnei, start_index);
   // compute force of a frame
-  for (int i_idx = start_index; i_idx < start_index + nloc; ++i_idx) {
-    // deriv wrt center atom
-    for (int aa = 0; aa < ndescrpt; ++aa) {
-      force[i_idx * 3 + 0] -= net_deriv[i_idx * ndescrpt + aa] *
-                              env_deriv[i_idx * ndescrpt * 3 + aa * 3 + 0];
-      force[i_idx * 3 + 1] -= net_deriv[i_idx * ndescrpt + aa] *
-                              env_deriv[i_idx * ndescrpt * 3 + aa * 3 + 1];
-      force[i_idx * 3 + 2] -= net_deriv[i_idx * ndescrpt + aa] *
-                              env_deriv[i_idx * ndescrpt * 3 + aa * 3 + 2];
+#pragma omp parallel for
+  for (int j_idx = 0; j_idx < nall; ++j_idx) {
+    FPTYPE fx = (FPTYPE)0., fy = (FPTYPE)0., fz = (FPTYPE)0.;
+    // deriv wrt center atom, the padded slots are skipped as their
+    // env_deriv vanishes
+    if (j_idx >= start_index && j_idx < start_index + nloc) {
+      const int* i_nlist = nlist + j_idx * nnei;
+      const FPTYPE* i_net_deriv = net_deriv + j_idx * ndescrpt;
+      const FPTYPE* i_env_deriv = env_deriv + j_idx * ndescrpt * 3;
+      for (int jj = 0; jj < nnei; ++jj) {
+        if (i_nlist[jj] < 0) continue;
+        for (int aa = jj * 4; aa < jj * 4 + 4; ++aa) {
+          fx -= i_net_deriv[aa] * i_env_deriv[aa * 3 + 0];
+          fy -= i_net_deriv[aa] * i_env_deriv[aa * 3 + 1];
+          fz -= i_net_deriv[aa] * i_env_deriv[aa * 3 + 2];
+        }
+      }
     }
-    // deriv wrt neighbors
-    for (int jj = 0; jj < nnei; ++jj) {
-      int j_idx = nlist[i_idx * nnei + jj];
-      if (j_idx < 0) continue;
-      int aa_start, aa_end;
-      make_index_range(aa_start, aa_end, jj, nnei);
-      for (int aa = aa_start; aa < aa_end; ++aa) {
-        force[j_idx * 3 + 0] += net_deriv[i_idx * ndescrpt + aa] *
-                                env_deriv[i_idx * ndescrpt * 3 + aa * 3 + 0];
-        force[j_idx * 3 + 1] += net_deriv[i_idx * ndescrpt + aa] *
-                                env_deriv[i_idx * ndescrpt * 3 + aa * 3 + 1];
-        force[j_idx * 3 + 2] += net_deriv[i_idx * ndescrpt + aa] *
-                                env_deriv[i_idx * ndescrpt * 3 + aa * 3 + 2];
+    // deriv wrt neighbors, slot i_idx * nnei + jj owns the 4 descriptor
+    // components starting from i_idx * ndescrpt + jj * 4
+    for (int rr = rev_start[j_idx]; rr < rev_start[j_idx + 1]; ++rr) {
+      const FPTYPE* s_net_deriv = net_deriv + rev_slot[rr] * 4;
+      const FPTYPE* s_env_deriv = env_deriv + rev_slot[rr] * 4 * 3;
+      for (int aa = 0; aa < 4; ++aa) {
+        fx += s_net_deriv[aa] * s_env_deriv[aa * 3 + 0];
+        fy += s_net_deriv[aa] * s_env_deriv[aa * 3 + 1];
+        fz += s_net_deriv[aa] * s_env_deriv[aa * 3 + 2];
       }
     }
+    force[j_idx * 3 + 0] = fx;
+    force[j_idx * 3 + 1] = fy;
+    force[j_idx * 3 + 2] = fz;
   }
 }
 
@@ -88,37 +87,36 @@ void deepmd::prod_force_r_cpu(FPTYPE* force,
                               const int nnei) {
   const int ndescrpt = 1 * nnei;
 
-  for (int ii = 0; ii < nall; ++ii) {
-    int i_idx = ii;
-    force[i_idx * 3 + 0] = (FPTYPE)0.;
-    force[i_idx * 3 + 1] = (FPTYPE)0.;
-    force[i_idx * 3 + 2] = (FPTYPE)0.;
-  }
-
+  std::vector<int> rev_start, rev_slot;
+  deepmd::build_reverse_nlist_cpu(rev_start, rev_slot, nlist, nloc, nall,
+                                  nnei);
   // compute force of a frame
-  for (int ii = 0; ii < nloc; ++ii) {
-    int i_idx = ii;
-    // deriv wrt center atom
-    for (int aa = 0; aa < ndescrpt; ++aa) {
-      force[i_idx * 3 + 0] -= net_deriv[i_idx * ndescrpt + aa] *
-                              env_deriv[i_idx * ndescrpt * 3 + aa * 3 + 0];
-      force[i_idx * 3 + 1] -= net_deriv[i_idx * ndescrpt + aa] *
-                              env_deriv[i_idx * ndescrpt * 3 + aa * 3 + 1];
-      force[i_idx * 3 + 2] -= net_deriv[i_idx * ndescrpt + aa] *
-                              env_deriv[i_idx * ndescrpt * 3 + aa * 3 + 2];
+#pragma omp parallel for
+  for (int j_idx = 0; j_idx < nall; ++j_idx) {
+    FPTYPE fx = (FPTYPE)0., fy = (FPTYPE)0., fz = (FPTYPE)0.;
+    // deriv wrt center atom, the padded slots are skipped
+    if (j_idx < nloc) {
+      const int* i_nlist = nlist + j_idx * nnei;
+      const FPTYPE* i_net_deriv = net_deriv + j_idx * ndescrpt;
+      const FPTYPE* i_env_deriv = env_deriv + j_idx * ndescrpt * 3;
+      for (int aa = 0; aa < ndescrpt; ++aa) {
+        if (i_nlist[aa] < 0) continue;
+        fx -= i_net_deriv[aa] * i_env_deriv[aa * 3 + 0];
+        fy -= i_net_deriv[aa] * i_env_deriv[aa * 3 + 1];
+        fz -= i_net_deriv[aa] * i_env_deriv[aa * 3 + 2];
+      }
     }
-    // deriv wrt neighbors
-    for (int jj = 0; jj < nnei; ++jj) {
-      int j_idx = nlist[i_idx * nnei + jj];
-      // if (j_idx > nloc) j_idx = j_idx % nloc;
-      if (j_idx < 0) continue;
-      force[j_idx * 3 + 0] += net_deriv[i_idx * ndescrpt + jj] *
-                              env_deriv[i_idx * ndescrpt * 3 + jj * 3 + 0];
-      force[j_idx * 3 + 1] += net_deriv[i_idx * ndescrpt + jj] *
-                              env_deriv[i_idx * ndescrpt * 3 + jj * 3 + 1];
-      force[j_idx * 3 + 2] += net_deriv[i_idx * ndescrpt + jj] *
-                              env_deriv[i_idx * ndescrpt * 3 + jj * 3 + 2];
+    // deriv wrt neighbors, slot i_idx * nnei + jj owns the descriptor
+    // component i_idx * ndescrpt + jj
+    for (int rr = rev_start[j_idx]; rr < rev_start[j_idx + 1]; ++rr) {
+      const int slot = rev_slot[rr];
+      fx += net_deriv[slot] * env_deriv[slot * 3 + 0];
+      fy += net_deriv[slot] * env_deriv[slot * 3 + 1];
+      fz += net_deriv[slot] * env_deriv[slot * 3 + 2];
     }
+    force[j_idx * 3 + 0] = fx;
+    force[j_idx * 3 + 1] = fy;
+    force[j_idx * 3 + 2] = fz;
   }
 }
 
@@ -1,20 +1,51 @@
 #include "prod_force_grad.h"
 
-#include <cstring>
-#include <iostream>
-#include <stdexcept>
+#include <cstddef>
 
-#include "errors.h"
+//	grad_net:	nframes x nloc x ndescrpt
+//	grad:		nframes x nloc x 3
+//	env_deriv:	nframes x nloc x ndescrpt x 3
+//	nlist:		nframes x nloc x nnei
+//
+// Each local atom of each frame owns its row of grad_net, so the frames
+// and the atoms are processed in a single parallel loop without any
+// reduction, and the result does not depend on the number of threads.
+template <int NCOMP, typename FPTYPE>
+static void prod_force_grad_cpu(FPTYPE* grad_net,
+                                const FPTYPE* grad,
+                                const FPTYPE* env_deriv,
+                                const int* nlist,
+                                const int nloc,
+                                const int nnei,
+                                const int nframes) {
+  const int ndescrpt = nnei * NCOMP;
 
-inline void make_index_range(int& idx_start,
-                             int& idx_end,
-                             const int& nei_idx,
-                             const int& nnei) {
-  if (nei_idx < nnei) {
-    idx_start = nei_idx * 4;
-    idx_end = nei_idx * 4 + 4;
-  } else {
-    throw deepmd::deepmd_exception("should no reach here");
+#pragma omp parallel for
+  for (int kk_ii = 0; kk_ii < nframes * nloc; ++kk_ii) {
+    const int kk = kk_ii / nloc;
+    const int i_idx = kk_ii - kk * nloc;
+    const FPTYPE* f_grad = grad + kk * nloc * 3;
+    const FPTYPE* i_env_deriv = env_deriv + (size_t)kk_ii * ndescrpt * 3;
+    const int* i_nlist = nlist + (size_t)kk_ii * nnei;
+    FPTYPE* i_grad_net = grad_net + (size_t)kk_ii * ndescrpt;
+    for (int jj = 0; jj < nnei; ++jj) {
+      int j_idx = i_nlist[jj];
+      if (j_idx >= nloc) j_idx = j_idx % nloc;
+      for (int aa = jj * NCOMP; aa < jj * NCOMP + NCOMP; ++aa) {
+        FPTYPE gg = (FPTYPE)0.;
+        // deriv wrt center atom
+        for (int dd = 0; dd < 3; ++dd) {
+          gg -= f_grad[i_idx * 3 + dd] * i_env_deriv[aa * 3 + dd];
+        }
+        // deriv wrt neighbors
+        if (j_idx >= 0) {
+          for (int dd = 0; dd < 3; ++dd) {
+            gg += f_grad[j_idx * 3 + dd] * i_env_deriv[aa * 3 + dd];
+          }
+        }
+        i_grad_net[aa] = gg;
+      }
+    }
   }
 }
 
@@ -24,46 +55,10 @@ void deepmd::prod_force_grad_a_cpu(FPTYPE* grad_net,
                                    const FPTYPE* env_deriv,
                                    const int* nlist,
                                    const int nloc,
-                                   const int nnei) {
-  const int ndescrpt = nnei * 4;
-
-  // reset the frame to 0
-  for (int ii = 0; ii < nloc; ++ii) {
-    for (int aa = 0; aa < ndescrpt; ++aa) {
-      grad_net[ii * ndescrpt + aa] = (FPTYPE)0.;
-    }
-  }
-
-// compute grad of one frame
-#pragma omp parallel for
-  for (int ii = 0; ii < nloc; ++ii) {
-    int i_idx = ii;
-
-    // deriv wrt center atom
-    for (int aa = 0; aa < ndescrpt; ++aa) {
-      for (int dd = 0; dd < 3; ++dd) {
-        grad_net[i_idx * ndescrpt + aa] -=
-            grad[i_idx * 3 + dd] *
-            env_deriv[i_idx * ndescrpt * 3 + aa * 3 + dd];
-      }
-    }
-
-    // loop over neighbors
-    for (int jj = 0; jj < nnei; ++jj) {
-      int j_idx = nlist[i_idx * nnei + jj];
-      if (j_idx >= nloc) j_idx = j_idx % nloc;
-      if (j_idx < 0) continue;
-      int aa_start, aa_end;
-      make_index_range(aa_start, aa_end, jj, nnei);
-      for (int aa = aa_start; aa < aa_end; ++aa) {
-        for (int dd = 0; dd < 3; ++dd) {
-          grad_net[i_idx * ndescrpt + aa] +=
-              grad[j_idx * 3 + dd] *
-              env_deriv[i_idx * ndescrpt * 3 + aa * 3 + dd];
-        }
-      }
-    }
-  }
+                                   const int nnei,
+                                   const int nframes) {
+  prod_force_grad_cpu<4>(grad_net, grad, env_deriv, nlist, nloc, nnei,
+                         nframes);
 }
 
 template void deepmd::prod_force_grad_a_cpu<double>(double* grad_net,
@@ -71,14 +66,16 @@ template void deepmd::prod_force_grad_a_cpu<double>(double* grad_net,
                                                     const double* env_deriv,
                                                     const int* nlist,
                                                     const int nloc,
-                                                    const int nnei);
+                                                    const int nnei,
+                                                    const int nframes);
 
 template void deepmd::prod_force_grad_a_cpu<float>(float* grad_net,
                                                    const float* grad,
                                                    const float* env_deriv,
                                                    const int* nlist,
                                                    const int nloc,
-                                                   const int nnei);
+                                                   const int nnei,
+                                                   const int nframes);
 
 template <typename FPTYPE>
 void deepmd::prod_force_grad_r_cpu(FPTYPE* grad_net,
@@ -86,49 +83,10 @@ void deepmd::prod_force_grad_r_cpu(FPTYPE* grad_net,
                                    const FPTYPE* env_deriv,
                                    const int* nlist,
                                    const int nloc,
-                                   const int nnei)
-//
-//	grad_net:	nloc x ndescrpt
-//	grad:		nloc x 3
-//	env_deriv:	nloc x ndescrpt x 3
-//	nlist:		nloc x nnei
-//
-{
-  const int ndescrpt = nnei * 1;
-
-  // reset the frame to 0
-  for (int ii = 0; ii < nloc; ++ii) {
-    for (int aa = 0; aa < ndescrpt; ++aa) {
-      grad_net[ii * ndescrpt + aa] = (FPTYPE)0.;
-    }
-  }
-
-// compute grad of one frame
-#pragma omp parallel for
-  for (int ii = 0; ii < nloc; ++ii) {
-    int i_idx = ii;
-
-    // deriv wrt center atom
-    for (int aa = 0; aa < ndescrpt; ++aa) {
-      for (int dd = 0; dd < 3; ++dd) {
-        grad_net[i_idx * ndescrpt + aa] -=
-            grad[i_idx * 3 + dd] *
-            env_deriv[i_idx * ndescrpt * 3 + aa * 3 + dd];
-      }
-    }
-
-    // loop over neighbors
-    for (int jj = 0; jj < nnei; ++jj) {
-      int j_idx = nlist[i_idx * nnei + jj];
-      if (j_idx >= nloc) j_idx = j_idx % nloc;
-      if (j_idx < 0) continue;
-      for (int dd = 0; dd < 3; ++dd) {
-        grad_net[i_idx * ndescrpt + jj] +=
-            grad[j_idx * 3 + dd] *
-            env_deriv[i_idx * ndescrpt * 3 + jj * 3 + dd];
-      }
-    }
-  }
+                                   const int nnei,
+                                   const int nframes) {
+  prod_force_grad_cpu<1>(grad_net, grad, env_deriv, nlist, nloc, nnei,
+                         nframes);
 }
 
 template void deepmd::prod_force_grad_r_cpu<double>(double* grad_net,
@@ -136,11 +94,13 @@ template void deepmd::prod_force_grad_r_cpu<double>(double* grad_net,
                                                     const double* env_deriv,
                                                     const int* nlist,
                                                     const int nloc,
-                                                    const int nnei);
+                                                    const int nnei,
+                                                    const int nframes);
 
 template void deepmd::prod_force_grad_r_cpu<float>(float* grad_net,
                                                    const float* grad,
                                                    const float* env_deriv,
                                                    const int* nlist,
                                                    const int nloc,
-                                                   const int nnei);
+                                                   const int nnei,
+                                                   const int nframes);
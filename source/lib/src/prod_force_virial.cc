@@ -0,0 +1,138 @@
+#include "prod_force_virial.h"
+
+#include <algorithm>
+#include <vector>
+
+#include "neighbor_list.h"
+
+// the atoms are gathered in blocks of a fixed size, the virial is reduced
+// from the sums of the blocks so that it does not depend on the number of
+// threads
+#define PROD_FORCE_VIRIAL_BLOCK 64
+
+// gather the force of the atom j_idx into ff and add the virial of its
+// neighbor slots to vv
+template <typename FPTYPE>
+static inline void gather_force_virial_a(FPTYPE* ff,
+                                         FPTYPE* vv,
+                                         const FPTYPE* net_deriv,
+                                         const FPTYPE* env_deriv,
+                                         const FPTYPE* rij,
+                                         const int* nlist,
+                                         const int* rev_start,
+                                         const int* rev_slot,
+                                         const int nloc,
+                                         const int nnei,
+                                         const int j_idx) {
+  const int ndescrpt = 4 * nnei;
+  ff[0] = ff[1] = ff[2] = (FPTYPE)0.;
+  // deriv wrt center atom, the padded slots are skipped
+  if (j_idx < nloc) {
+    const int* i_nlist = nlist + j_idx * nnei;
+    const FPTYPE* i_net_deriv = net_deriv + j_idx * ndescrpt;
+    const FPTYPE* i_env_deriv = env_deriv + j_idx * ndescrpt * 3;
+    for (int jj = 0; jj < nnei; ++jj) {
+      if (i_nlist[jj] < 0) continue;
+      for (int aa = jj * 4; aa < jj * 4 + 4; ++aa) {
+        ff[0] -= i_net_deriv[aa] * i_env_deriv[aa * 3 + 0];
+        ff[1] -= i_net_deriv[aa] * i_env_deriv[aa * 3 + 1];
+        ff[2] -= i_net_deriv[aa] * i_env_deriv[aa * 3 + 2];
+      }
+    }
+  }
+  // deriv wrt neighbors. rij does not depend on the descriptor component,
+  // so the virial of a slot is the outer product of its force and rij
+  for (int rr = rev_start[j_idx]; rr < rev_start[j_idx + 1]; ++rr) {
+    const int slot = rev_slot[rr];
+    const FPTYPE* s_net_deriv = net_deriv + slot * 4;
+    const FPTYPE* s_env_deriv = env_deriv + slot * 4 * 3;
+    FPTYPE sf[3] = {(FPTYPE)0.};
+    for (int aa = 0; aa < 4; ++aa) {
+      sf[0] += s_net_deriv[aa] * s_env_deriv[aa * 3 + 0];
+      sf[1] += s_net_deriv[aa] * s_env_deriv[aa * 3 + 1];
+      sf[2] += s_net_deriv[aa] * s_env_deriv[aa * 3 + 2];
+    }
+    for (int dd0 = 0; dd0 < 3; ++dd0) {
+      ff[dd0] += sf[dd0];
+      for (int dd1 = 0; dd1 < 3; ++dd1) {
+        vv[dd0 * 3 + dd1] += sf[dd0] * rij[slot * 3 + dd1];
+      }
+    }
+  }
+}
+
+template <typename FPTYPE>
+void deepmd::prod_force_virial_a_cpu(FPTYPE* force,
+                                     FPTYPE* virial,
+                                     FPTYPE* atom_virial,
+                                     const FPTYPE* net_deriv,
+                                     const FPTYPE* env_deriv,
+                                     const FPTYPE* rij,
+                                     const int* nlist,
+                                     const int nloc,
+                                     const int nall,
+                                     const int nnei) {
+  // gather over the reverse neighbor list as prod_force_a_cpu does
+  std::vector<int> rev_start, rev_slot;
+  deepmd::build_reverse_nlist_cpu(rev_start, rev_slot, nlist, nloc, nall,
+                                  nnei);
+  const int nblock =
+      (nall + PROD_FORCE_VIRIAL_BLOCK - 1) / PROD_FORCE_VIRIAL_BLOCK;
+  std::vector<FPTYPE> block_virial(static_cast<size_t>(nblock) * 9);
+#pragma omp parallel for
+  for (int bb = 0; bb < nblock; ++bb) {
+    FPTYPE bv[9] = {(FPTYPE)0.};
+    const int j_end = std::min((bb + 1) * PROD_FORCE_VIRIAL_BLOCK, nall);
+    for (int j_idx = bb * PROD_FORCE_VIRIAL_BLOCK; j_idx < j_end; ++j_idx) {
+      if (atom_virial) {
+        FPTYPE vv[9] = {(FPTYPE)0.};
+        gather_force_virial_a(force + j_idx * 3, vv, net_deriv, env_deriv,
+                              rij, nlist, &rev_start[0], &rev_slot[0], nloc,
+                              nnei, j_idx);
+        for (int dd = 0; dd < 9; ++dd) {
+          atom_virial[j_idx * 9 + dd] = vv[dd];
+          bv[dd] += vv[dd];
+        }
+      } else {
+        // only the virial is required, the slots are added to the block sum
+        gather_force_virial_a(force + j_idx * 3, bv, net_deriv, env_deriv,
+                              rij, nlist, &rev_start[0], &rev_slot[0], nloc,
+                              nnei, j_idx);
+      }
+    }
+    for (int dd = 0; dd < 9; ++dd) {
+      block_virial[bb * 9 + dd] = bv[dd];
+    }
+  }
+  for (int dd = 0; dd < 9; ++dd) {
+    virial[dd] = (FPTYPE)0.;
+  }
+  for (int bb = 0; bb < nblock; ++bb) {
+    for (int dd = 0; dd < 9; ++dd) {
+      virial[dd] += block_virial[bb * 9 + dd];
+    }
+  }
+}
+#undef PROD_FORCE_VIRIAL_BLOCK
+
+template void deepmd::prod_force_virial_a_cpu<double>(double* force,
+                                                      double* virial,
+                                                      double* atom_virial,
+                                                      const double* net_deriv,
+                                                      const double* env_deriv,
+                                                      const double* rij,
+                                                      const int* nlist,
+                                                      const int nloc,
+                                                      const int nall,
+                                                      const int nnei);
+
+template void deepmd::prod_force_virial_a_cpu<float>(float* force,
+                                                     float* virial,
+                                                     float* atom_virial,
+                                                     const float* net_deriv,
+                                                     const float* env_deriv,
+                                                     const float* rij,
+                                                     const int* nlist,
+                                                     const int nloc,
+                                                     const int nall,
+                                                     const int nnei);
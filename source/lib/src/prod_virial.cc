@@ -1,20 +1,85 @@
 #include "prod_virial.h"
 
-#include <cstring>
-#include <iostream>
-#include <stdexcept>
+#include <vector>
 
-#include "errors.h"
+#include "neighbor_list.h"
 
-inline void make_index_range(int& idx_start,
-                             int& idx_end,
-                             const int& nei_idx,
-                             const int& nnei) {
-  if (nei_idx < nnei) {
-    idx_start = nei_idx * 4;
-    idx_end = nei_idx * 4 + 4;
+// accumulate the virial of the neighbor slot i_idx * nnei + jj, which owns
+// the NCOMP descriptor components starting from slot * NCOMP
+template <int NCOMP, typename FPTYPE>
+static inline void accumulate_slot_virial(FPTYPE* vv,
+                                          const FPTYPE* net_deriv,
+                                          const FPTYPE* env_deriv,
+                                          const FPTYPE* rij,
+                                          const int slot) {
+  for (int aa = slot * NCOMP; aa < slot * NCOMP + NCOMP; ++aa) {
+    for (int dd0 = 0; dd0 < 3; ++dd0) {
+      for (int dd1 = 0; dd1 < 3; ++dd1) {
+        vv[dd0 * 3 + dd1] +=
+            net_deriv[aa] * rij[slot * 3 + dd1] * env_deriv[aa * 3 + dd0];
+      }
+    }
+  }
+}
+
+// The atom virial is gathered over the reverse neighbor list and the
+// virial is reduced from the per-atom (or per-center-atom if atom_virial is
+// NULL) sums in a fixed order, so no atomics are needed and the result does
+// not depend on the number of threads.
+template <int NCOMP, typename FPTYPE>
+static void prod_virial_cpu(FPTYPE* virial,
+                            FPTYPE* atom_virial,
+                            const FPTYPE* net_deriv,
+                            const FPTYPE* env_deriv,
+                            const FPTYPE* rij,
+                            const int* nlist,
+                            const int nloc,
+                            const int nall,
+                            const int nnei) {
+  std::vector<FPTYPE> i_virial;
+  const FPTYPE* part_virial = atom_virial;
+  int npart = nall;
+  if (atom_virial) {
+    std::vector<int> rev_start, rev_slot;
+    deepmd::build_reverse_nlist_cpu(rev_start, rev_slot, nlist, nloc, nall,
+                                    nnei);
+#pragma omp parallel for
+    for (int j_idx = 0; j_idx < nall; ++j_idx) {
+      FPTYPE vv[9] = {(FPTYPE)0.};
+      for (int rr = rev_start[j_idx]; rr < rev_start[j_idx + 1]; ++rr) {
+        accumulate_slot_virial<NCOMP>(vv, net_deriv, env_deriv, rij,
+                                      rev_slot[rr]);
+      }
+      for (int dd = 0; dd < 9; ++dd) {
+        atom_virial[j_idx * 9 + dd] = vv[dd];
+      }
+    }
   } else {
-    throw deepmd::deepmd_exception("should no reach here");
+    // only the virial is required, sum over the neighbors of each center
+    // atom without building the reverse neighbor list
+    i_virial.resize(static_cast<size_t>(nloc) * 9);
+#pragma omp parallel for
+    for (int i_idx = 0; i_idx < nloc; ++i_idx) {
+      FPTYPE vv[9] = {(FPTYPE)0.};
+      for (int jj = 0; jj < nnei; ++jj) {
+        if (nlist[i_idx * nnei + jj] < 0) continue;
+        accumulate_slot_virial<NCOMP>(vv, net_deriv, env_deriv, rij,
+                                      i_idx * nnei + jj);
+      }
+      for (int dd = 0; dd < 9; ++dd) {
+        i_virial[i_idx * 9 + dd] = vv[dd];
+      }
+    }
+    part_virial = i_virial.data();
+    npart = nloc;
+  }
+  for (int dd = 0; dd < 9; ++dd) {
+    virial[dd] = (FPTYPE)0.;
+  }
+  for (int ii = 0; ii < npart; ++ii) {
+    for (int dd = 0; dd < 9; ++dd) {
+      virial[dd] += part_virial[ii * 9 + dd];
+    }
   }
 }
 
@@ -28,41 +93,8 @@ void deepmd::prod_virial_a_cpu(FPTYPE* virial,
                                const int nloc,
                                const int nall,
                                const int nnei) {
-  const int ndescrpt = 4 * nnei;
-
-  for (int ii = 0; ii < 9; ++ii) {
-    virial[ii] = (FPTYPE)0.;
-  }
-  for (int ii = 0; ii < 9 * nall; ++ii) {
-    atom_virial[ii] = (FPTYPE)0.;
-  }
-
-// compute virial of a frame
-#pragma omp parallel for
-  for (int ii = 0; ii < nloc; ++ii) {
-    int i_idx = ii;
-
-    // deriv wrt neighbors
-    for (int jj = 0; jj < nnei; ++jj) {
-      int j_idx = nlist[i_idx * nnei + jj];
-      if (j_idx < 0) continue;
-      int aa_start, aa_end;
-      make_index_range(aa_start, aa_end, jj, nnei);
-      for (int aa = aa_start; aa < aa_end; ++aa) {
-        FPTYPE pref = (FPTYPE)-1.0 * net_deriv[i_idx * ndescrpt + aa];
-        for (int dd0 = 0; dd0 < 3; ++dd0) {
-          for (int dd1 = 0; dd1 < 3; ++dd1) {
-            FPTYPE tmp_v = pref * rij[i_idx * nnei * 3 + jj * 3 + dd1] *
-                           env_deriv[i_idx * ndescrpt * 3 + aa * 3 + dd0];
-#pragma omp atomic
-            virial[dd0 * 3 + dd1] -= tmp_v;
-#pragma omp atomic
-            atom_virial[j_idx * 9 + dd0 * 3 + dd1] -= tmp_v;
-          }
-        }
-      }
-    }
-  }
+  prod_virial_cpu<4>(virial, atom_virial, net_deriv, env_deriv, rij, nlist,
+                     nloc, nall, nnei);
 }
 
 template void deepmd::prod_virial_a_cpu<double>(double* virial,
@@ -95,37 +127,8 @@ void deepmd::prod_virial_r_cpu(FPTYPE* virial,
                                const int nloc,
                                const int nall,
                                const int nnei) {
-  const int ndescrpt = nnei;
-
-  for (int ii = 0; ii < 9; ++ii) {
-    virial[ii] = (FPTYPE)0.;
-  }
-  for (int ii = 0; ii < 9 * nall; ++ii) {
-    atom_virial[ii] = (FPTYPE)0.;
-  }
-
-// compute virial of a frame
-#pragma omp parallel for
-  for (int ii = 0; ii < nloc; ++ii) {
-    int i_idx = ii;
-
-    // deriv wrt neighbors
-    for (int jj = 0; jj < nnei; ++jj) {
-      int j_idx = nlist[i_idx * nnei + jj];
-      if (j_idx < 0) continue;
-      FPTYPE pref = -1.0 * net_deriv[i_idx * ndescrpt + jj];
-      for (int dd0 = 0; dd0 < 3; ++dd0) {
-        for (int dd1 = 0; dd1 < 3; ++dd1) {
-          FPTYPE tmp_v = pref * rij[i_idx * nnei * 3 + jj * 3 + dd1] *
-                         env_deriv[i_idx * ndescrpt * 3 + jj * 3 + dd0];
-#pragma omp atomic
-          virial[dd0 * 3 + dd1] -= tmp_v;
-#pragma omp atomic
-          atom_virial[j_idx * 9 + dd0 * 3 + dd1] -= tmp_v;
-        }
-      }
-    }
-  }
+  prod_virial_cpu<1>(virial, atom_virial, net_deriv, env_deriv, rij, nlist,
+                     nloc, nall, nnei);
 }
 
 template void deepmd::prod_virial_r_cpu<double>(double* virial,
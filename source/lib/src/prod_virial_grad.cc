@@ -1,19 +1,59 @@
 #include "prod_virial_grad.h"
 
-#include <cstring>
-#include <stdexcept>
+#include <cstddef>
 
-#include "errors.h"
+//	grad_net:	nframes x nloc x ndescrpt
+//	grad:		nframes x 9
+//	env_deriv:	nframes x nloc x ndescrpt x 3
+//	rij:		nframes x nloc x nnei x 3
+//	nlist:		nframes x nloc x nnei
+//
+// Each local atom of each frame owns its row of grad_net, so the frames
+// and the atoms are processed in a single parallel loop without any
+// reduction, and the result does not depend on the number of threads.
+template <int NCOMP, typename FPTYPE>
+static void prod_virial_grad_cpu(FPTYPE* grad_net,
+                                 const FPTYPE* grad,
+                                 const FPTYPE* env_deriv,
+                                 const FPTYPE* rij,
+                                 const int* nlist,
+                                 const int nloc,
+                                 const int nnei,
+                                 const int nframes) {
+  const int ndescrpt = nnei * NCOMP;
 
-inline void make_index_range(int& idx_start,
-                             int& idx_end,
-                             const int& nei_idx,
-                             const int& nnei) {
-  if (nei_idx < nnei) {
-    idx_start = nei_idx * 4;
-    idx_end = nei_idx * 4 + 4;
-  } else {
-    throw deepmd::deepmd_exception("should no reach here");
+#pragma omp parallel for
+  for (int kk_ii = 0; kk_ii < nframes * nloc; ++kk_ii) {
+    const int kk = kk_ii / nloc;
+    const FPTYPE* f_grad = grad + kk * 9;
+    const FPTYPE* i_env_deriv = env_deriv + (size_t)kk_ii * ndescrpt * 3;
+    const FPTYPE* i_rij = rij + (size_t)kk_ii * nnei * 3;
+    const int* i_nlist = nlist + (size_t)kk_ii * nnei;
+    FPTYPE* i_grad_net = grad_net + (size_t)kk_ii * ndescrpt;
+    for (int jj = 0; jj < nnei; ++jj) {
+      if (i_nlist[jj] < 0) {
+        for (int aa = jj * NCOMP; aa < jj * NCOMP + NCOMP; ++aa) {
+          i_grad_net[aa] = (FPTYPE)0.;
+        }
+        continue;
+      }
+      // grad contracted with rij, shared by the components of the slot
+      FPTYPE grad_rij[9];
+      for (int dd0 = 0; dd0 < 3; ++dd0) {
+        for (int dd1 = 0; dd1 < 3; ++dd1) {
+          grad_rij[dd0 * 3 + dd1] = f_grad[dd0 * 3 + dd1] * i_rij[jj * 3 + dd1];
+        }
+      }
+      for (int aa = jj * NCOMP; aa < jj * NCOMP + NCOMP; ++aa) {
+        FPTYPE gg = (FPTYPE)0.;
+        for (int dd0 = 0; dd0 < 3; ++dd0) {
+          for (int dd1 = 0; dd1 < 3; ++dd1) {
+            gg += grad_rij[dd0 * 3 + dd1] * i_env_deriv[aa * 3 + dd0];
+          }
+        }
+        i_grad_net[aa] = gg;
+      }
+    }
   }
 }
 
@@ -24,39 +64,10 @@ void deepmd::prod_virial_grad_a_cpu(FPTYPE* grad_net,
                                     const FPTYPE* rij,
                                     const int* nlist,
                                     const int nloc,
-                                    const int nnei) {
-  const int ndescrpt = nnei * 4;
-
-  // reset the frame to 0
-  for (int ii = 0; ii < nloc; ++ii) {
-    for (int aa = 0; aa < ndescrpt; ++aa) {
-      grad_net[ii * ndescrpt + aa] = 0;
-    }
-  }
-
-// compute grad of one frame
-#pragma omp parallel for
-  for (int ii = 0; ii < nloc; ++ii) {
-    int i_idx = ii;
-
-    // loop over neighbors
-    for (int jj = 0; jj < nnei; ++jj) {
-      int j_idx = nlist[i_idx * nnei + jj];
-      if (j_idx < 0) continue;
-      int aa_start, aa_end;
-      make_index_range(aa_start, aa_end, jj, nnei);
-      for (int aa = aa_start; aa < aa_end; ++aa) {
-        for (int dd0 = 0; dd0 < 3; ++dd0) {
-          for (int dd1 = 0; dd1 < 3; ++dd1) {
-            grad_net[i_idx * ndescrpt + aa] -=
-                -1.0 * grad[dd0 * 3 + dd1] *
-                rij[i_idx * nnei * 3 + jj * 3 + dd1] *
-                env_deriv[i_idx * ndescrpt * 3 + aa * 3 + dd0];
-          }
-        }
-      }
-    }
-  }
+                                    const int nnei,
+                                    const int nframes) {
+  prod_virial_grad_cpu<4>(grad_net, grad, env_deriv, rij, nlist, nloc, nnei,
+                          nframes);
 }
 
 template void deepmd::prod_virial_grad_a_cpu<double>(double* grad_net,
@@ -65,7 +76,8 @@ template void deepmd::prod_virial_grad_a_cpu<double>(double* grad_net,
                                                      const double* rij,
                                                      const int* nlist,
                                                      const int nloc,
-                                                     const int nnei);
+                                                     const int nnei,
+                                                     const int nframes);
 
 template void deepmd::prod_virial_grad_a_cpu<float>(float* grad_net,
                                                     const float* grad,
@@ -73,7 +85,8 @@ template void deepmd::prod_virial_grad_a_cpu<float>(float* grad_net,
                                                     const float* rij,
                                                     const int* nlist,
                                                     const int nloc,
-                                                    const int nnei);
+                                                    const int nnei,
+                                                    const int nframes);
 
 template <typename FPTYPE>
 void deepmd::prod_virial_grad_r_cpu(FPTYPE* grad_net,
@@ -82,43 +95,10 @@ void deepmd::prod_virial_grad_r_cpu(FPTYPE* grad_net,
                                     const FPTYPE* rij,
                                     const int* nlist,
                                     const int nloc,
-                                    const int nnei)
-//
-//	grad_net:	nloc x ndescrpt
-//	grad:		9
-//	env_deriv:	nloc x ndescrpt x 3
-//	rij:		nloc x nnei x 3
-//	nlist:		nloc x nnei
-//
-{
-  const int ndescrpt = nnei * 1;
-
-  // reset the frame to 0
-  for (int ii = 0; ii < nloc; ++ii) {
-    for (int aa = 0; aa < ndescrpt; ++aa) {
-      grad_net[ii * ndescrpt + aa] = 0;
-    }
-  }
-
-// compute grad of one frame
-#pragma omp parallel for
-  for (int ii = 0; ii < nloc; ++ii) {
-    int i_idx = ii;
-
-    // loop over neighbors
-    for (int jj = 0; jj < nnei; ++jj) {
-      int j_idx = nlist[i_idx * nnei + jj];
-      if (j_idx < 0) continue;
-      for (int dd0 = 0; dd0 < 3; ++dd0) {
-        for (int dd1 = 0; dd1 < 3; ++dd1) {
-          grad_net[i_idx * ndescrpt + jj] -=
-              -1.0 * grad[dd0 * 3 + dd1] *
-              rij[i_idx * nnei * 3 + jj * 3 + dd1] *
-              env_deriv[i_idx * ndescrpt * 3 + jj * 3 + dd0];
-        }
-      }
-    }
-  }
+                                    const int nnei,
+                                    const int nframes) {
+  prod_virial_grad_cpu<1>(grad_net, grad, env_deriv, rij, nlist, nloc, nnei,
+                          nframes);
 }
 
 template void deepmd::prod_virial_grad_r_cpu<double>(double* grad_net,
@@ -127,7 +107,8 @@ template void deepmd::prod_virial_grad_r_cpu<double>(double* grad_net,
                                                      const double* rij,
                                                      const int* nlist,
                                                      const int nloc,
-                                                     const int nnei);
+                                                     const int nnei,
+                                                     const int nframes);
 
 template void deepmd::prod_virial_grad_r_cpu<float>(float* grad_net,
                                                     const float* grad,
@@ -135,4 +116,5 @@ template void deepmd::prod_virial_grad_r_cpu<float>(float* grad_net,
                                                     const float* rij,
                                                     const int* nlist,
                                                     const int nloc,
-                                                    const int nnei);
+                                                    const int nnei,
+                                                    const int nframes);
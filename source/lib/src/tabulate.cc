@@ -2,7 +2,9 @@
 
 #include <string.h>
 
+#include <algorithm>
 #include <cassert>
+#include <cstddef>
 #include <iostream>
 #include <vector>
 /*
@@ -301,6 +303,408 @@ void deepmd::tabulate_fusion_se_a_grad_grad_cpu(FPTYPE* dz_dy,
   }
 }
 
+// The SIMD kernels of se_a take the coefficient-major table [idx][6][kk], so
+// that the coefficients of consecutive kk are contiguous and each vector lane
+// evaluates the polynomial of one kk. The same kernels are compiled for
+// AVX-512, AVX2 and the baseline ISA, and the best one supported by the CPU
+// is chosen at runtime.
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define TABULATE_SIMD_DISPATCH
+#define TABULATE_INLINE inline __attribute__((always_inline))
+#else
+#define TABULATE_INLINE inline
+#endif
+
+template <typename FPTYPE>
+void deepmd::tabulate_table_coef_major_cpu(FPTYPE* table_cm,
+                                           const FPTYPE* table,
+                                           const int nspline,
+                                           const int last_layer_size) {
+#pragma omp parallel for
+  for (int ii = 0; ii < nspline; ii++) {
+    const FPTYPE* i_table = table + (size_t)ii * last_layer_size * 6;
+    FPTYPE* i_table_cm = table_cm + (size_t)ii * last_layer_size * 6;
+    for (int kk = 0; kk < last_layer_size; kk++) {
+      for (int cc = 0; cc < 6; cc++) {
+        i_table_cm[cc * last_layer_size + kk] = i_table[kk * 6 + cc];
+      }
+    }
+  }
+}
+
+template <typename FPTYPE>
+void deepmd::tabulate_table_bf16_cpu(uint16_t* table_bf16,
+                                     const FPTYPE* table,
+                                     const int size) {
+#pragma omp parallel for
+  for (int ii = 0; ii < size; ii++) {
+    // round the float to the nearest bfloat16, ties to even
+    float ff = table[ii];
+    uint32_t bits;
+    memcpy(&bits, &ff, sizeof(float));
+    bits += 0x7fffu + ((bits >> 16) & 1u);
+    table_bf16[ii] = bits >> 16;
+  }
+}
+
+// load a coefficient stored in FPTYPE, or in bfloat16 as the upper 16 bits
+// of a float
+template <typename FPTYPE>
+static TABULATE_INLINE FPTYPE tabulate_load(const FPTYPE& cc) {
+  return cc;
+}
+
+template <typename FPTYPE>
+static TABULATE_INLINE FPTYPE tabulate_load(const uint16_t& cc) {
+  const uint32_t bits = (uint32_t)cc << 16;
+  float ff;
+  memcpy(&ff, &bits, sizeof(float));
+  return ff;
+}
+
+// one atom of tabulate_fusion_se_a_cpu
+template <int LLS, typename FPTYPE, typename TTYPE>
+static TABULATE_INLINE void tabulate_fusion_se_a_simd_kernel(
+    FPTYPE* out,
+    const TTYPE* table_cm,
+    const FPTYPE* table_info,
+    const FPTYPE* em_x,
+    const FPTYPE* em,
+    const int nnei,
+    const int _last_layer_size) {
+  const int last_layer_size = LLS > 0 ? LLS : _last_layer_size;
+  const FPTYPE lower = table_info[0];
+  const FPTYPE upper = table_info[1];
+  const FPTYPE _max = table_info[2];
+  const FPTYPE stride0 = table_info[3];
+  const FPTYPE stride1 = table_info[4];
+  FPTYPE* out0 = out + 0 * last_layer_size;
+  FPTYPE* out1 = out + 1 * last_layer_size;
+  FPTYPE* out2 = out + 2 * last_layer_size;
+  FPTYPE* out3 = out + 3 * last_layer_size;
+  const FPTYPE ago = em_x[nnei - 1];
+  for (int jj = 0; jj < nnei; jj++) {
+    const FPTYPE ll[4] = {em[jj * 4 + 0], em[jj * 4 + 1], em[jj * 4 + 2],
+                          em[jj * 4 + 3]};
+    FPTYPE xx = em_x[jj];
+    // the padding at the tail is counted (nnei - jj) times
+    const bool unloop = (ago == xx);
+    const FPTYPE nrep = unloop ? (FPTYPE)(nnei - jj) : (FPTYPE)1.;
+    int table_idx = 0;
+    locate_xx(lower, upper, _max, stride0, stride1, xx, table_idx);
+    const TTYPE* a0 = table_cm + (size_t)table_idx * last_layer_size * 6;
+    const TTYPE* a1 = a0 + last_layer_size;
+    const TTYPE* a2 = a1 + last_layer_size;
+    const TTYPE* a3 = a2 + last_layer_size;
+    const TTYPE* a4 = a3 + last_layer_size;
+    const TTYPE* a5 = a4 + last_layer_size;
+#pragma omp simd
+    for (int kk = 0; kk < last_layer_size; kk++) {
+      const FPTYPE c0 = tabulate_load<FPTYPE>(a0[kk]);
+      const FPTYPE c1 = tabulate_load<FPTYPE>(a1[kk]);
+      const FPTYPE c2 = tabulate_load<FPTYPE>(a2[kk]);
+      const FPTYPE c3 = tabulate_load<FPTYPE>(a3[kk]);
+      const FPTYPE c4 = tabulate_load<FPTYPE>(a4[kk]);
+      const FPTYPE c5 = tabulate_load<FPTYPE>(a5[kk]);
+      FPTYPE var = c0 + (c1 + (c2 + (c3 + (c4 + c5 * xx) * xx) * xx) * xx) * xx;
+      var *= nrep;
+      out0[kk] += var * ll[0];
+      out1[kk] += var * ll[1];
+      out2[kk] += var * ll[2];
+      out3[kk] += var * ll[3];
+    }
+    if (unloop) break;
+  }
+}
+
+// one atom of tabulate_fusion_se_a_grad_cpu
+template <int LLS, typename FPTYPE, typename TTYPE>
+static TABULATE_INLINE void tabulate_fusion_se_a_grad_simd_kernel(
+    FPTYPE* dy_dem_x,
+    FPTYPE* dy_dem,
+    const TTYPE* table_cm,
+    const FPTYPE* table_info,
+    const FPTYPE* em_x,
+    const FPTYPE* em,
+    const FPTYPE* dy,
+    const int nnei,
+    const int _last_layer_size) {
+  const int last_layer_size = LLS > 0 ? LLS : _last_layer_size;
+  const FPTYPE lower = table_info[0];
+  const FPTYPE upper = table_info[1];
+  const FPTYPE _max = table_info[2];
+  const FPTYPE stride0 = table_info[3];
+  const FPTYPE stride1 = table_info[4];
+  const FPTYPE* rr0 = dy + 0 * last_layer_size;
+  const FPTYPE* rr1 = dy + 1 * last_layer_size;
+  const FPTYPE* rr2 = dy + 2 * last_layer_size;
+  const FPTYPE* rr3 = dy + 3 * last_layer_size;
+  const FPTYPE ago = em_x[nnei - 1];
+  for (int jj = 0; jj < nnei; jj++) {
+    const FPTYPE ll[4] = {em[jj * 4 + 0], em[jj * 4 + 1], em[jj * 4 + 2],
+                          em[jj * 4 + 3]};
+    FPTYPE xx = em_x[jj];
+    const bool unloop = (ago == xx);
+    const FPTYPE nrep = unloop ? (FPTYPE)(nnei - jj) : (FPTYPE)1.;
+    int table_idx = 0;
+    locate_xx(lower, upper, _max, stride0, stride1, xx, table_idx);
+    const TTYPE* a0 = table_cm + (size_t)table_idx * last_layer_size * 6;
+    const TTYPE* a1 = a0 + last_layer_size;
+    const TTYPE* a2 = a1 + last_layer_size;
+    const TTYPE* a3 = a2 + last_layer_size;
+    const TTYPE* a4 = a3 + last_layer_size;
+    const TTYPE* a5 = a4 + last_layer_size;
+    FPTYPE grad = (FPTYPE)0., dem0 = (FPTYPE)0., dem1 = (FPTYPE)0.,
+           dem2 = (FPTYPE)0., dem3 = (FPTYPE)0.;
+#pragma omp simd reduction(+ : grad, dem0, dem1, dem2, dem3)
+    for (int kk = 0; kk < last_layer_size; kk++) {
+      const FPTYPE c0 = tabulate_load<FPTYPE>(a0[kk]);
+      const FPTYPE c1 = tabulate_load<FPTYPE>(a1[kk]);
+      const FPTYPE c2 = tabulate_load<FPTYPE>(a2[kk]);
+      const FPTYPE c3 = tabulate_load<FPTYPE>(a3[kk]);
+      const FPTYPE c4 = tabulate_load<FPTYPE>(a4[kk]);
+      const FPTYPE c5 = tabulate_load<FPTYPE>(a5[kk]);
+      FPTYPE res = c0 + (c1 + (c2 + (c3 + (c4 + c5 * xx) * xx) * xx) * xx) * xx;
+      FPTYPE res_grad =
+          c1 +
+          ((FPTYPE)2. * c2 +
+           ((FPTYPE)3. * c3 + ((FPTYPE)4. * c4 + (FPTYPE)5. * c5 * xx) * xx) *
+               xx) *
+              xx;
+      grad += res_grad * (ll[0] * rr0[kk] + ll[1] * rr1[kk] +
+                          ll[2] * rr2[kk] + ll[3] * rr3[kk]);
+      dem0 += res * rr0[kk];
+      dem1 += res * rr1[kk];
+      dem2 += res * rr2[kk];
+      dem3 += res * rr3[kk];
+    }
+    dy_dem_x[jj] = grad * nrep;
+    dy_dem[jj * 4 + 0] = dem0 * nrep;
+    dy_dem[jj * 4 + 1] = dem1 * nrep;
+    dy_dem[jj * 4 + 2] = dem2 * nrep;
+    dy_dem[jj * 4 + 3] = dem3 * nrep;
+    if (unloop) break;
+  }
+}
+
+// one atom of tabulate_fusion_se_a_grad_grad_cpu
+template <int LLS, typename FPTYPE, typename TTYPE>
+static TABULATE_INLINE void tabulate_fusion_se_a_grad_grad_simd_kernel(
+    FPTYPE* dz_dy,
+    const TTYPE* table_cm,
+    const FPTYPE* table_info,
+    const FPTYPE* em_x,
+    const FPTYPE* em,
+    const FPTYPE* dz_dy_dem_x,
+    const FPTYPE* dz_dy_dem,
+    const int nnei,
+    const int _last_layer_size) {
+  const int last_layer_size = LLS > 0 ? LLS : _last_layer_size;
+  const FPTYPE lower = table_info[0];
+  const FPTYPE upper = table_info[1];
+  const FPTYPE _max = table_info[2];
+  const FPTYPE stride0 = table_info[3];
+  const FPTYPE stride1 = table_info[4];
+  FPTYPE* dz_dy0 = dz_dy + 0 * last_layer_size;
+  FPTYPE* dz_dy1 = dz_dy + 1 * last_layer_size;
+  FPTYPE* dz_dy2 = dz_dy + 2 * last_layer_size;
+  FPTYPE* dz_dy3 = dz_dy + 3 * last_layer_size;
+  const FPTYPE ago = em_x[nnei - 1];
+  for (int jj = 0; jj < nnei; jj++) {
+    const FPTYPE ll[4] = {em[jj * 4 + 0], em[jj * 4 + 1], em[jj * 4 + 2],
+                          em[jj * 4 + 3]};
+    const FPTYPE hh[4] = {dz_dy_dem[jj * 4 + 0], dz_dy_dem[jj * 4 + 1],
+                          dz_dy_dem[jj * 4 + 2], dz_dy_dem[jj * 4 + 3]};
+    FPTYPE xx = em_x[jj];
+    const FPTYPE dz_xx = dz_dy_dem_x[jj];
+    const bool unloop = (ago == xx);
+    const FPTYPE nrep = unloop ? (FPTYPE)(nnei - jj) : (FPTYPE)1.;
+    int table_idx = 0;
+    locate_xx(lower, upper, _max, stride0, stride1, xx, table_idx);
+    const TTYPE* a0 = table_cm + (size_t)table_idx * last_layer_size * 6;
+    const TTYPE* a1 = a0 + last_layer_size;
+    const TTYPE* a2 = a1 + last_layer_size;
+    const TTYPE* a3 = a2 + last_layer_size;
+    const TTYPE* a4 = a3 + last_layer_size;
+    const TTYPE* a5 = a4 + last_layer_size;
+#pragma omp simd
+    for (int kk = 0; kk < last_layer_size; kk++) {
+      const FPTYPE c0 = tabulate_load<FPTYPE>(a0[kk]);
+      const FPTYPE c1 = tabulate_load<FPTYPE>(a1[kk]);
+      const FPTYPE c2 = tabulate_load<FPTYPE>(a2[kk]);
+      const FPTYPE c3 = tabulate_load<FPTYPE>(a3[kk]);
+      const FPTYPE c4 = tabulate_load<FPTYPE>(a4[kk]);
+      const FPTYPE c5 = tabulate_load<FPTYPE>(a5[kk]);
+      FPTYPE var = c0 + (c1 + (c2 + (c3 + (c4 + c5 * xx) * xx) * xx) * xx) * xx;
+      FPTYPE var_grad =
+          c1 +
+          ((FPTYPE)2. * c2 +
+           ((FPTYPE)3. * c3 + ((FPTYPE)4. * c4 + (FPTYPE)5. * c5 * xx) * xx) *
+               xx) *
+              xx;
+      var_grad *= dz_xx;
+      dz_dy0[kk] += nrep * (var * hh[0] + var_grad * ll[0]);
+      dz_dy1[kk] += nrep * (var * hh[1] + var_grad * ll[1]);
+      dz_dy2[kk] += nrep * (var * hh[2] + var_grad * ll[2]);
+      dz_dy3[kk] += nrep * (var * hh[3] + var_grad * ll[3]);
+    }
+    if (unloop) break;
+  }
+}
+
+#ifdef TABULATE_SIMD_DISPATCH
+// the kernels compiled for each ISA
+#define TABULATE_SIMD_VARIANT(kernel, isa, suffix)                     \
+  template <int LLS, typename FPTYPE, typename... Args>                \
+  __attribute__((target(isa))) static void kernel##_##suffix(          \
+      Args... args) {                                                  \
+    kernel<LLS, FPTYPE>(args...);                                      \
+  }
+TABULATE_SIMD_VARIANT(tabulate_fusion_se_a_simd_kernel,
+                      "avx512f,avx512dq,avx2,fma",
+                      avx512)
+TABULATE_SIMD_VARIANT(tabulate_fusion_se_a_simd_kernel, "avx2,fma", avx2)
+TABULATE_SIMD_VARIANT(tabulate_fusion_se_a_grad_simd_kernel,
+                      "avx512f,avx512dq,avx2,fma",
+                      avx512)
+TABULATE_SIMD_VARIANT(tabulate_fusion_se_a_grad_simd_kernel, "avx2,fma", avx2)
+TABULATE_SIMD_VARIANT(tabulate_fusion_se_a_grad_grad_simd_kernel,
+                      "avx512f,avx512dq,avx2,fma",
+                      avx512)
+TABULATE_SIMD_VARIANT(tabulate_fusion_se_a_grad_grad_simd_kernel,
+                      "avx2,fma",
+                      avx2)
+#undef TABULATE_SIMD_VARIANT
+
+enum TabulateIsa { TABULATE_BASE, TABULATE_AVX2, TABULATE_AVX512 };
+
+static TabulateIsa tabulate_detect_isa() {
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512dq")) {
+    return TABULATE_AVX512;
+  } else if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) {
+    return TABULATE_AVX2;
+  } else {
+    return TABULATE_BASE;
+  }
+}
+
+static const TabulateIsa tabulate_isa = tabulate_detect_isa();
+
+#define TABULATE_SIMD_CALL(kernel, LLS, FPTYPE, ...) \
+  if (tabulate_isa == TABULATE_AVX512) {             \
+    kernel##_avx512<LLS, FPTYPE>(__VA_ARGS__);       \
+  } else if (tabulate_isa == TABULATE_AVX2) {        \
+    kernel##_avx2<LLS, FPTYPE>(__VA_ARGS__);         \
+  } else {                                           \
+    kernel<LLS, FPTYPE>(__VA_ARGS__);                \
+  }
+#else
+#define TABULATE_SIMD_CALL(kernel, LLS, FPTYPE, ...) \
+  kernel<LLS, FPTYPE>(__VA_ARGS__);
+#endif  // TABULATE_SIMD_DISPATCH
+
+// The kernels are also compiled with last_layer_size fixed to the common
+// widths of the last embedding layer, 32, 64 and 128, the 100 of the default
+// [25, 50, 100] net and 240, so that the kk loops have a constant trip count
+// and are fully vectorized without a remainder. Other widths use the generic
+// kernels, LLS = 0. The gain of each width is measured by
+// source/lib/tests/bench_simd_widths.sh.
+#define TABULATE_WIDTH_CASE(N, kernel, FPTYPE, ...)    \
+  case N: {                                            \
+    TABULATE_SIMD_CALL(kernel, N, FPTYPE, __VA_ARGS__) \
+    break;                                             \
+  }
+#ifndef SIMD_GENERIC_WIDTH_ONLY
+#define TABULATE_WIDTH_CALL(kernel, FPTYPE, last_layer_size, ...) \
+  switch (last_layer_size) {                                      \
+    TABULATE_WIDTH_CASE(32, kernel, FPTYPE, __VA_ARGS__)          \
+    TABULATE_WIDTH_CASE(64, kernel, FPTYPE, __VA_ARGS__)          \
+    TABULATE_WIDTH_CASE(100, kernel, FPTYPE, __VA_ARGS__)         \
+    TABULATE_WIDTH_CASE(128, kernel, FPTYPE, __VA_ARGS__)         \
+    TABULATE_WIDTH_CASE(240, kernel, FPTYPE, __VA_ARGS__)         \
+    default: {                                                    \
+      TABULATE_SIMD_CALL(kernel, 0, FPTYPE, __VA_ARGS__)          \
+    }                                                             \
+  }
+#else
+#define TABULATE_WIDTH_CALL(kernel, FPTYPE, last_layer_size, ...) \
+  { TABULATE_SIMD_CALL(kernel, 0, FPTYPE, __VA_ARGS__) }
+#endif  // SIMD_GENERIC_WIDTH_ONLY
+
+template <typename FPTYPE, typename TTYPE>
+void deepmd::tabulate_fusion_se_a_simd_cpu(FPTYPE* out,
+                                           const TTYPE* table_cm,
+                                           const FPTYPE* table_info,
+                                           const FPTYPE* em_x,
+                                           const FPTYPE* em,
+                                           const int nloc,
+                                           const int nnei,
+                                           const int last_layer_size) {
+  memset(out, 0, sizeof(FPTYPE) * nloc * 4 * last_layer_size);
+#pragma omp parallel for
+  for (int ii = 0; ii < nloc; ii++) {
+    TABULATE_WIDTH_CALL(tabulate_fusion_se_a_simd_kernel, FPTYPE,
+                        last_layer_size, out + (size_t)ii * last_layer_size * 4,
+                        table_cm, table_info, em_x + (size_t)ii * nnei,
+                        em + (size_t)ii * nnei * 4, nnei, last_layer_size);
+  }
+}
+
+template <typename FPTYPE, typename TTYPE>
+void deepmd::tabulate_fusion_se_a_grad_simd_cpu(FPTYPE* dy_dem_x,
+                                                FPTYPE* dy_dem,
+                                                const TTYPE* table_cm,
+                                                const FPTYPE* table_info,
+                                                const FPTYPE* em_x,
+                                                const FPTYPE* em,
+                                                const FPTYPE* dy,
+                                                const int nloc,
+                                                const int nnei,
+                                                const int last_layer_size) {
+  memset(dy_dem_x, 0, sizeof(FPTYPE) * nloc * nnei);
+  memset(dy_dem, 0, sizeof(FPTYPE) * nloc * nnei * 4);
+#pragma omp parallel for
+  for (int ii = 0; ii < nloc; ii++) {
+    TABULATE_WIDTH_CALL(tabulate_fusion_se_a_grad_simd_kernel, FPTYPE,
+                        last_layer_size, dy_dem_x + (size_t)ii * nnei,
+                        dy_dem + (size_t)ii * nnei * 4, table_cm, table_info,
+                        em_x + (size_t)ii * nnei, em + (size_t)ii * nnei * 4,
+                        dy + (size_t)ii * last_layer_size * 4, nnei,
+                        last_layer_size);
+  }
+}
+
+template <typename FPTYPE, typename TTYPE>
+void deepmd::tabulate_fusion_se_a_grad_grad_simd_cpu(
+    FPTYPE* dz_dy,
+    const TTYPE* table_cm,
+    const FPTYPE* table_info,
+    const FPTYPE* em_x,
+    const FPTYPE* em,
+    const FPTYPE* dz_dy_dem_x,
+    const FPTYPE* dz_dy_dem,
+    const int nloc,
+    const int nnei,
+    const int last_layer_size) {
+  memset(dz_dy, 0, sizeof(FPTYPE) * nloc * 4 * last_layer_size);
+#pragma omp parallel for
+  for (int ii = 0; ii < nloc; ii++) {
+    TABULATE_WIDTH_CALL(tabulate_fusion_se_a_grad_grad_simd_kernel, FPTYPE,
+                        last_layer_size,
+                        dz_dy + (size_t)ii * last_layer_size * 4, table_cm,
+                        table_info, em_x + (size_t)ii * nnei,
+                        em + (size_t)ii * nnei * 4,
+                        dz_dy_dem_x + (size_t)ii * nnei,
+                        dz_dy_dem + (size_t)ii * nnei * 4, nnei,
+                        last_layer_size);
+  }
+}
+#undef TABULATE_WIDTH_CALL
+#undef TABULATE_WIDTH_CASE
+#undef TABULATE_SIMD_CALL
+
 template <typename FPTYPE>
 void deepmd::tabulate_fusion_se_t_cpu(FPTYPE* out,
                                       const FPTYPE* table,
@@ -492,6 +896,294 @@ void deepmd::tabulate_fusion_se_t_grad_grad_cpu(FPTYPE* dz_dy,
   }
 }
 
+// The se_t kernels for a symmetric em_x, i.e. the two neighbor sets of the
+// angle are the same. Only the pairs jj <= kk are evaluated, and each
+// evaluation serves both (jj, kk) and (kk, jj). The pairs are collected into
+// tiles of TABULATE_SE_T_TILE after the table lookup, and the table rows of a
+// tile are evaluated block by block of TABULATE_SE_T_BLOCK columns, so that
+// each block of out is accumulated locally over the tile and stored once.
+
+#define TABULATE_SE_T_TILE 64
+#define TABULATE_SE_T_BLOCK 64
+
+// the first slot of the padding at the tail of each row of em_x, which the
+// se_t kernels evaluate once, see the unloop of tabulate_fusion_se_t_cpu
+template <typename FPTYPE>
+static inline void tabulate_se_t_tail(int* tail,
+                                      const FPTYPE* em_x,
+                                      const int nnei) {
+  for (int jj = 0; jj < nnei; jj++) {
+    const FPTYPE* row = em_x + (size_t)jj * nnei;
+    const FPTYPE ago = row[nnei - 1];
+    int kk = 0;
+    while (row[kk] != ago) {
+      kk++;
+    }
+    tail[jj] = kk;
+  }
+}
+
+// how many times the slot kk of a row of the given tail is counted by the
+// scalar se_t kernels
+static inline int tabulate_se_t_nrep(const int kk,
+                                     const int tail,
+                                     const int nnei) {
+  return kk < tail ? 1 : (kk == tail ? nnei - tail : 0);
+}
+
+// accumulate sum_p (var_p * w0_p + var_grad_p * w1_p) of the tile into out;
+// var_grad is skipped if GRAD is false
+template <typename FPTYPE, bool GRAD>
+static inline void tabulate_se_t_tile_accumulate(FPTYPE* out,
+                                                 const FPTYPE* table,
+                                                 const int* tile_idx,
+                                                 const FPTYPE* tile_xx,
+                                                 const FPTYPE* tile_w0,
+                                                 const FPTYPE* tile_w1,
+                                                 const int ntile,
+                                                 const int last_layer_size) {
+  for (int m0 = 0; m0 < last_layer_size; m0 += TABULATE_SE_T_BLOCK) {
+    const int nm = std::min(TABULATE_SE_T_BLOCK, last_layer_size - m0);
+    FPTYPE acc[TABULATE_SE_T_BLOCK] = {(FPTYPE)0.};
+    for (int pp = 0; pp < ntile; pp++) {
+      const FPTYPE* aa =
+          table + ((size_t)tile_idx[pp] * last_layer_size + m0) * 6;
+      const FPTYPE xx = tile_xx[pp];
+      const FPTYPE w0 = tile_w0[pp];
+      for (int mm = 0; mm < nm; mm++) {
+        const FPTYPE* a = aa + mm * 6;
+        FPTYPE var =
+            a[0] +
+            (a[1] + (a[2] + (a[3] + (a[4] + a[5] * xx) * xx) * xx) * xx) * xx;
+        acc[mm] += var * w0;
+        if (GRAD) {
+          FPTYPE var_grad =
+              a[1] + ((FPTYPE)2. * a[2] +
+                      ((FPTYPE)3. * a[3] +
+                       ((FPTYPE)4. * a[4] + (FPTYPE)5. * a[5] * xx) * xx) *
+                          xx) *
+                         xx;
+          acc[mm] += var_grad * tile_w1[pp];
+        }
+      }
+    }
+    for (int mm = 0; mm < nm; mm++) {
+      out[m0 + mm] += acc[mm];
+    }
+  }
+}
+
+template <typename FPTYPE>
+void deepmd::tabulate_fusion_se_t_sym_cpu(FPTYPE* out,
+                                          const FPTYPE* table,
+                                          const FPTYPE* table_info,
+                                          const FPTYPE* em_x,
+                                          const FPTYPE* /*em*/,
+                                          const int nloc,
+                                          const int nnei,
+                                          const int last_layer_size) {
+  memset(out, 0, sizeof(FPTYPE) * nloc * last_layer_size);
+  const FPTYPE lower = table_info[0];
+  const FPTYPE upper = table_info[1];
+  const FPTYPE _max = table_info[2];
+  const FPTYPE stride0 = table_info[3];
+  const FPTYPE stride1 = table_info[4];
+#pragma omp parallel
+  {
+    std::vector<int> tail(nnei);
+    int tile_idx[TABULATE_SE_T_TILE];
+    FPTYPE tile_xx[TABULATE_SE_T_TILE];
+    FPTYPE tile_ww[TABULATE_SE_T_TILE];
+#pragma omp for
+    for (int ii = 0; ii < nloc; ii++) {
+      const FPTYPE* i_em_x = em_x + (size_t)ii * nnei * nnei;
+      FPTYPE* i_out = out + (size_t)ii * last_layer_size;
+      tabulate_se_t_tail(&tail[0], i_em_x, nnei);
+      int ntile = 0;
+      for (int jj = 0; jj < nnei; jj++) {
+        for (int kk = jj; kk < nnei; kk++) {
+          int nrep = tabulate_se_t_nrep(kk, tail[jj], nnei);
+          if (kk != jj) {
+            nrep += tabulate_se_t_nrep(jj, tail[kk], nnei);
+          }
+          FPTYPE xx = i_em_x[jj * nnei + kk];
+          // var * xx vanishes on the padding, where xx is zero
+          const FPTYPE ww = nrep * xx;
+          if (ww == (FPTYPE)0.) {
+            continue;
+          }
+          int table_idx = 0;
+          locate_xx_se_t(lower, upper, -_max, _max, stride0, stride1, xx,
+                         table_idx);
+          tile_idx[ntile] = table_idx;
+          tile_xx[ntile] = xx;
+          tile_ww[ntile] = ww;
+          if (++ntile == TABULATE_SE_T_TILE) {
+            tabulate_se_t_tile_accumulate<FPTYPE, false>(
+                i_out, table, tile_idx, tile_xx, tile_ww, tile_ww, ntile,
+                last_layer_size);
+            ntile = 0;
+          }
+        }
+      }
+      tabulate_se_t_tile_accumulate<FPTYPE, false>(
+          i_out, table, tile_idx, tile_xx, tile_ww, tile_ww, ntile,
+          last_layer_size);
+    }
+  }
+}
+
+template <typename FPTYPE>
+void deepmd::tabulate_fusion_se_t_grad_sym_cpu(FPTYPE* dy_dem_x,
+                                               FPTYPE* dy_dem,
+                                               const FPTYPE* table,
+                                               const FPTYPE* table_info,
+                                               const FPTYPE* em_x,
+                                               const FPTYPE* /*em*/,
+                                               const FPTYPE* dy,
+                                               const int nloc,
+                                               const int nnei,
+                                               const int last_layer_size) {
+  memset(dy_dem_x, 0, sizeof(FPTYPE) * nloc * nnei * nnei);
+  memset(dy_dem, 0, sizeof(FPTYPE) * nloc * nnei * nnei);
+  const FPTYPE lower = table_info[0];
+  const FPTYPE upper = table_info[1];
+  const FPTYPE _max = table_info[2];
+  const FPTYPE stride0 = table_info[3];
+  const FPTYPE stride1 = table_info[4];
+#pragma omp parallel
+  {
+    std::vector<int> tail(nnei);
+#pragma omp for
+    for (int ii = 0; ii < nloc; ii++) {
+      const FPTYPE* i_em_x = em_x + (size_t)ii * nnei * nnei;
+      FPTYPE* i_dy_dem_x = dy_dem_x + (size_t)ii * nnei * nnei;
+      FPTYPE* i_dy_dem = dy_dem + (size_t)ii * nnei * nnei;
+      const FPTYPE* rr = dy + (size_t)ii * last_layer_size;
+      tabulate_se_t_tail(&tail[0], i_em_x, nnei);
+      for (int jj = 0; jj < nnei; jj++) {
+        for (int kk = jj; kk < nnei; kk++) {
+          const int nrep_jk = tabulate_se_t_nrep(kk, tail[jj], nnei);
+          const int nrep_kj =
+              kk != jj ? tabulate_se_t_nrep(jj, tail[kk], nnei) : 0;
+          if (nrep_jk == 0 && nrep_kj == 0) {
+            continue;
+          }
+          FPTYPE xx = i_em_x[jj * nnei + kk];
+          const FPTYPE ll = xx;
+          int table_idx = 0;
+          locate_xx_se_t(lower, upper, -_max, _max, stride0, stride1, xx,
+                         table_idx);
+          const FPTYPE* aa = table + (size_t)table_idx * last_layer_size * 6;
+          FPTYPE res = (FPTYPE)0.;
+          FPTYPE grad = (FPTYPE)0.;
+          for (int mm = 0; mm < last_layer_size; mm++) {
+            const FPTYPE* a = aa + mm * 6;
+            FPTYPE var =
+                a[0] +
+                (a[1] + (a[2] + (a[3] + (a[4] + a[5] * xx) * xx) * xx) * xx) *
+                    xx;
+            FPTYPE var_grad =
+                a[1] + ((FPTYPE)2. * a[2] +
+                        ((FPTYPE)3. * a[3] +
+                         ((FPTYPE)4. * a[4] + (FPTYPE)5. * a[5] * xx) * xx) *
+                            xx) *
+                           xx;
+            res += var * rr[mm];
+            grad += var_grad * rr[mm];
+          }
+          grad *= ll;
+          if (nrep_jk != 0) {
+            i_dy_dem_x[jj * nnei + kk] = grad * nrep_jk;
+            i_dy_dem[jj * nnei + kk] = res * nrep_jk;
+          }
+          if (nrep_kj != 0) {
+            i_dy_dem_x[kk * nnei + jj] = grad * nrep_kj;
+            i_dy_dem[kk * nnei + jj] = res * nrep_kj;
+          }
+        }
+      }
+    }
+  }
+}
+
+template <typename FPTYPE>
+void deepmd::tabulate_fusion_se_t_grad_grad_sym_cpu(FPTYPE* dz_dy,
+                                                    const FPTYPE* table,
+                                                    const FPTYPE* table_info,
+                                                    const FPTYPE* em_x,
+                                                    const FPTYPE* /*em*/,
+                                                    const FPTYPE* dz_dy_dem_x,
+                                                    const FPTYPE* dz_dy_dem,
+                                                    const int nloc,
+                                                    const int nnei,
+                                                    const int last_layer_size) {
+  memset(dz_dy, 0, sizeof(FPTYPE) * nloc * last_layer_size);
+  const FPTYPE lower = table_info[0];
+  const FPTYPE upper = table_info[1];
+  const FPTYPE _max = table_info[2];
+  const FPTYPE stride0 = table_info[3];
+  const FPTYPE stride1 = table_info[4];
+#pragma omp parallel
+  {
+    std::vector<int> tail(nnei);
+    int tile_idx[TABULATE_SE_T_TILE];
+    FPTYPE tile_xx[TABULATE_SE_T_TILE];
+    FPTYPE tile_dz_em[TABULATE_SE_T_TILE];
+    FPTYPE tile_dz_xx[TABULATE_SE_T_TILE];
+#pragma omp for
+    for (int ii = 0; ii < nloc; ii++) {
+      const FPTYPE* i_em_x = em_x + (size_t)ii * nnei * nnei;
+      const FPTYPE* i_dz_xx = dz_dy_dem_x + (size_t)ii * nnei * nnei;
+      const FPTYPE* i_dz_em = dz_dy_dem + (size_t)ii * nnei * nnei;
+      FPTYPE* i_dz_dy = dz_dy + (size_t)ii * last_layer_size;
+      tabulate_se_t_tail(&tail[0], i_em_x, nnei);
+      int ntile = 0;
+      for (int jj = 0; jj < nnei; jj++) {
+        for (int kk = jj; kk < nnei; kk++) {
+          // the scalar kernel visits the slots up to the tail once
+          const bool visit_jk = kk <= tail[jj];
+          const bool visit_kj = kk != jj && jj <= tail[kk];
+          if (!visit_jk && !visit_kj) {
+            continue;
+          }
+          FPTYPE dz_em = (FPTYPE)0.;
+          FPTYPE dz_xx = (FPTYPE)0.;
+          if (visit_jk) {
+            dz_em += i_dz_em[jj * nnei + kk];
+            dz_xx += i_dz_xx[jj * nnei + kk];
+          }
+          if (visit_kj) {
+            dz_em += i_dz_em[kk * nnei + jj];
+            dz_xx += i_dz_xx[kk * nnei + jj];
+          }
+          FPTYPE xx = i_em_x[jj * nnei + kk];
+          dz_xx *= xx;
+          int table_idx = 0;
+          locate_xx_se_t(lower, upper, -_max, _max, stride0, stride1, xx,
+                         table_idx);
+          tile_idx[ntile] = table_idx;
+          tile_xx[ntile] = xx;
+          tile_dz_em[ntile] = dz_em;
+          tile_dz_xx[ntile] = dz_xx;
+          if (++ntile == TABULATE_SE_T_TILE) {
+            tabulate_se_t_tile_accumulate<FPTYPE, true>(
+                i_dz_dy, table, tile_idx, tile_xx, tile_dz_em, tile_dz_xx,
+                ntile, last_layer_size);
+            ntile = 0;
+          }
+        }
+      }
+      tabulate_se_t_tile_accumulate<FPTYPE, true>(
+          i_dz_dy, table, tile_idx, tile_xx, tile_dz_em, tile_dz_xx, ntile,
+          last_layer_size);
+    }
+  }
+}
+
+#undef TABULATE_SE_T_TILE
+#undef TABULATE_SE_T_BLOCK
+
 template <typename FPTYPE>
 void deepmd::tabulate_fusion_se_r_cpu(FPTYPE* out,
                                       const FPTYPE* table,
@@ -678,6 +1370,147 @@ template void deepmd::tabulate_fusion_se_a_grad_grad_cpu<double>(
     const int nnei,
     const int last_layer_size);
 
+template void deepmd::tabulate_table_coef_major_cpu<float>(
+    float* table_cm,
+    const float* table,
+    const int nspline,
+    const int last_layer_size);
+template void deepmd::tabulate_table_coef_major_cpu<double>(
+    double* table_cm,
+    const double* table,
+    const int nspline,
+    const int last_layer_size);
+template void deepmd::tabulate_fusion_se_a_simd_cpu<float, float>(
+    float* out,
+    const float* table_cm,
+    const float* table_info,
+    const float* em_x,
+    const float* em,
+    const int nloc,
+    const int nnei,
+    const int last_layer_size);
+template void deepmd::tabulate_fusion_se_a_simd_cpu<double, double>(
+    double* out,
+    const double* table_cm,
+    const double* table_info,
+    const double* em_x,
+    const double* em,
+    const int nloc,
+    const int nnei,
+    const int last_layer_size);
+template void deepmd::tabulate_fusion_se_a_simd_cpu<float, uint16_t>(
+    float* out,
+    const uint16_t* table_cm,
+    const float* table_info,
+    const float* em_x,
+    const float* em,
+    const int nloc,
+    const int nnei,
+    const int last_layer_size);
+template void deepmd::tabulate_fusion_se_a_simd_cpu<double, uint16_t>(
+    double* out,
+    const uint16_t* table_cm,
+    const double* table_info,
+    const double* em_x,
+    const double* em,
+    const int nloc,
+    const int nnei,
+    const int last_layer_size);
+template void deepmd::tabulate_fusion_se_a_grad_simd_cpu<float, float>(
+    float* dy_dem_x,
+    float* dy_dem,
+    const float* table_cm,
+    const float* table_info,
+    const float* em_x,
+    const float* em,
+    const float* dy,
+    const int nloc,
+    const int nnei,
+    const int last_layer_size);
+template void deepmd::tabulate_fusion_se_a_grad_simd_cpu<double, double>(
+    double* dy_dem_x,
+    double* dy_dem,
+    const double* table_cm,
+    const double* table_info,
+    const double* em_x,
+    const double* em,
+    const double* dy,
+    const int nloc,
+    const int nnei,
+    const int last_layer_size);
+template void deepmd::tabulate_fusion_se_a_grad_simd_cpu<float, uint16_t>(
+    float* dy_dem_x,
+    float* dy_dem,
+    const uint16_t* table_cm,
+    const float* table_info,
+    const float* em_x,
+    const float* em,
+    const float* dy,
+    const int nloc,
+    const int nnei,
+    const int last_layer_size);
+template void deepmd::tabulate_fusion_se_a_grad_simd_cpu<double, uint16_t>(
+    double* dy_dem_x,
+    double* dy_dem,
+    const uint16_t* table_cm,
+    const double* table_info,
+    const double* em_x,
+    const double* em,
+    const double* dy,
+    const int nloc,
+    const int nnei,
+    const int last_layer_size);
+template void deepmd::tabulate_fusion_se_a_grad_grad_simd_cpu<float, float>(
+    float* dz_dy,
+    const float* table_cm,
+    const float* table_info,
+    const float* em_x,
+    const float* em,
+    const float* dz_dy_dem_x,
+    const float* dz_dy_dem,
+    const int nloc,
+    const int nnei,
+    const int last_layer_size);
+template void deepmd::tabulate_fusion_se_a_grad_grad_simd_cpu<double, double>(
+    double* dz_dy,
+    const double* table_cm,
+    const double* table_info,
+    const double* em_x,
+    const double* em,
+    const double* dz_dy_dem_x,
+    const double* dz_dy_dem,
+    const int nloc,
+    const int nnei,
+    const int last_layer_size);
+template void deepmd::tabulate_fusion_se_a_grad_grad_simd_cpu<float, uint16_t>(
+    float* dz_dy,
+    const uint16_t* table_cm,
+    const float* table_info,
+    const float* em_x,
+    const float* em,
+    const float* dz_dy_dem_x,
+    const float* dz_dy_dem,
+    const int nloc,
+    const int nnei,
+    const int last_layer_size);
+template void deepmd::tabulate_fusion_se_a_grad_grad_simd_cpu<double, uint16_t>(
+    double* dz_dy,
+    const uint16_t* table_cm,
+    const double* table_info,
+    const double* em_x,
+    const double* em,
+    const double* dz_dy_dem_x,
+    const double* dz_dy_dem,
+    const int nloc,
+    const int nnei,
+    const int last_layer_size);
+template void deepmd::tabulate_table_bf16_cpu<float>(uint16_t* table_bf16,
+                                                     const float* table,
+                                                     const int size);
+template void deepmd::tabulate_table_bf16_cpu<double>(uint16_t* table_bf16,
+                                                      const double* table,
+                                                      const int size);
+
 template void deepmd::tabulate_fusion_se_t_cpu<float>(
     float* out,
     const float* table,
@@ -747,6 +1580,68 @@ template void deepmd::tabulate_fusion_se_t_grad_grad_cpu<double>(
     const int nnei_j,
     const int last_layer_size);
 
+template void deepmd::tabulate_fusion_se_t_sym_cpu<float>(
+    float* out,
+    const float* table,
+    const float* table_info,
+    const float* em_x,
+    const float* em,
+    const int nloc,
+    const int nnei,
+    const int last_layer_size);
+template void deepmd::tabulate_fusion_se_t_sym_cpu<double>(
+    double* out,
+    const double* table,
+    const double* table_info,
+    const double* em_x,
+    const double* em,
+    const int nloc,
+    const int nnei,
+    const int last_layer_size);
+template void deepmd::tabulate_fusion_se_t_grad_sym_cpu<float>(
+    float* dy_dem_x,
+    float* dy_dem,
+    const float* table,
+    const float* table_info,
+    const float* em_x,
+    const float* em,
+    const float* dy,
+    const int nloc,
+    const int nnei,
+    const int last_layer_size);
+template void deepmd::tabulate_fusion_se_t_grad_sym_cpu<double>(
+    double* dy_dem_x,
+    double* dy_dem,
+    const double* table,
+    const double* table_info,
+    const double* em_x,
+    const double* em,
+    const double* dy,
+    const int nloc,
+    const int nnei,
+    const int last_layer_size);
+template void deepmd::tabulate_fusion_se_t_grad_grad_sym_cpu<float>(
+    float* dz_dy,
+    const float* table,
+    const float* table_info,
+    const float* em_x,
+    const float* em,
+    const float* dz_dy_dem_x,
+    const float* dz_dy_dem,
+    const int nloc,
+    const int nnei,
+    const int last_layer_size);
+template void deepmd::tabulate_fusion_se_t_grad_grad_sym_cpu<double>(
+    double* dz_dy,
+    const double* table,
+    const double* table_info,
+    const double* em_x,
+    const double* em,
+    const double* dz_dy_dem_x,
+    const double* dz_dy_dem,
+    const int nloc,
+    const int nnei,
+    const int last_layer_size);
 template void deepmd::tabulate_fusion_se_r_cpu<float>(
     float* out,
     const float* table,
@@ -0,0 +1,110 @@
+// SPDX-License-Identifier: LGPL-3.0-or-later
+// Times the SIMD se_a kernels at the widths they are specialized for. Built
+// and run by bench_simd_widths.sh, once as is and once with
+// SIMD_GENERIC_WIDTH_ONLY, which compiles the generic kernels only.
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+#include "env_mat.h"
+#include "tabulate.h"
+
+template <typename FUNC>
+static double best_of(const int nrep, FUNC func) {
+  double best = 1e30;
+  for (int rr = 0; rr < nrep; ++rr) {
+    auto t0 = std::chrono::steady_clock::now();
+    func();
+    auto t1 = std::chrono::steady_clock::now();
+    best = std::min(
+        best, std::chrono::duration<double, std::milli>(t1 - t0).count());
+  }
+  return best;
+}
+
+static void bench_tabulate(const int nrep) {
+  const int nloc = 192, nnei = 138, nspline = 24;
+  std::vector<double> info = {0, 0.2, 0.4, 0.01, 0.1, -1};
+  std::vector<double> em_x(nloc * nnei), em(nloc * nnei * 4);
+  for (int ii = 0; ii < em_x.size(); ++ii) {
+    em_x[ii] = 0.19 * fabs(sin(1.3 * ii));
+  }
+  for (int ii = 0; ii < em.size(); ++ii) {
+    em[ii] = sin(0.7 * ii);
+  }
+  const int widths[] = {32, 64, 100, 128, 240};
+  for (int ww : widths) {
+    std::vector<double> table(nspline * ww * 6), table_cm(table.size());
+    for (int ii = 0; ii < table.size(); ++ii) {
+      table[ii] = sin(0.37 * ii);
+    }
+    deepmd::tabulate_table_coef_major_cpu<double>(&table_cm[0], &table[0],
+                                                  nspline, ww);
+    std::vector<double> out(nloc * 4 * ww), dy(nloc * 4 * ww, 1.0);
+    std::vector<double> dy_dem_x(nloc * nnei), dy_dem(nloc * nnei * 4);
+    double tf = best_of(nrep, [&]() {
+      deepmd::tabulate_fusion_se_a_simd_cpu<double>(
+          &out[0], &table_cm[0], &info[0], &em_x[0], &em[0], nloc, nnei, ww);
+    });
+    double tg = best_of(nrep, [&]() {
+      deepmd::tabulate_fusion_se_a_grad_simd_cpu<double>(
+          &dy_dem_x[0], &dy_dem[0], &table_cm[0], &info[0], &em_x[0], &em[0],
+          &dy[0], nloc, nnei, ww);
+    });
+    printf("tabulate  last_layer_size %4d  fwd %8.3f ms  grad %8.3f ms\n", ww,
+           tf, tg);
+  }
+}
+
+static void bench_env_mat(const int nrep) {
+  const int nloc = 512;
+  const float rmin = 0.5, rmax = 6.0;
+  const int sels[] = {46, 60, 92, 120};
+  for (int sel : sels) {
+    // two sections of the same width, filled to 3/4 of sel
+    std::vector<int> sec = {0, sel, 2 * sel};
+    const int nnei = sec.back();
+    const int nfill = sel * 3 / 4;
+    const int nall = 1 + 2 * nfill;
+    std::vector<double> posi(nall * 3);
+    for (int ii = 0; ii < nall; ++ii) {
+      double rr = ii == 0 ? 0. : 0.9 + 5.0 * fabs(sin(0.61 * ii));
+      posi[ii * 3 + 0] = rr * sin(1.7 * ii) * cos(2.3 * ii);
+      posi[ii * 3 + 1] = rr * sin(1.7 * ii) * sin(2.3 * ii);
+      posi[ii * 3 + 2] = rr * cos(1.7 * ii);
+    }
+    std::vector<int> fmt_nlist(nnei, -1);
+    for (int ss = 0; ss < 2; ++ss) {
+      for (int jj = 0; jj < nfill; ++jj) {
+        fmt_nlist[sec[ss] + jj] = 1 + ss * nfill + jj;
+      }
+    }
+    std::vector<double> descrpt(nnei * 4), descrpt_deriv(nnei * 4 * 3),
+        rij(nnei * 3);
+    double tf = best_of(nrep, [&]() {
+      for (int ii = 0; ii < nloc; ++ii) {
+        deepmd::env_mat_a_simd_cpu<double>(&descrpt[0], NULL, &rij[0],
+                                           &posi[0], 0, &fmt_nlist[0], sec,
+                                           rmin, rmax);
+      }
+    });
+    double td = best_of(nrep, [&]() {
+      for (int ii = 0; ii < nloc; ++ii) {
+        deepmd::env_mat_a_simd_cpu<double>(&descrpt[0], &descrpt_deriv[0],
+                                           &rij[0], &posi[0], 0, &fmt_nlist[0],
+                                           sec, rmin, rmax);
+      }
+    });
+    printf("env_mat   sel %4d x 2  no deriv %6.3f ms  deriv %6.3f ms\n",
+           sel, tf, td);
+  }
+}
+
+int main() {
+  const int nrep = 30;
+  bench_tabulate(nrep);
+  bench_env_mat(nrep);
+  return 0;
+}
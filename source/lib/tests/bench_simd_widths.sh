@@ -0,0 +1,25 @@
+# Compare the SIMD se_a kernels specialized for the common widths of the last
+# embedding layer and of sel against the generic kernels.
+# Usage: bash bench_simd_widths.sh [compiler flags]
+set -e
+
+SCRIPT_PATH=$(dirname $(realpath -s $0))
+LIB_PATH=$(realpath -s ${SCRIPT_PATH}/..)
+BUILD_TMP_DIR=$(mktemp -d)
+CXX=${CXX:-g++}
+CXXFLAGS="-O3 -DNDEBUG -std=c++11 -fopenmp -fno-math-errno -fno-trapping-math $*"
+SOURCES="${SCRIPT_PATH}/bench_simd_widths.cc ${LIB_PATH}/src/tabulate.cc ${LIB_PATH}/src/env_mat_simd.cc"
+
+${CXX} ${CXXFLAGS} -I${LIB_PATH}/include ${SOURCES} \
+	-o ${BUILD_TMP_DIR}/specialized
+${CXX} ${CXXFLAGS} -DSIMD_GENERIC_WIDTH_ONLY -I${LIB_PATH}/include ${SOURCES} \
+	-o ${BUILD_TMP_DIR}/generic
+
+# the two builds are run alternately, as the timings drift on a busy machine
+for i in 1 2 3; do
+	echo "# generic kernels, run ${i}"
+	OMP_NUM_THREADS=1 ${BUILD_TMP_DIR}/generic
+	echo "# specialized kernels, run ${i}"
+	OMP_NUM_THREADS=1 ${BUILD_TMP_DIR}/specialized
+done
+rm -rf ${BUILD_TMP_DIR}
@@ -3,8 +3,10 @@
 #include <algorithm>
 #include <cmath>
 
+#include "SimulationRegion.h"
 #include "coord.h"
 #include "device.h"
+#include "neighbor_list.h"
 
 class TestNormCoord : public ::testing::Test {
  protected:
@@ -759,6 +761,73 @@ TEST_F(TestCopyCoordMoreCell, cpu_lessmem) {
   // 	    << nall << std::endl;
 }
 
+// the ghost atoms are in the same order as the legacy implementation
+TEST(TestCopyCoordTriclinic, cpu_equal_orig) {
+  std::vector<double> boxt = {7.1, 0., 0., 1.3, 6.4, 0., -0.9, 1.1, 8.2};
+  int nloc = 60;
+  double rc = 3.5;
+  std::vector<double> posi(nloc * 3);
+  std::vector<int> atype(nloc);
+  for (int ii = 0; ii < nloc; ++ii) {
+    double inter[3];
+    for (int dd = 0; dd < 3; ++dd) {
+      inter[dd] = fmod(0.618034 * (ii + 1) * (dd + 1) + 0.1 * dd, 1.);
+    }
+    for (int dd = 0; dd < 3; ++dd) {
+      posi[ii * 3 + dd] = inter[0] * boxt[dd] + inter[1] * boxt[3 + dd] +
+                          inter[2] * boxt[6 + dd];
+    }
+    atype[ii] = ii % 3;
+  }
+  SimulationRegion<double> region_orig;
+  region_orig.reinitBox(&boxt[0]);
+  std::vector<double> expect_c;
+  std::vector<int> expect_t, expect_mapping, ncell, ngcell;
+  copy_coord(expect_c, expect_t, expect_mapping, ncell, ngcell, posi, atype,
+             rc, region_orig);
+  int expect_nall = expect_t.size();
+
+  int mem_size = expect_nall;
+  std::vector<double> out_c(mem_size * 3);
+  std::vector<int> out_t(mem_size), mapping(mem_size);
+  int nall;
+  deepmd::Region<double> region;
+  init_region_cpu(region, &boxt[0]);
+  int ret = copy_coord_cpu(&out_c[0], &out_t[0], &mapping[0], &nall, &posi[0],
+                           &atype[0], nloc, mem_size, rc, region);
+  EXPECT_EQ(ret, 0);
+  ASSERT_EQ(nall, expect_nall);
+  for (int ii = 0; ii < nall; ++ii) {
+    for (int dd = 0; dd < 3; ++dd) {
+      EXPECT_LT(fabs(out_c[ii * 3 + dd] - expect_c[ii * 3 + dd]), 1e-12);
+    }
+    EXPECT_EQ(out_t[ii], expect_t[ii]);
+    EXPECT_EQ(mapping[ii], expect_mapping[ii]);
+  }
+
+  // float, without the round trip through double
+  std::vector<float> posi_f(posi.begin(), posi.end());
+  std::vector<float> boxt_f(boxt.begin(), boxt.end());
+  std::vector<float> out_c_f(mem_size * 3);
+  deepmd::Region<float> region_f;
+  init_region_cpu(region_f, &boxt_f[0]);
+  ret = copy_coord_cpu(&out_c_f[0], &out_t[0], &mapping[0], &nall, &posi_f[0],
+                       &atype[0], nloc, mem_size, rc, region_f);
+  EXPECT_EQ(ret, 0);
+  ASSERT_EQ(nall, expect_nall);
+  for (int ii = 0; ii < nall; ++ii) {
+    for (int dd = 0; dd < 3; ++dd) {
+      EXPECT_LT(fabs(out_c_f[ii * 3 + dd] - expect_c[ii * 3 + dd]), 1e-4);
+    }
+    EXPECT_EQ(mapping[ii], expect_mapping[ii]);
+  }
+
+  ret = copy_coord_cpu(&out_c[0], &out_t[0], &mapping[0], &nall, &posi[0],
+                       &atype[0], nloc, expect_nall - 1, rc, region);
+  EXPECT_EQ(ret, 1);
+  EXPECT_EQ(nall, expect_nall);
+}
+
 #if GOOGLE_CUDA
 TEST_F(TestCopyCoordMoreCell, gpu) {
   int mem_size = 1000;
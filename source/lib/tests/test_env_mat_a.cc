@@ -331,6 +331,65 @@ TEST_F(TestEnvMatA, cpu) {
   }
 }
 
+TEST_F(TestEnvMatA, cpu_simd_equal_cpu) {
+  std::vector<int> fmt_nlist_a;
+  std::vector<double> env, env_deriv, rij_a;
+  std::vector<double> env_1(nnei * 4), env_deriv_1(nnei * 4 * 3),
+      rij_a_1(nnei * 3);
+  for (int ii = 0; ii < nloc; ++ii) {
+    int ret = format_nlist_i_cpu<double>(fmt_nlist_a, posi_cpy, atype_cpy, ii,
+                                         nlist_a_cpy[ii], rc, sec_a);
+    EXPECT_EQ(ret, -1);
+    deepmd::env_mat_a_cpu<double>(env, env_deriv, rij_a, posi_cpy, atype_cpy,
+                                  ii, fmt_nlist_a, sec_a, rc_smth, rc);
+    deepmd::env_mat_a_simd_cpu<double>(&env_1[0], &env_deriv_1[0],
+                                       &rij_a_1[0], &posi_cpy[0], ii,
+                                       &fmt_nlist_a[0], sec_a, rc_smth, rc);
+    for (int jj = 0; jj < nnei * 4; ++jj) {
+      EXPECT_LT(fabs(env[jj] - env_1[jj]), 1e-12);
+    }
+    for (int jj = 0; jj < nnei * 4 * 3; ++jj) {
+      EXPECT_LT(fabs(env_deriv[jj] - env_deriv_1[jj]), 1e-12);
+    }
+    for (int jj = 0; jj < nnei * 3; ++jj) {
+      EXPECT_EQ(rij_a[jj], rij_a_1[jj]);
+    }
+  }
+}
+
+TEST_F(TestEnvMatA, cpu_simd_equal_cpu_sel_widths) {
+  // the section widths with specialized kernels
+  const std::vector<std::vector<int>> secs = {
+      {0, 46, 138}, {0, 60, 180}, {0, 120, 240}};
+  for (int ss = 0; ss < secs.size(); ++ss) {
+    const std::vector<int>& sec = secs[ss];
+    const int nnei_s = sec.back();
+    std::vector<int> fmt_nlist_a;
+    std::vector<double> env, env_deriv, rij_a;
+    std::vector<double> env_1(nnei_s * 4), env_deriv_1(nnei_s * 4 * 3),
+        rij_a_1(nnei_s * 3);
+    for (int ii = 0; ii < nloc; ++ii) {
+      int ret = format_nlist_i_cpu<double>(fmt_nlist_a, posi_cpy, atype_cpy,
+                                           ii, nlist_a_cpy[ii], rc, sec);
+      EXPECT_EQ(ret, -1);
+      deepmd::env_mat_a_cpu<double>(env, env_deriv, rij_a, posi_cpy, atype_cpy,
+                                    ii, fmt_nlist_a, sec, rc_smth, rc);
+      deepmd::env_mat_a_simd_cpu<double>(&env_1[0], &env_deriv_1[0],
+                                         &rij_a_1[0], &posi_cpy[0], ii,
+                                         &fmt_nlist_a[0], sec, rc_smth, rc);
+      for (int jj = 0; jj < nnei_s * 4; ++jj) {
+        EXPECT_LT(fabs(env[jj] - env_1[jj]), 1e-12);
+      }
+      for (int jj = 0; jj < nnei_s * 4 * 3; ++jj) {
+        EXPECT_LT(fabs(env_deriv[jj] - env_deriv_1[jj]), 1e-12);
+      }
+      for (int jj = 0; jj < nnei_s * 3; ++jj) {
+        EXPECT_EQ(rij_a[jj], rij_a_1[jj]);
+      }
+    }
+  }
+}
+
 TEST_F(TestEnvMatA, cpu_equal_orig_cpy) {
   std::vector<int> fmt_nlist_a_0, fmt_nlist_r_0;
   std::vector<int> fmt_nlist_a_1, fmt_nlist_r_1;
@@ -519,6 +578,41 @@ TEST_F(TestEnvMatA, prod_cpu) {
   }
 }
 
+TEST_F(TestEnvMatA, prod_cpu_no_deriv) {
+  int max_nbor_size = 0;
+  for (int ii = 0; ii < nlist_a_cpy.size(); ++ii) {
+    if (nlist_a_cpy[ii].size() > max_nbor_size) {
+      max_nbor_size = nlist_a_cpy[ii].size();
+    }
+  }
+  std::vector<int> ilist(nloc), numneigh(nloc);
+  std::vector<int *> firstneigh(nloc);
+  deepmd::InputNlist inlist(nloc, &ilist[0], &numneigh[0], &firstneigh[0]);
+  convert_nlist(inlist, nlist_a_cpy);
+
+  std::vector<double> em(nloc * ndescrpt), em_deriv(nloc * ndescrpt * 3),
+      rij(nloc * nnei * 3);
+  std::vector<int> nlist(nloc * nnei);
+  std::vector<double> avg(ntypes * ndescrpt, 0);
+  std::vector<double> std(ntypes * ndescrpt, 1);
+  deepmd::prod_env_mat_a_cpu(&em[0], &em_deriv[0], &rij[0], &nlist[0],
+                             &posi_cpy[0], &atype_cpy[0], inlist, max_nbor_size,
+                             &avg[0], &std[0], nloc, nall, rc, rc_smth, sec_a);
+  // the derivative is skipped
+  std::vector<double> em_1(nloc * ndescrpt), rij_1(nloc * nnei * 3);
+  std::vector<int> nlist_1(nloc * nnei);
+  deepmd::prod_env_mat_a_cpu(&em_1[0], (double *)NULL, &rij_1[0], &nlist_1[0],
+                             &posi_cpy[0], &atype_cpy[0], inlist, max_nbor_size,
+                             &avg[0], &std[0], nloc, nall, rc, rc_smth, sec_a);
+  for (int ii = 0; ii < nloc * ndescrpt; ++ii) {
+    EXPECT_EQ(em_1[ii], em[ii]);
+  }
+  for (int ii = 0; ii < nloc * nnei * 3; ++ii) {
+    EXPECT_EQ(rij_1[ii], rij[ii]);
+  }
+  EXPECT_EQ(nlist_1, nlist);
+}
+
 TEST_F(TestEnvMatA, prod_cpu_equal_cpu) {
   EXPECT_EQ(nlist_r_cpy.size(), nloc);
   int tot_nnei = 0;
@@ -585,6 +679,67 @@ TEST_F(TestEnvMatA, prod_cpu_equal_cpu) {
   // }
 }
 
+TEST_F(TestEnvMatA, prod_cpu_trim) {
+  int max_nbor_size = 0;
+  for (int ii = 0; ii < nlist_a_cpy.size(); ++ii) {
+    if (nlist_a_cpy[ii].size() > max_nbor_size) {
+      max_nbor_size = nlist_a_cpy[ii].size();
+    }
+  }
+  std::vector<int> ilist(nloc), numneigh(nloc);
+  std::vector<int *> firstneigh(nloc);
+  deepmd::InputNlist inlist(nloc, &ilist[0], &numneigh[0], &firstneigh[0]);
+  convert_nlist(inlist, nlist_a_cpy);
+  std::vector<double> em(nloc * ndescrpt), em_deriv(nloc * ndescrpt * 3),
+      rij(nloc * nnei * 3);
+  std::vector<int> nlist(nloc * nnei);
+  std::vector<double> avg(ntypes * ndescrpt, 0);
+  std::vector<double> std(ntypes * ndescrpt, 1);
+  deepmd::prod_env_mat_a_cpu(&em[0], &em_deriv[0], &rij[0], &nlist[0],
+                             &posi_cpy[0], &atype_cpy[0], inlist, max_nbor_size,
+                             &avg[0], &std[0], nloc, nall, rc, rc_smth, sec_a);
+
+  std::vector<int> sel_index, sel_trim;
+  deepmd::env_mat_trim_index_cpu(sel_index, sel_trim, &nlist[0], nloc, sec_a);
+  // at most 2 neighbors of type 0 and 4 neighbors of type 1
+  std::vector<int> expected_sel_trim = {2, 4};
+  std::vector<int> expected_sel_index = {0, 1, 10, 11, 12, 13};
+  EXPECT_EQ(sel_trim, expected_sel_trim);
+  EXPECT_EQ(sel_index, expected_sel_index);
+  int nnei_trim = sel_index.size();
+  std::vector<double> em_deriv_trim(nloc * nnei_trim * 4 * 3),
+      rij_trim(nloc * nnei_trim * 3);
+  std::vector<int> nlist_trim(nloc * nnei_trim);
+  deepmd::env_mat_trim_cpu(&em_deriv_trim[0], &em_deriv[0], sel_index, nloc,
+                           nnei, 4 * 3);
+  deepmd::env_mat_trim_cpu(&rij_trim[0], &rij[0], sel_index, nloc, nnei, 3);
+  deepmd::env_mat_trim_cpu(&nlist_trim[0], &nlist[0], sel_index, nloc, nnei,
+                           1);
+  for (int ii = 0; ii < nloc; ++ii) {
+    for (int jj = 0; jj < nnei_trim; ++jj) {
+      int kk = sel_index[jj];
+      EXPECT_EQ(nlist_trim[ii * nnei_trim + jj], nlist[ii * nnei + kk]);
+      for (int dd = 0; dd < 3; ++dd) {
+        EXPECT_EQ(rij_trim[(ii * nnei_trim + jj) * 3 + dd],
+                  rij[(ii * nnei + kk) * 3 + dd]);
+      }
+      for (int dd = 0; dd < 12; ++dd) {
+        EXPECT_EQ(em_deriv_trim[(ii * nnei_trim + jj) * 12 + dd],
+                  em_deriv[(ii * nnei + kk) * 12 + dd]);
+      }
+    }
+  }
+  // the dropped slots are padding
+  int nvalid = 0, nvalid_trim = 0;
+  for (int ii = 0; ii < nloc * nnei; ++ii) {
+    nvalid += nlist[ii] >= 0;
+  }
+  for (int ii = 0; ii < nloc * nnei_trim; ++ii) {
+    nvalid_trim += nlist_trim[ii] >= 0;
+  }
+  EXPECT_EQ(nvalid_trim, nvalid);
+}
+
 #if GOOGLE_CUDA
 TEST_F(TestEnvMatA, prod_gpu_cuda) {
   EXPECT_EQ(nlist_r_cpy.size(), nloc);
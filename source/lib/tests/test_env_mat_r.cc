@@ -191,6 +191,32 @@ TEST_F(TestEnvMatR, cpu) {
   }
 }
 
+TEST_F(TestEnvMatR, cpu_simd_equal_cpu) {
+  std::vector<int> fmt_nlist_a;
+  std::vector<double> env, env_deriv, rij_a;
+  std::vector<double> env_1(nnei * 1), env_deriv_1(nnei * 1 * 3),
+      rij_a_1(nnei * 3);
+  for (int ii = 0; ii < nloc; ++ii) {
+    int ret = format_nlist_i_cpu<double>(fmt_nlist_a, posi_cpy, atype_cpy, ii,
+                                         nlist_a_cpy[ii], rc, sec_a);
+    EXPECT_EQ(ret, -1);
+    deepmd::env_mat_r_cpu<double>(env, env_deriv, rij_a, posi_cpy, atype_cpy,
+                                  ii, fmt_nlist_a, sec_a, rc_smth, rc);
+    deepmd::env_mat_r_simd_cpu<double>(&env_1[0], &env_deriv_1[0],
+                                       &rij_a_1[0], &posi_cpy[0], ii,
+                                       &fmt_nlist_a[0], sec_a, rc_smth, rc);
+    for (int jj = 0; jj < nnei * 1; ++jj) {
+      EXPECT_LT(fabs(env[jj] - env_1[jj]), 1e-12);
+    }
+    for (int jj = 0; jj < nnei * 1 * 3; ++jj) {
+      EXPECT_LT(fabs(env_deriv[jj] - env_deriv_1[jj]), 1e-12);
+    }
+    for (int jj = 0; jj < nnei * 3; ++jj) {
+      EXPECT_EQ(rij_a[jj], rij_a_1[jj]);
+    }
+  }
+}
+
 TEST_F(TestEnvMatR, cpu_equal_orig_cpy) {
   std::vector<int> fmt_nlist_a_0, fmt_nlist_r_0;
   std::vector<int> fmt_nlist_a_1, fmt_nlist_r_1;
@@ -297,6 +323,41 @@ TEST_F(TestEnvMatR, prod_cpu) {
   }
 }
 
+TEST_F(TestEnvMatR, prod_cpu_no_deriv) {
+  int max_nbor_size = 0;
+  for (int ii = 0; ii < nlist_a_cpy.size(); ++ii) {
+    if (nlist_a_cpy[ii].size() > max_nbor_size) {
+      max_nbor_size = nlist_a_cpy[ii].size();
+    }
+  }
+  std::vector<int> ilist(nloc), numneigh(nloc);
+  std::vector<int *> firstneigh(nloc);
+  deepmd::InputNlist inlist(nloc, &ilist[0], &numneigh[0], &firstneigh[0]);
+  convert_nlist(inlist, nlist_a_cpy);
+
+  std::vector<double> em(nloc * ndescrpt), em_deriv(nloc * ndescrpt * 3),
+      rij(nloc * nnei * 3);
+  std::vector<int> nlist(nloc * nnei);
+  std::vector<double> avg(ntypes * ndescrpt, 0);
+  std::vector<double> std(ntypes * ndescrpt, 1);
+  deepmd::prod_env_mat_r_cpu(&em[0], &em_deriv[0], &rij[0], &nlist[0],
+                             &posi_cpy[0], &atype_cpy[0], inlist, max_nbor_size,
+                             &avg[0], &std[0], nloc, nall, rc, rc_smth, sec_a);
+  // the derivative is skipped
+  std::vector<double> em_1(nloc * ndescrpt), rij_1(nloc * nnei * 3);
+  std::vector<int> nlist_1(nloc * nnei);
+  deepmd::prod_env_mat_r_cpu(&em_1[0], (double *)NULL, &rij_1[0], &nlist_1[0],
+                             &posi_cpy[0], &atype_cpy[0], inlist, max_nbor_size,
+                             &avg[0], &std[0], nloc, nall, rc, rc_smth, sec_a);
+  for (int ii = 0; ii < nloc * ndescrpt; ++ii) {
+    EXPECT_EQ(em_1[ii], em[ii]);
+  }
+  for (int ii = 0; ii < nloc * nnei * 3; ++ii) {
+    EXPECT_EQ(rij_1[ii], rij[ii]);
+  }
+  EXPECT_EQ(nlist_1, nlist);
+}
+
 TEST_F(TestEnvMatR, prod_cpu_equal_cpu) {
   EXPECT_EQ(nlist_r_cpy.size(), nloc);
   int tot_nnei = 0;
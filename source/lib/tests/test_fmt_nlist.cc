@@ -1,5 +1,8 @@
 #include <gtest/gtest.h>
 
+#include <algorithm>
+#include <cmath>
+
 #include "fmt_nlist.h"
 #include "neighbor_list.h"
 
@@ -312,6 +315,140 @@ TEST_F(TestFormatNlistShortSel, cpu) {
   }
 }
 
+// dense lattice with many equidistant neighbors and overflowing sel
+TEST(TestFormatNlistDense, cpu_equal_full_sort) {
+  int ntypes = 3;
+  float rc = 2.6;
+  std::vector<int> sec_a = {0, 7, 12, 40};
+  std::vector<double> posi;
+  std::vector<int> atype;
+  for (int ii = 0; ii < 6; ++ii) {
+    for (int jj = 0; jj < 6; ++jj) {
+      for (int kk = 0; kk < 6; ++kk) {
+        posi.push_back(ii);
+        posi.push_back(jj);
+        posi.push_back(kk);
+        atype.push_back((ii + 2 * jj + kk) % (ntypes + 1) - 1);
+      }
+    }
+  }
+  int nall = atype.size();
+  int nloc = nall;
+  std::vector<std::vector<int>> nlist_a(nloc);
+  for (int ii = 0; ii < nloc; ++ii) {
+    for (int jj = nall - 1; jj >= 0; --jj) {
+      if (jj != ii) {
+        nlist_a[ii].push_back(jj);
+      }
+    }
+  }
+  int inum = nloc;
+  std::vector<int> ilist(inum);
+  std::vector<int> numneigh(inum);
+  std::vector<int*> firstneigh(inum);
+  deepmd::InputNlist in_nlist(inum, &ilist[0], &numneigh[0], &firstneigh[0]);
+  convert_nlist(in_nlist, nlist_a);
+  std::vector<int> nlist(inum * sec_a.back());
+  format_nlist_cpu(&nlist[0], in_nlist, &posi[0], &atype[0], nloc, nall, rc,
+                   sec_a);
+
+  std::vector<int> fmt_nlist_a;
+  int n_overflow = 0;
+  for (int ii = 0; ii < nloc; ++ii) {
+    // reference: sort all candidates by (type, distance, index)
+    std::vector<std::vector<std::pair<float, int>>> sel_nei(ntypes);
+    for (int jj : nlist_a[ii]) {
+      if (atype[jj] < 0) continue;
+      float diff[3];
+      for (int dd = 0; dd < 3; ++dd) {
+        diff[dd] = (float)posi[jj * 3 + dd] - (float)posi[ii * 3 + dd];
+      }
+      float rr2 = diff[0] * diff[0] + diff[1] * diff[1] + diff[2] * diff[2];
+      if (rr2 <= rc * rc) {
+        sel_nei[atype[jj]].push_back(std::make_pair(rr2, jj));
+      }
+    }
+    int expect_ret = -1;
+    std::vector<int> expect(sec_a.back(), -1);
+    for (int tt = 0; tt < ntypes; ++tt) {
+      std::sort(sel_nei[tt].begin(), sel_nei[tt].end());
+      for (int kk = 0; kk < sel_nei[tt].size(); ++kk) {
+        if (sec_a[tt] + kk < sec_a[tt + 1]) {
+          expect[sec_a[tt] + kk] = sel_nei[tt][kk].second;
+        } else {
+          expect_ret = tt;
+        }
+      }
+    }
+    int ret = format_nlist_i_cpu<double>(fmt_nlist_a, posi, atype, ii,
+                                         nlist_a[ii], rc, sec_a);
+    EXPECT_EQ(ret, expect_ret);
+    n_overflow += (ret >= 0);
+    for (int jj = 0; jj < sec_a.back(); ++jj) {
+      EXPECT_EQ(fmt_nlist_a[jj], expect[jj]);
+      EXPECT_EQ(nlist[ii * sec_a.back() + jj], expect[jj]);
+    }
+  }
+  EXPECT_GT(n_overflow, 0);
+}
+
+TEST(TestFormatNlistDense, cpu_reuse_order) {
+  float rc = 2.1;
+  std::vector<int> sec_a = {0, 6, 20};
+  std::vector<double> posi;
+  std::vector<int> atype;
+  for (int ii = 0; ii < 5; ++ii) {
+    for (int jj = 0; jj < 5; ++jj) {
+      for (int kk = 0; kk < 5; ++kk) {
+        posi.push_back(ii);
+        posi.push_back(jj);
+        posi.push_back(kk);
+        atype.push_back((ii + jj + kk) % 2);
+      }
+    }
+  }
+  int nall = atype.size();
+  int nloc = nall;
+  // the candidates include a skin beyond the cutoff
+  std::vector<std::vector<int>> nlist_a(nloc);
+  for (int ii = 0; ii < nloc; ++ii) {
+    for (int jj = 0; jj < nall; ++jj) {
+      double rr2 = 0;
+      for (int dd = 0; dd < 3; ++dd) {
+        double diff = posi[jj * 3 + dd] - posi[ii * 3 + dd];
+        rr2 += diff * diff;
+      }
+      if (jj != ii && rr2 < (rc + 1.) * (rc + 1.)) {
+        nlist_a[ii].push_back(jj);
+      }
+    }
+  }
+  int inum = nloc;
+  std::vector<int> ilist(inum);
+  std::vector<int> numneigh(inum);
+  std::vector<int*> firstneigh(inum);
+  deepmd::InputNlist in_nlist(inum, &ilist[0], &numneigh[0], &firstneigh[0]);
+  convert_nlist(in_nlist, nlist_a);
+  std::vector<int> nlist(inum * sec_a.back());
+  std::vector<int> expect_nlist(inum * sec_a.back());
+  deepmd::NeighborOrder order;
+  for (int step = 0; step < 10; ++step) {
+    // move the atoms so that neighbors swap and cross the cutoff
+    for (int ii = 0; ii < nall; ++ii) {
+      for (int dd = 0; dd < 3; ++dd) {
+        posi[ii * 3 + dd] += 0.05 * sin(1.7 * ii + 2.3 * dd + step);
+      }
+    }
+    format_nlist_cpu(&nlist[0], order, in_nlist, &posi[0], &atype[0], nloc,
+                     nall, rc, sec_a, step > 0);
+    format_nlist_cpu(&expect_nlist[0], in_nlist, &posi[0], &atype[0], nloc,
+                     nall, rc, sec_a);
+    for (int ii = 0; ii < nlist.size(); ++ii) {
+      EXPECT_EQ(nlist[ii], expect_nlist[ii]);
+    }
+  }
+}
+
 #if GOOGLE_CUDA
 TEST_F(TestFormatNlist, gpu_cuda) {
   std::vector<std::vector<int>> nlist_a_0, nlist_r_0;
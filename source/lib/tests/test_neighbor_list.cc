@@ -3,6 +3,9 @@
 #include "device.h"
 #include "fmt_nlist.h"
 #include "neighbor_list.h"
+#if defined(_OPENMP)
+#include <omp.h>
+#endif
 
 class TestNeighborList : public ::testing::Test {
  protected:
@@ -134,6 +137,108 @@ TEST_F(TestNeighborList, cpu_lessmem) {
   delete[] firstneigh;
 }
 
+TEST(TestNeighborListCell, cpu_triclinic) {
+  // a triclinic box much larger than rc, so that the cell list is used
+  std::vector<double> boxt = {19., 0., 0., 3.1, 17., 0., -2.3, 4.2, 18.};
+  int nloc = 200;
+  double rc = 4.5;
+  std::vector<double> posi(nloc * 3);
+  std::vector<int> atype(nloc, 0);
+  srand(20230321);
+  for (int ii = 0; ii < nloc; ++ii) {
+    double inter[3];
+    for (int dd = 0; dd < 3; ++dd) {
+      inter[dd] = (double)rand() / RAND_MAX;
+    }
+    for (int dd = 0; dd < 3; ++dd) {
+      posi[ii * 3 + dd] = inter[0] * boxt[0 * 3 + dd] +
+                          inter[1] * boxt[1 * 3 + dd] +
+                          inter[2] * boxt[2 * 3 + dd];
+    }
+  }
+  SimulationRegion<double> region;
+  region.reinitBox(&boxt[0]);
+  std::vector<double> posi_cpy;
+  std::vector<int> atype_cpy, mapping, ncell, ngcell;
+  copy_coord(posi_cpy, atype_cpy, mapping, ncell, ngcell, posi, atype, rc,
+             region);
+  int nall = posi_cpy.size() / 3;
+  // all-pair reference
+  std::vector<std::vector<int>> expect_nlist(nloc);
+  for (int ii = 0; ii < nloc; ++ii) {
+    for (int jj = 0; jj < nall; ++jj) {
+      if (jj == ii) continue;
+      double diff[3];
+      for (int dd = 0; dd < 3; ++dd) {
+        diff[dd] = posi_cpy[ii * 3 + dd] - posi_cpy[jj * 3 + dd];
+      }
+      if (deepmd::dot3(diff, diff) < rc * rc) {
+        expect_nlist[ii].push_back(jj);
+      }
+    }
+  }
+  int mem_size = 200;
+  std::vector<int> ilist(nloc), numneigh(nloc);
+  std::vector<int*> firstneigh(nloc);
+  std::vector<std::vector<int>> jlist(nloc, std::vector<int>(mem_size));
+  for (int ii = 0; ii < nloc; ++ii) {
+    firstneigh[ii] = &jlist[ii][0];
+  }
+  deepmd::InputNlist nlist(nloc, &ilist[0], &numneigh[0], &firstneigh[0]);
+  int max_list_size;
+  int ret = build_nlist_cpu(nlist, &max_list_size, &posi_cpy[0], nloc, nall,
+                            mem_size, rc);
+  EXPECT_EQ(ret, 0);
+  int expect_max = 0;
+  for (int ii = 0; ii < nloc; ++ii) {
+    EXPECT_EQ(nlist.ilist[ii], ii);
+    ASSERT_EQ(nlist.numneigh[ii], expect_nlist[ii].size());
+    for (int jj = 0; jj < nlist.numneigh[ii]; ++jj) {
+      EXPECT_EQ(nlist.firstneigh[ii][jj], expect_nlist[ii][jj]);
+    }
+    expect_max = std::max(expect_max, (int)expect_nlist[ii].size());
+  }
+  EXPECT_EQ(max_list_size, expect_max);
+  // not enough memory
+  ret = build_nlist_cpu(nlist, &max_list_size, &posi_cpy[0], nloc, nall,
+                        expect_max - 1, rc);
+  EXPECT_EQ(ret, 1);
+  EXPECT_EQ(max_list_size, expect_max);
+}
+
+TEST(TestReverseNlist, cpu) {
+  // 2 ghost atoms, the local atoms [1, 6) with padded slots
+  const int nloc = 5, nall = 8, nnei = 3, start_index = 1;
+  std::vector<int> nlist = {-1, -1, -1, 2, 7, -1, 1, 3,  -1, 7, 0, -1,
+                            1,  2,  -1, 0, 6, 7,  -1, -1, -1};
+  // the reference of the slots pointing to each atom
+  std::vector<std::vector<int>> expect_rev(nall);
+  for (int ii = start_index * nnei; ii < (start_index + nloc) * nnei; ++ii) {
+    if (nlist[ii] >= 0) expect_rev[nlist[ii]].push_back(ii);
+  }
+  std::vector<int> nthreads = {1, 3};
+  for (int tt = 0; tt < nthreads.size(); ++tt) {
+#if defined(_OPENMP)
+    int max_threads = omp_get_max_threads();
+    omp_set_num_threads(nthreads[tt]);
+#endif
+    std::vector<int> rev_start, rev_slot;
+    deepmd::build_reverse_nlist_cpu(rev_start, rev_slot, &nlist[0], nloc,
+                                    nall, nnei, start_index);
+#if defined(_OPENMP)
+    omp_set_num_threads(max_threads);
+#endif
+    ASSERT_EQ(rev_start.size(), nall + 1);
+    EXPECT_EQ(rev_start[0], 0);
+    for (int jj = 0; jj < nall; ++jj) {
+      ASSERT_EQ(rev_start[jj + 1] - rev_start[jj], expect_rev[jj].size());
+      for (int rr = rev_start[jj]; rr < rev_start[jj + 1]; ++rr) {
+        EXPECT_EQ(rev_slot[rr], expect_rev[jj][rr - rev_start[jj]]);
+      }
+    }
+  }
+}
+
 #if GOOGLE_CUDA
 TEST_F(TestNeighborList, gpu) {
   int mem_size = 48;
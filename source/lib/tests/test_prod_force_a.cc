@@ -7,6 +7,9 @@
 #include "fmt_nlist.h"
 #include "neighbor_list.h"
 #include "prod_force.h"
+#if defined(_OPENMP)
+#include <omp.h>
+#endif
 
 class TestProdForceA : public ::testing::Test {
  protected:
@@ -122,6 +125,54 @@ TEST_F(TestProdForceA, cpu) {
   // printf("\n");
 }
 
+TEST_F(TestProdForceA, cpu_skip_padding) {
+  // the padded slots are not read
+  for (int ii = 0; ii < nloc * nnei; ++ii) {
+    if (nlist[ii] >= 0) continue;
+    for (int aa = ii * 4; aa < ii * 4 + 4; ++aa) {
+      net_deriv[aa] = NAN;
+      for (int dd = 0; dd < 3; ++dd) env_deriv[aa * 3 + dd] = NAN;
+    }
+  }
+  std::vector<double> force(nall * 3);
+  deepmd::prod_force_a_cpu<double>(&force[0], &net_deriv[0], &env_deriv[0],
+                                   &nlist[0], nloc, nall, nnei);
+  for (int jj = 0; jj < force.size(); ++jj) {
+    EXPECT_LT(fabs(force[jj] - expected_force[jj]), 1e-5);
+  }
+}
+
+#if defined(_OPENMP)
+TEST_F(TestProdForceA, cpu_nthreads) {
+  int nthreads = omp_get_max_threads();
+  std::vector<double> force_1(nall * 3), force_3(nall * 3);
+  omp_set_num_threads(1);
+  deepmd::prod_force_a_cpu<double>(&force_1[0], &net_deriv[0], &env_deriv[0],
+                                   &nlist[0], nloc, nall, nnei);
+  omp_set_num_threads(3);
+  deepmd::prod_force_a_cpu<double>(&force_3[0], &net_deriv[0], &env_deriv[0],
+                                   &nlist[0], nloc, nall, nnei);
+  omp_set_num_threads(nthreads);
+  // the summation order does not depend on the number of threads
+  for (int jj = 0; jj < nall * 3; ++jj) {
+    EXPECT_EQ(force_1[jj], force_3[jj]);
+  }
+}
+#endif  // _OPENMP
+
+TEST_F(TestProdForceA, cpu_start_index) {
+  std::vector<double> force_0(nall * 3), force_1(nall * 3);
+  int nloc_0 = nloc / 2;
+  deepmd::prod_force_a_cpu<double>(&force_0[0], &net_deriv[0], &env_deriv[0],
+                                   &nlist[0], nloc_0, nall, nnei, 0);
+  deepmd::prod_force_a_cpu<double>(&force_1[0], &net_deriv[0], &env_deriv[0],
+                                   &nlist[0], nloc - nloc_0, nall, nnei,
+                                   nloc_0);
+  for (int jj = 0; jj < nall * 3; ++jj) {
+    EXPECT_LT(fabs(force_0[jj] + force_1[jj] - expected_force[jj]), 1e-5);
+  }
+}
+
 #if GOOGLE_CUDA
 TEST_F(TestProdForceA, gpu_cuda) {
   std::vector<double> force(nall * 3, 0.0);
@@ -132,6 +132,25 @@ TEST_F(TestProdForceGradA, cpu) {
   // printf("\n");
 }
 
+TEST_F(TestProdForceGradA, cpu_nframes) {
+  // the second frame has the grad scaled by 2
+  int nframes = 2;
+  std::vector<double> grad_2(grad), env_deriv_2(env_deriv);
+  std::vector<int> nlist_2(nlist);
+  for (int ii = 0; ii < nloc * 3; ++ii) grad_2.push_back(grad[ii] * 2.);
+  env_deriv_2.insert(env_deriv_2.end(), env_deriv.begin(), env_deriv.end());
+  nlist_2.insert(nlist_2.end(), nlist.begin(), nlist.end());
+  std::vector<double> grad_net(nframes * nloc * ndescrpt);
+  deepmd::prod_force_grad_a_cpu<double>(&grad_net[0], &grad_2[0],
+                                        &env_deriv_2[0], &nlist_2[0], nloc,
+                                        nnei, nframes);
+  for (int jj = 0; jj < nloc * ndescrpt; ++jj) {
+    EXPECT_LT(fabs(grad_net[jj] - expected_grad_net[jj]), 1e-5);
+    EXPECT_LT(fabs(grad_net[nloc * ndescrpt + jj] - 2. * expected_grad_net[jj]),
+              1e-5);
+  }
+}
+
 #if GOOGLE_CUDA
 TEST_F(TestProdForceGradA, gpu) {
   std::vector<double> grad_net(nloc * ndescrpt);
@@ -7,6 +7,9 @@
 #include "fmt_nlist.h"
 #include "neighbor_list.h"
 #include "prod_force.h"
+#if defined(_OPENMP)
+#include <omp.h>
+#endif
 
 class TestProdForceR : public ::testing::Test {
  protected:
@@ -119,6 +122,24 @@ TEST_F(TestProdForceR, cpu) {
   // printf("\n");
 }
 
+#if defined(_OPENMP)
+TEST_F(TestProdForceR, cpu_nthreads) {
+  int nthreads = omp_get_max_threads();
+  std::vector<double> force_1(nall * 3), force_3(nall * 3);
+  omp_set_num_threads(1);
+  deepmd::prod_force_r_cpu<double>(&force_1[0], &net_deriv[0], &env_deriv[0],
+                                   &nlist[0], nloc, nall, nnei);
+  omp_set_num_threads(3);
+  deepmd::prod_force_r_cpu<double>(&force_3[0], &net_deriv[0], &env_deriv[0],
+                                   &nlist[0], nloc, nall, nnei);
+  omp_set_num_threads(nthreads);
+  // the summation order does not depend on the number of threads
+  for (int jj = 0; jj < nall * 3; ++jj) {
+    EXPECT_EQ(force_1[jj], force_3[jj]);
+  }
+}
+#endif  // _OPENMP
+
 #if GOOGLE_CUDA
 TEST_F(TestProdForceR, gpu_cuda) {
   std::vector<double> force(nall * 3, 0.0);
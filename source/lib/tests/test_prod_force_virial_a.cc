@@ -0,0 +1,156 @@
+#include <gtest/gtest.h>
+
+#include <iostream>
+
+#include "device.h"
+#include "env_mat.h"
+#include "fmt_nlist.h"
+#include "neighbor_list.h"
+#include "prod_force.h"
+#include "prod_force_virial.h"
+#include "prod_virial.h"
+#if defined(_OPENMP)
+#include <omp.h>
+#endif
+
+class TestProdForceVirialA : public ::testing::Test {
+ protected:
+  std::vector<double> posi = {12.83, 2.56, 2.18, 12.09, 2.87, 2.74,
+                              00.25, 3.32, 1.68, 3.36,  3.00, 1.81,
+                              3.51,  2.51, 2.60, 4.27,  3.22, 1.56};
+  std::vector<int> atype = {0, 1, 1, 0, 1, 1};
+  std::vector<double> posi_cpy;
+  std::vector<int> atype_cpy;
+  int ntypes = 2;
+  int nloc, nall, nnei, ndescrpt;
+  double rc = 6;
+  double rc_smth = 0.8;
+  SimulationRegion<double> region;
+  std::vector<int> mapping, ncell, ngcell;
+  std::vector<int> sec_a = {0, 5, 10};
+  std::vector<int> sec_r = {0, 0, 0};
+  std::vector<int> nat_stt, ext_stt, ext_end;
+  std::vector<std::vector<int>> nlist_a_cpy, nlist_r_cpy;
+  std::vector<double> net_deriv, in_deriv;
+  std::vector<double> env, env_deriv, rij;
+  std::vector<int> nlist;
+  std::vector<int> fmt_nlist_a;
+  void SetUp() override {
+    double box[] = {13., 0., 0., 0., 13., 0., 0., 0., 13.};
+    region.reinitBox(box);
+    copy_coord(posi_cpy, atype_cpy, mapping, ncell, ngcell, posi, atype, rc,
+               region);
+    nloc = posi.size() / 3;
+    nall = posi_cpy.size() / 3;
+    nnei = sec_a.back();
+    ndescrpt = nnei * 4;
+    nat_stt.resize(3);
+    ext_stt.resize(3);
+    ext_end.resize(3);
+    for (int dd = 0; dd < 3; ++dd) {
+      ext_stt[dd] = -ngcell[dd];
+      ext_end[dd] = ncell[dd] + ngcell[dd];
+    }
+    build_nlist(nlist_a_cpy, nlist_r_cpy, posi_cpy, nloc, rc, rc, nat_stt,
+                ncell, ext_stt, ext_end, region, ncell);
+    nlist.resize(nloc * nnei);
+    env.resize(nloc * ndescrpt);
+    env_deriv.resize(nloc * ndescrpt * 3);
+    rij.resize(nloc * nnei * 3);
+    for (int ii = 0; ii < nloc; ++ii) {
+      // format nlist and record
+      format_nlist_i_cpu<double>(fmt_nlist_a, posi_cpy, atype_cpy, ii,
+                                 nlist_a_cpy[ii], rc, sec_a);
+      for (int jj = 0; jj < nnei; ++jj) {
+        nlist[ii * nnei + jj] = fmt_nlist_a[jj];
+      }
+      std::vector<double> t_env, t_env_deriv, t_rij;
+      // compute env_mat and its deriv, record
+      deepmd::env_mat_a_cpu<double>(t_env, t_env_deriv, t_rij, posi_cpy,
+                                    atype_cpy, ii, fmt_nlist_a, sec_a, rc_smth,
+                                    rc);
+      for (int jj = 0; jj < ndescrpt; ++jj) {
+        env[ii * ndescrpt + jj] = t_env[jj];
+        for (int dd = 0; dd < 3; ++dd) {
+          env_deriv[ii * ndescrpt * 3 + jj * 3 + dd] = t_env_deriv[jj * 3 + dd];
+        }
+      }
+      for (int jj = 0; jj < nnei * 3; ++jj) {
+        rij[ii * nnei * 3 + jj] = t_rij[jj];
+      }
+    }
+    net_deriv.resize(nloc * ndescrpt);
+    for (int ii = 0; ii < nloc * ndescrpt; ++ii) {
+      net_deriv[ii] = 10 - ii * 0.01;
+    }
+  }
+  void TearDown() override {}
+};
+
+TEST_F(TestProdForceVirialA, cpu) {
+  std::vector<double> force(nall * 3), virial(9), atom_virial(nall * 9);
+  deepmd::prod_force_virial_a_cpu<double>(
+      &force[0], &virial[0], &atom_virial[0], &net_deriv[0], &env_deriv[0],
+      &rij[0], &nlist[0], nloc, nall, nnei);
+  // the same as the separated kernels
+  std::vector<double> expected_force(nall * 3), expected_virial(9),
+      expected_atom_virial(nall * 9);
+  deepmd::prod_force_a_cpu<double>(&expected_force[0], &net_deriv[0],
+                                   &env_deriv[0], &nlist[0], nloc, nall, nnei);
+  deepmd::prod_virial_a_cpu<double>(&expected_virial[0],
+                                    &expected_atom_virial[0], &net_deriv[0],
+                                    &env_deriv[0], &rij[0], &nlist[0], nloc,
+                                    nall, nnei);
+  for (int jj = 0; jj < nall * 3; ++jj) {
+    EXPECT_LT(fabs(force[jj] - expected_force[jj]), 1e-10);
+  }
+  for (int jj = 0; jj < 9; ++jj) {
+    EXPECT_LT(fabs(virial[jj] - expected_virial[jj]), 1e-10);
+  }
+  for (int jj = 0; jj < nall * 9; ++jj) {
+    EXPECT_LT(fabs(atom_virial[jj] - expected_atom_virial[jj]), 1e-10);
+  }
+  // the atom virial can be skipped
+  std::vector<double> virial_1(9);
+  deepmd::prod_force_virial_a_cpu<double>(
+      &force[0], &virial_1[0], (double*)NULL, &net_deriv[0], &env_deriv[0],
+      &rij[0], &nlist[0], nloc, nall, nnei);
+  for (int jj = 0; jj < 9; ++jj) {
+    EXPECT_LT(fabs(virial_1[jj] - virial[jj]), 1e-10);
+  }
+}
+
+#if defined(_OPENMP)
+TEST_F(TestProdForceVirialA, cpu_nthreads) {
+  int nthreads = omp_get_max_threads();
+  std::vector<double> force_1(nall * 3), virial_1(9), atom_virial_1(nall * 9);
+  std::vector<double> force_3(nall * 3), virial_3(9), atom_virial_3(nall * 9);
+  std::vector<double> virial_null_1(9), virial_null_3(9);
+  omp_set_num_threads(1);
+  deepmd::prod_force_virial_a_cpu<double>(
+      &force_1[0], &virial_1[0], &atom_virial_1[0], &net_deriv[0],
+      &env_deriv[0], &rij[0], &nlist[0], nloc, nall, nnei);
+  deepmd::prod_force_virial_a_cpu<double>(
+      &force_1[0], &virial_null_1[0], (double*)NULL, &net_deriv[0],
+      &env_deriv[0], &rij[0], &nlist[0], nloc, nall, nnei);
+  omp_set_num_threads(3);
+  deepmd::prod_force_virial_a_cpu<double>(
+      &force_3[0], &virial_3[0], &atom_virial_3[0], &net_deriv[0],
+      &env_deriv[0], &rij[0], &nlist[0], nloc, nall, nnei);
+  deepmd::prod_force_virial_a_cpu<double>(
+      &force_3[0], &virial_null_3[0], (double*)NULL, &net_deriv[0],
+      &env_deriv[0], &rij[0], &nlist[0], nloc, nall, nnei);
+  omp_set_num_threads(nthreads);
+  // the summation order does not depend on the number of threads
+  for (int jj = 0; jj < nall * 3; ++jj) {
+    EXPECT_EQ(force_1[jj], force_3[jj]);
+  }
+  for (int jj = 0; jj < 9; ++jj) {
+    EXPECT_EQ(virial_1[jj], virial_3[jj]);
+    EXPECT_EQ(virial_null_1[jj], virial_null_3[jj]);
+  }
+  for (int jj = 0; jj < nall * 9; ++jj) {
+    EXPECT_EQ(atom_virial_1[jj], atom_virial_3[jj]);
+  }
+}
+#endif
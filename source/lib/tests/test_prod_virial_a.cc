@@ -7,6 +7,9 @@
 #include "fmt_nlist.h"
 #include "neighbor_list.h"
 #include "prod_virial.h"
+#if defined(_OPENMP)
+#include <omp.h>
+#endif
 
 class TestProdVirialA : public ::testing::Test {
  protected:
@@ -177,6 +180,40 @@ TEST_F(TestProdVirialA, cpu) {
   // printf("\n");
 }
 
+TEST_F(TestProdVirialA, cpu_no_atom_virial) {
+  std::vector<double> virial(9);
+  deepmd::prod_virial_a_cpu<double>(&virial[0], (double*)NULL, &net_deriv[0],
+                                    &env_deriv[0], &rij[0], &nlist[0], nloc,
+                                    nall, nnei);
+  for (int jj = 0; jj < virial.size(); ++jj) {
+    EXPECT_LT(fabs(virial[jj] - expected_virial[jj]), 1e-5);
+  }
+}
+
+#if defined(_OPENMP)
+TEST_F(TestProdVirialA, cpu_nthreads) {
+  int nthreads = omp_get_max_threads();
+  std::vector<double> virial_1(9), virial_3(9);
+  std::vector<double> atom_virial_1(nall * 9), atom_virial_3(nall * 9);
+  omp_set_num_threads(1);
+  deepmd::prod_virial_a_cpu<double>(&virial_1[0], &atom_virial_1[0],
+                                    &net_deriv[0], &env_deriv[0], &rij[0],
+                                    &nlist[0], nloc, nall, nnei);
+  omp_set_num_threads(3);
+  deepmd::prod_virial_a_cpu<double>(&virial_3[0], &atom_virial_3[0],
+                                    &net_deriv[0], &env_deriv[0], &rij[0],
+                                    &nlist[0], nloc, nall, nnei);
+  omp_set_num_threads(nthreads);
+  // the summation order does not depend on the number of threads
+  for (int jj = 0; jj < 9; ++jj) {
+    EXPECT_EQ(virial_1[jj], virial_3[jj]);
+  }
+  for (int jj = 0; jj < nall * 9; ++jj) {
+    EXPECT_EQ(atom_virial_1[jj], atom_virial_3[jj]);
+  }
+}
+#endif  // _OPENMP
+
 #if GOOGLE_CUDA
 TEST_F(TestProdVirialA, gpu_cuda) {
   std::vector<double> virial(9, 0.0);
@@ -641,6 +641,153 @@ TEST_F(TestTabulateSeA, tabulate_fusion_se_a_grad_cpu) {
   }
 }
 
+TEST_F(TestTabulateSeA, tabulate_fusion_se_a_simd_cpu) {
+  const int nspline = table.size() / (last_layer_size * 6);
+  std::vector<double> table_cm(table.size());
+  deepmd::tabulate_table_coef_major_cpu<double>(&table_cm[0], &table[0],
+                                                nspline, last_layer_size);
+  std::vector<double> xyz_scatter(nloc * nnei * last_layer_size);
+  deepmd::tabulate_fusion_se_a_simd_cpu<double>(
+      &xyz_scatter[0], &table_cm[0], &info[0], &em_x[0], &em[0], nloc, nnei,
+      last_layer_size);
+  EXPECT_EQ(xyz_scatter.size(), expected_xyz_scatter.size());
+  for (int jj = 0; jj < xyz_scatter.size(); ++jj) {
+    EXPECT_LT(fabs(xyz_scatter[jj] - expected_xyz_scatter[jj]), 1e-5);
+  }
+}
+
+TEST_F(TestTabulateSeA, tabulate_fusion_se_a_grad_simd_cpu) {
+  const int nspline = table.size() / (last_layer_size * 6);
+  std::vector<double> table_cm(table.size());
+  deepmd::tabulate_table_coef_major_cpu<double>(&table_cm[0], &table[0],
+                                                nspline, last_layer_size);
+  std::vector<double> dy_dem_x(em_x.size());
+  std::vector<double> dy_dem(em.size());
+  std::vector<double> dy(nloc * nnei * last_layer_size, 1.0);
+  deepmd::tabulate_fusion_se_a_grad_simd_cpu<double>(
+      &dy_dem_x[0], &dy_dem[0], &table_cm[0], &info[0], &em_x[0], &em[0],
+      &dy[0], nloc, nnei, last_layer_size);
+  EXPECT_EQ(dy_dem_x.size(), expected_dy_dem_x.size());
+  EXPECT_EQ(dy_dem.size(), expected_dy_dem.size());
+  for (int jj = 0; jj < dy_dem_x.size(); ++jj) {
+    EXPECT_LT(fabs(dy_dem_x[jj] - expected_dy_dem_x[jj]), 1e-5);
+  }
+  for (int jj = 0; jj < dy_dem.size(); ++jj) {
+    EXPECT_LT(fabs(dy_dem[jj] - expected_dy_dem[jj]), 1e-5);
+  }
+}
+
+TEST_F(TestTabulateSeA, tabulate_fusion_se_a_grad_grad_simd_cpu) {
+  const int nspline = table.size() / (last_layer_size * 6);
+  std::vector<double> table_cm(table.size());
+  deepmd::tabulate_table_coef_major_cpu<double>(&table_cm[0], &table[0],
+                                                nspline, last_layer_size);
+  std::vector<double> dz_dy_dem_x(em_x.size()), dz_dy_dem(em.size());
+  for (int jj = 0; jj < dz_dy_dem_x.size(); ++jj) {
+    dz_dy_dem_x[jj] = 0.1 * jj - 0.3;
+  }
+  for (int jj = 0; jj < dz_dy_dem.size(); ++jj) {
+    dz_dy_dem[jj] = 0.05 * jj - 1.2;
+  }
+  std::vector<double> dz_dy(nloc * 4 * last_layer_size),
+      dz_dy_1(nloc * 4 * last_layer_size);
+  deepmd::tabulate_fusion_se_a_grad_grad_cpu<double>(
+      &dz_dy[0], &table[0], &info[0], &em_x[0], &em[0], &dz_dy_dem_x[0],
+      &dz_dy_dem[0], nloc, nnei, last_layer_size);
+  deepmd::tabulate_fusion_se_a_grad_grad_simd_cpu<double>(
+      &dz_dy_1[0], &table_cm[0], &info[0], &em_x[0], &em[0], &dz_dy_dem_x[0],
+      &dz_dy_dem[0], nloc, nnei, last_layer_size);
+  for (int jj = 0; jj < dz_dy.size(); ++jj) {
+    EXPECT_LT(fabs(dz_dy_1[jj] - dz_dy[jj]), 1e-10);
+  }
+}
+
+TEST_F(TestTabulateSeA, tabulate_fusion_se_a_bf16_cpu) {
+  const int nspline = table.size() / (last_layer_size * 6);
+  std::vector<double> table_cm(table.size());
+  deepmd::tabulate_table_coef_major_cpu<double>(&table_cm[0], &table[0],
+                                                nspline, last_layer_size);
+  std::vector<uint16_t> table_bf16(table.size());
+  deepmd::tabulate_table_bf16_cpu<double>(&table_bf16[0], &table_cm[0],
+                                          table_cm.size());
+  std::vector<double> xyz_scatter(nloc * nnei * last_layer_size);
+  deepmd::tabulate_fusion_se_a_simd_cpu<double>(
+      &xyz_scatter[0], &table_bf16[0], &info[0], &em_x[0], &em[0], nloc, nnei,
+      last_layer_size);
+  EXPECT_EQ(xyz_scatter.size(), expected_xyz_scatter.size());
+  for (int jj = 0; jj < xyz_scatter.size(); ++jj) {
+    EXPECT_LT(fabs(xyz_scatter[jj] - expected_xyz_scatter[jj]),
+              1e-2 * fabs(expected_xyz_scatter[jj]) + 1e-5);
+  }
+  std::vector<double> dy_dem_x(em_x.size()), dy_dem_x_1(em_x.size());
+  std::vector<double> dy_dem(em.size()), dy_dem_1(em.size());
+  std::vector<double> dy(nloc * nnei * last_layer_size, 1.0);
+  deepmd::tabulate_fusion_se_a_grad_simd_cpu<double>(
+      &dy_dem_x[0], &dy_dem[0], &table_cm[0], &info[0], &em_x[0], &em[0],
+      &dy[0], nloc, nnei, last_layer_size);
+  deepmd::tabulate_fusion_se_a_grad_simd_cpu<double>(
+      &dy_dem_x_1[0], &dy_dem_1[0], &table_bf16[0], &info[0], &em_x[0], &em[0],
+      &dy[0], nloc, nnei, last_layer_size);
+  for (int jj = 0; jj < dy_dem.size(); ++jj) {
+    EXPECT_LT(fabs(dy_dem_1[jj] - dy_dem[jj]), 1e-2 * fabs(dy_dem[jj]) + 1e-5);
+  }
+}
+
+TEST_F(TestTabulateSeA, tabulate_fusion_se_a_simd_cpu_widths) {
+  // the widths with specialized kernels and a generic one
+  const std::vector<int> widths = {32, 64, 100, 128, 240, 40};
+  const int nspline = 24;
+  for (int ww = 0; ww < widths.size(); ++ww) {
+    const int width = widths[ww];
+    std::vector<double> table_w(nspline * width * 6);
+    for (int jj = 0; jj < table_w.size(); ++jj) {
+      table_w[jj] = sin(0.37 * jj) / (1 + jj % 6);
+    }
+    std::vector<double> table_cm(table_w.size());
+    deepmd::tabulate_table_coef_major_cpu<double>(&table_cm[0], &table_w[0],
+                                                  nspline, width);
+    std::vector<double> xyz_scatter(nloc * 4 * width),
+        xyz_scatter_1(nloc * 4 * width);
+    deepmd::tabulate_fusion_se_a_cpu<double>(&xyz_scatter[0], &table_w[0],
+                                             &info[0], &em_x[0], &em[0], nloc,
+                                             nnei, width);
+    deepmd::tabulate_fusion_se_a_simd_cpu<double>(
+        &xyz_scatter_1[0], &table_cm[0], &info[0], &em_x[0], &em[0], nloc,
+        nnei, width);
+    for (int jj = 0; jj < xyz_scatter.size(); ++jj) {
+      EXPECT_LT(fabs(xyz_scatter_1[jj] - xyz_scatter[jj]), 1e-10);
+    }
+    std::vector<double> dy(nloc * 4 * width);
+    for (int jj = 0; jj < dy.size(); ++jj) {
+      dy[jj] = cos(0.11 * jj);
+    }
+    std::vector<double> dy_dem_x(em_x.size()), dy_dem_x_1(em_x.size());
+    std::vector<double> dy_dem(em.size()), dy_dem_1(em.size());
+    deepmd::tabulate_fusion_se_a_grad_cpu<double>(
+        &dy_dem_x[0], &dy_dem[0], &table_w[0], &info[0], &em_x[0], &em[0],
+        &dy[0], nloc, nnei, width);
+    deepmd::tabulate_fusion_se_a_grad_simd_cpu<double>(
+        &dy_dem_x_1[0], &dy_dem_1[0], &table_cm[0], &info[0], &em_x[0],
+        &em[0], &dy[0], nloc, nnei, width);
+    for (int jj = 0; jj < dy_dem_x.size(); ++jj) {
+      EXPECT_LT(fabs(dy_dem_x_1[jj] - dy_dem_x[jj]), 1e-10);
+    }
+    for (int jj = 0; jj < dy_dem.size(); ++jj) {
+      EXPECT_LT(fabs(dy_dem_1[jj] - dy_dem[jj]), 1e-10);
+    }
+    std::vector<double> dz_dy(nloc * 4 * width), dz_dy_1(nloc * 4 * width);
+    deepmd::tabulate_fusion_se_a_grad_grad_cpu<double>(
+        &dz_dy[0], &table_w[0], &info[0], &em_x[0], &em[0], &dy_dem_x[0],
+        &dy_dem[0], nloc, nnei, width);
+    deepmd::tabulate_fusion_se_a_grad_grad_simd_cpu<double>(
+        &dz_dy_1[0], &table_cm[0], &info[0], &em_x[0], &em[0], &dy_dem_x[0],
+        &dy_dem[0], nloc, nnei, width);
+    for (int jj = 0; jj < dz_dy.size(); ++jj) {
+      EXPECT_LT(fabs(dz_dy_1[jj] - dz_dy[jj]), 1e-10);
+    }
+  }
+}
+
 #if GOOGLE_CUDA
 TEST_F(TestTabulateSeA, tabulate_fusion_se_a_gpu_cuda) {
   std::vector<double> xyz_scatter(nloc * nnei * last_layer_size, 0.0);
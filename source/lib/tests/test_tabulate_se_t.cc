@@ -5259,6 +5259,83 @@ TEST_F(TestTabulateSeT, tabulate_fusion_se_t_grad_cpu) {
   }
 }
 
+TEST_F(TestTabulateSeT, tabulate_fusion_se_t_sym_cpu) {
+  std::vector<double> xyz_scatter(nloc * last_layer_size, 0);
+  deepmd::tabulate_fusion_se_t_sym_cpu<double>(
+      &xyz_scatter[0], &table[0], &info[0], &em_x[0], &em[0], nloc, nnei_i,
+      last_layer_size);
+  EXPECT_EQ(xyz_scatter.size(), expected_xyz_scatter.size());
+  for (int jj = 0; jj < xyz_scatter.size(); ++jj) {
+    EXPECT_LT(fabs(xyz_scatter[jj] - expected_xyz_scatter[jj]), 1e-5);
+  }
+}
+
+TEST_F(TestTabulateSeT, tabulate_fusion_se_t_grad_sym_cpu) {
+  std::vector<double> dy_dem_x(em_x.size());
+  std::vector<double> dy_dem(em.size());
+  deepmd::tabulate_fusion_se_t_grad_sym_cpu<double>(
+      &dy_dem_x[0], &dy_dem[0], &table[0], &info[0], &em_x[0], &em[0], &dy[0],
+      nloc, nnei_i, last_layer_size);
+  EXPECT_EQ(dy_dem_x.size(), expected_dy_dem_x.size());
+  EXPECT_EQ(dy_dem.size(), expected_dy_dem.size());
+  for (int jj = 0; jj < dy_dem_x.size(); ++jj) {
+    EXPECT_LT(fabs(dy_dem_x[jj] - expected_dy_dem_x[jj]), 1e-5);
+  }
+  for (int jj = 0; jj < dy_dem.size(); ++jj) {
+    EXPECT_LT(fabs(dy_dem[jj] - expected_dy_dem[jj]), 1e-5);
+  }
+}
+
+TEST_F(TestTabulateSeT, tabulate_fusion_se_t_sym_cpu_padding) {
+  // the last neighbor of every other atom is padding
+  std::vector<double> em_x_pad(em_x);
+  for (int ii = 0; ii < nloc; ii += 2) {
+    for (int jj = 0; jj < nnei_i; ++jj) {
+      em_x_pad[(ii * nnei_i + jj) * nnei_j + nnei_j - 1] = 0.;
+      em_x_pad[(ii * nnei_i + nnei_i - 1) * nnei_j + jj] = 0.;
+    }
+  }
+  std::vector<double> dz_dy_dem_x(em_x.size()), dz_dy_dem(em.size());
+  for (int jj = 0; jj < dz_dy_dem_x.size(); ++jj) {
+    dz_dy_dem_x[jj] = 0.1 * (jj % 17) - 0.3;
+    dz_dy_dem[jj] = 0.05 * (jj % 13) - 1.2;
+  }
+  std::vector<double> xyz_scatter(nloc * last_layer_size),
+      xyz_scatter_1(nloc * last_layer_size);
+  deepmd::tabulate_fusion_se_t_cpu<double>(&xyz_scatter[0], &table[0], &info[0],
+                                           &em_x_pad[0], &em_x_pad[0], nloc,
+                                           nnei_i, nnei_j, last_layer_size);
+  deepmd::tabulate_fusion_se_t_sym_cpu<double>(
+      &xyz_scatter_1[0], &table[0], &info[0], &em_x_pad[0], &em_x_pad[0],
+      nloc, nnei_i, last_layer_size);
+  for (int jj = 0; jj < xyz_scatter.size(); ++jj) {
+    EXPECT_LT(fabs(xyz_scatter_1[jj] - xyz_scatter[jj]), 1e-10);
+  }
+  std::vector<double> dy_dem_x(em_x.size()), dy_dem_x_1(em_x.size());
+  std::vector<double> dy_dem(em.size()), dy_dem_1(em.size());
+  deepmd::tabulate_fusion_se_t_grad_cpu<double>(
+      &dy_dem_x[0], &dy_dem[0], &table[0], &info[0], &em_x_pad[0],
+      &em_x_pad[0], &dy[0], nloc, nnei_i, nnei_j, last_layer_size);
+  deepmd::tabulate_fusion_se_t_grad_sym_cpu<double>(
+      &dy_dem_x_1[0], &dy_dem_1[0], &table[0], &info[0], &em_x_pad[0],
+      &em_x_pad[0], &dy[0], nloc, nnei_i, last_layer_size);
+  for (int jj = 0; jj < dy_dem_x.size(); ++jj) {
+    EXPECT_LT(fabs(dy_dem_x_1[jj] - dy_dem_x[jj]), 1e-10);
+    EXPECT_LT(fabs(dy_dem_1[jj] - dy_dem[jj]), 1e-10);
+  }
+  std::vector<double> dz_dy(nloc * last_layer_size),
+      dz_dy_1(nloc * last_layer_size);
+  deepmd::tabulate_fusion_se_t_grad_grad_cpu<double>(
+      &dz_dy[0], &table[0], &info[0], &em_x_pad[0], &em_x_pad[0],
+      &dz_dy_dem_x[0], &dz_dy_dem[0], nloc, nnei_i, nnei_j, last_layer_size);
+  deepmd::tabulate_fusion_se_t_grad_grad_sym_cpu<double>(
+      &dz_dy_1[0], &table[0], &info[0], &em_x_pad[0], &em_x_pad[0],
+      &dz_dy_dem_x[0], &dz_dy_dem[0], nloc, nnei_i, last_layer_size);
+  for (int jj = 0; jj < dz_dy.size(); ++jj) {
+    EXPECT_LT(fabs(dz_dy_1[jj] - dz_dy[jj]), 1e-10);
+  }
+}
+
 #if GOOGLE_CUDA
 TEST_F(TestTabulateSeT, tabulate_fusion_se_t_gpu_cuda) {
   std::vector<double> xyz_scatter(nloc * last_layer_size, 0.0);
@@ -30,10 +30,32 @@ def _tabulate_fusion_se_a_grad_grad_cc(op, dy, dy_):
     return [None, None, None, None, dz_dy, None]
 
 
+@ops.RegisterGradient("TabulateFusionSeABf16")
+def _tabulate_fusion_se_a_bf16_grad_cc(op, dy):
+    dy_dx, dy_df = op_module.tabulate_fusion_se_a_bf16_grad(
+        op.inputs[0], op.inputs[1], op.inputs[2], op.inputs[3], dy, op.outputs[0]
+    )
+    return [None, None, dy_dx, dy_df]
+
+
+@ops.RegisterGradient("TabulateFusionSeABf16Grad")
+def _tabulate_fusion_se_a_bf16_grad_grad_cc(op, dy, dy_):
+    dz_dy = op_module.tabulate_fusion_se_a_bf16_grad_grad(
+        op.inputs[0], op.inputs[1], op.inputs[2], op.inputs[3], dy, dy_, op.inputs[5]
+    )
+    return [None, None, None, None, dz_dy, None]
+
+
 @ops.RegisterGradient("TabulateFusionSeT")
 def _tabulate_fusion_se_t_grad_cc(op, dy):
     dy_dx, dy_df = op_module.tabulate_fusion_se_t_grad(
-        op.inputs[0], op.inputs[1], op.inputs[2], op.inputs[3], dy, op.outputs[0]
+        op.inputs[0],
+        op.inputs[1],
+        op.inputs[2],
+        op.inputs[3],
+        dy,
+        op.outputs[0],
+        symmetric=op.get_attr("symmetric"),
     )
     return [None, None, dy_dx, dy_df]
 
@@ -41,7 +63,14 @@ def _tabulate_fusion_se_t_grad_cc(op, dy):
 @ops.RegisterGradient("TabulateFusionSeTGrad")
 def _tabulate_fusion_se_t_grad_grad_cc(op, dy, dy_):
     dz_dy = op_module.tabulate_fusion_se_t_grad_grad(
-        op.inputs[0], op.inputs[1], op.inputs[2], op.inputs[3], dy, dy_, op.inputs[5]
+        op.inputs[0],
+        op.inputs[1],
+        op.inputs[2],
+        op.inputs[3],
+        dy,
+        dy_,
+        op.inputs[5],
+        symmetric=op.get_attr("symmetric"),
     )
     return [None, None, None, None, dz_dy, None]
 
@@ -0,0 +1,251 @@
+// only support v1.15 or v2
+#include "tensorflow/core/public/version.h"
+// skip windows
+#ifndef _WIN32
+#if TF_MAJOR_VERSION >= 2 || (TF_MAJOR_VERSION == 1 && TF_MINOR_VERSION >= 15)
+
+#include "fuse.h"
+#include "tensorflow/core/framework/attr_value_util.h"
+#include "tensorflow/core/framework/node_def_util.h"
+#include "tensorflow/core/grappler/devices.h"
+#include "tensorflow/core/grappler/graph_view.h"
+#include "tensorflow/core/grappler/grappler_item.h"
+#include "tensorflow/core/grappler/optimizers/custom_graph_optimizer_registry.h"
+#include "tensorflow/core/grappler/utils.h"
+#include "tensorflow/core/grappler/utils/graph_view.h"
+#include "tensorflow/core/protobuf/rewriter_config.pb.h"
+
+// based on tensorflow/core/grappler/optimizers/remapper.cc
+
+namespace {
+
+// the fused pairs keep their node names, see FuseProdForceVirial, so the
+// nodes to preserve of the item are kept
+struct FuseContext {
+  explicit FuseContext(GrapplerItem *item, Status *status)
+      : nodes_to_preserve(item->NodesToPreserve()),
+        graph_view(&item->graph, status) {}
+
+  std::unordered_set<std::string> nodes_to_preserve;
+  utils::MutableGraphView graph_view;
+  // the nodes in the fanin of the nodes to preserve, empty if the item has
+  // no fetch
+  std::vector<bool> fetched_fanin;
+};
+
+// The optimizer runs once per fetch signature of a session, so an output that
+// is not consumed by the fanin of the fetched nodes is never used by the
+// signature, e.g. the derivative of the environment matrix when only the
+// energy is fetched.
+void FindFetchedFanin(FuseContext *ctx, const GrapplerItem &item) {
+  ctx->fetched_fanin.clear();
+  if (item.fetch.empty()) return;
+  std::vector<int> stack;
+  for (const std::string &name : ctx->nodes_to_preserve) {
+    const auto *node_view = ctx->graph_view.GetNode(name);
+    if (node_view != nullptr) stack.push_back(node_view->node_index());
+  }
+  std::vector<bool> fanin(ctx->graph_view.NumNodes());
+  while (!stack.empty()) {
+    const int node_index = stack.back();
+    stack.pop_back();
+    if (fanin[node_index]) continue;
+    fanin[node_index] = true;
+    const auto *node_view = ctx->graph_view.GetNode(node_index);
+    for (const auto &fanin_view : node_view->GetRegularFanins()) {
+      stack.push_back(fanin_view.node_index());
+    }
+    for (const auto &fanin_view : node_view->GetControllingFanins()) {
+      stack.push_back(fanin_view.node_index());
+    }
+  }
+  ctx->fetched_fanin.swap(fanin);
+}
+
+bool IsOutputConsumed(FuseContext *ctx, int node_index, int port) {
+  if (ctx->fetched_fanin.empty()) return true;
+  const auto *node_view = ctx->graph_view.GetNode(node_index);
+  if (ctx->nodes_to_preserve.count(node_view->GetName()) > 0) return true;
+  for (const auto &fanout_view : node_view->GetRegularFanout(port)) {
+    if (ctx->fetched_fanin[fanout_view.node_index()]) return true;
+  }
+  return false;
+}
+
+// the op computes the output only if the attr is true
+struct SkippableOutput {
+  const char *op;
+  int port;
+  const char *attr;
+};
+
+const SkippableOutput kSkippableOutputs[] = {
+    {"ProdEnvMatA", 1, "compute_em_deriv"},
+    {"ProdEnvMatR", 1, "compute_em_deriv"},
+    {"ProdEnvMatAMix", 1, "compute_em_deriv"},
+    {"ProdVirialSeA", 1, "compute_atom_virial"},
+    {"ProdVirialSeR", 1, "compute_atom_virial"},
+};
+
+Status SkipUnconsumedOutputs(FuseContext *ctx) {
+  utils::Mutation *mutation = ctx->graph_view.GetMutationBuilder();
+  AttrValue attr_false;
+  attr_false.set_b(false);
+  const int num_nodes = ctx->graph_view.NumNodes();
+  for (int i = 0; i < num_nodes; ++i) {
+    auto *node_view = ctx->graph_view.GetNode(i);
+    for (const SkippableOutput &output : kSkippableOutputs) {
+      if (node_view->GetOp() == output.op &&
+          !IsOutputConsumed(ctx, i, output.port)) {
+        mutation->AddOrUpdateNodeAttr(node_view, output.attr, attr_false);
+      }
+    }
+  }
+  return mutation->Apply();
+}
+
+bool IsProdForce(const NodeDef &node) { return node.op() == "ProdForceSeA"; }
+
+bool IsProdVirial(const NodeDef &node) { return node.op() == "ProdVirialSeA"; }
+
+// The attr is missing if the default attrs are stripped from the graph, then
+// the nodes are not fused.
+bool HasSameAttr(const NodeDef &force,
+                 const NodeDef &virial,
+                 const std::string &name) {
+  auto force_it = force.attr().find(name);
+  auto virial_it = virial.attr().find(name);
+  return force_it != force.attr().end() && virial_it != virial.attr().end() &&
+         AreAttrValuesEqual(force_it->second, virial_it->second);
+}
+
+// ProdForceSeA(net_deriv, in_deriv, nlist, natoms) and
+// ProdVirialSeA(net_deriv, in_deriv, rij, nlist, natoms) can be fused if
+// they share the inputs and the attributes. Nodes with control inputs are
+// not touched.
+bool IsFusable(const NodeDef &force, const NodeDef &virial) {
+  if (force.input_size() != 4 || virial.input_size() != 5) return false;
+  if (force.device() != virial.device()) return false;
+  if (force.input(0) != virial.input(0) || force.input(1) != virial.input(1) ||
+      force.input(2) != virial.input(3) || force.input(3) != virial.input(4)) {
+    return false;
+  }
+  return HasSameAttr(force, virial, "T") &&
+         HasSameAttr(force, virial, "n_a_sel") &&
+         HasSameAttr(force, virial, "n_r_sel");
+}
+
+Status FuseProdForceVirial(FuseContext *ctx,
+                           int force_index,
+                           int virial_index,
+                           std::vector<bool> *invalidated_nodes) {
+  const NodeDef *force_node = ctx->graph_view.GetNode(force_index)->node();
+  const NodeDef *virial_node = ctx->graph_view.GetNode(virial_index)->node();
+  DataType dtype;
+  int n_a_sel, n_r_sel;
+  TF_RETURN_IF_ERROR(GetNodeAttr(*virial_node, "T", &dtype));
+  TF_RETURN_IF_ERROR(GetNodeAttr(*virial_node, "n_a_sel", &n_a_sel));
+  TF_RETURN_IF_ERROR(GetNodeAttr(*virial_node, "n_r_sel", &n_r_sel));
+
+  NodeDef fused_node;
+  fused_node.set_name(virial_node->name() + "/fused_force");
+  fused_node.set_op("ProdForceVirialSeA");
+  fused_node.set_device(virial_node->device());
+  for (int jj = 0; jj < 5; ++jj) fused_node.add_input(virial_node->input(jj));
+  auto *fused_attr = fused_node.mutable_attr();
+  (*fused_attr)["T"].set_type(dtype);
+  (*fused_attr)["n_a_sel"].set_i(n_a_sel);
+  (*fused_attr)["n_r_sel"].set_i(n_r_sel);
+  // the atom virial is skipped if the original one is not consumed
+  (*fused_attr)["compute_atom_virial"].set_b(
+      IsOutputConsumed(ctx, virial_index, 1));
+
+  // the original nodes are replaced by identities of the fused outputs, so
+  // their consumers and the fetched tensors are kept unchanged
+  NodeDef new_force_node;
+  new_force_node.set_name(force_node->name());
+  new_force_node.set_op("Identity");
+  new_force_node.set_device(force_node->device());
+  new_force_node.add_input(fused_node.name() + ":0");
+  (*new_force_node.mutable_attr())["T"].set_type(dtype);
+
+  NodeDef new_virial_node;
+  new_virial_node.set_name(virial_node->name());
+  new_virial_node.set_op("IdentityN");
+  new_virial_node.set_device(virial_node->device());
+  new_virial_node.add_input(fused_node.name() + ":1");
+  new_virial_node.add_input(fused_node.name() + ":2");
+  auto *type_list = (*new_virial_node.mutable_attr())["T"].mutable_list();
+  type_list->add_type(dtype);
+  type_list->add_type(dtype);
+
+  utils::Mutation *mutation = ctx->graph_view.GetMutationBuilder();
+  Status status;
+  mutation->AddNode(std::move(fused_node), &status);
+  TF_RETURN_IF_ERROR(status);
+  mutation->AddNode(std::move(new_force_node), &status);
+  TF_RETURN_IF_ERROR(status);
+  mutation->AddNode(std::move(new_virial_node), &status);
+  TF_RETURN_IF_ERROR(status);
+  TF_RETURN_IF_ERROR(mutation->Apply());
+  (*invalidated_nodes)[force_index] = true;
+  (*invalidated_nodes)[virial_index] = true;
+
+  return Status();
+}
+
+}  // namespace
+
+Status DPFuse::Optimize(Cluster *cluster,
+                        const GrapplerItem &item,
+                        GraphDef *optimized_graph) {
+  GrapplerItem mutable_item = item;
+  Status status;
+  FuseContext ctx(&mutable_item, &status);
+  TF_RETURN_IF_ERROR(status);
+  TF_RETURN_IF_ERROR(
+      ctx.graph_view.SortTopologically(/*ignore_cycles=*/false, {}));
+
+  const int num_nodes = item.graph.node_size();
+  std::vector<bool> invalidated_nodes(num_nodes);
+
+  // the fused op is only registered on CPUs
+  if (GetNumAvailableGPUs() > 0 || item.optimization_options().is_eager_mode) {
+    *optimized_graph = std::move(mutable_item.graph);
+    return Status();
+  }
+
+  FindFetchedFanin(&ctx, item);
+  TF_RETURN_IF_ERROR(SkipUnconsumedOutputs(&ctx));
+
+  std::vector<int> force_indices, virial_indices;
+  for (int i = 0; i < num_nodes; ++i) {
+    const NodeDef *node_def = ctx.graph_view.GetNode(i)->node();
+    if (IsProdForce(*node_def)) {
+      force_indices.push_back(i);
+    } else if (IsProdVirial(*node_def)) {
+      virial_indices.push_back(i);
+    }
+  }
+  for (int virial_index : virial_indices) {
+    for (int force_index : force_indices) {
+      if (invalidated_nodes[force_index]) continue;
+      // the indices are stable as the mutations append or replace nodes
+      if (IsFusable(*ctx.graph_view.GetNode(force_index)->node(),
+                    *ctx.graph_view.GetNode(virial_index)->node())) {
+        TF_RETURN_IF_ERROR(FuseProdForceVirial(&ctx, force_index, virial_index,
+                                               &invalidated_nodes));
+        break;
+      }
+    }
+  }
+
+  *optimized_graph = std::move(mutable_item.graph);
+
+  return Status();
+}
+
+REGISTER_GRAPH_OPTIMIZER_AS(DPFuse, "dpfuse");
+
+#endif
+#endif
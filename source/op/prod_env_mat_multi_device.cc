@@ -1,3 +1,5 @@
+#include <mutex>
+
 #include "coord.h"
 #include "custom_op.h"
 #include "errors.h"
@@ -20,6 +22,7 @@ REGISTER_OP("ProdEnvMatA")
     .Attr("rcut_r_smth: float")
     .Attr("sel_a: list(int)")
     .Attr("sel_r: list(int)")  // all zero
+    .Attr("compute_em_deriv: bool = true")
     .Output("descrpt: T")
     .Output("descrpt_deriv: T")
     .Output("rij: T")
@@ -64,6 +67,9 @@ rcut_r: The cutoff radius for the environment matrix.
 rcut_r_smth: From where the environment matrix should be smoothed.
 sel_a: sel_a[i] specifies the maxmum number of type i atoms in the cut-off radius.
 sel_r: This argument is not used.
+compute_em_deriv: If false, descrpt_deriv is not computed on CPUs and its
+  values are undefined. It is set by the dpfuse optimizer if descrpt_deriv is
+  not consumed, e.g. only the energy is evaluated.
 descrpt: The environment matrix.
 descrpt_deriv: The derivative of the environment matrix.
 rij: The distance between the atoms.
@@ -124,6 +130,7 @@ REGISTER_OP("ProdEnvMatR")
     .Attr("rcut: float")
     .Attr("rcut_smth: float")
     .Attr("sel: list(int)")
+    .Attr("compute_em_deriv: bool = true")
     .Output("descrpt: T")
     .Output("descrpt_deriv: T")
     .Output("rij: T")
@@ -161,6 +168,7 @@ REGISTER_OP("ProdEnvMatAMix")
     .Attr("rcut_r_smth: float")
     .Attr("sel_a: list(int)")
     .Attr("sel_r: list(int)")  // all zero
+    .Attr("compute_em_deriv: bool = true")
     .Output("descrpt: T")
     .Output("descrpt_deriv: T")
     .Output("rij: T")
@@ -417,6 +425,9 @@ class ProdEnvMatAOp : public OpKernel {
     mem_cpy = 256;
     max_nnei_trial = 100;
     mem_nnei = 256;
+    if (context->HasAttr("compute_em_deriv"))
+      OP_REQUIRES_OK(context,
+                     context->GetAttr("compute_em_deriv", &compute_em_deriv));
   }
 
   void Compute(OpKernelContext* context) override {
@@ -663,10 +674,24 @@ class ProdEnvMatAOp : public OpKernel {
             ilist, numneigh, firstneigh, jlist, frame_nall, mem_cpy, mem_nnei,
             max_nbor_size, box, mesh_tensor.flat<int>().data(), nloc, nei_mode,
             rcut_r, max_cpy_trial, max_nnei_trial);
+        // keep the neighbor order while the external nlist is not rebuilt
+        deepmd::NeighborOrder* order = NULL;
+        bool reuse_order = false;
+        std::unique_lock<std::mutex> order_lock(nbor_order_mutex,
+                                                std::defer_lock);
+        if (nei_mode == 3 && nsamples == 1) {
+          order_lock.lock();
+          order = &nbor_order;
+          reuse_order = mesh_tensor.flat<int>().data()[0] > 0;
+        }
+        // the derivative is skipped if it is not consumed, see
+        // optimizer/fuse.cc
+        if (!compute_em_deriv) em_deriv = NULL;
         // launch the cpu compute function
         deepmd::prod_env_mat_a_cpu(em, em_deriv, rij, nlist, coord, type,
                                    inlist, max_nbor_size, avg, std, nloc,
-                                   frame_nall, rcut_r, rcut_r_smth, sec_a);
+                                   frame_nall, rcut_r, rcut_r_smth, sec_a,
+                                   NULL, order, reuse_order);
         // do nlist mapping if coords were copied
         if (b_nlist_map) _map_nlist_cpu(nlist, &idx_mapping[0], nloc, nnei);
       }
@@ -691,6 +716,9 @@ class ProdEnvMatAOp : public OpKernel {
   unsigned long long* array_longlong = NULL;
   deepmd::InputNlist gpu_inlist;
   int* nbor_list_dev = NULL;
+  deepmd::NeighborOrder nbor_order;
+  std::mutex nbor_order_mutex;
+  bool compute_em_deriv = true;
 };
 
 template <typename Device, typename FPTYPE>
@@ -710,6 +738,9 @@ class ProdEnvMatROp : public OpKernel {
     mem_cpy = 256;
     max_nnei_trial = 100;
     mem_nnei = 256;
+    if (context->HasAttr("compute_em_deriv"))
+      OP_REQUIRES_OK(context,
+                     context->GetAttr("compute_em_deriv", &compute_em_deriv));
   }
 
   void Compute(OpKernelContext* context) override {
@@ -945,10 +976,24 @@ class ProdEnvMatROp : public OpKernel {
             ilist, numneigh, firstneigh, jlist, frame_nall, mem_cpy, mem_nnei,
             max_nbor_size, box, mesh_tensor.flat<int>().data(), nloc, nei_mode,
             rcut, max_cpy_trial, max_nnei_trial);
+        // keep the neighbor order while the external nlist is not rebuilt
+        deepmd::NeighborOrder* order = NULL;
+        bool reuse_order = false;
+        std::unique_lock<std::mutex> order_lock(nbor_order_mutex,
+                                                std::defer_lock);
+        if (nei_mode == 3 && nsamples == 1) {
+          order_lock.lock();
+          order = &nbor_order;
+          reuse_order = mesh_tensor.flat<int>().data()[0] > 0;
+        }
+        // the derivative is skipped if it is not consumed, see
+        // optimizer/fuse.cc
+        if (!compute_em_deriv) em_deriv = NULL;
         // launch the cpu compute function
         deepmd::prod_env_mat_r_cpu(em, em_deriv, rij, nlist, coord, type,
                                    inlist, max_nbor_size, avg, std, nloc,
-                                   frame_nall, rcut, rcut_smth, sec);
+                                   frame_nall, rcut, rcut_smth, sec, order,
+                                   reuse_order);
         if (b_nlist_map) _map_nlist_cpu(nlist, &idx_mapping[0], nloc, nnei);
       }
     }
@@ -971,6 +1016,9 @@ class ProdEnvMatROp : public OpKernel {
   unsigned long long* array_longlong = NULL;
   deepmd::InputNlist gpu_inlist;
   int* nbor_list_dev = NULL;
+  deepmd::NeighborOrder nbor_order;
+  std::mutex nbor_order_mutex;
+  bool compute_em_deriv = true;
 };
 
 template <typename Device, typename FPTYPE>
@@ -998,6 +1046,9 @@ class ProdEnvMatAMixOp : public OpKernel {
     mem_cpy = 256;
     max_nnei_trial = 100;
     mem_nnei = 256;
+    if (context->HasAttr("compute_em_deriv"))
+      OP_REQUIRES_OK(context,
+                     context->GetAttr("compute_em_deriv", &compute_em_deriv));
   }
 
   void Compute(OpKernelContext* context) override {
@@ -1284,10 +1335,24 @@ class ProdEnvMatAMixOp : public OpKernel {
             ilist, numneigh, firstneigh, jlist, frame_nall, mem_cpy, mem_nnei,
             max_nbor_size, box, mesh_tensor.flat<int>().data(), nloc, nei_mode,
             rcut_r, max_cpy_trial, max_nnei_trial);
+        // keep the neighbor order while the external nlist is not rebuilt
+        deepmd::NeighborOrder* order = NULL;
+        bool reuse_order = false;
+        std::unique_lock<std::mutex> order_lock(nbor_order_mutex,
+                                                std::defer_lock);
+        if (nei_mode == 3 && nsamples == 1) {
+          order_lock.lock();
+          order = &nbor_order;
+          reuse_order = mesh_tensor.flat<int>().data()[0] > 0;
+        }
+        // the derivative is skipped if it is not consumed, see
+        // optimizer/fuse.cc
+        if (!compute_em_deriv) em_deriv = NULL;
         // launch the cpu compute function
-        deepmd::prod_env_mat_a_cpu(
-            em, em_deriv, rij, nlist, coord, type, inlist, max_nbor_size, avg,
-            std, nloc, frame_nall, rcut_r, rcut_r_smth, sec_a, f_type);
+        deepmd::prod_env_mat_a_cpu(em, em_deriv, rij, nlist, coord, type,
+                                   inlist, max_nbor_size, avg, std, nloc,
+                                   frame_nall, rcut_r, rcut_r_smth, sec_a,
+                                   f_type, order, reuse_order);
         // do nlist mapping if coords were copied
         _map_nei_info_cpu(nlist, ntype, nmask, type, &idx_mapping[0], nloc,
                           nnei, ntypes, b_nlist_map);
@@ -1313,6 +1378,9 @@ class ProdEnvMatAMixOp : public OpKernel {
   unsigned long long* array_longlong = NULL;
   deepmd::InputNlist gpu_inlist;
   int* nbor_list_dev = NULL;
+  deepmd::NeighborOrder nbor_order;
+  std::mutex nbor_order_mutex;
+  bool compute_em_deriv = true;
 };
 
 template <typename FPTYPE>
@@ -86,7 +86,8 @@ class ProdForceSeAGradOp : public OpKernel {
     OP_REQUIRES(context,
                 (int_64(nloc) * ndescrpt * 3 == in_deriv_shape.dim_size(1)),
                 errors::InvalidArgument("number of descriptors should match"));
-    OP_REQUIRES(context, (nnei == n_a_sel + n_r_sel),
+    // the layout may be trimmed by TrimEnvMatA
+    OP_REQUIRES(context, (nnei <= n_a_sel + n_r_sel),
                 errors::InvalidArgument("number of neighbors should match"));
 
     // Create an output tensor
@@ -119,12 +120,12 @@ class ProdForceSeAGradOp : public OpKernel {
     const FPTYPE* p_in_deriv = in_deriv_tensor.flat<FPTYPE>().data();
     const int* p_nlist = nlist_tensor.flat<int>().data();
 
-    for (int_64 kk = 0; kk < nframes; ++kk) {
-      FPTYPE* grad_net = p_grad_net + kk * nloc * ndescrpt;
-      const FPTYPE* grad = p_grad + kk * nloc * 3;
-      const FPTYPE* in_deriv = p_in_deriv + kk * nloc * ndescrpt * 3;
-      const int* nlist = p_nlist + kk * nloc * nnei;
-      if (device == "GPU") {
+    if (device == "GPU") {
+      for (int_64 kk = 0; kk < nframes; ++kk) {
+        FPTYPE* grad_net = p_grad_net + kk * nloc * ndescrpt;
+        const FPTYPE* grad = p_grad + kk * nloc * 3;
+        const FPTYPE* in_deriv = p_in_deriv + kk * nloc * ndescrpt * 3;
+        const int* nlist = p_nlist + kk * nloc * nnei;
 #if GOOGLE_CUDA
         deepmd::prod_force_grad_a_gpu_cuda(grad_net, grad, in_deriv, nlist,
                                            nloc, nnei);
@@ -134,10 +135,11 @@ class ProdForceSeAGradOp : public OpKernel {
         deepmd::prod_force_grad_a_gpu_rocm(grad_net, grad, in_deriv, nlist,
                                            nloc, nnei);
 #endif  // TENSORFLOW_USE_ROCM
-      } else if (device == "CPU") {
-        deepmd::prod_force_grad_a_cpu(grad_net, grad, in_deriv, nlist, nloc,
-                                      nnei);
       }
+    } else if (device == "CPU") {
+      // all the frames at once, in parallel over the frames and atoms
+      deepmd::prod_force_grad_a_cpu(p_grad_net, p_grad, p_in_deriv, p_nlist,
+                                    nloc, nnei, nframes);
     }
   }
 
@@ -238,13 +240,12 @@ class ProdForceSeRGradOp : public OpKernel {
     const FPTYPE* p_in_deriv = in_deriv_tensor.flat<FPTYPE>().data();
     const int* p_nlist = nlist_tensor.flat<int>().data();
 
-    // loop over frames
-    for (int_64 kk = 0; kk < nframes; ++kk) {
-      FPTYPE* grad_net = p_grad_net + kk * nloc * ndescrpt;
-      const FPTYPE* grad = p_grad + kk * nloc * 3;
-      const FPTYPE* in_deriv = p_in_deriv + kk * nloc * ndescrpt * 3;
-      const int* nlist = p_nlist + kk * nloc * nnei;
-      if (device == "GPU") {
+    if (device == "GPU") {
+      for (int_64 kk = 0; kk < nframes; ++kk) {
+        FPTYPE* grad_net = p_grad_net + kk * nloc * ndescrpt;
+        const FPTYPE* grad = p_grad + kk * nloc * 3;
+        const FPTYPE* in_deriv = p_in_deriv + kk * nloc * ndescrpt * 3;
+        const int* nlist = p_nlist + kk * nloc * nnei;
 #if GOOGLE_CUDA
         deepmd::prod_force_grad_r_gpu_cuda(grad_net, grad, in_deriv, nlist,
                                            nloc, nnei);
@@ -254,10 +255,11 @@ class ProdForceSeRGradOp : public OpKernel {
         deepmd::prod_force_grad_r_gpu_rocm(grad_net, grad, in_deriv, nlist,
                                            nloc, nnei);
 #endif  // TENSORFLOW_USE_ROCM
-      } else if (device == "CPU") {
-        deepmd::prod_force_grad_r_cpu(grad_net, grad, in_deriv, nlist, nloc,
-                                      nnei);
       }
+    } else if (device == "CPU") {
+      // all the frames at once, in parallel over the frames and atoms
+      deepmd::prod_force_grad_r_cpu(p_grad_net, p_grad, p_in_deriv, p_nlist,
+                                    nloc, nnei, nframes);
     }
   }
 
@@ -96,7 +96,8 @@ class ProdVirialSeAGradOp : public OpKernel {
                 errors::InvalidArgument("number of descriptors should match"));
     OP_REQUIRES(context, (int_64(nloc) * nnei * 3 == rij_shape.dim_size(1)),
                 errors::InvalidArgument("dim of rij should be  nnei * 3"));
-    OP_REQUIRES(context, (nnei == n_a_sel + n_r_sel),
+    // the layout may be trimmed by TrimEnvMatA
+    OP_REQUIRES(context, (nnei <= n_a_sel + n_r_sel),
                 errors::InvalidArgument("number of neighbors should match"));
 
     // Create an output tensor
@@ -133,14 +134,13 @@ class ProdVirialSeAGradOp : public OpKernel {
     const FPTYPE* p_rij = rij_tensor.flat<FPTYPE>().data();
     const int* p_nlist = nlist_tensor.flat<int>().data();
 
-    // loop over frames
-    for (int_64 kk = 0; kk < nframes; ++kk) {
-      FPTYPE* grad_net = p_grad_net + kk * nloc * ndescrpt;
-      const FPTYPE* grad = p_grad + kk * 9;
-      const FPTYPE* in_deriv = p_in_deriv + kk * nloc * ndescrpt * 3;
-      const FPTYPE* rij = p_rij + kk * nloc * nnei * 3;
-      const int* nlist = p_nlist + kk * nloc * nnei;
-      if (device == "GPU") {
+    if (device == "GPU") {
+      for (int_64 kk = 0; kk < nframes; ++kk) {
+        FPTYPE* grad_net = p_grad_net + kk * nloc * ndescrpt;
+        const FPTYPE* grad = p_grad + kk * 9;
+        const FPTYPE* in_deriv = p_in_deriv + kk * nloc * ndescrpt * 3;
+        const FPTYPE* rij = p_rij + kk * nloc * nnei * 3;
+        const int* nlist = p_nlist + kk * nloc * nnei;
 #if GOOGLE_CUDA
         deepmd::prod_virial_grad_a_gpu_cuda(grad_net, grad, in_deriv, rij,
                                             nlist, nloc, nnei);
@@ -150,10 +150,11 @@ class ProdVirialSeAGradOp : public OpKernel {
         deepmd::prod_virial_grad_a_gpu_rocm(grad_net, grad, in_deriv, rij,
                                             nlist, nloc, nnei);
 #endif  // TENSORFLOW_USE_ROCM
-      } else if (device == "CPU") {
-        deepmd::prod_virial_grad_a_cpu(grad_net, grad, in_deriv, rij, nlist,
-                                       nloc, nnei);
       }
+    } else if (device == "CPU") {
+      // all the frames at once, in parallel over the frames and atoms
+      deepmd::prod_virial_grad_a_cpu(p_grad_net, p_grad, p_in_deriv, p_rij,
+                                     p_nlist, nloc, nnei, nframes);
     }
   }
 
@@ -266,14 +267,13 @@ class ProdVirialSeRGradOp : public OpKernel {
     const FPTYPE* p_rij = rij_tensor.flat<FPTYPE>().data();
     const int* p_nlist = nlist_tensor.flat<int>().data();
 
-    // loop over frames
-    for (int_64 kk = 0; kk < nframes; ++kk) {
-      FPTYPE* grad_net = p_grad_net + kk * nloc * ndescrpt;
-      const FPTYPE* grad = p_grad + kk * 9;
-      const FPTYPE* in_deriv = p_in_deriv + kk * nloc * ndescrpt * 3;
-      const FPTYPE* rij = p_rij + kk * nloc * nnei * 3;
-      const int* nlist = p_nlist + kk * nloc * nnei;
-      if (device == "GPU") {
+    if (device == "GPU") {
+      for (int_64 kk = 0; kk < nframes; ++kk) {
+        FPTYPE* grad_net = p_grad_net + kk * nloc * ndescrpt;
+        const FPTYPE* grad = p_grad + kk * 9;
+        const FPTYPE* in_deriv = p_in_deriv + kk * nloc * ndescrpt * 3;
+        const FPTYPE* rij = p_rij + kk * nloc * nnei * 3;
+        const int* nlist = p_nlist + kk * nloc * nnei;
 #if GOOGLE_CUDA
         deepmd::prod_virial_grad_r_gpu_cuda(grad_net, grad, in_deriv, rij,
                                             nlist, nloc, nnei);
@@ -283,10 +283,11 @@ class ProdVirialSeRGradOp : public OpKernel {
         deepmd::prod_virial_grad_r_gpu_rocm(grad_net, grad, in_deriv, rij,
                                             nlist, nloc, nnei);
 #endif  // TENSORFLOW_USE_ROCM
-      } else if (device == "CPU") {
-        deepmd::prod_virial_grad_r_cpu(grad_net, grad, in_deriv, rij, nlist,
-                                       nloc, nnei);
       }
+    } else if (device == "CPU") {
+      // all the frames at once, in parallel over the frames and atoms
+      deepmd::prod_virial_grad_r_cpu(p_grad_net, p_grad, p_in_deriv, p_rij,
+                                     p_nlist, nloc, nnei, nframes);
     }
   }
 
@@ -10,6 +10,7 @@ REGISTER_OP("ProdVirialSeA")
     .Input("natoms: int32")
     .Attr("n_a_sel: int")
     .Attr("n_r_sel: int")
+    .Attr("compute_atom_virial: bool = true")
     .Output("virial: T")
     .Output("atom_virial: T");
 // compatible with v0.12
@@ -32,13 +33,18 @@ REGISTER_OP("ProdVirialSeR")
     .Input("rij: T")
     .Input("nlist: int32")
     .Input("natoms: int32")
+    .Attr("compute_atom_virial: bool = true")
     .Output("virial: T")
     .Output("atom_virial: T");
 
 template <typename Device, typename FPTYPE>
 class ProdVirialSeAOp : public OpKernel {
  public:
-  explicit ProdVirialSeAOp(OpKernelConstruction* context) : OpKernel(context) {}
+  explicit ProdVirialSeAOp(OpKernelConstruction* context) : OpKernel(context) {
+    if (context->HasAttr("compute_atom_virial"))
+      OP_REQUIRES_OK(context, context->GetAttr("compute_atom_virial",
+                                               &compute_atom_virial));
+  }
   void Compute(OpKernelContext* context) override {
     deepmd::safe_compute(
         context, [this](OpKernelContext* context) { this->_Compute(context); });
@@ -129,6 +135,9 @@ class ProdVirialSeAOp : public OpKernel {
                                        rij, nlist, nloc, nall, nnei);
 #endif  // TENSORFLOW_USE_ROCM
       } else if (device == "CPU") {
+        // the atom virial is skipped if it is not consumed, see
+        // optimizer/fuse.cc
+        if (!compute_atom_virial) atom_virial = NULL;
         deepmd::prod_virial_a_cpu(virial, atom_virial, net_deriv, in_deriv, rij,
                                   nlist, nloc, nall, nnei);
       }
@@ -137,12 +146,17 @@ class ProdVirialSeAOp : public OpKernel {
 
  private:
   std::string device;
+  bool compute_atom_virial = true;
 };
 
 template <typename Device, typename FPTYPE>
 class ProdVirialSeROp : public OpKernel {
  public:
-  explicit ProdVirialSeROp(OpKernelConstruction* context) : OpKernel(context) {}
+  explicit ProdVirialSeROp(OpKernelConstruction* context) : OpKernel(context) {
+    if (context->HasAttr("compute_atom_virial"))
+      OP_REQUIRES_OK(context, context->GetAttr("compute_atom_virial",
+                                               &compute_atom_virial));
+  }
   void Compute(OpKernelContext* context) override {
     deepmd::safe_compute(
         context, [this](OpKernelContext* context) { this->_Compute(context); });
@@ -233,6 +247,9 @@ class ProdVirialSeROp : public OpKernel {
                                        rij, nlist, nloc, nall, nnei);
 #endif  // TENSORFLOW_USE_ROCM
       } else if (device == "CPU") {
+        // the atom virial is skipped if it is not consumed, see
+        // optimizer/fuse.cc
+        if (!compute_atom_virial) atom_virial = NULL;
         deepmd::prod_virial_r_cpu(virial, atom_virial, net_deriv, in_deriv, rij,
                                   nlist, nloc, nall, nnei);
       }
@@ -241,6 +258,7 @@ class ProdVirialSeROp : public OpKernel {
 
  private:
   std::string device;
+  bool compute_atom_virial = true;
 };
 
 // Register the CPU kernels.
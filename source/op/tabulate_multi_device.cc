@@ -1,3 +1,7 @@
+#include <map>
+#include <memory>
+#include <mutex>
+
 #include "custom_op.h"
 #include "tabulate.h"
 
@@ -63,6 +67,40 @@ REGISTER_OP("TabulateFusionSeAGradGrad")
     .Input("descriptor: T")
     .Output("dz_dy: T");
 
+// The se_a ops on a coefficient-major table rounded to bfloat16, stored as
+// the upper 16 bits of a float, which is written by `dp compress
+// --table-prec bf16`. CPU only.
+REGISTER_OP("TabulateFusionSeABf16")
+    .Attr("T: {float, double} = DT_DOUBLE")
+    .Input("table: uint16")
+    .Input("table_info: T")
+    .Input("em_x: T")
+    .Input("em: T")
+    .Attr("last_layer_size: int")
+    .Output("descriptor: T");
+
+REGISTER_OP("TabulateFusionSeABf16Grad")
+    .Attr("T: {float, double} = DT_DOUBLE")
+    .Input("table: uint16")
+    .Input("table_info: T")
+    .Input("em_x: T")
+    .Input("em: T")
+    .Input("dy: T")
+    .Input("descriptor: T")
+    .Output("dy_dem_x: T")
+    .Output("dy_dem: T");
+
+REGISTER_OP("TabulateFusionSeABf16GradGrad")
+    .Attr("T: {float, double}")
+    .Input("table: uint16")
+    .Input("table_info: T")
+    .Input("em_x: T")
+    .Input("em: T")
+    .Input("dz_dy_dem_x: T")
+    .Input("dz_dy_dem: T")
+    .Input("descriptor: T")
+    .Output("dz_dy: T");
+
 REGISTER_OP("TabulateFusionSeT")
     .Attr("T: {float, double} = DT_DOUBLE")
     .Input("table: T")
@@ -70,6 +108,7 @@ REGISTER_OP("TabulateFusionSeT")
     .Input("em_x: T")
     .Input("em: T")
     .Attr("last_layer_size: int")
+    .Attr("symmetric: bool = false")
     .Output("descriptor: T");
 
 REGISTER_OP("TabulateFusionSeTGrad")
@@ -80,6 +119,7 @@ REGISTER_OP("TabulateFusionSeTGrad")
     .Input("em: T")
     .Input("dy: T")
     .Input("descriptor: T")
+    .Attr("symmetric: bool = false")
     .Output("dy_dem_x: T")
     .Output("dy_dem: T");
 
@@ -92,6 +132,7 @@ REGISTER_OP("TabulateFusionSeTGradGrad")
     .Input("dz_dy_dem_x: T")
     .Input("dz_dy_dem: T")
     .Input("descriptor: T")
+    .Attr("symmetric: bool = false")
     .Output("dz_dy: T");
 
 REGISTER_OP("TabulateFusionSeR")
@@ -120,6 +161,70 @@ REGISTER_OP("TabulateFusionSeRGradGrad")
     .Input("descriptor: T")
     .Output("dz_dy: T");
 
+// The coefficient-major copy of the table taken by the SIMD kernels of se_a.
+// The source tensor is kept referenced so that its buffer is not reused by
+// another table.
+template <typename FPTYPE>
+struct TabulateTable {
+  Tensor src;
+  std::vector<FPTYPE> table;
+};
+
+// The copies are shared by all the se_a ops, i.e. the forward, grad and
+// grad-grad ops of a descriptor, and keyed by the buffer of the table. A copy
+// is freed when no op refers to it any longer.
+template <typename FPTYPE>
+std::shared_ptr<const TabulateTable<FPTYPE>> get_tabulate_table_coef_major(
+    const Tensor& table_tensor, const int last_layer_size) {
+  static std::mutex mutex;
+  static std::map<const void*, std::weak_ptr<const TabulateTable<FPTYPE>>>
+      tables;
+  const void* key = table_tensor.tensor_data().data();
+  std::lock_guard<std::mutex> lock(mutex);
+  std::shared_ptr<const TabulateTable<FPTYPE>> table_cm = tables[key].lock();
+  if (table_cm && table_cm->src.SharesBufferWith(table_tensor)) {
+    return table_cm;
+  }
+  const int nspline = table_tensor.shape().dim_size(0);
+  std::shared_ptr<TabulateTable<FPTYPE>> buff =
+      std::make_shared<TabulateTable<FPTYPE>>();
+  buff->src = table_tensor;
+  buff->table.resize(table_tensor.NumElements());
+  deepmd::tabulate_table_coef_major_cpu(buff->table.data(),
+                                        table_tensor.flat<FPTYPE>().data(),
+                                        nspline, last_layer_size);
+  // drop the entries of the tables that are no longer used
+  for (auto it = tables.begin(); it != tables.end();) {
+    if (it->second.expired()) {
+      it = tables.erase(it);
+    } else {
+      ++it;
+    }
+  }
+  tables[key] = buff;
+  return buff;
+}
+
+// The table is a constant of the graph, so an op looks the shared copy up
+// only when it is given a different table buffer.
+template <typename FPTYPE>
+class TabulateTableCoefMajor {
+ public:
+  std::shared_ptr<const TabulateTable<FPTYPE>> get(const Tensor& table_tensor,
+                                                   const int last_layer_size) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!table_cm || !table_cm->src.SharesBufferWith(table_tensor)) {
+      table_cm = get_tabulate_table_coef_major<FPTYPE>(table_tensor,
+                                                       last_layer_size);
+    }
+    return table_cm;
+  }
+
+ private:
+  std::shared_ptr<const TabulateTable<FPTYPE>> table_cm;
+  std::mutex mutex;
+};
+
 template <typename Device, typename FPTYPE>
 class TabulateFusionSeAOp : public OpKernel {
  public:
@@ -177,14 +282,18 @@ class TabulateFusionSeAOp : public OpKernel {
                                             em, nloc, nnei, last_layer_size);
 #endif  // TENSORFLOW_USE_ROCM
     } else if (device == "CPU") {
-      deepmd::tabulate_fusion_se_a_cpu(descriptor, table, table_info, em_x, em,
-                                       nloc, nnei, last_layer_size);
+      std::shared_ptr<const TabulateTable<FPTYPE>> table_cm =
+          table_coef_major.get(table_tensor, last_layer_size);
+      deepmd::tabulate_fusion_se_a_simd_cpu(descriptor, table_cm->table.data(),
+                                            table_info, em_x, em, nloc, nnei,
+                                            last_layer_size);
     }
   }
 
  private:
   int last_layer_size;
   std::string device;
+  TabulateTableCoefMajor<FPTYPE> table_coef_major;
 };
 
 template <typename Device, typename FPTYPE>
@@ -246,14 +355,17 @@ class TabulateFusionSeAGradOp : public OpKernel {
                                                  nnei, last_layer_size);
 #endif  // TENSORFLOW_USE_ROCM
     } else if (device == "CPU") {
-      deepmd::tabulate_fusion_se_a_grad_cpu(dy_dem_x, dy_dem, table, table_info,
-                                            em_x, em, dy, nloc, nnei,
-                                            last_layer_size);
+      std::shared_ptr<const TabulateTable<FPTYPE>> table_cm =
+          table_coef_major.get(table_tensor, last_layer_size);
+      deepmd::tabulate_fusion_se_a_grad_simd_cpu(
+          dy_dem_x, dy_dem, table_cm->table.data(), table_info, em_x, em, dy,
+          nloc, nnei, last_layer_size);
     }
   }
 
  private:
   std::string device;
+  TabulateTableCoefMajor<FPTYPE> table_coef_major;
 };
 
 template <typename Device, typename FPTYPE>
@@ -311,14 +423,173 @@ class TabulateFusionSeAGradGradOp : public OpKernel {
                       "In the process of model compression, the size of the "
                       "last layer of embedding net must be less than 1024!"));
     } else if (device == "CPU") {
-      deepmd::tabulate_fusion_se_a_grad_grad_cpu(dz_dy, table, table_info, em_x,
-                                                 em, dz_dy_dem_x, dz_dy_dem,
-                                                 nloc, nnei, last_layer_size);
+      std::shared_ptr<const TabulateTable<FPTYPE>> table_cm =
+          table_coef_major.get(table_tensor, last_layer_size);
+      deepmd::tabulate_fusion_se_a_grad_grad_simd_cpu(
+          dz_dy, table_cm->table.data(), table_info, em_x, em, dz_dy_dem_x,
+          dz_dy_dem, nloc, nnei, last_layer_size);
     }
   }
 
  private:
   std::string device;
+  TabulateTableCoefMajor<FPTYPE> table_coef_major;
+};
+
+template <typename Device, typename FPTYPE>
+class TabulateFusionSeABf16Op : public OpKernel {
+ public:
+  explicit TabulateFusionSeABf16Op(OpKernelConstruction* context)
+      : OpKernel(context) {
+    OP_REQUIRES_OK(context,
+                   context->GetAttr("last_layer_size", &last_layer_size));
+  }
+  void Compute(OpKernelContext* context) override {
+    deepmd::safe_compute(
+        context, [this](OpKernelContext* context) { this->_Compute(context); });
+  }
+
+  void _Compute(OpKernelContext* context) {
+    // Grab the input tensor
+    int context_input_index = 0;
+    const Tensor& table_tensor = context->input(context_input_index++);
+    const Tensor& table_info_tensor = context->input(context_input_index++);
+    const Tensor& em_x_tensor = context->input(context_input_index++);
+    const Tensor& em_tensor = context->input(context_input_index++);
+    // set size of the sample
+    OP_REQUIRES(context, (table_tensor.shape().dims() == 2),
+                errors::InvalidArgument("Dim of table should be 2"));
+    OP_REQUIRES(context,
+                (table_tensor.shape().dim_size(1) == 6 * last_layer_size),
+                errors::InvalidArgument(
+                    "The table should have 6 x last_layer_size columns"));
+    OP_REQUIRES(context, (em_x_tensor.shape().dims() == 2),
+                errors::InvalidArgument("Dim of input should be 2"));
+    OP_REQUIRES(context, (em_tensor.shape().dims() == 3),
+                errors::InvalidArgument("Dim of input should be 3"));
+    TensorShape descriptor_shape;
+    descriptor_shape.AddDim(em_tensor.shape().dim_size(0));
+    descriptor_shape.AddDim(4);
+    descriptor_shape.AddDim(last_layer_size);
+    int context_output_index = 0;
+    Tensor* descriptor_tensor = NULL;
+    OP_REQUIRES_OK(context, context->allocate_output(context_output_index++,
+                                                     descriptor_shape,
+                                                     &descriptor_tensor));
+    // flat the tensors
+    FPTYPE* descriptor = descriptor_tensor->flat<FPTYPE>().data();
+    const uint16_t* table = table_tensor.flat<uint16>().data();
+    const FPTYPE* table_info = table_info_tensor.flat<FPTYPE>().data();
+    const FPTYPE* em_x = em_x_tensor.flat<FPTYPE>().data();
+    const FPTYPE* em = em_tensor.flat<FPTYPE>().data();
+    const int nloc = em_tensor.shape().dim_size(0);
+    const int nnei = em_tensor.shape().dim_size(1);
+
+    deepmd::tabulate_fusion_se_a_simd_cpu(descriptor, table, table_info, em_x,
+                                          em, nloc, nnei, last_layer_size);
+  }
+
+ private:
+  int last_layer_size;
+};
+
+template <typename Device, typename FPTYPE>
+class TabulateFusionSeABf16GradOp : public OpKernel {
+ public:
+  explicit TabulateFusionSeABf16GradOp(OpKernelConstruction* context)
+      : OpKernel(context) {}
+  void Compute(OpKernelContext* context) override {
+    deepmd::safe_compute(
+        context, [this](OpKernelContext* context) { this->_Compute(context); });
+  }
+
+  void _Compute(OpKernelContext* context) {
+    // Grab the input tensor
+    int context_input_index = 0;
+    const Tensor& table_tensor = context->input(context_input_index++);
+    const Tensor& table_info_tensor = context->input(context_input_index++);
+    const Tensor& em_x_tensor = context->input(context_input_index++);
+    const Tensor& em_tensor = context->input(context_input_index++);
+    const Tensor& dy_tensor = context->input(context_input_index++);
+    const Tensor& descriptor_tensor = context->input(context_input_index++);
+    // set size of the sample
+    OP_REQUIRES(context, (dy_tensor.shape().dims() == 3),
+                errors::InvalidArgument("Dim of table should be 3"));
+    int context_output_index = 0;
+    Tensor* dy_dem_x_tensor = NULL;
+    OP_REQUIRES_OK(context, context->allocate_output(context_output_index++,
+                                                     em_x_tensor.shape(),
+                                                     &dy_dem_x_tensor));
+    Tensor* dy_dem_tensor = NULL;
+    OP_REQUIRES_OK(context,
+                   context->allocate_output(context_output_index++,
+                                            em_tensor.shape(), &dy_dem_tensor));
+
+    // flat the tensors
+    FPTYPE* dy_dem_x = dy_dem_x_tensor->flat<FPTYPE>().data();
+    FPTYPE* dy_dem = dy_dem_tensor->flat<FPTYPE>().data();
+    const uint16_t* table = table_tensor.flat<uint16>().data();
+    const FPTYPE* table_info = table_info_tensor.flat<FPTYPE>().data();
+    const FPTYPE* em_x = em_x_tensor.flat<FPTYPE>().data();
+    const FPTYPE* em = em_tensor.flat<FPTYPE>().data();
+    const FPTYPE* dy = dy_tensor.flat<FPTYPE>().data();
+    const int nloc = em_tensor.shape().dim_size(0);
+    const int nnei = em_tensor.shape().dim_size(1);
+    const int last_layer_size = descriptor_tensor.shape().dim_size(2);
+
+    deepmd::tabulate_fusion_se_a_grad_simd_cpu(dy_dem_x, dy_dem, table,
+                                               table_info, em_x, em, dy, nloc,
+                                               nnei, last_layer_size);
+  }
+};
+
+template <typename Device, typename FPTYPE>
+class TabulateFusionSeABf16GradGradOp : public OpKernel {
+ public:
+  explicit TabulateFusionSeABf16GradGradOp(OpKernelConstruction* context)
+      : OpKernel(context) {}
+  void Compute(OpKernelContext* context) override {
+    deepmd::safe_compute(
+        context, [this](OpKernelContext* context) { this->_Compute(context); });
+  }
+
+  void _Compute(OpKernelContext* context) {
+    // Grab the input tensor
+    int context_input_index = 0;
+    const Tensor& table_tensor = context->input(context_input_index++);
+    const Tensor& table_info_tensor = context->input(context_input_index++);
+    const Tensor& em_x_tensor = context->input(context_input_index++);
+    const Tensor& em_tensor = context->input(context_input_index++);
+    const Tensor& dz_dy_dem_x_tensor = context->input(context_input_index++);
+    const Tensor& dz_dy_dem_tensor = context->input(context_input_index++);
+    const Tensor& descriptor_tensor = context->input(context_input_index++);
+    // set size of the sample
+    OP_REQUIRES(context, (dz_dy_dem_x_tensor.shape().dims() == 2),
+                errors::InvalidArgument("Dim of input should be 2"));
+    OP_REQUIRES(context, (dz_dy_dem_tensor.shape().dims() == 3),
+                errors::InvalidArgument("Dim of input should be 3"));
+    int context_output_index = 0;
+    Tensor* dz_dy_tensor = NULL;
+    OP_REQUIRES_OK(context, context->allocate_output(context_output_index++,
+                                                     descriptor_tensor.shape(),
+                                                     &dz_dy_tensor));
+
+    // flat the tensors
+    FPTYPE* dz_dy = dz_dy_tensor->flat<FPTYPE>().data();
+    const uint16_t* table = table_tensor.flat<uint16>().data();
+    const FPTYPE* table_info = table_info_tensor.flat<FPTYPE>().data();
+    const FPTYPE* em_x = em_x_tensor.flat<FPTYPE>().data();
+    const FPTYPE* em = em_tensor.flat<FPTYPE>().data();
+    const FPTYPE* dz_dy_dem_x = dz_dy_dem_x_tensor.flat<FPTYPE>().data();
+    const FPTYPE* dz_dy_dem = dz_dy_dem_tensor.flat<FPTYPE>().data();
+    const int nloc = em_tensor.shape().dim_size(0);
+    const int nnei = em_tensor.shape().dim_size(1);
+    const int last_layer_size = descriptor_tensor.shape().dim_size(2);
+
+    deepmd::tabulate_fusion_se_a_grad_grad_simd_cpu(
+        dz_dy, table, table_info, em_x, em, dz_dy_dem_x, dz_dy_dem, nloc, nnei,
+        last_layer_size);
+  }
 };
 
 template <typename Device, typename FPTYPE>
@@ -328,6 +599,7 @@ class TabulateFusionSeTOp : public OpKernel {
       : OpKernel(context) {
     OP_REQUIRES_OK(context,
                    context->GetAttr("last_layer_size", &last_layer_size));
+    OP_REQUIRES_OK(context, context->GetAttr("symmetric", &symmetric));
   }
   void Compute(OpKernelContext* context) override {
     deepmd::safe_compute(
@@ -380,13 +652,21 @@ class TabulateFusionSeTOp : public OpKernel {
                                             last_layer_size);
 #endif  // TENSORFLOW_USE_ROCM
     } else if (device == "CPU") {
-      deepmd::tabulate_fusion_se_t_cpu(descriptor, table, table_info, em_x, em,
-                                       nloc, nnei_i, nnei_j, last_layer_size);
+      if (symmetric && nnei_i == nnei_j) {
+        deepmd::tabulate_fusion_se_t_sym_cpu(descriptor, table, table_info,
+                                             em_x, em, nloc, nnei_i,
+                                             last_layer_size);
+      } else {
+        deepmd::tabulate_fusion_se_t_cpu(descriptor, table, table_info, em_x,
+                                         em, nloc, nnei_i, nnei_j,
+                                         last_layer_size);
+      }
     }
   }
 
  private:
   int last_layer_size;
+  bool symmetric;
   std::string device;
 };
 
@@ -394,7 +674,9 @@ template <typename Device, typename FPTYPE>
 class TabulateFusionSeTGradOp : public OpKernel {
  public:
   explicit TabulateFusionSeTGradOp(OpKernelConstruction* context)
-      : OpKernel(context) {}
+      : OpKernel(context) {
+    OP_REQUIRES_OK(context, context->GetAttr("symmetric", &symmetric));
+  }
   void Compute(OpKernelContext* context) override {
     deepmd::safe_compute(
         context, [this](OpKernelContext* context) { this->_Compute(context); });
@@ -450,13 +732,20 @@ class TabulateFusionSeTGradOp : public OpKernel {
           nnei_j, last_layer_size);
 #endif  // TENSORFLOW_USE_ROCM
     } else if (device == "CPU") {
-      deepmd::tabulate_fusion_se_t_grad_cpu(dy_dem_x, dy_dem, table, table_info,
-                                            em_x, em, dy, nloc, nnei_i, nnei_j,
-                                            last_layer_size);
+      if (symmetric && nnei_i == nnei_j) {
+        deepmd::tabulate_fusion_se_t_grad_sym_cpu(
+            dy_dem_x, dy_dem, table, table_info, em_x, em, dy, nloc, nnei_i,
+            last_layer_size);
+      } else {
+        deepmd::tabulate_fusion_se_t_grad_cpu(
+            dy_dem_x, dy_dem, table, table_info, em_x, em, dy, nloc, nnei_i,
+            nnei_j, last_layer_size);
+      }
     }
   }
 
  private:
+  bool symmetric;
   std::string device;
 };
 
@@ -464,7 +753,9 @@ template <typename Device, typename FPTYPE>
 class TabulateFusionSeTGradGradOp : public OpKernel {
  public:
   explicit TabulateFusionSeTGradGradOp(OpKernelConstruction* context)
-      : OpKernel(context) {}
+      : OpKernel(context) {
+    OP_REQUIRES_OK(context, context->GetAttr("symmetric", &symmetric));
+  }
   void Compute(OpKernelContext* context) override {
     // Grab the input tensor
     int context_input_index = 0;
@@ -516,13 +807,20 @@ class TabulateFusionSeTGradGradOp : public OpKernel {
                       "In the process of model compression, the size of the "
                       "last layer of embedding net must be less than 1024!"));
     } else if (device == "CPU") {
-      deepmd::tabulate_fusion_se_t_grad_grad_cpu(
-          dz_dy, table, table_info, em_x, em, dz_dy_dem_x, dz_dy_dem, nloc,
-          nnei_i, nnei_j, last_layer_size);
+      if (symmetric && nnei_i == nnei_j) {
+        deepmd::tabulate_fusion_se_t_grad_grad_sym_cpu(
+            dz_dy, table, table_info, em_x, em, dz_dy_dem_x, dz_dy_dem, nloc,
+            nnei_i, last_layer_size);
+      } else {
+        deepmd::tabulate_fusion_se_t_grad_grad_cpu(
+            dz_dy, table, table_info, em_x, em, dz_dy_dem_x, dz_dy_dem, nloc,
+            nnei_i, nnei_j, last_layer_size);
+      }
     }
   }
 
  private:
+  bool symmetric;
   std::string device;
 };
 template <typename Device, typename FPTYPE>
@@ -725,6 +1023,18 @@ class TabulateFusionSeRGradGradOp : public OpKernel {
                               .Device(DEVICE_CPU)                              \
                               .TypeConstraint<T>("T"),                         \
                           TabulateFusionSeAGradGradOp<CPUDevice, T>);          \
+  REGISTER_KERNEL_BUILDER(Name("TabulateFusionSeABf16")                        \
+                              .Device(DEVICE_CPU)                              \
+                              .TypeConstraint<T>("T"),                         \
+                          TabulateFusionSeABf16Op<CPUDevice, T>);              \
+  REGISTER_KERNEL_BUILDER(Name("TabulateFusionSeABf16Grad")                    \
+                              .Device(DEVICE_CPU)                              \
+                              .TypeConstraint<T>("T"),                         \
+                          TabulateFusionSeABf16GradOp<CPUDevice, T>);          \
+  REGISTER_KERNEL_BUILDER(Name("TabulateFusionSeABf16GradGrad")                \
+                              .Device(DEVICE_CPU)                              \
+                              .TypeConstraint<T>("T"),                         \
+                          TabulateFusionSeABf16GradGradOp<CPUDevice, T>);      \
   REGISTER_KERNEL_BUILDER(                                                     \
       Name("TabulateFusionSeT").Device(DEVICE_CPU).TypeConstraint<T>("T"),     \
       TabulateFusionSeTOp<CPUDevice, T>);                                      \
@@ -0,0 +1,130 @@
+#include "custom_op.h"
+#include "prod_env_mat.h"
+#include "utilities.h"
+
+// drop the slots of ProdEnvMatA outputs that are padding in every atom of the
+// batch, so that ProdForceSeA and ProdVirialSeA work on a narrower layout.
+// sel_index maps the kept slots to the slots of the full layout.
+REGISTER_OP("TrimEnvMatA")
+    .Attr("T: {float, double} = DT_DOUBLE")
+    .Input("descrpt_deriv: T")
+    .Input("rij: T")
+    .Input("nlist: int32")
+    .Input("natoms: int32")
+    .Attr("sel_a: list(int)")
+    .Output("descrpt_deriv_trim: T")
+    .Output("rij_trim: T")
+    .Output("nlist_trim: int32")
+    .Output("sel_index: int32");
+
+template <typename Device, typename FPTYPE>
+class TrimEnvMatAOp : public OpKernel {
+ public:
+  explicit TrimEnvMatAOp(OpKernelConstruction* context) : OpKernel(context) {
+    OP_REQUIRES_OK(context, context->GetAttr("sel_a", &sel_a));
+    deepmd::cum_sum(sec_a, sel_a);
+  }
+
+  void Compute(OpKernelContext* context) override {
+    deepmd::safe_compute(
+        context, [this](OpKernelContext* context) { this->_Compute(context); });
+  }
+
+  void _Compute(OpKernelContext* context) {
+    // Grab the input tensor
+    int context_input_index = 0;
+    const Tensor& in_deriv_tensor = context->input(context_input_index++);
+    const Tensor& rij_tensor = context->input(context_input_index++);
+    const Tensor& nlist_tensor = context->input(context_input_index++);
+    const Tensor& natoms_tensor = context->input(context_input_index++);
+    // set size of the sample
+    OP_REQUIRES(context, (in_deriv_tensor.shape().dims() == 2),
+                errors::InvalidArgument("Dim of input deriv should be 2"));
+    OP_REQUIRES(context, (rij_tensor.shape().dims() == 2),
+                errors::InvalidArgument("Dim of rij should be 2"));
+    OP_REQUIRES(context, (nlist_tensor.shape().dims() == 2),
+                errors::InvalidArgument("Dim of nlist should be 2"));
+    OP_REQUIRES(context, (natoms_tensor.shape().dims() == 1),
+                errors::InvalidArgument("Dim of natoms should be 1"));
+    OP_REQUIRES(context, (natoms_tensor.shape().dim_size(0) >= 3),
+                errors::InvalidArgument(
+                    "number of atoms should be larger than (or equal to) 3"));
+    const int* natoms = natoms_tensor.flat<int>().data();
+    int nloc = natoms[0];
+    int nnei = sec_a.back();
+    int nframes = nlist_tensor.shape().dim_size(0);
+    // check the sizes
+    OP_REQUIRES(context, (nframes == in_deriv_tensor.shape().dim_size(0)),
+                errors::InvalidArgument("number of samples should match"));
+    OP_REQUIRES(context, (nframes == rij_tensor.shape().dim_size(0)),
+                errors::InvalidArgument("number of samples should match"));
+    OP_REQUIRES(context,
+                (int_64(nloc) * nnei == nlist_tensor.shape().dim_size(1)),
+                errors::InvalidArgument("number of neighbors should match"));
+    OP_REQUIRES(
+        context,
+        (int_64(nloc) * nnei * 12 == in_deriv_tensor.shape().dim_size(1)),
+        errors::InvalidArgument("number of descriptors should match"));
+    OP_REQUIRES(context,
+                (int_64(nloc) * nnei * 3 == rij_tensor.shape().dim_size(1)),
+                errors::InvalidArgument("dim of rij should be nnei * 3"));
+    const int* p_nlist = nlist_tensor.flat<int>().data();
+    // the frames of the batch share the trimmed layout
+    std::vector<int> sel_index, sel_trim;
+    deepmd::env_mat_trim_index_cpu(sel_index, sel_trim, p_nlist,
+                                   nframes * nloc, sec_a);
+    int nnei_trim = sel_index.size();
+    // Create an output tensor
+    TensorShape in_deriv_shape;
+    in_deriv_shape.AddDim(nframes);
+    in_deriv_shape.AddDim(int_64(nloc) * nnei_trim * 12);
+    TensorShape rij_shape;
+    rij_shape.AddDim(nframes);
+    rij_shape.AddDim(int_64(nloc) * nnei_trim * 3);
+    TensorShape nlist_shape;
+    nlist_shape.AddDim(nframes);
+    nlist_shape.AddDim(int_64(nloc) * nnei_trim);
+    TensorShape sel_index_shape;
+    sel_index_shape.AddDim(nnei_trim);
+    int context_output_index = 0;
+    Tensor* in_deriv_trim_tensor = NULL;
+    OP_REQUIRES_OK(context, context->allocate_output(context_output_index++,
+                                                     in_deriv_shape,
+                                                     &in_deriv_trim_tensor));
+    Tensor* rij_trim_tensor = NULL;
+    OP_REQUIRES_OK(context,
+                   context->allocate_output(context_output_index++, rij_shape,
+                                            &rij_trim_tensor));
+    Tensor* nlist_trim_tensor = NULL;
+    OP_REQUIRES_OK(context,
+                   context->allocate_output(context_output_index++,
+                                            nlist_shape, &nlist_trim_tensor));
+    Tensor* sel_index_tensor = NULL;
+    OP_REQUIRES_OK(context, context->allocate_output(context_output_index++,
+                                                     sel_index_shape,
+                                                     &sel_index_tensor));
+    // flat the tensors
+    deepmd::env_mat_trim_cpu(in_deriv_trim_tensor->flat<FPTYPE>().data(),
+                             in_deriv_tensor.flat<FPTYPE>().data(), sel_index,
+                             nframes * nloc, nnei, 12);
+    deepmd::env_mat_trim_cpu(rij_trim_tensor->flat<FPTYPE>().data(),
+                             rij_tensor.flat<FPTYPE>().data(), sel_index,
+                             nframes * nloc, nnei, 3);
+    deepmd::env_mat_trim_cpu(nlist_trim_tensor->flat<int>().data(), p_nlist,
+                             sel_index, nframes * nloc, nnei, 1);
+    std::copy(sel_index.begin(), sel_index.end(),
+              sel_index_tensor->flat<int>().data());
+  }
+
+ private:
+  std::vector<int32> sel_a;
+  std::vector<int> sec_a;
+};
+
+// Register the CPU kernels.
+#define REGISTER_CPU(T)                                              \
+  REGISTER_KERNEL_BUILDER(                                           \
+      Name("TrimEnvMatA").Device(DEVICE_CPU).TypeConstraint<T>("T"), \
+      TrimEnvMatAOp<CPUDevice, T>);
+REGISTER_CPU(float);
+REGISTER_CPU(double);
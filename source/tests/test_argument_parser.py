@@ -331,6 +331,7 @@ class TestParserOutput(unittest.TestCase):
             "--step": dict(type=float, value=0.1),
             "--frequency": dict(type=int, value=-1),
             "--checkpoint-folder": dict(type=str, value="."),
+            "--table-prec": dict(type=str, value="bf16"),
         }
 
         self.run_test(command="compress", mapping=ARGS)
@@ -12,6 +12,9 @@ from common import (
     tests_path,
 )
 
+from deepmd.entrypoints.table_prec import (
+    table_prec,
+)
 from deepmd.env import (
     GLOBAL_NP_FLOAT_PRECISION,
 )
@@ -47,6 +50,7 @@ def _init_models():
     data_file = str(tests_path / os.path.join("model_compression", "data"))
     frozen_model = str(tests_path / "dp-original.pb")
     compressed_model = str(tests_path / "dp-compressed.pb")
+    bf16_model = str(tests_path / "dp-compressed-bf16.pb")
     INPUT = str(tests_path / "input.json")
     jdata = j_loader(str(tests_path / os.path.join("model_compression", "input.json")))
     jdata["training"]["training_data"]["systems"] = data_file
@@ -60,10 +64,14 @@ def _init_models():
     np.testing.assert_equal(ret, 0, "DP freeze failed!")
     ret = run_dp("dp compress " + " -i " + frozen_model + " -o " + compressed_model)
     np.testing.assert_equal(ret, 0, "DP model compression failed!")
-    return INPUT, frozen_model, compressed_model
+    ret = run_dp(
+        "dp compress --table-prec bf16 " + " -i " + frozen_model + " -o " + bf16_model
+    )
+    np.testing.assert_equal(ret, 0, "DP model compression failed!")
+    return INPUT, frozen_model, compressed_model, bf16_model, data_file
 
 
-INPUT, FROZEN_MODEL, COMPRESSED_MODEL = _init_models()
+INPUT, FROZEN_MODEL, COMPRESSED_MODEL, BF16_MODEL, DATA_FILE = _init_models()
 
 
 class TestDeepPotAPBC(unittest.TestCase):
@@ -406,6 +414,67 @@ class TestDeepPotALargeBoxNoPBC(unittest.TestCase):
         np.testing.assert_almost_equal(ee0, ee1, default_places)
 
 
+class TestDeepPotABf16Table(unittest.TestCase):
+    @classmethod
+    def setUpClass(self):
+        self.dp_compressed = DeepPot(COMPRESSED_MODEL)
+        self.dp_bf16 = DeepPot(BF16_MODEL)
+        self.coords = np.array(
+            [
+                12.83,
+                2.56,
+                2.18,
+                12.09,
+                2.87,
+                2.74,
+                00.25,
+                3.32,
+                1.68,
+                3.36,
+                3.00,
+                1.81,
+                3.51,
+                2.51,
+                2.60,
+                4.27,
+                3.22,
+                1.56,
+            ]
+        )
+        self.atype = [0, 1, 1, 0, 1, 1]
+        self.box = np.array([13.0, 0.0, 0.0, 0.0, 13.0, 0.0, 0.0, 0.0, 13.0])
+
+    def test_ops(self):
+        ops = {op.type for op in self.dp_bf16.graph.get_operations()}
+        self.assertIn("TabulateFusionSeABf16", ops)
+        self.assertNotIn("TabulateFusionSeA", ops)
+
+    def test_1frame(self):
+        ee0, ff0, vv0 = self.dp_compressed.eval(self.coords, self.box, self.atype)
+        ee1, ff1, vv1 = self.dp_bf16.eval(self.coords, self.box, self.atype)
+        # the coefficients of the tables have a relative error of 2^-9
+        np.testing.assert_almost_equal(ff0, ff1, 2)
+        np.testing.assert_almost_equal(ee0 / 6, ee1 / 6, 2)
+        np.testing.assert_almost_equal(vv0 / 6, vv1 / 6, 2)
+
+    def test_table_prec(self):
+        ret = run_dp(
+            "dp table-prec -m " + COMPRESSED_MODEL + " -s " + DATA_FILE + " -p bf16"
+        )
+        np.testing.assert_equal(ret, 0, "DP table-prec failed!")
+        err_e, err_f, err_v = table_prec(
+            model=COMPRESSED_MODEL,
+            system=DATA_FILE,
+            set_prefix="set",
+            numb_test=2,
+            precision="bf16",
+        )
+        self.assertGreater(err_f, 0.0)
+        self.assertLess(err_e, 1e-2)
+        self.assertLess(err_f, 1e-2)
+        self.assertLess(err_v, 1e-2)
+
+
 class TestDeepPotAPBCExcludeTypes(unittest.TestCase):
     @classmethod
     def setUpClass(self):
@@ -441,6 +510,7 @@ class TestDeepPotAPBCExcludeTypes(unittest.TestCase):
         _file_delete(INPUT)
         _file_delete(FROZEN_MODEL)
         _file_delete(COMPRESSED_MODEL)
+        _file_delete(BF16_MODEL)
         _file_delete("out.json")
         _file_delete("compress.json")
         _file_delete("checkpoint")
@@ -1,3 +1,6 @@
+import os
+import unittest
+
 import dpdata
 import numpy as np
 from common import (
@@ -133,6 +136,16 @@ class TestModel(tf.test.TestCase):
         self.assertAlmostEqual(e[0], set_atom_ener[1], places=10)
 
     def test_model(self):
+        self._test_model("se_a")
+
+    def test_model_trim_nnei(self):
+        """The slots trimmed with DP_TRIM_NNEI do not change the model."""
+        with unittest.mock.patch.dict(os.environ, {"DP_TRIM_NNEI": "1"}):
+            self._test_model("se_a_trim_nnei")
+        op_types = {op.type for op in tf.get_default_graph().get_operations()}
+        self.assertIn("TrimEnvMatA", op_types)
+
+    def _test_model(self, suffix):
         jfile = "water_se_a.json"
         jdata = j_loader(jfile)
 
@@ -189,7 +202,7 @@ class TestModel(tf.test.TestCase):
             t_box,
             t_mesh,
             t_fparam,
-            suffix="se_a",
+            suffix=suffix,
             reuse=False,
         )
         energy = model_pred["energy"]
@@ -0,0 +1,188 @@
+import os
+import platform
+import unittest
+
+import numpy as np
+from common import (
+    tests_path,
+)
+from packaging.version import parse as parse_version
+
+from deepmd.env import (
+    GLOBAL_NP_FLOAT_PRECISION,
+    op_module,
+    tf,
+    tf_py_version,
+)
+from deepmd.infer import (
+    DeepPot,
+)
+from deepmd.utils.convert import (
+    convert_pbtxt_to_pb,
+)
+from deepmd.utils.sess import (
+    run_sess,
+)
+
+if GLOBAL_NP_FLOAT_PRECISION == np.float32:
+    default_places = 4
+else:
+    default_places = 10
+
+
+@unittest.skipIf(
+    parse_version(tf_py_version) < parse_version("1.15")
+    or platform.system() == "Windows",
+    reason="the dpfuse optimizer requires TF >= 1.15 outside Windows",
+)
+@unittest.skipIf(tf.test.is_gpu_available(), reason="Not supported in GPUs")
+class TestOpFusion(unittest.TestCase):
+    """Evaluate a frozen model with and without the dpfuse optimizer."""
+
+    @classmethod
+    def setUpClass(cls):
+        convert_pbtxt_to_pb(
+            str(tests_path / os.path.join("infer", "deeppot.pbtxt")),
+            "deeppot-fuse.pb",
+        )
+        cls.dp = DeepPot("deeppot-fuse.pb")
+
+    @classmethod
+    def tearDownClass(cls):
+        os.remove("deeppot-fuse.pb")
+        cls.dp = None
+
+    def setUp(self):
+        self.coords = np.array(
+            [
+                12.83,
+                2.56,
+                2.18,
+                12.09,
+                2.87,
+                2.74,
+                00.25,
+                3.32,
+                1.68,
+                3.36,
+                3.00,
+                1.81,
+                3.51,
+                2.51,
+                2.60,
+                4.27,
+                3.22,
+                1.56,
+            ]
+        )
+        self.atype = [0, 1, 1, 0, 1, 1]
+        self.box = np.array([13.0, 0.0, 0.0, 0.0, 13.0, 0.0, 0.0, 0.0, 13.0])
+
+    def _run(self, fuse: bool, fetches=None):
+        if fetches is None:
+            fetches = [self.dp.t_force, self.dp.t_virial, self.dp.t_av]
+        feed_dict, _ = self.dp._prepare_feed_dict(
+            self.coords, self.box, self.atype, None, None, None
+        )
+        return self._run_graph(self.dp.graph, fuse, fetches, feed_dict)
+
+    def _run_graph(self, graph, fuse: bool, fetches, feed_dict):
+        config = tf.ConfigProto()
+        if fuse:
+            config.graph_options.rewrite_options.custom_optimizers.add().name = "dpfuse"
+        run_options = tf.RunOptions(output_partition_graphs=True)
+        run_metadata = tf.RunMetadata()
+        with tf.Session(graph=graph, config=config) as sess:
+            ret = run_sess(
+                sess,
+                fetches,
+                feed_dict=feed_dict,
+                options=run_options,
+                run_metadata=run_metadata,
+            )
+        nodes = [node for graph in run_metadata.partition_graphs for node in graph.node]
+        return ret, nodes
+
+    def _attr(self, nodes, op: str, name: str) -> bool:
+        # a missing attr takes its default value, true
+        values = [
+            node.attr[name].b if name in node.attr else True
+            for node in nodes
+            if node.op == op
+        ]
+        self.assertEqual(len(values), 1)
+        return values[0]
+
+    def test_fuse(self):
+        (ff0, vv0, av0), nodes0 = self._run(False)
+        (ff1, vv1, av1), nodes1 = self._run(True)
+        ops0 = {node.op for node in nodes0}
+        ops1 = {node.op for node in nodes1}
+        self.assertNotIn("ProdForceVirialSeA", ops0)
+        self.assertIn("ProdForceVirialSeA", ops1)
+        self.assertNotIn("ProdForceSeA", ops1)
+        self.assertNotIn("ProdVirialSeA", ops1)
+        np.testing.assert_almost_equal(ff1, ff0, default_places)
+        np.testing.assert_almost_equal(vv1, vv0, default_places)
+        np.testing.assert_almost_equal(av1, av0, default_places)
+
+    def test_skip_em_deriv(self):
+        # the derivative of the environment matrix is only computed if the
+        # force or the virial is fetched
+        (ee0,), nodes0 = self._run(False, [self.dp.t_energy])
+        (ee1,), nodes1 = self._run(True, [self.dp.t_energy])
+        (ee2, _), nodes2 = self._run(True, [self.dp.t_energy, self.dp.t_force])
+        self.assertTrue(self._attr(nodes0, "ProdEnvMatA", "compute_em_deriv"))
+        self.assertFalse(self._attr(nodes1, "ProdEnvMatA", "compute_em_deriv"))
+        self.assertTrue(self._attr(nodes2, "ProdEnvMatA", "compute_em_deriv"))
+        np.testing.assert_almost_equal(ee1, ee0, default_places)
+        np.testing.assert_almost_equal(ee2, ee0, default_places)
+
+    def test_skip_atom_virial(self):
+        # a ProdVirialSeA without ProdForceSeA is not fused, and its atom
+        # virial is only computed if it is fetched
+        nloc, nall, nnei = 2, 3, 2
+        ndescrpt = nnei * 4
+        with tf.Graph().as_default() as graph:
+            t_net_deriv = tf.placeholder(tf.float64, [None, nloc * ndescrpt])
+            t_in_deriv = tf.placeholder(tf.float64, [None, nloc * ndescrpt * 3])
+            t_rij = tf.placeholder(tf.float64, [None, nloc * nnei * 3])
+            t_nlist = tf.placeholder(tf.int32, [None, nloc * nnei])
+            t_natoms = tf.placeholder(tf.int32, [3])
+            t_virial, t_atom_virial = op_module.prod_virial_se_a(
+                t_net_deriv,
+                t_in_deriv,
+                t_rij,
+                t_nlist,
+                t_natoms,
+                n_a_sel=nnei,
+                n_r_sel=0,
+            )
+        feed_dict = {
+            t_net_deriv: np.random.random([1, nloc * ndescrpt]),
+            t_in_deriv: np.random.random([1, nloc * ndescrpt * 3]),
+            t_rij: np.random.random([1, nloc * nnei * 3]),
+            t_nlist: np.array([[1, 2, 0, -1]], dtype=np.int32),
+            t_natoms: np.array([nloc, nall, nloc], dtype=np.int32),
+        }
+        (vv0, av0), nodes0 = self._run_graph(
+            graph, True, [t_virial, t_atom_virial], feed_dict
+        )
+        (vv1,), nodes1 = self._run_graph(graph, True, [t_virial], feed_dict)
+        self.assertTrue(self._attr(nodes0, "ProdVirialSeA", "compute_atom_virial"))
+        self.assertFalse(self._attr(nodes1, "ProdVirialSeA", "compute_atom_virial"))
+        np.testing.assert_almost_equal(vv1, vv0, default_places)
+        np.testing.assert_almost_equal(
+            vv0, np.sum(av0.reshape([1, nall, 9]), axis=1), default_places
+        )
+
+    def test_fuse_skip_atom_virial(self):
+        (ff0, vv0), _ = self._run(False, [self.dp.t_force, self.dp.t_virial])
+        (ff1, vv1), nodes1 = self._run(True, [self.dp.t_force, self.dp.t_virial])
+        _, nodes2 = self._run(True)
+        self.assertFalse(
+            self._attr(nodes1, "ProdForceVirialSeA", "compute_atom_virial")
+        )
+        self.assertTrue(self._attr(nodes2, "ProdForceVirialSeA", "compute_atom_virial"))
+        np.testing.assert_almost_equal(ff1, ff0, default_places)
+        np.testing.assert_almost_equal(vv1, vv0, default_places)
@@ -1058,6 +1058,39 @@ class TestProdEnvMat(tf.test.TestCase):
         for ff in range(self.nframes):
             np.testing.assert_almost_equal(dem[ff], self.pbc_expected_output, 5)
 
+    def test_pbc_self_built_nlist_no_deriv(self):
+        tem, tem_deriv, trij, tnlist = op_module.prod_env_mat_a(
+            self.tcoord,
+            self.ttype,
+            self.tnatoms,
+            self.tbox,
+            tf.constant(np.zeros(6, dtype=np.int32)),
+            self.t_avg,
+            self.t_std,
+            rcut_a=-1,
+            rcut_r=self.rcut,
+            rcut_r_smth=self.rcut_smth,
+            sel_a=self.sel,
+            sel_r=[0, 0],
+            compute_em_deriv=False,
+        )
+        self.sess.run(tf.global_variables_initializer())
+        # the derivative is not fetched
+        dem, drij, dnlist = self.sess.run(
+            [tem, trij, tnlist],
+            feed_dict={
+                self.tcoord: self.dcoord,
+                self.ttype: self.dtype,
+                self.tbox: self.dbox,
+                self.tnatoms: self.dnatoms,
+            },
+        )
+        self.assertEqual(dem.shape, (self.nframes, self.nloc * self.ndescrpt))
+        self.assertEqual(drij.shape, (self.nframes, self.nloc * self.nnei * 3))
+        self.assertEqual(dnlist.shape, (self.nframes, self.nloc * self.nnei))
+        for ff in range(self.nframes):
+            np.testing.assert_almost_equal(dem[ff], self.pbc_expected_output, 5)
+
     def test_pbc_self_built_nlist_deriv(self):
         hh = 1e-4
         tem, tem_deriv, trij, tnlist = op_module.prod_env_mat_a(
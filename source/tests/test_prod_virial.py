@@ -1,3 +1,5 @@
+import unittest
+
 import numpy as np
 
 from deepmd.env import (
@@ -1522,3 +1524,43 @@ class TestProdVirial(tf.test.TestCase):
             np.testing.assert_almost_equal(
                 datom_virial[ff], self.expected_atom_virial, 5
             )
+
+    @unittest.skipIf(tf.test.is_gpu_available(), reason="Not supported in GPUs")
+    def test_prod_force_virial(self):
+        tforce, tvirial, tatom_virial = op_module.prod_force_virial_se_a(
+            self.tnet_deriv,
+            self.tem_deriv,
+            self.trij,
+            self.tnlist,
+            self.tnatoms,
+            n_a_sel=self.nnei,
+            n_r_sel=0,
+        )
+        tforce_ref = op_module.prod_force_se_a(
+            self.tnet_deriv,
+            self.tem_deriv,
+            self.tnlist,
+            self.tnatoms,
+            n_a_sel=self.nnei,
+            n_r_sel=0,
+        )
+        self.sess.run(tf.global_variables_initializer())
+        dforce, dvirial, datom_virial, dforce_ref = self.sess.run(
+            [tforce, tvirial, tatom_virial, tforce_ref],
+            feed_dict={
+                self.tnet_deriv: self.dnet_deriv,
+                self.tem_deriv: self.dem_deriv,
+                self.trij: self.drij,
+                self.tnlist: self.dnlist,
+                self.tnatoms: self.dnatoms,
+            },
+        )
+        self.assertEqual(dforce.shape, (self.nframes, self.nall * 3))
+        self.assertEqual(dvirial.shape, (self.nframes, 9))
+        self.assertEqual(datom_virial.shape, (self.nframes, self.nall * 9))
+        np.testing.assert_almost_equal(dforce, dforce_ref, 5)
+        for ff in range(self.nframes):
+            np.testing.assert_almost_equal(dvirial[ff], self.expected_virial, 5)
+            np.testing.assert_almost_equal(
+                datom_virial[ff], self.expected_atom_virial, 5
+            )
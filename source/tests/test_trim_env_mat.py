@@ -0,0 +1,210 @@
+import unittest
+
+import numpy as np
+
+import deepmd.op  # noqa: F401
+from deepmd.env import (
+    GLOBAL_NP_FLOAT_PRECISION,
+    GLOBAL_TF_FLOAT_PRECISION,
+    op_module,
+    tf,
+)
+
+
+@unittest.skipIf(tf.test.is_gpu_available(), reason="Not supported in GPUs")
+class TestTrimEnvMat(tf.test.TestCase):
+    def setUp(self):
+        self.sess = self.test_session().__enter__()
+        self.nframes = 2
+        self.dcoord = [
+            12.83,
+            2.56,
+            2.18,
+            12.09,
+            2.87,
+            2.74,
+            00.25,
+            3.32,
+            1.68,
+            3.36,
+            3.00,
+            1.81,
+            3.51,
+            2.51,
+            2.60,
+            4.27,
+            3.22,
+            1.56,
+        ]
+        self.dtype = [0, 1, 1, 0, 1, 1]
+        self.dbox = [13.0, 0.0, 0.0, 0.0, 13.0, 0.0, 0.0, 0.0, 13.0]
+        self.dcoord = np.reshape(self.dcoord, [1, -1])
+        self.dtype = np.reshape(self.dtype, [1, -1])
+        self.dbox = np.reshape(self.dbox, [1, -1])
+        self.dcoord = np.tile(self.dcoord, [self.nframes, 1])
+        # the second frame has a different occupancy of the sections
+        self.dcoord[1, 0:3] += [-4.0, 0.5, 0.3]
+        self.dtype = np.tile(self.dtype, [self.nframes, 1])
+        self.dbox = np.tile(self.dbox, [self.nframes, 1])
+        self.sel = [10, 10]
+        self.sec = np.array([0, 0, 0], dtype=int)
+        self.sec[1:3] = np.cumsum(self.sel)
+        self.rcut = 6.0
+        self.rcut_smth = 0.8
+        self.dnatoms = [6, 6, 2, 4]
+        self.nloc = self.dnatoms[0]
+        self.nall = self.dnatoms[1]
+        self.nnei = self.sec[-1]
+        self.ndescrpt = 4 * self.nnei
+        self.ntypes = np.max(self.dtype) + 1
+        self.tcoord = tf.placeholder(
+            GLOBAL_TF_FLOAT_PRECISION, [None, self.dnatoms[0] * 3], name="t_coord"
+        )
+        self.tbox = tf.placeholder(GLOBAL_TF_FLOAT_PRECISION, [None, 9], name="t_box")
+        self.ttype = tf.placeholder(tf.int32, [None, self.dnatoms[0]], name="t_type")
+        self.tnatoms = tf.placeholder(tf.int32, [None], name="t_natoms")
+        davg = np.zeros([self.ntypes, self.ndescrpt])
+        dstd = np.ones([self.ntypes, self.ndescrpt])
+        _, self.tem_deriv, self.trij, self.tnlist = op_module.prod_env_mat_a(
+            self.tcoord,
+            self.ttype,
+            self.tnatoms,
+            self.tbox,
+            tf.constant(np.zeros(6, dtype=np.int32)),
+            tf.constant(davg.astype(GLOBAL_NP_FLOAT_PRECISION)),
+            tf.constant(dstd.astype(GLOBAL_NP_FLOAT_PRECISION)),
+            rcut_a=-1,
+            rcut_r=self.rcut,
+            rcut_r_smth=self.rcut_smth,
+            sel_a=self.sel,
+            sel_r=[0, 0],
+        )
+        self.dnet_deriv = np.reshape(
+            np.sin(0.1 * np.arange(self.nframes * self.nloc * self.ndescrpt)),
+            [self.nframes, -1],
+        )
+        self.tnet_deriv = tf.constant(
+            self.dnet_deriv.astype(GLOBAL_NP_FLOAT_PRECISION), name="t_net_deriv"
+        )
+        self.feed_dict = {
+            self.tcoord: self.dcoord,
+            self.ttype: self.dtype,
+            self.tbox: self.dbox,
+            self.tnatoms: self.dnatoms,
+        }
+
+    def _trim(self):
+        return op_module.trim_env_mat_a(
+            self.tem_deriv, self.trij, self.tnlist, self.tnatoms, sel_a=self.sel
+        )
+
+    def _trim_net_deriv(self, sel_index):
+        return tf.reshape(
+            tf.gather(
+                tf.reshape(self.tnet_deriv, [-1, self.nloc, self.nnei, 4]),
+                sel_index,
+                axis=2,
+            ),
+            [-1, self.nloc * tf.size(sel_index) * 4],
+        )
+
+    def test_trim(self):
+        tem_deriv_trim, trij_trim, tnlist_trim, tsel_index = self._trim()
+        (
+            dem_deriv,
+            drij,
+            dnlist,
+            dem_deriv_trim,
+            drij_trim,
+            dnlist_trim,
+            dsel_index,
+        ) = self.sess.run(
+            [
+                self.tem_deriv,
+                self.trij,
+                self.tnlist,
+                tem_deriv_trim,
+                trij_trim,
+                tnlist_trim,
+                tsel_index,
+            ],
+            feed_dict=self.feed_dict,
+        )
+        # each section keeps its largest occupancy over the batch
+        dnlist = np.reshape(dnlist, [-1, self.nnei])
+        expected_sel_index = []
+        for ii in range(len(self.sel)):
+            nocc = np.max(np.sum(dnlist[:, self.sec[ii] : self.sec[ii + 1]] >= 0, 1))
+            expected_sel_index += list(range(self.sec[ii], self.sec[ii] + nocc))
+        np.testing.assert_equal(dsel_index, expected_sel_index)
+        self.assertLess(len(dsel_index), self.nnei)
+        # the dropped slots are padding
+        dropped = np.setdiff1d(np.arange(self.nnei), dsel_index)
+        np.testing.assert_equal(dnlist[:, dropped], -1)
+        np.testing.assert_equal(
+            np.reshape(dem_deriv, [-1, self.nnei, 12])[:, dropped], 0.0
+        )
+        np.testing.assert_equal(np.reshape(drij, [-1, self.nnei, 3])[:, dropped], 0.0)
+        # the kept slots are gathered
+        nnei_trim = len(dsel_index)
+        self.assertEqual(
+            dem_deriv_trim.shape, (self.nframes, self.nloc * nnei_trim * 12)
+        )
+        self.assertEqual(drij_trim.shape, (self.nframes, self.nloc * nnei_trim * 3))
+        self.assertEqual(dnlist_trim.shape, (self.nframes, self.nloc * nnei_trim))
+        np.testing.assert_equal(
+            np.reshape(dem_deriv_trim, [-1, nnei_trim, 12]),
+            np.reshape(dem_deriv, [-1, self.nnei, 12])[:, dsel_index],
+        )
+        np.testing.assert_equal(
+            np.reshape(drij_trim, [-1, nnei_trim, 3]),
+            np.reshape(drij, [-1, self.nnei, 3])[:, dsel_index],
+        )
+        np.testing.assert_equal(
+            np.reshape(dnlist_trim, [-1, nnei_trim]), dnlist[:, dsel_index]
+        )
+
+    def _force_virial(self, net_deriv, em_deriv, rij, nlist):
+        force = op_module.prod_force_se_a(
+            net_deriv,
+            em_deriv,
+            nlist,
+            self.tnatoms,
+            n_a_sel=self.nnei,
+            n_r_sel=0,
+        )
+        virial, atom_virial = op_module.prod_virial_se_a(
+            net_deriv,
+            em_deriv,
+            rij,
+            nlist,
+            self.tnatoms,
+            n_a_sel=self.nnei,
+            n_r_sel=0,
+        )
+        return force, virial, atom_virial
+
+    def test_force_virial(self):
+        tem_deriv_trim, trij_trim, tnlist_trim, tsel_index = self._trim()
+        tnet_deriv_trim = self._trim_net_deriv(tsel_index)
+        tout = self._force_virial(
+            self.tnet_deriv, self.tem_deriv, self.trij, self.tnlist
+        )
+        tout_trim = self._force_virial(
+            tnet_deriv_trim, tem_deriv_trim, trij_trim, tnlist_trim
+        )
+        # the grad ops of the trimmed layout have nnei < n_a_sel + n_r_sel
+        tgrad = [
+            tf.gradients(tf.reduce_sum(tt * tf.sin(tt)), self.tnet_deriv)[0]
+            for tt in tout
+        ]
+        tgrad_trim = [
+            tf.gradients(tf.reduce_sum(tt * tf.sin(tt)), self.tnet_deriv)[0]
+            for tt in tout_trim
+        ]
+        dout, dout_trim, dgrad, dgrad_trim = self.sess.run(
+            [tout, tout_trim, tgrad, tgrad_trim], feed_dict=self.feed_dict
+        )
+        for ii in range(len(dout)):
+            np.testing.assert_almost_equal(dout_trim[ii], dout[ii], 10)
+            np.testing.assert_almost_equal(dgrad_trim[ii], dgrad[ii], 10)